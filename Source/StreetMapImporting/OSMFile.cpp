@@ -2,10 +2,236 @@
 
 #include "StreetMapImporting.h"
 #include "OSMFile.h"
+#include "OSMXmlStreamReader.h"
+#include "OSMPbfReader.h"
+#include "Algo/BinarySearch.h"
+
+
+namespace OSMFileTags
+{
+	/** Tag keys that we're interested in */
+	enum class EOSMTagKey : uint8
+	{
+		Unknown,
+		Name,
+		Ref,
+		Height,
+		BuildingLevels,
+		OneWay,
+
+		/** Any key that appears in the WayTypeTags table */
+		WayType,
+	};
+
+	struct FOSMTagKeyEntry
+	{
+		const TCHAR* Key;
+		EOSMTagKey TagKey;
+	};
+
+	/** Maps tag keys to what they mean to us.  Keys that decide the type of a way are added automatically from the WayTypeTags table. */
+	static const FOSMTagKeyEntry TagKeys[] =
+	{
+		{ TEXT( "name" ), EOSMTagKey::Name },
+		{ TEXT( "ref" ), EOSMTagKey::Ref },
+		{ TEXT( "height" ), EOSMTagKey::Height },
+		{ TEXT( "building:levels" ), EOSMTagKey::BuildingLevels },
+		{ TEXT( "oneway" ), EOSMTagKey::OneWay },
+	};
+
+	struct FOSMWayTypeTag
+	{
+		const TCHAR* Key;
+
+		/** Value of the tag, or nullptr to match any value for this key */
+		const TCHAR* Value;
+
+		FOSMFile::EOSMWayType WayType;
+	};
+
+	/**
+	 * Maps tags to the type of way they describe.  To support a new type of way, just add it here.  When a way has a tag
+	 * whose key is listed here but whose value isn't, the way's type is set to "Other".
+	 */
+	static const FOSMWayTypeTag WayTypeTags[] =
+	{
+		// Roads.  See http://wiki.openstreetmap.org/wiki/Key:highway
+		{ TEXT( "highway" ), TEXT( "motorway" ), FOSMFile::EOSMWayType::Motorway },
+		{ TEXT( "highway" ), TEXT( "motorway_link" ), FOSMFile::EOSMWayType::Motorway_Link },
+		{ TEXT( "highway" ), TEXT( "trunk" ), FOSMFile::EOSMWayType::Trunk },
+		{ TEXT( "highway" ), TEXT( "trunk_link" ), FOSMFile::EOSMWayType::Trunk_Link },
+		{ TEXT( "highway" ), TEXT( "primary" ), FOSMFile::EOSMWayType::Primary },
+		{ TEXT( "highway" ), TEXT( "primary_link" ), FOSMFile::EOSMWayType::Primary_Link },
+		{ TEXT( "highway" ), TEXT( "secondary" ), FOSMFile::EOSMWayType::Secondary },
+		{ TEXT( "highway" ), TEXT( "secondary_link" ), FOSMFile::EOSMWayType::Secondary_Link },
+		{ TEXT( "highway" ), TEXT( "tertiary" ), FOSMFile::EOSMWayType::Tertiary },
+		{ TEXT( "highway" ), TEXT( "tertiary_link" ), FOSMFile::EOSMWayType::Tertiary_Link },
+		{ TEXT( "highway" ), TEXT( "residential" ), FOSMFile::EOSMWayType::Residential },
+		{ TEXT( "highway" ), TEXT( "service" ), FOSMFile::EOSMWayType::Service },
+		{ TEXT( "highway" ), TEXT( "unclassified" ), FOSMFile::EOSMWayType::Unclassified },
+		{ TEXT( "highway" ), TEXT( "living_street" ), FOSMFile::EOSMWayType::Living_Street },
+		{ TEXT( "highway" ), TEXT( "pedestrian" ), FOSMFile::EOSMWayType::Pedestrian },
+		{ TEXT( "highway" ), TEXT( "track" ), FOSMFile::EOSMWayType::Track },
+		{ TEXT( "highway" ), TEXT( "bus_guideway" ), FOSMFile::EOSMWayType::Bus_Guideway },
+		{ TEXT( "highway" ), TEXT( "raceway" ), FOSMFile::EOSMWayType::Raceway },
+		{ TEXT( "highway" ), TEXT( "road" ), FOSMFile::EOSMWayType::Road },
+		{ TEXT( "highway" ), TEXT( "footway" ), FOSMFile::EOSMWayType::Footway },
+		{ TEXT( "highway" ), TEXT( "cycleway" ), FOSMFile::EOSMWayType::Cycleway },
+		{ TEXT( "highway" ), TEXT( "bridleway" ), FOSMFile::EOSMWayType::Bridleway },
+		{ TEXT( "highway" ), TEXT( "steps" ), FOSMFile::EOSMWayType::Steps },
+		{ TEXT( "highway" ), TEXT( "path" ), FOSMFile::EOSMWayType::Path },
+		{ TEXT( "highway" ), TEXT( "proposed" ), FOSMFile::EOSMWayType::Proposed },
+		{ TEXT( "highway" ), TEXT( "construction" ), FOSMFile::EOSMWayType::Construction },
+
+		// Buildings.  We don't distinguish between types of buildings yet.  See http://wiki.openstreetmap.org/wiki/Key:building
+		{ TEXT( "building" ), nullptr, FOSMFile::EOSMWayType::Building },
+	};
+
+
+	/**
+	 * Open addressing hash tables for the tag keys and way type tags, so that classifying a tag costs a hash of its key and
+	 * value plus (almost always) a single string comparison, instead of a string comparison against every known value.
+	 * Tags are case insensitive, just like the Stricmp comparisons they replace.
+	 */
+	class FTagLookupTable
+	{
+
+	public:
+
+		/** Fills in the tables from TagKeys and WayTypeTags */
+		FTagLookupTable()
+		{
+			FMemory::Memzero( KeySlots );
+			FMemory::Memzero( KeySlotHashes );
+			FMemory::Memzero( WayTypeSlots );
+			FMemory::Memzero( WayTypeSlotHashes );
+
+			for( const FOSMTagKeyEntry& Entry : TagKeys )
+			{
+				AddKey( Entry );
+			}
+
+			for( const FOSMWayTypeTag& Entry : WayTypeTags )
+			{
+				const uint32 KeyHash = HashString( Entry.Key );
+				if( FindKey( Entry.Key, KeyHash ) == EOSMTagKey::Unknown )
+				{
+					AddKey( FOSMTagKeyEntry{ Entry.Key, EOSMTagKey::WayType } );
+				}
+				check( FindKey( Entry.Key, KeyHash ) == EOSMTagKey::WayType );
+
+				const uint32 Hash = Entry.Value != nullptr ? HashCombine( KeyHash, HashString( Entry.Value ) ) : KeyHash;
+				uint32 SlotIndex = Hash & SlotMask;
+				while( WayTypeSlots[ SlotIndex ] != nullptr )
+				{
+					SlotIndex = ( SlotIndex + 1 ) & SlotMask;
+				}
+				WayTypeSlots[ SlotIndex ] = &Entry;
+				WayTypeSlotHashes[ SlotIndex ] = Hash;
+			}
+		}
+
+		/** Case insensitive FNV-1a hash of a tag string */
+		static uint32 HashString( const TCHAR* String )
+		{
+			uint32 Hash = 2166136261u;
+			for( ; *String != 0; ++String )
+			{
+				Hash = ( Hash ^ (uint32)FChar::ToLower( *String ) ) * 16777619u;
+			}
+			return Hash;
+		}
+
+		/** Figures out what a tag key means to us */
+		EOSMTagKey FindKey( const TCHAR* Key, const uint32 KeyHash ) const
+		{
+			for( uint32 SlotIndex = KeyHash & SlotMask; KeySlots[ SlotIndex ].Key != nullptr; SlotIndex = ( SlotIndex + 1 ) & SlotMask )
+			{
+				const FOSMTagKeyEntry& Slot = KeySlots[ SlotIndex ];
+				if( KeySlotHashes[ SlotIndex ] == KeyHash && !FCString::Stricmp( Slot.Key, Key ) )
+				{
+					return Slot.TagKey;
+				}
+			}
+			return EOSMTagKey::Unknown;
+		}
+
+		/** Figures out the type of way that a tag describes.  The key must be a way type key. */
+		FOSMFile::EOSMWayType FindWayType( const TCHAR* Key, const uint32 KeyHash, const TCHAR* Value ) const
+		{
+			const FOSMWayTypeTag* Found = FindWayTypeTag( Key, HashCombine( KeyHash, HashString( Value ) ), Value );
+			if( Found == nullptr )
+			{
+				// Maybe there is an entry for any value of this key
+				Found = FindWayTypeTag( Key, KeyHash, nullptr );
+			}
+			return Found != nullptr ? Found->WayType : FOSMFile::EOSMWayType::Other;
+		}
+
+
+	private:
+
+		void AddKey( const FOSMTagKeyEntry& Entry )
+		{
+			const uint32 KeyHash = HashString( Entry.Key );
+			uint32 SlotIndex = KeyHash & SlotMask;
+			while( KeySlots[ SlotIndex ].Key != nullptr )
+			{
+				SlotIndex = ( SlotIndex + 1 ) & SlotMask;
+			}
+			KeySlots[ SlotIndex ] = Entry;
+			KeySlotHashes[ SlotIndex ] = KeyHash;
+		}
+
+		const FOSMWayTypeTag* FindWayTypeTag( const TCHAR* Key, const uint32 Hash, const TCHAR* Value ) const
+		{
+			for( uint32 SlotIndex = Hash & SlotMask; WayTypeSlots[ SlotIndex ] != nullptr; SlotIndex = ( SlotIndex + 1 ) & SlotMask )
+			{
+				const FOSMWayTypeTag& Slot = *WayTypeSlots[ SlotIndex ];
+				if( WayTypeSlotHashes[ SlotIndex ] == Hash &&
+					!FCString::Stricmp( Slot.Key, Key ) &&
+					( Slot.Value == nullptr ? Value == nullptr : ( Value != nullptr && !FCString::Stricmp( Slot.Value, Value ) ) ) )
+				{
+					return &Slot;
+				}
+			}
+			return nullptr;
+		}
+
+		/** Number of slots in each table.  Must be a power of two, and comfortably larger than the number of entries. */
+		static const uint32 NumSlots = 256;
+		static const uint32 SlotMask = NumSlots - 1;
+		static_assert( ARRAY_COUNT( TagKeys ) + ARRAY_COUNT( WayTypeTags ) < NumSlots / 2, "Tag lookup tables are too full, increase NumSlots" );
+
+		FOSMTagKeyEntry KeySlots[ NumSlots ];
+		uint32 KeySlotHashes[ NumSlots ];
+
+		const FOSMWayTypeTag* WayTypeSlots[ NumSlots ];
+		uint32 WayTypeSlotHashes[ NumSlots ];
+	};
+
+	/**
+	 * The lookup table, built once when the module is loaded rather than on first use, so that classifying a tag doesn't have
+	 * to check whether it has been built yet.  TagKeys and WayTypeTags are constant initialized, so they are ready before it.
+	 */
+	static const FTagLookupTable TagLookupTable;
+}
+
 
 
 FOSMFile::FOSMFile()
-	: ParsingState( ParsingState::Root )
+	: ParsingState( ParsingState::Root ),
+	  CurrentNodeID( 0 ),
+	  CurrentNodeLatitude( 0.0 ),
+	  CurrentNodeLongitude( 0.0 ),
+	  CurrentWayInfo( nullptr ),
+	  bWasCanceled( false ),
+	  bNodeIDsAreSorted( true ),
+	  bSortedNodeIndicesAreStale( false ),
+	  LastFoundNodeIndex( INDEX_NONE ),
+	  LoadPass( ELoadPass::Load ),
+	  NumCompactedReferencedNodeIDs( 0 ),
+	  NextReferencedNodeIDIndex( 0 )
 {
 }
 		
@@ -19,55 +245,426 @@ FOSMFile::~FOSMFile()
 			delete Way;
 		}
 		Ways.Empty();
-				
-		for( auto HashPair : NodeMap )
-		{
-			FOSMNodeInfo* NodeInfo = HashPair.Value;
-			delete NodeInfo;
-		}
-		NodeMap.Empty();
+
+		delete CurrentWayInfo;
+		CurrentWayInfo = nullptr;
 	}
 }
 
 
-bool FOSMFile::LoadOpenStreetMapFile( FString& OSMFilePath, const bool bIsFilePathActuallyTextBuffer, FFeedbackContext* FeedbackContext )
+bool FOSMFile::LoadOpenStreetMapFile( const FString& OSMFilePath, const FWayFilter& InWayFilter, FFeedbackContext* FeedbackContext )
 {
-	const bool bShowSlowTaskDialog = true;
-	const bool bShowCancelButton = true;
-
 	FText ErrorMessage;
-	int32 ErrorLineNumber;
-	if( FFastXml::ParseXmlFile( 
-		this, 
-		bIsFilePathActuallyTextBuffer ? nullptr : *OSMFilePath, 
-		bIsFilePathActuallyTextBuffer ? OSMFilePath.GetCharArray().GetData() : nullptr, 
-		FeedbackContext, 
-		bShowSlowTaskDialog, 
-		bShowCancelButton, 
-		/* Out */ ErrorMessage, 
-		/* Out */ ErrorLineNumber ) )
+	int32 ErrorLineNumber = 0;
+
+	// Binary (protobuf) files are usually named "*.osm.pbf"
+	const bool bIsPbfFile = FPaths::GetExtension( OSMFilePath ).Equals( TEXT( "pbf" ), ESearchCase::IgnoreCase );
+
+	WayFilter = InWayFilter;
+
+	bool bLoadedOkay = true;
+	if( WayFilter )
+	{
+		// First pass: Find out which nodes are used by the ways we're keeping
+		LoadPass = ELoadPass::ScanWays;
+		bLoadedOkay = ParseFile( OSMFilePath, bIsPbfFile, FeedbackContext, /* Out */ ErrorMessage, /* Out */ ErrorLineNumber );
+
+		CompactReferencedNodeIDs();
+		ScannedWayNodeIDs.Empty();
+		ReferencedNodeIDs.Shrink();
+		LoadPass = ELoadPass::Load;
+	}
+
+	if( bLoadedOkay )
+	{
+		bLoadedOkay = ParseFile( OSMFilePath, bIsPbfFile, FeedbackContext, /* Out */ ErrorMessage, /* Out */ ErrorLineNumber );
+	}
+
+	ReferencedNodeIDs.Empty();
+	WayFilter = nullptr;
+
+	if( bLoadedOkay )
 	{
-		if( NodeMap.Num() > 0 )
+		ResolvePendingWayNodeRefs();
+
+		if( NodeIDs.Num() > 0 )
 		{
-			AverageLatitude /= NodeMap.Num();
-			AverageLongitude /= NodeMap.Num();
+			AverageLatitude /= NodeIDs.Num();
+			AverageLongitude /= NodeIDs.Num();
 		}
 
+		// Lookups are finished, so we don't need the sorted index anymore
+		SortedNodeIndices.Empty();
+
+		BuildNodeWayRefs();
+
 		return true;
 	}
 
-	if( FeedbackContext != nullptr )
+	// The ways are incomplete, so their nodes won't be looked up
+	PendingWayNodeRefs.Empty();
+
+	if( FeedbackContext != nullptr && !bWasCanceled )
 	{
-		FeedbackContext->Logf(
-			ELogVerbosity::Error,
-			TEXT( "Failed to load OpenStreetMap XML file ('%s', Line %i)" ),
-			*ErrorMessage.ToString(),
-			ErrorLineNumber );
+		if( bIsPbfFile )
+		{
+			FeedbackContext->Logf(
+				ELogVerbosity::Error,
+				TEXT( "Failed to load OpenStreetMap PBF file ('%s')" ),
+				*ErrorMessage.ToString() );
+		}
+		else
+		{
+			FeedbackContext->Logf(
+				ELogVerbosity::Error,
+				TEXT( "Failed to load OpenStreetMap XML file ('%s', Line %i)" ),
+				*ErrorMessage.ToString(),
+				ErrorLineNumber );
+		}
 	}
 
 	return false;
 }
 
+
+bool FOSMFile::ParseFile( const FString& OSMFilePath, const bool bIsPbfFile, FFeedbackContext* FeedbackContext, FText& OutErrorMessage, int32& OutErrorLineNumber )
+{
+	ParsingState = ParsingState::Root;
+
+	return bIsPbfFile ?
+		FOSMPbfReader::ParseFile( OSMFilePath, *this, FeedbackContext, /* Out */ OutErrorMessage, /* Out */ bWasCanceled ) :
+		FOSMXmlStreamReader::ParseFile( OSMFilePath, this, FeedbackContext, /* Out */ OutErrorMessage, /* Out */ OutErrorLineNumber, /* Out */ bWasCanceled );
+}
+
+
+void FOSMFile::AddNode( const int64 NodeID, const double Latitude, const double Longitude )
+{
+	if( LoadPass == ELoadPass::ScanWays )
+	{
+		// We don't know which nodes we need until all ways have been scanned
+		return;
+	}
+
+	if( WayFilter && !IsNodeReferenced( NodeID ) )
+	{
+		// None of the ways we're keeping use this node, so don't waste memory on it
+		return;
+	}
+
+	if( NodeIDs.Num() > 0 && NodeID <= NodeIDs.Last() )
+	{
+		bNodeIDsAreSorted = false;
+	}
+	bSortedNodeIndicesAreStale = true;
+
+	NodeIDs.Add( NodeID );
+	NodeLatitudes.Add( Latitude );
+	NodeLongitudes.Add( Longitude );
+
+	AverageLatitude += Latitude;
+	AverageLongitude += Longitude;
+
+	// Update minimum and maximum latitude and longitude
+	// @todo: Performance: Instead of computing our own bounding box, we could parse the "minlat" and
+	//        "minlon" tags from the OSM file
+	if( Latitude < MinLatitude )
+	{
+		MinLatitude = Latitude;
+	}
+	if( Latitude > MaxLatitude )
+	{
+		MaxLatitude = Latitude;
+	}
+	if( Longitude < MinLongitude )
+	{
+		MinLongitude = Longitude;
+	}
+	if( Longitude > MaxLongitude )
+	{
+		MaxLongitude = Longitude;
+	}
+}
+
+
+int32 FOSMFile::FindNodeIndex( const int64 NodeID )
+{
+	const int32 NumNodes = NodeIDs.Num();
+
+	// Ways tend to reference nodes that were stored right next to each other
+	if( LastFoundNodeIndex != INDEX_NONE && LastFoundNodeIndex + 1 < NumNodes && NodeIDs[ LastFoundNodeIndex + 1 ] == NodeID )
+	{
+		return ++LastFoundNodeIndex;
+	}
+
+	int32 FoundNodeIndex = INDEX_NONE;
+	if( bNodeIDsAreSorted )
+	{
+		const int32 LowerBound = Algo::LowerBound( NodeIDs, NodeID );
+		if( LowerBound < NumNodes && NodeIDs[ LowerBound ] == NodeID )
+		{
+			FoundNodeIndex = LowerBound;
+		}
+	}
+	else
+	{
+		if( bSortedNodeIndicesAreStale )
+		{
+			SortedNodeIndices.SetNumUninitialized( NumNodes );
+			for( int32 NodeIndex = 0; NodeIndex < NumNodes; ++NodeIndex )
+			{
+				SortedNodeIndices[ NodeIndex ] = NodeIndex;
+			}
+
+			const TArray<int64>& IDs = NodeIDs;
+			SortedNodeIndices.Sort( [&IDs]( const int32 A, const int32 B ) { return IDs[ A ] < IDs[ B ]; } );
+			bSortedNodeIndicesAreStale = false;
+		}
+
+		const TArray<int64>& IDs = NodeIDs;
+		const int32 LowerBound = Algo::LowerBoundBy( SortedNodeIndices, NodeID, [&IDs]( const int32 NodeIndex ) { return IDs[ NodeIndex ]; } );
+		if( LowerBound < NumNodes && NodeIDs[ SortedNodeIndices[ LowerBound ] ] == NodeID )
+		{
+			FoundNodeIndex = SortedNodeIndices[ LowerBound ];
+		}
+	}
+
+	if( FoundNodeIndex != INDEX_NONE )
+	{
+		LastFoundNodeIndex = FoundNodeIndex;
+	}
+	return FoundNodeIndex;
+}
+
+
+FOSMFile::FOSMWayInfo* FOSMFile::BeginWay()
+{
+	FOSMWayInfo* WayInfo = new FOSMWayInfo();
+	WayInfo->WayType = EOSMWayType::Other;
+	WayInfo->Height = 0.0;
+	WayInfo->BuildingLevels = 0;
+	WayInfo->bIsOneWay = false;
+
+	// @todo: We're currently ignoring the "visible" tag on ways, which means that roads will always
+	//        be included in our data set.  It might be nice to make this an import option.
+
+	return WayInfo;
+}
+
+
+void FOSMFile::AddWayNodeRef( FOSMWayInfo& Way, const int64 NodeID )
+{
+	if( LoadPass == ELoadPass::ScanWays )
+	{
+		// Nodes haven't been loaded yet, so just remember the ID until we know whether the way will be kept
+		ScannedWayNodeIDs.Add( NodeID );
+		return;
+	}
+
+	// Nodes are almost always sorted, and come before the ways that use them, so the node can usually be found right away
+	const int32 ReferencedNodeIndex = bNodeIDsAreSorted ? FindNodeIndex( NodeID ) : INDEX_NONE;
+	if( ReferencedNodeIndex == INDEX_NONE )
+	{
+		// Either the node hasn't been read yet (or isn't in the file at all), or the nodes aren't sorted and can't be
+		// searched until they have all been read.  Leave a gap for it, and fill it in at the end.
+		PendingWayNodeRefs.Add( FPendingWayNodeRef{ &Way, Way.Nodes.Num(), NodeID } );
+	}
+
+	// NOTE: The node's list of way refs is filled in later on by BuildNodeWayRefs(), so that we don't need a separate
+	//       allocation for every node
+	Way.Nodes.Add( ReferencedNodeIndex );
+}
+
+
+void FOSMFile::ApplyWayTag( FOSMWayInfo& Way, const TCHAR* Key, const TCHAR* Value )
+{
+	const OSMFileTags::FTagLookupTable& LookupTable = OSMFileTags::TagLookupTable;
+
+	const uint32 KeyHash = OSMFileTags::FTagLookupTable::HashString( Key );
+	switch( LookupTable.FindKey( Key, KeyHash ) )
+	{
+		case OSMFileTags::EOSMTagKey::Name:
+			Way.Name = Value;
+			break;
+
+		case OSMFileTags::EOSMTagKey::Ref:
+			Way.Ref = Value;
+			break;
+
+		case OSMFileTags::EOSMTagKey::WayType:
+		{
+			// Types we don't recognize yet are left as "Other".  See http://wiki.openstreetmap.org/wiki/Key:highway and
+			// http://wiki.openstreetmap.org/wiki/Key:building
+			Way.WayType = LookupTable.FindWayType( Key, KeyHash, Value );
+		}
+		break;
+
+		case OSMFileTags::EOSMTagKey::Height:
+		{
+			// Check to see if there is a space character in the height value.  For now, we're looking
+			// for straight-up floating point values.
+			if( FCString::Strchr( Value, TEXT( ' ' ) ) == nullptr )
+			{
+				// Okay, no space character.  So this has got to be a floating point number.  The OSM
+				// spec says that the height values are in meters.
+				Way.Height = FPlatformString::Atod( Value );
+			}
+			else
+			{
+				// Looks like the height value contains units of some sort.
+				// @todo: Add support for interpreting unit strings and converting the values
+			}
+		}
+		break;
+
+		case OSMFileTags::EOSMTagKey::BuildingLevels:
+			Way.BuildingLevels = FPlatformString::Atoi( Value );
+			break;
+
+		case OSMFileTags::EOSMTagKey::OneWay:
+			Way.bIsOneWay = !FCString::Stricmp( Value, TEXT( "yes" ) );
+			break;
+
+		case OSMFileTags::EOSMTagKey::Unknown:
+			// Don't care about this tag
+			break;
+	}
+}
+
+
+void FOSMFile::FinishWay( FOSMWayInfo* Way )
+{
+	if( LoadPass == ELoadPass::ScanWays )
+	{
+		if( WayFilter( *Way ) )
+		{
+			ReferencedNodeIDs.Append( ScannedWayNodeIDs );
+
+			// Most nodes are shared by a couple of ways, so squeeze out the duplicates every so often to keep memory use down
+			if( ReferencedNodeIDs.Num() > FMath::Max( NumCompactedReferencedNodeIDs * 2, 1024 * 1024 ) )
+			{
+				CompactReferencedNodeIDs();
+			}
+		}
+		ScannedWayNodeIDs.Reset();
+
+		// We only needed the way for its node IDs and tags.  It will be loaded again in the next pass.
+		delete Way;
+	}
+	else if( WayFilter && !WayFilter( *Way ) )
+	{
+		// Forget about any of the way's nodes we were still going to look up.  They're the last ones added.
+		while( PendingWayNodeRefs.Num() > 0 && PendingWayNodeRefs.Last().Way == Way )
+		{
+			PendingWayNodeRefs.Pop( /* bAllowShrinking */ false );
+		}
+
+		delete Way;
+	}
+	else
+	{
+		Ways.Add( Way );
+	}
+}
+
+
+void FOSMFile::ResolvePendingWayNodeRefs()
+{
+	// Every node has been read now, so this sorts the node index (if it's needed at all) just once
+	FOSMWayInfo* LastWay = nullptr;
+	for( const FPendingWayNodeRef& PendingRef : PendingWayNodeRefs )
+	{
+		PendingRef.Way->Nodes[ PendingRef.WayNodeIndex ] = FindNodeIndex( PendingRef.NodeID );
+
+		// Nodes that still can't be found aren't in the file.  This happens with extracts that were clipped to a bounding box.
+		if( LastWay != nullptr && LastWay != PendingRef.Way )
+		{
+			LastWay->Nodes.Remove( INDEX_NONE );
+		}
+		LastWay = PendingRef.Way;
+	}
+	if( LastWay != nullptr )
+	{
+		LastWay->Nodes.Remove( INDEX_NONE );
+	}
+
+	PendingWayNodeRefs.Empty();
+}
+
+
+void FOSMFile::CompactReferencedNodeIDs()
+{
+	ReferencedNodeIDs.Sort();
+
+	int32 NumUniqueNodeIDs = 0;
+	for( int32 NodeIDIndex = 0; NodeIDIndex < ReferencedNodeIDs.Num(); ++NodeIDIndex )
+	{
+		if( NumUniqueNodeIDs == 0 || ReferencedNodeIDs[ NodeIDIndex ] != ReferencedNodeIDs[ NumUniqueNodeIDs - 1 ] )
+		{
+			ReferencedNodeIDs[ NumUniqueNodeIDs++ ] = ReferencedNodeIDs[ NodeIDIndex ];
+		}
+	}
+	ReferencedNodeIDs.SetNum( NumUniqueNodeIDs, /* bAllowShrinking */ false );
+
+	NumCompactedReferencedNodeIDs = NumUniqueNodeIDs;
+	NextReferencedNodeIDIndex = 0;
+}
+
+
+bool FOSMFile::IsNodeReferenced( const int64 NodeID )
+{
+	const int32 NumReferencedNodeIDs = ReferencedNodeIDs.Num();
+
+	// Nodes are usually stored in ID order, so we'll almost always find the node right where the last one left off
+	if( NextReferencedNodeIDIndex >= NumReferencedNodeIDs || ReferencedNodeIDs[ NextReferencedNodeIDIndex ] != NodeID )
+	{
+		NextReferencedNodeIDIndex = Algo::LowerBound( ReferencedNodeIDs, NodeID );
+		if( NextReferencedNodeIDIndex >= NumReferencedNodeIDs || ReferencedNodeIDs[ NextReferencedNodeIDIndex ] != NodeID )
+		{
+			return false;
+		}
+	}
+
+	++NextReferencedNodeIDIndex;
+	return true;
+}
+
+
+void FOSMFile::BuildNodeWayRefs()
+{
+	const int32 NumNodes = NodeIDs.Num();
+
+	// Count the refs for each node, then turn the counts into start offsets
+	NodeWayRefStarts.Reset();
+	NodeWayRefStarts.AddZeroed( NumNodes + 1 );
+	for( const FOSMWayInfo* Way : Ways )
+	{
+		for( const int32 NodeIndex : Way->Nodes )
+		{
+			++NodeWayRefStarts[ NodeIndex + 1 ];
+		}
+	}
+	for( int32 NodeIndex = 0; NodeIndex < NumNodes; ++NodeIndex )
+	{
+		NodeWayRefStarts[ NodeIndex + 1 ] += NodeWayRefStarts[ NodeIndex ];
+	}
+
+	// Fill in the refs, in the same order that the ways were loaded
+	TArray<int32> NextRefForNode;
+	NextRefForNode.Append( NodeWayRefStarts.GetData(), NumNodes );
+
+	NodeWayRefs.SetNumUninitialized( NodeWayRefStarts[ NumNodes ] );
+	for( int32 WayIndex = 0; WayIndex < Ways.Num(); ++WayIndex )
+	{
+		const FOSMWayInfo* Way = Ways[ WayIndex ];
+		for( int32 WayNodeIndex = 0; WayNodeIndex < Way->Nodes.Num(); ++WayNodeIndex )
+		{
+			FOSMWayRef& WayRef = NodeWayRefs[ NextRefForNode[ Way->Nodes[ WayNodeIndex ] ]++ ];
+			WayRef.WayIndex = WayIndex;
+			WayRef.NodeIndex = WayNodeIndex;
+		}
+	}
+}
+
 		
 bool FOSMFile::ProcessXmlDeclaration( const TCHAR* ElementData, int32 XmlFileLineNumber )
 {
@@ -90,22 +687,14 @@ bool FOSMFile::ProcessElement( const TCHAR* ElementName, const TCHAR* ElementDat
 		if( !FCString::Stricmp( ElementName, TEXT( "node" ) ) )
 		{
 			ParsingState = ParsingState::Node;
-			CurrentNodeInfo = new FOSMNodeInfo();
-			CurrentNodeInfo->Latitude = 0.0;
-			CurrentNodeInfo->Longitude = 0.0;
+			CurrentNodeID = 0;
+			CurrentNodeLatitude = 0.0;
+			CurrentNodeLongitude = 0.0;
 		}
 		else if( !FCString::Stricmp( ElementName, TEXT( "way" ) ) )
 		{
 			ParsingState = ParsingState::Way;
-			CurrentWayInfo = new FOSMWayInfo();
-			CurrentWayInfo->Name.Empty();
-			CurrentWayInfo->Ref.Empty();
-			CurrentWayInfo->WayType = EOSMWayType::Other;
-			CurrentWayInfo->Height = 0.0;
-			CurrentWayInfo->bIsOneWay = false;
-
-			// @todo: We're currently ignoring the "visible" tag on ways, which means that roads will always
-			//        be included in our data set.  It might be nice to make this an import option.
+			CurrentWayInfo = BeginWay();
 		}
 	}
 	else if( ParsingState == ParsingState::Way )
@@ -134,37 +723,11 @@ bool FOSMFile::ProcessAttribute( const TCHAR* AttributeName, const TCHAR* Attrib
 		}
 		else if( !FCString::Stricmp( AttributeName, TEXT( "lat" ) ) )
 		{
-			CurrentNodeInfo->Latitude = FPlatformString::Atod( AttributeValue );
-
-			AverageLatitude += CurrentNodeInfo->Latitude;
-					
-			// Update minimum and maximum latitude
-			// @todo: Performance: Instead of computing our own bounding box, we could parse the "minlat" and
-			//        "minlon" tags from the OSM file
-			if( CurrentNodeInfo->Latitude < MinLatitude )
-			{
-				MinLatitude = CurrentNodeInfo->Latitude;
-			}
-			if( CurrentNodeInfo->Latitude > MaxLatitude )
-			{
-				MaxLatitude = CurrentNodeInfo->Latitude;
-			}
+			CurrentNodeLatitude = FPlatformString::Atod( AttributeValue );
 		}
 		else if( !FCString::Stricmp( AttributeName, TEXT( "lon" ) ) )
 		{
-			CurrentNodeInfo->Longitude = FPlatformString::Atod( AttributeValue );
-
-			AverageLongitude += CurrentNodeInfo->Longitude;
-					
-			// Update minimum and maximum longitude
-			if( CurrentNodeInfo->Longitude < MinLongitude )
-			{
-				MinLongitude = CurrentNodeInfo->Longitude;
-			}
-			if( CurrentNodeInfo->Longitude > MaxLongitude )
-			{
-				MaxLongitude = CurrentNodeInfo->Longitude;
-			}
+			CurrentNodeLongitude = FPlatformString::Atod( AttributeValue );
 		}
 	}
 	else if( ParsingState == ParsingState::Way )
@@ -175,17 +738,7 @@ bool FOSMFile::ProcessAttribute( const TCHAR* AttributeName, const TCHAR* Attrib
 	{
 		if( !FCString::Stricmp( AttributeName, TEXT( "ref" ) ) )
 		{
-			FOSMNodeInfo* ReferencedNode = NodeMap.FindRef( FPlatformString::Atoi64( AttributeValue ) );
-			const int NewNodeIndex = CurrentWayInfo->Nodes.Num();
-			CurrentWayInfo->Nodes.Add( ReferencedNode );
-					
-			// Update the node with information about the way that is referencing it
-			{
-				FOSMWayRef NewWayRef;
-				NewWayRef.Way = CurrentWayInfo;
-				NewWayRef.NodeIndex = NewNodeIndex;
-				ReferencedNode->WayRefs.Add( NewWayRef );
-			}
+			AddWayNodeRef( *CurrentWayInfo, FPlatformString::Atoi64( AttributeValue ) );
 		}
 	}
 	else if( ParsingState == ParsingState::Way_Tag )
@@ -196,174 +749,7 @@ bool FOSMFile::ProcessAttribute( const TCHAR* AttributeName, const TCHAR* Attrib
 		}
 		else if( !FCString::Stricmp( AttributeName, TEXT( "v" ) ) )
 		{
-			if( !FCString::Stricmp( CurrentWayTagKey, TEXT( "name" ) ) )
-			{
-				CurrentWayInfo->Name = AttributeValue;
-			}
-			else if( !FCString::Stricmp( CurrentWayTagKey, TEXT( "ref" ) ) )
-			{
-				CurrentWayInfo->Ref = AttributeValue;
-			}
-			else if( !FCString::Stricmp( CurrentWayTagKey, TEXT( "highway" ) ) )
-			{
-				EOSMWayType WayType = EOSMWayType::Other;
-						
-				if( !FCString::Stricmp( AttributeValue, TEXT( "motorway" ) ) )
-				{
-					WayType = EOSMWayType::Motorway;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "motorway_link" ) ) )
-				{
-					WayType = EOSMWayType::Motorway_Link;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "trunk" ) ) )
-				{
-					WayType = EOSMWayType::Trunk;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "trunk_link" ) ) )
-				{
-					WayType = EOSMWayType::Trunk_Link;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "primary" ) ) )
-				{
-					WayType = EOSMWayType::Primary;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "primary_link" ) ) )
-				{
-					WayType = EOSMWayType::Primary_Link;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "secondary" ) ) )
-				{
-					WayType = EOSMWayType::Secondary;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "secondary_link" ) ) )
-				{
-					WayType = EOSMWayType::Secondary_Link;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "tertiary" ) ) )
-				{
-					WayType = EOSMWayType::Tertiary;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "tertiary_link" ) ) )
-				{
-					WayType = EOSMWayType::Tertiary_Link;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "residential" ) ) )
-				{
-					WayType = EOSMWayType::Residential;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "service" ) ) )
-				{
-					WayType = EOSMWayType::Service;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "unclassified" ) ) )
-				{
-					WayType = EOSMWayType::Unclassified;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "living_street" ) ) )
-				{
-					WayType = EOSMWayType::Living_Street;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "pedestrian" ) ) )
-				{
-					WayType = EOSMWayType::Pedestrian;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "track" ) ) )
-				{
-					WayType = EOSMWayType::Track;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "bus_guideway" ) ) )
-				{
-					WayType = EOSMWayType::Bus_Guideway;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "raceway" ) ) )
-				{
-					WayType = EOSMWayType::Raceway;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "road" ) ) )
-				{
-					WayType = EOSMWayType::Road;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "footway" ) ) )
-				{
-					WayType = EOSMWayType::Footway;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "cycleway" ) ) )
-				{
-					WayType = EOSMWayType::Cycleway;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "bridleway" ) ) )
-				{
-					WayType = EOSMWayType::Bridleway;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "steps" ) ) )
-				{
-					WayType = EOSMWayType::Steps;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "path" ) ) )
-				{
-					WayType = EOSMWayType::Path;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "proposed" ) ) )
-				{
-					WayType = EOSMWayType::Proposed;
-				}
-				else if( !FCString::Stricmp( AttributeValue, TEXT( "construction" ) ) )
-				{
-					WayType = EOSMWayType::Construction;
-				}
-				else
-				{
-					// Other type that we don't recognize yet.  See http://wiki.openstreetmap.org/wiki/Key:highway
-				}
-						
-						
-				CurrentWayInfo->WayType = WayType;
-			}
-			else if( !FCString::Stricmp( CurrentWayTagKey, TEXT( "building" ) ) )
-			{
-				CurrentWayInfo->WayType = EOSMWayType::Building;
-
-				if( !FCString::Stricmp( AttributeValue, TEXT( "yes" ) ) )
-				{
-					CurrentWayInfo->WayType = EOSMWayType::Building;
-				}
-				else
-				{
-					// Other type that we don't recognize yet.  See http://wiki.openstreetmap.org/wiki/Key:building
-				}
-			}
-			else if( !FCString::Stricmp( CurrentWayTagKey, TEXT( "height" ) ) )
-			{
-				// Check to see if there is a space character in the height value.  For now, we're looking
-				// for straight-up floating point values.
-				if( !FString( AttributeValue ).Contains( TEXT( " " ) ) )
-				{
-					// Okay, no space character.  So this has got to be a floating point number.  The OSM
-					// spec says that the height values are in meters.
-					CurrentWayInfo->Height = FPlatformString::Atod( AttributeValue );
-				}
-				else
-				{
-					// Looks like the height value contains units of some sort.
-					// @todo: Add support for interpreting unit strings and converting the values
-				}
-			}
-			else if (!FCString::Stricmp(CurrentWayTagKey, TEXT("building:levels")))
-			{
-				CurrentWayInfo->BuildingLevels = FPlatformString::Atoi(AttributeValue);
-			}
-			else if( !FCString::Stricmp( CurrentWayTagKey, TEXT( "oneway" ) ) )
-			{
-				if( !FCString::Stricmp( AttributeValue, TEXT( "yes" ) ) )
-				{
-					CurrentWayInfo->bIsOneWay = true;
-				}
-				else
-				{
-					CurrentWayInfo->bIsOneWay = false;
-				}
-			}
+			ApplyWayTag( *CurrentWayInfo, *CurrentWayTagKey, AttributeValue );
 		}
 	}
 
@@ -375,15 +761,14 @@ bool FOSMFile::ProcessClose( const TCHAR* Element )
 {
 	if( ParsingState == ParsingState::Node )
 	{
-		NodeMap.Add( CurrentNodeID, CurrentNodeInfo );
+		AddNode( CurrentNodeID, CurrentNodeLatitude, CurrentNodeLongitude );
 		CurrentNodeID = 0;
-		CurrentNodeInfo = nullptr;
 				
 		ParsingState = ParsingState::Root;
 	}
 	else if( ParsingState == ParsingState::Way )
 	{
-		Ways.Add( CurrentWayInfo );
+		FinishWay( CurrentWayInfo );
 		CurrentWayInfo = nullptr;
 				
 		ParsingState = ParsingState::Root;
@@ -394,7 +779,7 @@ bool FOSMFile::ProcessClose( const TCHAR* Element )
 	}
 	else if( ParsingState == ParsingState::Way_Tag )
 	{
-		CurrentWayTagKey = TEXT( "" );
+		CurrentWayTagKey.Reset();
 		ParsingState = ParsingState::Way;
 	}
 
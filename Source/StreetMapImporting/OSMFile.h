@@ -2,6 +2,7 @@
 #pragma once
 
 #include "FastXml.h"
+#include "Templates/Function.h"
 
 
 /** OpenStreetMap file loader */
@@ -16,11 +17,26 @@ public:
 	/** Destructor for FOSMFile */
 	virtual ~FOSMFile();
 
-	/** Loads the map from an OpenStreetMap XML file.  Note that in the case of the file path containing the XML data, the string must be mutable for us to parse it quickly. */
-	bool LoadOpenStreetMapFile( FString& OSMFilePath, const bool bIsFilePathActuallyTextBuffer, class FFeedbackContext* FeedbackContext );
+	struct FOSMWayInfo;
 
+	/** Decides whether a way should be kept.  Ways that are rejected are discarded as soon as they have been parsed. */
+	typedef TFunction<bool( const FOSMWayInfo& Way )> FWayFilter;
+
+	/**
+	 * Loads the map from an OpenStreetMap XML (.osm) or PBF (.osm.pbf) file.  The file is streamed from disk, so it is never held in memory all at once.
+	 *
+	 * If a way filter is supplied, the file is read twice.  The first pass only looks at ways, and collects the IDs of the nodes
+	 * that the kept ways reference.  The second pass then only stores those nodes, and discards all rejected ways, which greatly
+	 * reduces peak memory use for files with many points of interest, address points and unsupported ways.
+	 */
+	bool LoadOpenStreetMapFile( const FString& OSMFilePath, const FWayFilter& WayFilter, class FFeedbackContext* FeedbackContext );
+
+	/** Returns true if the last load failed because the user canceled it */
+	bool WasCanceled() const
+	{
+		return bWasCanceled;
+	}
 
-	struct FOSMWayInfo;
 		
 	/** Types of ways */
 	enum class EOSMWayType
@@ -142,27 +158,22 @@ public:
 
 	struct FOSMWayRef
 	{
-		// Way that we're referencing at this node
-		FOSMWayInfo* Way;
+		// Index of the way that we're referencing at this node (into the Ways array)
+		int32 WayIndex;
 			
 		// Index of the node in the way's array of nodes
 		int32 NodeIndex;
 	};
 		
 		
-	struct FOSMNodeInfo
-	{
-		double Latitude;
-		double Longitude;
-		TArray<FOSMWayRef> WayRefs;
-	};
-		
-		
 	struct FOSMWayInfo
 	{
 		FString Name;
 		FString Ref;
-		TArray<FOSMNodeInfo*> Nodes;
+
+		// Indices of the nodes on this way (into the NodeIDs/NodeLatitudes/NodeLongitudes arrays)
+		TArray<int32> Nodes;
+
 		EOSMWayType WayType;
 		double Height;
 		int32 BuildingLevels;
@@ -184,8 +195,49 @@ public:
 	// All ways we've parsed
 	TArray<FOSMWayInfo*> Ways;
 		
-	// Maps node IDs to info about each node
-	TMap<int64, FOSMNodeInfo*> NodeMap;
+	// All nodes we've parsed, stored as parallel arrays so that each node costs a few bytes and no allocations.  A node's
+	// index into these arrays never changes once it has been added.
+	TArray<int64> NodeIDs;
+	TArray<double> NodeLatitudes;
+	TArray<double> NodeLongitudes;
+
+	// The ways that reference each node, in compressed sparse row form.  The refs for node N are stored in NodeWayRefs,
+	// starting at NodeWayRefStarts[ N ] and ending before NodeWayRefStarts[ N + 1 ].  Built after all ways are loaded.
+	TArray<int32> NodeWayRefStarts;
+	TArray<FOSMWayRef> NodeWayRefs;
+
+	/** Returns the number of nodes */
+	int32 GetNodeCount() const
+	{
+		return NodeIDs.Num();
+	}
+
+	/** Returns the index of the node with the specified ID, or INDEX_NONE if there is no such node */
+	int32 FindNodeIndex( const int64 NodeID );
+
+
+	///
+	/// Building the data set.  The XML and PBF readers call these as they parse nodes and ways.
+	///
+
+	/** Adds a node with the specified ID and coordinates */
+	void AddNode( const int64 NodeID, const double Latitude, const double Longitude );
+
+	/** Creates a new, empty way.  Fill it in with AddWayNodeRef() and ApplyWayTag(), then pass it to FinishWay() */
+	FOSMWayInfo* BeginWay();
+
+	/**
+	 * Appends a reference to a node to the way's list of nodes.  Nodes that haven't been added yet, and all nodes in files
+	 * whose nodes aren't sorted by ID, are looked up once the whole file has been read.  References to nodes that aren't in
+	 * the file are then dropped.
+	 */
+	void AddWayNodeRef( FOSMWayInfo& Way, const int64 NodeID );
+
+	/** Applies a key/value tag to a way, filling in its type, name, height, etc. */
+	void ApplyWayTag( FOSMWayInfo& Way, const TCHAR* Key, const TCHAR* Value );
+
+	/** Adds a way that was created with BeginWay() to our list of ways, taking ownership of it */
+	void FinishWay( FOSMWayInfo* Way );
 
 protected:
 
@@ -214,14 +266,86 @@ protected:
 	// ID of node that is currently being parsed
 	int64 CurrentNodeID;
 		
-	// Node that is currently being parsed
-	FOSMNodeInfo* CurrentNodeInfo;
+	// Coordinates of the node that is currently being parsed
+	double CurrentNodeLatitude;
+	double CurrentNodeLongitude;
 		
 	// Way that is currently being parsed
 	FOSMWayInfo* CurrentWayInfo;
+
+	/** Reads the whole file once, sending its nodes and ways to AddNode(), AddWayNodeRef(), etc. */
+	bool ParseFile( const FString& OSMFilePath, const bool bIsPbfFile, class FFeedbackContext* FeedbackContext, FText& OutErrorMessage, int32& OutErrorLineNumber );
+
+	// True if the user canceled the load
+	bool bWasCanceled;
+
+	/** Looks up the nodes that ways referenced before they could be found, and drops references to nodes that aren't in the file */
+	void ResolvePendingWayNodeRefs();
+
+	/** Builds the NodeWayRefs table from the nodes listed on each way */
+	void BuildNodeWayRefs();
+
+	/** Sorts the referenced node IDs and removes duplicates */
+	void CompactReferencedNodeIDs();
+
+	/** Returns true if the node with the specified ID is referenced by a kept way.  Only valid after the way scanning pass. */
+	bool IsNodeReferenced( const int64 NodeID );
+
+	enum class ELoadPass
+	{
+		/** Storing every node and way (single pass load), or every referenced node and kept way (second pass) */
+		Load,
+
+		/** Only scanning ways for the nodes they reference (first pass) */
+		ScanWays,
+	};
+
+	// Which pass over the file we're currently in
+	ELoadPass LoadPass;
+
+	// Filter for ways that we want to keep, if any
+	FWayFilter WayFilter;
+
+	// IDs of the nodes that are referenced by kept ways.  Sorted and free of duplicates after the way scanning pass.
+	TArray<int64> ReferencedNodeIDs;
+
+	// Number of entries in ReferencedNodeIDs after it was last compacted
+	int32 NumCompactedReferencedNodeIDs;
+
+	// Position in ReferencedNodeIDs where we expect to find the next node.  Nodes are usually sorted by ID, just like the referenced IDs.
+	int32 NextReferencedNodeIDIndex;
+
+	// IDs of the nodes on the way that is currently being scanned
+	TArray<int64> ScannedWayNodeIDs;
+
+	// True if the node IDs were added in increasing order, so that the NodeIDs array can be binary searched directly.
+	// OpenStreetMap files are almost always sorted by ID.
+	bool bNodeIDsAreSorted;
+
+	// Indices of all nodes, sorted by node ID.  Only used for files whose nodes aren't sorted, and only built once all
+	// nodes have been read.
+	TArray<int32> SortedNodeIndices;
+	bool bSortedNodeIndicesAreStale;
+
+	/** A node reference on a way that couldn't be looked up when the way was read */
+	struct FPendingWayNodeRef
+	{
+		// The way, and where in its list of nodes the reference goes
+		FOSMWayInfo* Way;
+		int32 WayNodeIndex;
+
+		int64 NodeID;
+	};
+
+	// Node references waiting to be looked up, in the order they were read.  Looking them up as they come in would mean
+	// sorting every node again whenever nodes and ways are interleaved in a file whose nodes aren't sorted.
+	TArray<FPendingWayNodeRef> PendingWayNodeRefs;
+
+	// Index of the node found by the last lookup.  Ways usually reference nodes that are next to each other in the file.
+	int32 LastFoundNodeIndex;
 		
-	// Current way's tag key string
-	const TCHAR* CurrentWayTagKey;
+	// Current way's tag key string.  This is copied because attribute strings are only valid during the callback.
+	FString CurrentWayTagKey;
 };
 
 
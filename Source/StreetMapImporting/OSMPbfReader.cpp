@@ -0,0 +1,761 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapImporting.h"
+#include "OSMPbfReader.h"
+#include "OSMFile.h"
+#include "Async/ParallelFor.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/Compression.h"
+#include "Misc/ScopedSlowTask.h"
+
+
+#define LOCTEXT_NAMESPACE "StreetMapImporting"
+
+
+// Limits from the PBF specification
+static const int32 PbfMaxBlobHeaderSize = 64 * 1024;
+static const int32 PbfMaxBlobSize = 32 * 1024 * 1024;
+
+// Maximum number of compressed bytes we'll hold in memory before decoding a batch of blobs
+static const int64 PbfMaxBatchBytes = 64 * 1024 * 1024;
+
+
+/** Minimal reader for protocol buffer messages.  Supports the wire types used by the OSM PBF format. */
+struct FPbfMessageReader
+{
+	const uint8* Cursor;
+	const uint8* End;
+	bool bIsValid;
+
+	FPbfMessageReader( const uint8* InData, const int64 InSize )
+		: Cursor( InData ),
+		  End( InData + InSize ),
+		  bIsValid( InData != nullptr || InSize == 0 )
+	{
+	}
+
+	/** Reads a field key.  Returns false at the end of the message, or if the message is malformed. */
+	bool ReadKey( uint32& OutFieldNumber, uint32& OutWireType )
+	{
+		if( !bIsValid || Cursor >= End )
+		{
+			return false;
+		}
+
+		const uint64 Key = ReadVarint();
+		OutFieldNumber = (uint32)( Key >> 3 );
+		OutWireType = (uint32)( Key & 7 );
+		return bIsValid;
+	}
+
+	uint64 ReadVarint()
+	{
+		uint64 Result = 0;
+		for( int32 Shift = 0; Shift < 64; Shift += 7 )
+		{
+			if( Cursor >= End )
+			{
+				break;
+			}
+
+			const uint8 Byte = *Cursor++;
+			Result |= uint64( Byte & 0x7F ) << Shift;
+			if( ( Byte & 0x80 ) == 0 )
+			{
+				return Result;
+			}
+		}
+
+		bIsValid = false;
+		return 0;
+	}
+
+	/** Reads a zig-zag encoded varint (sint32/sint64) */
+	int64 ReadSignedVarint()
+	{
+		const uint64 Value = ReadVarint();
+		return (int64)( Value >> 1 ) ^ -(int64)( Value & 1 );
+	}
+
+	/** Reads a length delimited field (bytes, string, embedded message or packed array) as a reader over its contents */
+	FPbfMessageReader ReadLengthDelimited()
+	{
+		const uint64 Length = ReadVarint();
+		if( !bIsValid || Length > uint64( End - Cursor ) )
+		{
+			bIsValid = false;
+			FPbfMessageReader Invalid( nullptr, 0 );
+			Invalid.bIsValid = false;
+			return Invalid;
+		}
+
+		FPbfMessageReader Contents( Cursor, (int64)Length );
+		Cursor += Length;
+		return Contents;
+	}
+
+	void SkipField( const uint32 WireType )
+	{
+		switch( WireType )
+		{
+			case 0:
+				ReadVarint();
+				break;
+
+			case 1:
+				SkipBytes( 8 );
+				break;
+
+			case 2:
+				ReadLengthDelimited();
+				break;
+
+			case 5:
+				SkipBytes( 4 );
+				break;
+
+			default:
+				bIsValid = false;
+				break;
+		}
+	}
+
+	void SkipBytes( const int64 Count )
+	{
+		if( Count > End - Cursor )
+		{
+			bIsValid = false;
+			Cursor = End;
+		}
+		else
+		{
+			Cursor += Count;
+		}
+	}
+
+	int64 Size() const
+	{
+		return End - Cursor;
+	}
+};
+
+
+/** Reads a repeated zig-zag encoded integer field, which may be either packed or not */
+static void ReadRepeatedSignedVarints( FPbfMessageReader& Message, const uint32 WireType, TArray<int64>& OutValues )
+{
+	if( WireType == 2 )
+	{
+		FPbfMessageReader Packed = Message.ReadLengthDelimited();
+		while( Packed.bIsValid && Packed.Cursor < Packed.End )
+		{
+			OutValues.Add( Packed.ReadSignedVarint() );
+		}
+		Message.bIsValid &= Packed.bIsValid;
+	}
+	else
+	{
+		OutValues.Add( Message.ReadSignedVarint() );
+	}
+}
+
+
+/** Reads a repeated unsigned integer field, which may be either packed or not */
+static void ReadRepeatedVarints( FPbfMessageReader& Message, const uint32 WireType, TArray<uint32>& OutValues )
+{
+	if( WireType == 2 )
+	{
+		FPbfMessageReader Packed = Message.ReadLengthDelimited();
+		while( Packed.bIsValid && Packed.Cursor < Packed.End )
+		{
+			OutValues.Add( (uint32)Packed.ReadVarint() );
+		}
+		Message.bIsValid &= Packed.bIsValid;
+	}
+	else
+	{
+		OutValues.Add( (uint32)Message.ReadVarint() );
+	}
+}
+
+
+/** Converts a UTF-8 string from the file to an FString */
+static FString MakeStringFromUTF8( const uint8* Data, const int32 Length )
+{
+	const FUTF8ToTCHAR Converted( (const ANSICHAR*)Data, Length );
+	return FString( Converted.Length(), Converted.Get() );
+}
+
+
+/** A blob read from the file, still compressed */
+struct FPbfBlob
+{
+	/** Byte offset of the blob in the file, for error messages */
+	int64 FileOffset;
+
+	/** Serialized 'Blob' message */
+	TArray<uint8> Data;
+};
+
+
+/** Nodes and ways decoded from a single PrimitiveBlock, ready to be merged into the FOSMFile */
+struct FPbfDecodedBlock
+{
+	TArray<int64> NodeIDs;
+	TArray<double> NodeLatitudes;
+	TArray<double> NodeLongitudes;
+
+	/** Node references of all ways, back to back.  Way N owns references [WayNodeRefStarts[N], WayNodeRefStarts[N + 1]) */
+	TArray<int64> WayNodeRefs;
+	TArray<int32> WayNodeRefStarts;
+
+	/** Tags of all ways as interleaved key/value strings.  Way N owns tags [WayTagStarts[N], WayTagStarts[N + 1]) */
+	TArray<FString> WayTags;
+	TArray<int32> WayTagStarts;
+
+	/** Set if the block couldn't be decoded */
+	FText ErrorMessage;
+};
+
+
+/** A string in a PrimitiveBlock's string table.  Points into the decompressed block data. */
+struct FPbfString
+{
+	const uint8* Data;
+	int32 Length;
+};
+
+
+/** Decompresses a 'Blob' message */
+static bool DecompressBlob( const FPbfBlob& Blob, TArray<uint8>& OutData, FText& OutErrorMessage )
+{
+	FPbfMessageReader Message( Blob.Data.GetData(), Blob.Data.Num() );
+
+	int64 RawSize = -1;
+	FPbfMessageReader RawData( nullptr, 0 );
+	FPbfMessageReader ZlibData( nullptr, 0 );
+	bool bHasRawData = false;
+	bool bHasZlibData = false;
+	bool bHasUnsupportedCompression = false;
+
+	uint32 FieldNumber, WireType;
+	while( Message.ReadKey( FieldNumber, WireType ) )
+	{
+		if( FieldNumber == 1 && WireType == 2 )
+		{
+			RawData = Message.ReadLengthDelimited();
+			bHasRawData = true;
+		}
+		else if( FieldNumber == 2 && WireType == 0 )
+		{
+			RawSize = (int64)Message.ReadVarint();
+		}
+		else if( FieldNumber == 3 && WireType == 2 )
+		{
+			ZlibData = Message.ReadLengthDelimited();
+			bHasZlibData = true;
+		}
+		else
+		{
+			// LZMA, LZ4, ZSTD, etc. are rarely used in practice
+			bHasUnsupportedCompression |= ( FieldNumber >= 4 && FieldNumber <= 7 );
+			Message.SkipField( WireType );
+		}
+	}
+
+	if( !Message.bIsValid )
+	{
+		OutErrorMessage = FText::Format( LOCTEXT( "PbfMalformedBlob", "Malformed blob at offset {0}" ), FText::AsNumber( Blob.FileOffset ) );
+		return false;
+	}
+
+	if( bHasRawData )
+	{
+		OutData.SetNumUninitialized( (int32)RawData.Size() );
+		FMemory::Memcpy( OutData.GetData(), RawData.Cursor, RawData.Size() );
+		return true;
+	}
+
+	if( bHasZlibData )
+	{
+		if( RawSize < 0 || RawSize > PbfMaxBlobSize )
+		{
+			OutErrorMessage = FText::Format( LOCTEXT( "PbfBadRawSize", "Blob at offset {0} has an invalid uncompressed size" ), FText::AsNumber( Blob.FileOffset ) );
+			return false;
+		}
+
+		OutData.SetNumUninitialized( (int32)RawSize );
+		if( !FCompression::UncompressMemory( NAME_Zlib, OutData.GetData(), (int32)RawSize, ZlibData.Cursor, (int32)ZlibData.Size() ) )
+		{
+			OutErrorMessage = FText::Format( LOCTEXT( "PbfDecompressFailed", "Failed to decompress blob at offset {0}" ), FText::AsNumber( Blob.FileOffset ) );
+			return false;
+		}
+		return true;
+	}
+
+	OutErrorMessage = bHasUnsupportedCompression ?
+		FText::Format( LOCTEXT( "PbfUnsupportedCompression", "Blob at offset {0} uses an unsupported compression method.  Only zlib is supported." ), FText::AsNumber( Blob.FileOffset ) ) :
+		FText::Format( LOCTEXT( "PbfEmptyBlob", "Blob at offset {0} has no data" ), FText::AsNumber( Blob.FileOffset ) );
+	return false;
+}
+
+
+/** Checks the 'HeaderBlock' for features we don't support */
+static bool DecodeHeaderBlob( const FPbfBlob& Blob, FText& OutErrorMessage )
+{
+	TArray<uint8> Data;
+	if( !DecompressBlob( Blob, Data, OutErrorMessage ) )
+	{
+		return false;
+	}
+
+	FPbfMessageReader Message( Data.GetData(), Data.Num() );
+	uint32 FieldNumber, WireType;
+	while( Message.ReadKey( FieldNumber, WireType ) )
+	{
+		if( FieldNumber == 4 && WireType == 2 )
+		{
+			// required_features
+			const FPbfMessageReader Feature = Message.ReadLengthDelimited();
+			const FString FeatureName = MakeStringFromUTF8( Feature.Cursor, (int32)Feature.Size() );
+			if( FeatureName != TEXT( "OsmSchema-V0.6" ) && FeatureName != TEXT( "DenseNodes" ) )
+			{
+				OutErrorMessage = FText::Format( LOCTEXT( "PbfUnsupportedFeature", "File requires unsupported feature '{0}'" ), FText::FromString( FeatureName ) );
+				return false;
+			}
+		}
+		else
+		{
+			Message.SkipField( WireType );
+		}
+	}
+
+	if( !Message.bIsValid )
+	{
+		OutErrorMessage = LOCTEXT( "PbfMalformedHeader", "Malformed header block" );
+		return false;
+	}
+
+	return true;
+}
+
+
+/** Decodes a 'PrimitiveBlock' into nodes and ways.  Runs on worker threads. */
+static void DecodeDataBlob( const FPbfBlob& Blob, FPbfDecodedBlock& OutBlock )
+{
+	TArray<uint8> Data;
+	if( !DecompressBlob( Blob, Data, OutBlock.ErrorMessage ) )
+	{
+		return;
+	}
+
+	TArray<FPbfString> StringTable;
+	TArray<FPbfMessageReader, TInlineAllocator<4>> Groups;
+	int64 Granularity = 100;
+	int64 LatitudeOffset = 0;
+	int64 LongitudeOffset = 0;
+
+	FPbfMessageReader Block( Data.GetData(), Data.Num() );
+	uint32 FieldNumber, WireType;
+	while( Block.ReadKey( FieldNumber, WireType ) )
+	{
+		if( FieldNumber == 1 && WireType == 2 )
+		{
+			FPbfMessageReader StringTableMessage = Block.ReadLengthDelimited();
+			while( StringTableMessage.ReadKey( FieldNumber, WireType ) )
+			{
+				if( FieldNumber == 1 && WireType == 2 )
+				{
+					const FPbfMessageReader String = StringTableMessage.ReadLengthDelimited();
+					StringTable.Add( FPbfString{ String.Cursor, (int32)String.Size() } );
+				}
+				else
+				{
+					StringTableMessage.SkipField( WireType );
+				}
+			}
+			Block.bIsValid &= StringTableMessage.bIsValid;
+		}
+		else if( FieldNumber == 2 && WireType == 2 )
+		{
+			// Groups may come before the granularity fields, so decode them afterwards
+			Groups.Add( Block.ReadLengthDelimited() );
+		}
+		else if( FieldNumber == 17 && WireType == 0 )
+		{
+			Granularity = (int64)Block.ReadVarint();
+		}
+		else if( FieldNumber == 19 && WireType == 0 )
+		{
+			LatitudeOffset = (int64)Block.ReadVarint();
+		}
+		else if( FieldNumber == 20 && WireType == 0 )
+		{
+			LongitudeOffset = (int64)Block.ReadVarint();
+		}
+		else
+		{
+			Block.SkipField( WireType );
+		}
+	}
+
+	auto ToLatitude = [Granularity, LatitudeOffset]( const int64 Value ) -> double
+	{
+		return 0.000000001 * (double)( LatitudeOffset + Granularity * Value );
+	};
+	auto ToLongitude = [Granularity, LongitudeOffset]( const int64 Value ) -> double
+	{
+		return 0.000000001 * (double)( LongitudeOffset + Granularity * Value );
+	};
+
+	bool bIsValid = Block.bIsValid;
+	TArray<int64> IDs, Latitudes, Longitudes;
+	TArray<uint32> Keys, Values;
+
+	for( FPbfMessageReader& Group : Groups )
+	{
+		while( bIsValid && Group.ReadKey( FieldNumber, WireType ) )
+		{
+			if( FieldNumber == 1 && WireType == 2 )
+			{
+				// Node
+				FPbfMessageReader Node = Group.ReadLengthDelimited();
+				int64 NodeID = 0, Latitude = 0, Longitude = 0;
+				while( Node.ReadKey( FieldNumber, WireType ) )
+				{
+					if( FieldNumber == 1 && WireType == 0 )
+					{
+						NodeID = Node.ReadSignedVarint();
+					}
+					else if( FieldNumber == 8 && WireType == 0 )
+					{
+						Latitude = Node.ReadSignedVarint();
+					}
+					else if( FieldNumber == 9 && WireType == 0 )
+					{
+						Longitude = Node.ReadSignedVarint();
+					}
+					else
+					{
+						Node.SkipField( WireType );
+					}
+				}
+				bIsValid &= Node.bIsValid;
+
+				OutBlock.NodeIDs.Add( NodeID );
+				OutBlock.NodeLatitudes.Add( ToLatitude( Latitude ) );
+				OutBlock.NodeLongitudes.Add( ToLongitude( Longitude ) );
+			}
+			else if( FieldNumber == 2 && WireType == 2 )
+			{
+				// DenseNodes.  IDs and coordinates are delta coded against the previous node.
+				FPbfMessageReader DenseNodes = Group.ReadLengthDelimited();
+				IDs.Reset();
+				Latitudes.Reset();
+				Longitudes.Reset();
+				while( DenseNodes.ReadKey( FieldNumber, WireType ) )
+				{
+					if( FieldNumber == 1 )
+					{
+						ReadRepeatedSignedVarints( DenseNodes, WireType, IDs );
+					}
+					else if( FieldNumber == 8 )
+					{
+						ReadRepeatedSignedVarints( DenseNodes, WireType, Latitudes );
+					}
+					else if( FieldNumber == 9 )
+					{
+						ReadRepeatedSignedVarints( DenseNodes, WireType, Longitudes );
+					}
+					else
+					{
+						DenseNodes.SkipField( WireType );
+					}
+				}
+				bIsValid &= DenseNodes.bIsValid && IDs.Num() == Latitudes.Num() && IDs.Num() == Longitudes.Num();
+
+				if( bIsValid )
+				{
+					const int32 FirstNode = OutBlock.NodeIDs.Num();
+					OutBlock.NodeIDs.AddUninitialized( IDs.Num() );
+					OutBlock.NodeLatitudes.AddUninitialized( IDs.Num() );
+					OutBlock.NodeLongitudes.AddUninitialized( IDs.Num() );
+
+					int64 NodeID = 0, Latitude = 0, Longitude = 0;
+					for( int32 DenseIndex = 0; DenseIndex < IDs.Num(); ++DenseIndex )
+					{
+						NodeID += IDs[ DenseIndex ];
+						Latitude += Latitudes[ DenseIndex ];
+						Longitude += Longitudes[ DenseIndex ];
+
+						OutBlock.NodeIDs[ FirstNode + DenseIndex ] = NodeID;
+						OutBlock.NodeLatitudes[ FirstNode + DenseIndex ] = ToLatitude( Latitude );
+						OutBlock.NodeLongitudes[ FirstNode + DenseIndex ] = ToLongitude( Longitude );
+					}
+				}
+			}
+			else if( FieldNumber == 3 && WireType == 2 )
+			{
+				// Way.  Node references are delta coded.
+				FPbfMessageReader Way = Group.ReadLengthDelimited();
+				IDs.Reset();
+				Keys.Reset();
+				Values.Reset();
+				while( Way.ReadKey( FieldNumber, WireType ) )
+				{
+					if( FieldNumber == 2 )
+					{
+						ReadRepeatedVarints( Way, WireType, Keys );
+					}
+					else if( FieldNumber == 3 )
+					{
+						ReadRepeatedVarints( Way, WireType, Values );
+					}
+					else if( FieldNumber == 8 )
+					{
+						ReadRepeatedSignedVarints( Way, WireType, IDs );
+					}
+					else
+					{
+						Way.SkipField( WireType );
+					}
+				}
+				bIsValid &= Way.bIsValid && Keys.Num() == Values.Num();
+
+				if( bIsValid )
+				{
+					OutBlock.WayNodeRefStarts.Add( OutBlock.WayNodeRefs.Num() );
+					int64 NodeRef = 0;
+					for( const int64 Delta : IDs )
+					{
+						NodeRef += Delta;
+						OutBlock.WayNodeRefs.Add( NodeRef );
+					}
+
+					OutBlock.WayTagStarts.Add( OutBlock.WayTags.Num() );
+					for( int32 TagIndex = 0; TagIndex < Keys.Num(); ++TagIndex )
+					{
+						if( !StringTable.IsValidIndex( Keys[ TagIndex ] ) || !StringTable.IsValidIndex( Values[ TagIndex ] ) )
+						{
+							bIsValid = false;
+							break;
+						}
+
+						const FPbfString& Key = StringTable[ Keys[ TagIndex ] ];
+						const FPbfString& Value = StringTable[ Values[ TagIndex ] ];
+						OutBlock.WayTags.Add( MakeStringFromUTF8( Key.Data, Key.Length ) );
+						OutBlock.WayTags.Add( MakeStringFromUTF8( Value.Data, Value.Length ) );
+					}
+				}
+			}
+			else
+			{
+				// Relations and changesets aren't used
+				Group.SkipField( WireType );
+			}
+		}
+		bIsValid &= Group.bIsValid;
+	}
+
+	// Terminate the per-way ranges
+	OutBlock.WayNodeRefStarts.Add( OutBlock.WayNodeRefs.Num() );
+	OutBlock.WayTagStarts.Add( OutBlock.WayTags.Num() );
+
+	if( !bIsValid )
+	{
+		OutBlock.ErrorMessage = FText::Format( LOCTEXT( "PbfMalformedBlock", "Malformed data block at offset {0}" ), FText::AsNumber( Blob.FileOffset ) );
+	}
+}
+
+
+/** Adds the decoded nodes and ways to the OSM file.  Must be called for each block in file order, because ways can only reference nodes that were already added. */
+static void MergeDecodedBlock( const FPbfDecodedBlock& Block, FOSMFile& OSMFile )
+{
+	for( int32 NodeIndex = 0; NodeIndex < Block.NodeIDs.Num(); ++NodeIndex )
+	{
+		OSMFile.AddNode( Block.NodeIDs[ NodeIndex ], Block.NodeLatitudes[ NodeIndex ], Block.NodeLongitudes[ NodeIndex ] );
+	}
+
+	const int32 NumWays = Block.WayNodeRefStarts.Num() - 1;
+	for( int32 WayIndex = 0; WayIndex < NumWays; ++WayIndex )
+	{
+		FOSMFile::FOSMWayInfo* Way = OSMFile.BeginWay();
+
+		for( int32 RefIndex = Block.WayNodeRefStarts[ WayIndex ]; RefIndex < Block.WayNodeRefStarts[ WayIndex + 1 ]; ++RefIndex )
+		{
+			OSMFile.AddWayNodeRef( *Way, Block.WayNodeRefs[ RefIndex ] );
+		}
+
+		for( int32 TagIndex = Block.WayTagStarts[ WayIndex ]; TagIndex < Block.WayTagStarts[ WayIndex + 1 ]; TagIndex += 2 )
+		{
+			OSMFile.ApplyWayTag( *Way, *Block.WayTags[ TagIndex ], *Block.WayTags[ TagIndex + 1 ] );
+		}
+
+		OSMFile.FinishWay( Way );
+	}
+}
+
+
+bool FOSMPbfReader::ParseFile( const FString& FilePath, FOSMFile& OSMFile, FFeedbackContext* FeedbackContext, FText& OutErrorMessage, bool& bOutWasCanceled )
+{
+	OutErrorMessage = FText::GetEmpty();
+	bOutWasCanceled = false;
+
+	TUniquePtr<IFileHandle> FileHandle( FPlatformFileManager::Get().GetPlatformFile().OpenRead( *FilePath ) );
+	if( !FileHandle.IsValid() )
+	{
+		OutErrorMessage = FText::Format( LOCTEXT( "PbfCouldNotOpen", "Unable to open file '{0}'" ), FText::FromString( FilePath ) );
+		return false;
+	}
+
+	const int64 FileSize = FileHandle->Size();
+
+	const bool bShowCancelButton = true;
+	FScopedSlowTask SlowTask( (float)FileSize, LOCTEXT( "PbfParsing", "Parsing OpenStreetMap PBF" ), true, FeedbackContext != nullptr ? *FeedbackContext : *GWarn );
+	SlowTask.MakeDialog( bShowCancelButton );
+
+	TArray<FPbfBlob> Batch;
+	int64 BatchBytes = 0;
+	const int32 MaxBatchBlobs = FMath::Max( 8, FPlatformMisc::NumberOfCoresIncludingHyperthreads() * 4 );
+
+	// Decodes all of the blobs in the batch in parallel, then merges the results in file order
+	auto ProcessBatch = [&Batch, &BatchBytes, &OSMFile, &OutErrorMessage]() -> bool
+	{
+		TArray<FPbfDecodedBlock> DecodedBlocks;
+		DecodedBlocks.SetNum( Batch.Num() );
+
+		ParallelFor( Batch.Num(), [&Batch, &DecodedBlocks]( int32 BlobIndex )
+		{
+			DecodeDataBlob( Batch[ BlobIndex ], DecodedBlocks[ BlobIndex ] );
+		} );
+
+		Batch.Reset();
+		BatchBytes = 0;
+
+		for( const FPbfDecodedBlock& DecodedBlock : DecodedBlocks )
+		{
+			if( !DecodedBlock.ErrorMessage.IsEmpty() )
+			{
+				OutErrorMessage = DecodedBlock.ErrorMessage;
+				return false;
+			}
+
+			MergeDecodedBlock( DecodedBlock, OSMFile );
+		}
+
+		return true;
+	};
+
+	int64 FileOffset = 0;
+	TArray<uint8> BlobHeaderData;
+	while( FileOffset < FileSize )
+	{
+		if( SlowTask.ShouldCancel() )
+		{
+			OutErrorMessage = LOCTEXT( "PbfCanceled", "Import was canceled" );
+			bOutWasCanceled = true;
+			return false;
+		}
+
+		const int64 BlobOffset = FileOffset;
+
+		// Each blob is preceded by the size of its header, as a big endian 32-bit integer
+		uint8 HeaderSizeBytes[ 4 ];
+		if( FileSize - FileOffset < 4 || !FileHandle->Read( HeaderSizeBytes, 4 ) )
+		{
+			OutErrorMessage = LOCTEXT( "PbfTruncated", "File is truncated" );
+			return false;
+		}
+		const int32 HeaderSize = ( HeaderSizeBytes[ 0 ] << 24 ) | ( HeaderSizeBytes[ 1 ] << 16 ) | ( HeaderSizeBytes[ 2 ] << 8 ) | HeaderSizeBytes[ 3 ];
+		FileOffset += 4;
+
+		if( HeaderSize <= 0 || HeaderSize > PbfMaxBlobHeaderSize || FileSize - FileOffset < HeaderSize )
+		{
+			OutErrorMessage = FText::Format( LOCTEXT( "PbfBadHeaderSize", "Invalid blob header size at offset {0}" ), FText::AsNumber( BlobOffset ) );
+			return false;
+		}
+
+		BlobHeaderData.SetNumUninitialized( HeaderSize );
+		if( !FileHandle->Read( BlobHeaderData.GetData(), HeaderSize ) )
+		{
+			OutErrorMessage = LOCTEXT( "PbfReadFailed", "Failed to read from file" );
+			return false;
+		}
+		FileOffset += HeaderSize;
+
+		// BlobHeader: type (1) and datasize (3)
+		FString BlobType;
+		int64 BlobSize = -1;
+		{
+			FPbfMessageReader BlobHeader( BlobHeaderData.GetData(), BlobHeaderData.Num() );
+			uint32 FieldNumber, WireType;
+			while( BlobHeader.ReadKey( FieldNumber, WireType ) )
+			{
+				if( FieldNumber == 1 && WireType == 2 )
+				{
+					const FPbfMessageReader Type = BlobHeader.ReadLengthDelimited();
+					BlobType = MakeStringFromUTF8( Type.Cursor, (int32)Type.Size() );
+				}
+				else if( FieldNumber == 3 && WireType == 0 )
+				{
+					BlobSize = (int64)BlobHeader.ReadVarint();
+				}
+				else
+				{
+					BlobHeader.SkipField( WireType );
+				}
+			}
+
+			if( !BlobHeader.bIsValid || BlobSize < 0 || BlobSize > PbfMaxBlobSize || FileSize - FileOffset < BlobSize )
+			{
+				OutErrorMessage = FText::Format( LOCTEXT( "PbfBadBlobHeader", "Invalid blob header at offset {0}" ), FText::AsNumber( BlobOffset ) );
+				return false;
+			}
+		}
+
+		if( BlobType == TEXT( "OSMHeader" ) || BlobType == TEXT( "OSMData" ) )
+		{
+			FPbfBlob Blob;
+			Blob.FileOffset = BlobOffset;
+			Blob.Data.SetNumUninitialized( (int32)BlobSize );
+			if( !FileHandle->Read( Blob.Data.GetData(), BlobSize ) )
+			{
+				OutErrorMessage = LOCTEXT( "PbfReadFailed", "Failed to read from file" );
+				return false;
+			}
+
+			if( BlobType == TEXT( "OSMHeader" ) )
+			{
+				if( !DecodeHeaderBlob( Blob, OutErrorMessage ) )
+				{
+					return false;
+				}
+			}
+			else
+			{
+				BatchBytes += BlobSize;
+				Batch.Add( MoveTemp( Blob ) );
+			}
+		}
+		else
+		{
+			// Unknown blob types must be skipped, according to the spec
+			FileHandle->Seek( FileOffset + BlobSize );
+		}
+		FileOffset += BlobSize;
+
+		SlowTask.EnterProgressFrame( (float)( FileOffset - BlobOffset ) );
+
+		if( Batch.Num() >= MaxBatchBlobs || BatchBytes >= PbfMaxBatchBytes )
+		{
+			if( !ProcessBatch() )
+			{
+				return false;
+			}
+		}
+	}
+
+	return ProcessBatch();
+}
+
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,20 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+
+/**
+ * Reader for OpenStreetMap PBF files (*.osm.pbf), the compact binary format most regional extracts are distributed in.
+ * See http://wiki.openstreetmap.org/wiki/PBF_Format
+ *
+ * The file is a sequence of blobs, each holding a zlib-compressed protocol buffer message.  Blobs are read from disk in
+ * batches and decompressed and decoded in parallel, then merged into the FOSMFile in file order.  The protocol buffer
+ * decoding is self-contained, so no external protobuf library is required.
+ */
+class FOSMPbfReader
+{
+
+public:
+
+	/** Parses the PBF file at the specified path, adding all of its nodes and ways to the OSM file.  bOutWasCanceled is set if the user canceled. */
+	static bool ParseFile( const FString& FilePath, class FOSMFile& OSMFile, class FFeedbackContext* FeedbackContext, FText& OutErrorMessage, bool& bOutWasCanceled );
+};
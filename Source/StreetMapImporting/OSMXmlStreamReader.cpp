@@ -0,0 +1,571 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapImporting.h"
+#include "OSMXmlStreamReader.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/ScopedSlowTask.h"
+
+
+#define LOCTEXT_NAMESPACE "StreetMapImporting"
+
+
+// Number of bytes we read from the file at a time.  Tags that straddle a chunk boundary are handled by keeping the
+// unconsumed bytes around and appending the next chunk after them.
+static const int32 OSMXmlReadChunkSize = 4 * 1024 * 1024;
+
+
+static inline bool IsXmlWhitespace( const ANSICHAR Character )
+{
+	return Character == ' ' || Character == '\t' || Character == '\r' || Character == '\n';
+}
+
+
+bool FOSMXmlStreamReader::ParseFile( const FString& FilePath, IFastXmlCallback* Callback, FFeedbackContext* FeedbackContext, FText& OutErrorMessage, int32& OutErrorLineNumber, bool& bOutWasCanceled )
+{
+	check( Callback != nullptr );
+	OutErrorMessage = FText::GetEmpty();
+	OutErrorLineNumber = 0;
+	bOutWasCanceled = false;
+
+	TUniquePtr<IFileHandle> FileHandle( FPlatformFileManager::Get().GetPlatformFile().OpenRead( *FilePath ) );
+	if( !FileHandle.IsValid() )
+	{
+		OutErrorMessage = FText::Format( LOCTEXT( "OSMXmlCouldNotOpen", "Unable to open file '{0}'" ), FText::FromString( FilePath ) );
+		return false;
+	}
+
+	FOSMXmlStreamReader Reader( *FileHandle, *Callback );
+
+	const bool bShowCancelButton = true;
+	FScopedSlowTask SlowTask( (float)Reader.FileSize, LOCTEXT( "OSMXmlParsing", "Parsing OpenStreetMap XML" ), true, FeedbackContext != nullptr ? *FeedbackContext : *GWarn );
+	SlowTask.MakeDialog( bShowCancelButton );
+
+	const bool bParsedOkay = Reader.Parse( SlowTask );
+
+	OutErrorMessage = Reader.ErrorMessage;
+	OutErrorLineNumber = Reader.LineNumber;
+	bOutWasCanceled = Reader.bWasCanceled;
+	return bParsedOkay;
+}
+
+
+FOSMXmlStreamReader::FOSMXmlStreamReader( IFileHandle& InFileHandle, IFastXmlCallback& InCallback )
+	: FileHandle( InFileHandle ),
+	  Callback( InCallback ),
+	  FileSize( InFileHandle.Size() ),
+	  FileBytesRead( 0 ),
+	  BufferPosition( 0 ),
+	  LineNumber( 1 ),
+	  bWasCanceled( false )
+{
+}
+
+
+bool FOSMXmlStreamReader::Parse( FScopedSlowTask& SlowTask )
+{
+	// Skip the UTF-8 byte order mark, if there is one.  We don't support UTF-16 files.
+	while( Buffer.Num() - BufferPosition < 3 && ReadMore( SlowTask ) )
+	{
+	}
+	{
+		const int32 Available = Buffer.Num() - BufferPosition;
+		const uint8* Start = (const uint8*)Buffer.GetData() + BufferPosition;
+		if( Available >= 3 && Start[ 0 ] == 0xEF && Start[ 1 ] == 0xBB && Start[ 2 ] == 0xBF )
+		{
+			BufferPosition += 3;
+		}
+		else if( Available >= 2 && ( ( Start[ 0 ] == 0xFF && Start[ 1 ] == 0xFE ) || ( Start[ 0 ] == 0xFE && Start[ 1 ] == 0xFF ) ) )
+		{
+			SetError( LOCTEXT( "OSMXmlUTF16", "UTF-16 encoded files are not supported.  Please save the file as UTF-8." ) );
+			return false;
+		}
+	}
+
+	for( ;; )
+	{
+		// Skip any text up to the next tag.  OpenStreetMap files don't store anything interesting in element text.
+		const int32 TagStartOffset = FindTerminator( "<", 0, SlowTask );
+		if( TagStartOffset == INDEX_NONE )
+		{
+			break;
+		}
+		CountLines( Buffer.GetData() + BufferPosition, Buffer.GetData() + BufferPosition + TagStartOffset );
+		BufferPosition += TagStartOffset;
+
+		// Make sure we have enough characters to tell what kind of tag this is
+		while( Buffer.Num() - BufferPosition < 9 && ReadMore( SlowTask ) )
+		{
+		}
+		const int32 Available = Buffer.Num() - BufferPosition;
+		const ANSICHAR* TagStart = Buffer.GetData() + BufferPosition;
+
+		if( Available >= 4 && !FCStringAnsi::Strncmp( TagStart, "<!--", 4 ) )
+		{
+			const int32 CommentEndOffset = FindTerminator( "-->", 4, SlowTask );
+			if( CommentEndOffset == INDEX_NONE )
+			{
+				SetError( LOCTEXT( "OSMXmlUnterminatedComment", "Unterminated comment" ) );
+				return false;
+			}
+
+			ANSICHAR* Comment = Buffer.GetData() + BufferPosition;
+			const TCHAR* CommentText = ConvertToTCHAR( Comment + 4, CommentEndOffset - 4, AttributeValueScratch );
+			if( !Callback.ProcessComment( CommentText ) )
+			{
+				SetError( LOCTEXT( "OSMXmlAborted", "Parsing was aborted" ) );
+				return false;
+			}
+
+			CountLines( Comment, Comment + CommentEndOffset + 3 );
+			BufferPosition += CommentEndOffset + 3;
+		}
+		else if( Available >= 9 && !FCStringAnsi::Strncmp( TagStart, "<![CDATA[", 9 ) )
+		{
+			const int32 CDataEndOffset = FindTerminator( "]]>", 9, SlowTask );
+			if( CDataEndOffset == INDEX_NONE )
+			{
+				SetError( LOCTEXT( "OSMXmlUnterminatedCData", "Unterminated CDATA section" ) );
+				return false;
+			}
+
+			CountLines( Buffer.GetData() + BufferPosition, Buffer.GetData() + BufferPosition + CDataEndOffset + 3 );
+			BufferPosition += CDataEndOffset + 3;
+		}
+		else if( Available >= 2 && TagStart[ 1 ] == '?' )
+		{
+			const int32 DeclarationEndOffset = FindTerminator( "?>", 2, SlowTask );
+			if( DeclarationEndOffset == INDEX_NONE )
+			{
+				SetError( LOCTEXT( "OSMXmlUnterminatedDeclaration", "Unterminated XML declaration" ) );
+				return false;
+			}
+
+			ANSICHAR* Declaration = Buffer.GetData() + BufferPosition;
+			if( DeclarationEndOffset >= 5 && !FCStringAnsi::Strnicmp( Declaration, "<?xml", 5 ) )
+			{
+				const TCHAR* DeclarationText = ConvertToTCHAR( Declaration + 5, DeclarationEndOffset - 5, AttributeValueScratch );
+				if( !Callback.ProcessXmlDeclaration( DeclarationText, LineNumber ) )
+				{
+					SetError( LOCTEXT( "OSMXmlAborted", "Parsing was aborted" ) );
+					return false;
+				}
+			}
+
+			CountLines( Declaration, Declaration + DeclarationEndOffset + 2 );
+			BufferPosition += DeclarationEndOffset + 2;
+		}
+		else
+		{
+			// Start, end or DOCTYPE tag.  Attribute values are allowed to contain unescaped '>' characters, so we
+			// need to skip over quoted strings while searching for the end of the tag.
+			int32 TagEndOffset = INDEX_NONE;
+			{
+				ANSICHAR OpenQuote = 0;
+				int32 SearchOffset = 1;
+				while( TagEndOffset == INDEX_NONE )
+				{
+					const ANSICHAR* Search = Buffer.GetData() + BufferPosition;
+					const int32 SearchEnd = Buffer.Num() - BufferPosition;
+					for( ; SearchOffset < SearchEnd; ++SearchOffset )
+					{
+						const ANSICHAR Character = Search[ SearchOffset ];
+						if( OpenQuote != 0 )
+						{
+							if( Character == OpenQuote )
+							{
+								OpenQuote = 0;
+							}
+						}
+						else if( Character == '"' || Character == '\'' )
+						{
+							OpenQuote = Character;
+						}
+						else if( Character == '>' )
+						{
+							TagEndOffset = SearchOffset;
+							break;
+						}
+					}
+
+					if( TagEndOffset == INDEX_NONE && !ReadMore( SlowTask ) )
+					{
+						break;
+					}
+				}
+			}
+
+			if( TagEndOffset == INDEX_NONE )
+			{
+				SetError( LOCTEXT( "OSMXmlUnterminatedTag", "Unterminated tag" ) );
+				return false;
+			}
+
+			ANSICHAR* Tag = Buffer.GetData() + BufferPosition;
+			ANSICHAR* TagEnd = Tag + TagEndOffset;
+			if( Tag[ 1 ] == '/' )
+			{
+				ANSICHAR* NameStart = Tag + 2;
+				ANSICHAR* NameEnd = TagEnd;
+				while( NameEnd > NameStart && IsXmlWhitespace( NameEnd[ -1 ] ) )
+				{
+					--NameEnd;
+				}
+
+				const TCHAR* ElementName = ConvertToTCHAR( NameStart, NameEnd - NameStart, ElementNameScratch );
+				if( !Callback.ProcessClose( ElementName ) )
+				{
+					SetError( LOCTEXT( "OSMXmlAborted", "Parsing was aborted" ) );
+					return false;
+				}
+			}
+			else if( Tag[ 1 ] == '!' )
+			{
+				// DOCTYPE or some other declaration we don't care about
+			}
+			else if( !ParseStartTag( Tag, TagEnd ) )
+			{
+				return false;
+			}
+
+			CountLines( Tag, TagEnd + 1 );
+			BufferPosition += TagEndOffset + 1;
+		}
+	}
+
+	return ErrorMessage.IsEmpty();
+}
+
+
+bool FOSMXmlStreamReader::ReadMore( FScopedSlowTask& SlowTask )
+{
+	if( FileBytesRead >= FileSize || !ErrorMessage.IsEmpty() )
+	{
+		return false;
+	}
+
+	if( SlowTask.ShouldCancel() )
+	{
+		SetError( LOCTEXT( "OSMXmlCanceled", "Import was canceled" ) );
+		bWasCanceled = true;
+		return false;
+	}
+
+	// Discard everything we've consumed already, keeping the tail of a tag that was split across chunks
+	if( BufferPosition > 0 )
+	{
+		Buffer.RemoveAt( 0, BufferPosition, false );
+		BufferPosition = 0;
+	}
+
+	const int32 BytesToRead = (int32)FMath::Min<int64>( OSMXmlReadChunkSize, FileSize - FileBytesRead );
+	const int32 OldBufferSize = Buffer.Num();
+	Buffer.AddUninitialized( BytesToRead );
+	if( !FileHandle.Read( (uint8*)( Buffer.GetData() + OldBufferSize ), BytesToRead ) )
+	{
+		Buffer.SetNum( OldBufferSize, false );
+		SetError( LOCTEXT( "OSMXmlReadFailed", "Failed to read from file" ) );
+		return false;
+	}
+
+	FileBytesRead += BytesToRead;
+	SlowTask.EnterProgressFrame( (float)BytesToRead );
+
+	return true;
+}
+
+
+int32 FOSMXmlStreamReader::FindTerminator( const ANSICHAR* Terminator, const int32 SearchStartOffset, FScopedSlowTask& SlowTask )
+{
+	const int32 TerminatorLength = FCStringAnsi::Strlen( Terminator );
+
+	int32 SearchOffset = SearchStartOffset;
+	for( ;; )
+	{
+		const ANSICHAR* Search = Buffer.GetData() + BufferPosition;
+		const int32 SearchEnd = ( Buffer.Num() - BufferPosition ) - TerminatorLength;
+		for( ; SearchOffset <= SearchEnd; ++SearchOffset )
+		{
+			if( Search[ SearchOffset ] == Terminator[ 0 ] && ( TerminatorLength == 1 || !FCStringAnsi::Strncmp( Search + SearchOffset, Terminator, TerminatorLength ) ) )
+			{
+				return SearchOffset;
+			}
+		}
+
+		if( !ReadMore( SlowTask ) )
+		{
+			return INDEX_NONE;
+		}
+	}
+}
+
+
+bool FOSMXmlStreamReader::ParseStartTag( ANSICHAR* Start, ANSICHAR* End )
+{
+	const bool bIsEmptyElement = End[ -1 ] == '/';
+	ANSICHAR* AttributesEnd = bIsEmptyElement ? End - 1 : End;
+
+	ANSICHAR* Cursor = Start + 1;
+	ANSICHAR* NameStart = Cursor;
+	while( Cursor < AttributesEnd && !IsXmlWhitespace( *Cursor ) )
+	{
+		++Cursor;
+	}
+	if( Cursor == NameStart )
+	{
+		SetError( LOCTEXT( "OSMXmlMissingElementName", "Missing element name" ) );
+		return false;
+	}
+
+	const TCHAR* ElementName = ConvertToTCHAR( NameStart, Cursor - NameStart, ElementNameScratch );
+	if( !Callback.ProcessElement( ElementName, TEXT( "" ), LineNumber ) )
+	{
+		SetError( LOCTEXT( "OSMXmlAborted", "Parsing was aborted" ) );
+		return false;
+	}
+
+	for( ;; )
+	{
+		while( Cursor < AttributesEnd && IsXmlWhitespace( *Cursor ) )
+		{
+			++Cursor;
+		}
+		if( Cursor >= AttributesEnd )
+		{
+			break;
+		}
+
+		ANSICHAR* AttributeNameStart = Cursor;
+		while( Cursor < AttributesEnd && *Cursor != '=' && !IsXmlWhitespace( *Cursor ) )
+		{
+			++Cursor;
+		}
+		ANSICHAR* AttributeNameEnd = Cursor;
+
+		while( Cursor < AttributesEnd && IsXmlWhitespace( *Cursor ) )
+		{
+			++Cursor;
+		}
+		if( Cursor >= AttributesEnd || *Cursor != '=' )
+		{
+			SetError( LOCTEXT( "OSMXmlMissingEquals", "Expected '=' after attribute name" ) );
+			return false;
+		}
+		++Cursor;
+
+		while( Cursor < AttributesEnd && IsXmlWhitespace( *Cursor ) )
+		{
+			++Cursor;
+		}
+		if( Cursor >= AttributesEnd || ( *Cursor != '"' && *Cursor != '\'' ) )
+		{
+			SetError( LOCTEXT( "OSMXmlMissingQuote", "Expected quoted attribute value" ) );
+			return false;
+		}
+
+		// Both single and double quote delimiters are allowed
+		const ANSICHAR Quote = *Cursor++;
+		ANSICHAR* AttributeValueStart = Cursor;
+		while( Cursor < AttributesEnd && *Cursor != Quote )
+		{
+			++Cursor;
+		}
+		if( Cursor >= AttributesEnd )
+		{
+			SetError( LOCTEXT( "OSMXmlUnterminatedValue", "Unterminated attribute value" ) );
+			return false;
+		}
+		ANSICHAR* AttributeValueEnd = Cursor++;
+
+		const int32 AttributeValueLength = DecodeEntities( AttributeValueStart, AttributeValueEnd - AttributeValueStart );
+
+		const TCHAR* AttributeName = ConvertToTCHAR( AttributeNameStart, AttributeNameEnd - AttributeNameStart, AttributeNameScratch );
+		const TCHAR* AttributeValue = ConvertToTCHAR( AttributeValueStart, AttributeValueLength, AttributeValueScratch );
+		if( !Callback.ProcessAttribute( AttributeName, AttributeValue ) )
+		{
+			SetError( LOCTEXT( "OSMXmlAborted", "Parsing was aborted" ) );
+			return false;
+		}
+	}
+
+	if( bIsEmptyElement )
+	{
+		if( !Callback.ProcessClose( ElementName ) )
+		{
+			SetError( LOCTEXT( "OSMXmlAborted", "Parsing was aborted" ) );
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+void FOSMXmlStreamReader::CountLines( const ANSICHAR* Start, const ANSICHAR* End )
+{
+	for( const ANSICHAR* Character = Start; Character < End; ++Character )
+	{
+		if( *Character == '\n' )
+		{
+			++LineNumber;
+		}
+	}
+}
+
+
+int32 FOSMXmlStreamReader::DecodeEntities( ANSICHAR* String, const int32 Length )
+{
+	int32 ReadIndex = 0;
+	int32 WriteIndex = 0;
+	while( ReadIndex < Length )
+	{
+		if( String[ ReadIndex ] != '&' )
+		{
+			String[ WriteIndex++ ] = String[ ReadIndex++ ];
+			continue;
+		}
+
+		// Find the end of the reference.  Anything unexpected is passed through untouched.
+		int32 SemicolonIndex = ReadIndex + 1;
+		while( SemicolonIndex < Length && SemicolonIndex - ReadIndex <= 10 && String[ SemicolonIndex ] != ';' )
+		{
+			++SemicolonIndex;
+		}
+		if( SemicolonIndex >= Length || String[ SemicolonIndex ] != ';' )
+		{
+			String[ WriteIndex++ ] = String[ ReadIndex++ ];
+			continue;
+		}
+
+		const ANSICHAR* Reference = String + ReadIndex + 1;
+		const int32 ReferenceLength = SemicolonIndex - ( ReadIndex + 1 );
+
+		uint32 CodePoint = 0;
+		if( ReferenceLength == 3 && !FCStringAnsi::Strncmp( Reference, "amp", 3 ) )
+		{
+			CodePoint = '&';
+		}
+		else if( ReferenceLength == 2 && !FCStringAnsi::Strncmp( Reference, "lt", 2 ) )
+		{
+			CodePoint = '<';
+		}
+		else if( ReferenceLength == 2 && !FCStringAnsi::Strncmp( Reference, "gt", 2 ) )
+		{
+			CodePoint = '>';
+		}
+		else if( ReferenceLength == 4 && !FCStringAnsi::Strncmp( Reference, "quot", 4 ) )
+		{
+			CodePoint = '"';
+		}
+		else if( ReferenceLength == 4 && !FCStringAnsi::Strncmp( Reference, "apos", 4 ) )
+		{
+			CodePoint = '\'';
+		}
+		else if( ReferenceLength >= 2 && Reference[ 0 ] == '#' )
+		{
+			const bool bIsHex = Reference[ 1 ] == 'x' || Reference[ 1 ] == 'X';
+			for( int32 DigitIndex = bIsHex ? 2 : 1; DigitIndex < ReferenceLength; ++DigitIndex )
+			{
+				const ANSICHAR Digit = Reference[ DigitIndex ];
+				if( Digit >= '0' && Digit <= '9' )
+				{
+					CodePoint = CodePoint * ( bIsHex ? 16 : 10 ) + ( Digit - '0' );
+				}
+				else if( bIsHex && Digit >= 'a' && Digit <= 'f' )
+				{
+					CodePoint = CodePoint * 16 + ( Digit - 'a' + 10 );
+				}
+				else if( bIsHex && Digit >= 'A' && Digit <= 'F' )
+				{
+					CodePoint = CodePoint * 16 + ( Digit - 'A' + 10 );
+				}
+				else
+				{
+					CodePoint = 0;
+					break;
+				}
+			}
+		}
+
+		if( CodePoint == 0 || CodePoint > 0x10FFFF )
+		{
+			// Not something we recognize, so leave it alone
+			String[ WriteIndex++ ] = String[ ReadIndex++ ];
+			continue;
+		}
+
+		// Encode as UTF-8.  The encoded character is never longer than the reference it replaces.
+		if( CodePoint < 0x80 )
+		{
+			String[ WriteIndex++ ] = (ANSICHAR)CodePoint;
+		}
+		else if( CodePoint < 0x800 )
+		{
+			String[ WriteIndex++ ] = (ANSICHAR)( 0xC0 | ( CodePoint >> 6 ) );
+			String[ WriteIndex++ ] = (ANSICHAR)( 0x80 | ( CodePoint & 0x3F ) );
+		}
+		else if( CodePoint < 0x10000 )
+		{
+			String[ WriteIndex++ ] = (ANSICHAR)( 0xE0 | ( CodePoint >> 12 ) );
+			String[ WriteIndex++ ] = (ANSICHAR)( 0x80 | ( ( CodePoint >> 6 ) & 0x3F ) );
+			String[ WriteIndex++ ] = (ANSICHAR)( 0x80 | ( CodePoint & 0x3F ) );
+		}
+		else
+		{
+			String[ WriteIndex++ ] = (ANSICHAR)( 0xF0 | ( CodePoint >> 18 ) );
+			String[ WriteIndex++ ] = (ANSICHAR)( 0x80 | ( ( CodePoint >> 12 ) & 0x3F ) );
+			String[ WriteIndex++ ] = (ANSICHAR)( 0x80 | ( ( CodePoint >> 6 ) & 0x3F ) );
+			String[ WriteIndex++ ] = (ANSICHAR)( 0x80 | ( CodePoint & 0x3F ) );
+		}
+
+		ReadIndex = SemicolonIndex + 1;
+	}
+
+	return WriteIndex;
+}
+
+
+const TCHAR* FOSMXmlStreamReader::ConvertToTCHAR( const ANSICHAR* String, const int32 Length, TArray<TCHAR>& Scratch )
+{
+	bool bIsPureAnsi = true;
+	for( int32 CharIndex = 0; CharIndex < Length; ++CharIndex )
+	{
+		if( (uint8)String[ CharIndex ] >= 0x80 )
+		{
+			bIsPureAnsi = false;
+			break;
+		}
+	}
+
+	if( bIsPureAnsi )
+	{
+		// Fast path for the vast majority of strings in the file (element names, attribute names, numbers)
+		Scratch.SetNumUninitialized( Length + 1, false );
+		TCHAR* Destination = Scratch.GetData();
+		for( int32 CharIndex = 0; CharIndex < Length; ++CharIndex )
+		{
+			Destination[ CharIndex ] = (TCHAR)(uint8)String[ CharIndex ];
+		}
+		Destination[ Length ] = 0;
+	}
+	else
+	{
+		FUTF8ToTCHAR Converted( String, Length );
+		Scratch.SetNumUninitialized( Converted.Length() + 1, false );
+		FMemory::Memcpy( Scratch.GetData(), Converted.Get(), Converted.Length() * sizeof( TCHAR ) );
+		Scratch[ Converted.Length() ] = 0;
+	}
+
+	return Scratch.GetData();
+}
+
+
+void FOSMXmlStreamReader::SetError( const FText& Message )
+{
+	if( ErrorMessage.IsEmpty() )
+	{
+		ErrorMessage = Message;
+	}
+}
+
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,86 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "FastXml.h"
+
+
+/**
+ * Streaming reader for OpenStreetMap XML files.  The file is read as UTF-8 in fixed size chunks, and elements and
+ * attributes are handed to an IFastXmlCallback as soon as they are parsed.  Only the chunk currently being parsed is
+ * kept in memory, so peak memory use is bounded by the parsed data rather than by the size of the file.
+ *
+ * Only the subset of XML that OpenStreetMap files use is supported.  Element text is not reported (OSM files never
+ * use it), and DOCTYPE and CDATA sections are skipped.
+ */
+class FOSMXmlStreamReader
+{
+
+public:
+
+	/** Parses the XML file at the specified path, sending every element, attribute and close tag to the callback in document order.  bOutWasCanceled is set if the user canceled. */
+	static bool ParseFile( const FString& FilePath, IFastXmlCallback* Callback, class FFeedbackContext* FeedbackContext, FText& OutErrorMessage, int32& OutErrorLineNumber, bool& bOutWasCanceled );
+
+
+private:
+
+	FOSMXmlStreamReader( IFileHandle& InFileHandle, IFastXmlCallback& InCallback );
+
+	/** Parses everything in the file */
+	bool Parse( class FScopedSlowTask& SlowTask );
+
+	/** Reads the next chunk of the file into the buffer, keeping any data that hasn't been consumed yet.  Returns false at the end of the file. */
+	bool ReadMore( class FScopedSlowTask& SlowTask );
+
+	/** Finds the specified terminator at or after the current position, reading more of the file as needed.  Returns the terminator's offset into the buffer, or INDEX_NONE if the file ended first */
+	int32 FindTerminator( const ANSICHAR* Terminator, const int32 SearchStartOffset, class FScopedSlowTask& SlowTask );
+
+	/** Parses a start (or empty element) tag that spans the buffer range [Start, End) */
+	bool ParseStartTag( ANSICHAR* Start, ANSICHAR* End );
+
+	/** Counts line breaks in the buffer range [Start, End) */
+	void CountLines( const ANSICHAR* Start, const ANSICHAR* End );
+
+	/** Decodes XML character and entity references in place.  Returns the new length of the string */
+	static int32 DecodeEntities( ANSICHAR* String, const int32 Length );
+
+	/** Converts a UTF-8 string range into a null-terminated TCHAR string stored in the supplied scratch array */
+	static const TCHAR* ConvertToTCHAR( const ANSICHAR* String, const int32 Length, TArray<TCHAR>& Scratch );
+
+	/** Sets the error message for a malformed file */
+	void SetError( const FText& Message );
+
+
+private:
+
+	/** File that we're reading from */
+	IFileHandle& FileHandle;
+
+	/** Callback that receives elements and attributes */
+	IFastXmlCallback& Callback;
+
+	/** Total size of the file in bytes */
+	int64 FileSize;
+
+	/** Number of bytes read from the file so far */
+	int64 FileBytesRead;
+
+	/** Bytes read from the file that haven't been consumed yet, starting at BufferPosition */
+	TArray<ANSICHAR> Buffer;
+
+	/** Offset of the first byte in Buffer that hasn't been consumed yet */
+	int32 BufferPosition;
+
+	/** Current line number in the file, for error reporting */
+	int32 LineNumber;
+
+	/** Scratch storage for converted strings, reused across calls to avoid allocating */
+	TArray<TCHAR> ElementNameScratch;
+	TArray<TCHAR> AttributeNameScratch;
+	TArray<TCHAR> AttributeValueScratch;
+
+	/** Error message, if parsing failed */
+	FText ErrorMessage;
+
+	/** True if parsing stopped because the user canceled */
+	bool bWasCanceled;
+};
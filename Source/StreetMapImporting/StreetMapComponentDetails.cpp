@@ -147,12 +147,16 @@ void FStreetMapComponentDetails::CustomizeDetails(IDetailLayoutBuilder& DetailBu
 	if (bCanCreateMeshAsset)
 	{
 
-		const int32 NumVertices = SelectedStreetMapComponent->GetRawMeshVertices().Num();
+		const int32 NumVertices = SelectedStreetMapComponent->GetNumMeshVertices();
 		const FString NumVerticesToString = TEXT("Vertex Count : ") + FString::FromInt(NumVertices);
 
-		const int32 NumTriangles = SelectedStreetMapComponent->GetRawMeshIndices().Num() / 3;
+		const int32 NumTriangles = SelectedStreetMapComponent->GetNumMeshIndices() / 3;
 		const FString NumTrianglesToString = TEXT("Triangle Count : ") + FString::FromInt(NumTriangles);
 
+		int32 Num16BitSections, Num32BitSections;
+		SelectedStreetMapComponent->GetNumMeshSectionsByIndexSize(Num16BitSections, Num32BitSections);
+		const FString NumSectionsToString = FString::Printf(TEXT("Sections : %d (16-bit : %d, 32-bit : %d)"), Num16BitSections + Num32BitSections, Num16BitSections, Num32BitSections);
+
 		const bool bCollisionEnabled = SelectedStreetMapComponent->IsCollisionEnabled();
 		const FString CollisionStatusToString = bCollisionEnabled ? TEXT("Collision : ON") : TEXT("Collision : OFF");
 
@@ -175,6 +179,14 @@ void FStreetMapComponentDetails::CustomizeDetails(IDetailLayoutBuilder& DetailBu
 				.Font(FSlateFontInfo("Verdana", 8))
 			.Text(FText::FromString(NumTrianglesToString))
 			]
+			+ SHorizontalBox::Slot()
+			.HAlign(HAlign_Left)
+			.VAlign(VAlign_Center)
+			[
+				SNew(STextBlock)
+				.Font(FSlateFontInfo("Verdana", 8))
+			.Text(FText::FromString(NumSectionsToString))
+			]
 			+ SHorizontalBox::Slot()
 				.HAlign(HAlign_Left)
 				.VAlign(VAlign_Center)
@@ -234,8 +246,9 @@ FReply FStreetMapComponentDetails::OnCreateStaticMeshAssetClicked()
 			TArray<UMaterialInterface*> MeshMaterials = SelectedStreetMapComponent->GetMaterials();
 
 			
-			const TArray<FStreetMapVertex > RawMeshVertices = SelectedStreetMapComponent->GetRawMeshVertices();
-			const TArray< int32 > RawMeshIndices = SelectedStreetMapComponent->GetRawMeshIndices();
+			TArray<FStreetMapVertex > RawMeshVertices;
+			TArray< int32 > RawMeshIndices;
+			SelectedStreetMapComponent->GetRawMesh(RawMeshVertices, RawMeshIndices);
 
 
 			// Copy verts
@@ -4,12 +4,8 @@
 #include "StreetMapFactory.h"
 #include "OSMFile.h"
 #include "StreetMap.h"
-
-
-// Latitude/longitude scale factor
-//			- https://en.wikipedia.org/wiki/Equator#Exact_length
-static const double EarthCircumference = 40075036.0;
-const double UStreetMapFactory::LatitudeLongitudeScale = EarthCircumference / 360.0; // meters per degree
+#include "StreetMapProjection.h"
+#include "Async/ParallelFor.h"
 
 
 UStreetMapFactory::UStreetMapFactory(const FObjectInitializer& ObjectInitializer)
@@ -18,26 +14,27 @@ UStreetMapFactory::UStreetMapFactory(const FObjectInitializer& ObjectInitializer
 	SupportedClass = UStreetMap::StaticClass();
 
 	Formats.Add( TEXT( "osm;OpenStreetMap XML" ) );
+	Formats.Add( TEXT( "pbf;OpenStreetMap PBF" ) );
 	bCreateNew = false;
 	bEditorImport = true;
 	bEditAfterNew = false;
-	bText = true;
+
+	// We stream the file from disk ourselves in FactoryCreateFile(), rather than having the engine load the whole
+	// file into a string buffer first.  That would hold the entire file in memory, and fail for files over 2 GB.
+	bText = false;
+
+	bOnlyImportReferencedNodes = true;
+	bBuildContractionHierarchy = false;
 }
 
 
-UObject* UStreetMapFactory::FactoryCreateText( UClass* Class, UObject* Parent, FName Name, EObjectFlags Flags, UObject* Context, const TCHAR* Type, const TCHAR*& Buffer, const TCHAR* BufferEnd, FFeedbackContext* Warn )
+UObject* UStreetMapFactory::FactoryCreateFile( UClass* Class, UObject* Parent, FName Name, EObjectFlags Flags, const FString& Filename, const TCHAR* Parms, FFeedbackContext* Warn, bool& bOutOperationCanceled )
 {
 	UStreetMap* StreetMap = NewObject<UStreetMap>( Parent, Name, Flags | RF_Transactional );
 
-	StreetMap->AssetImportData->Update( this->GetCurrentFilename() );
-
-	// @todo: Performance: This will copy the entire text buffer into an FString.  We need to do this
-	//        because the FFastXml parser is expecting a buffer that it can mutate as it parses.
-	const int32 CharacterCount = BufferEnd - Buffer;
-	FString MutableTextBuffer( CharacterCount, Buffer );
+	StreetMap->AssetImportData->Update( Filename );
 
-	const bool bIsFilePathActuallyTextBuffer = true;
-	const bool bLoadedOkay = LoadFromOpenStreetMapXMLFile( StreetMap, MutableTextBuffer, bIsFilePathActuallyTextBuffer, Warn );
+	const bool bLoadedOkay = LoadFromOpenStreetMapFile( StreetMap, Filename, Warn, /* Out */ bOutOperationCanceled );
 
 	if( !bLoadedOkay )
 	{
@@ -49,48 +46,21 @@ UObject* UStreetMapFactory::FactoryCreateText( UClass* Class, UObject* Parent, F
 }
 
 
-bool UStreetMapFactory::LoadFromOpenStreetMapXMLFile( UStreetMap* StreetMap, FString& OSMFilePath, const bool bIsFilePathActuallyTextBuffer, FFeedbackContext* FeedbackContext )
+bool UStreetMapFactory::LoadFromOpenStreetMapFile( UStreetMap* StreetMap, const FString& OSMFilePath, FFeedbackContext* FeedbackContext, bool& bOutWasCanceled )
 {
+	bOutWasCanceled = false;
+
 	// OSM data is stored in meters.  This is the scale factor to convert those units into UE4's native units (cm)
 	// Keep in mind that if this is changed, UStreetMapComponent sizes for roads may need to be updated too!
 	// @todo: We should make this scale factor customizable as an import option
 	const float OSMToCentimetersScaleFactor = 100.0f;
 
 
-	// Converts latitude to meters
-	auto ConvertLatitudeToMeters = []( const double Latitude ) -> double
-	{
-		return -Latitude * LatitudeLongitudeScale;
-	};
-
-	// Converts longitude to meters
-	auto ConvertLongitudeToMeters = []( const double Longitude, const double Latitude ) -> double
-	{
-		return Longitude * LatitudeLongitudeScale * FMath::Cos( FMath::DegreesToRadians( Latitude ) );
-	};
-
-	// Converts latitude and longitude to X/Y coordinates, relative to some other latitude/longitude
-	auto ConvertLatLongToMetersRelative = [ConvertLatitudeToMeters, ConvertLongitudeToMeters]( 
-		const double Latitude, 
-		const double Longitude, 
-		const double RelativeToLatitude, 
-		const double RelativeToLongitude ) -> FVector2D
-	{
-		// Applies Sanson-Flamsteed (sinusoidal) Projection (see http://www.progonos.com/furuti/MapProj/Normal/CartHow/HowSanson/howSanson.html)
-		return FVector2D(
-			(float)( ConvertLongitudeToMeters( Longitude, Latitude ) - ConvertLongitudeToMeters( RelativeToLongitude, Latitude ) ),
-			(float)( ConvertLatitudeToMeters( Latitude ) - ConvertLatitudeToMeters( RelativeToLatitude ) ) );
-	};
-
-	// Adds a road to the street map using the OpenStreetMap data, flattening the road's coordinates into our map's space
-	auto AddRoadForWay = [ConvertLatLongToMetersRelative, OSMToCentimetersScaleFactor]( 
-		const FOSMFile& OSMFile, 
-		UStreetMap& StreetMapRef, 
-		const FOSMFile::FOSMWayInfo& OSMWay, 
-		int32& OutRoadIndex ) -> bool
+	// Figures out which type of road to create for an OpenStreetMap way, if any
+	auto GetRoadTypeForWayType = []( const FOSMFile::EOSMWayType WayType ) -> EStreetMapRoadType
 	{
 		EStreetMapRoadType RoadType = EStreetMapRoadType::Other;
-		switch( OSMWay.WayType )
+		switch( WayType )
 		{
 			case FOSMFile::EOSMWayType::Motorway:
 			case FOSMFile::EOSMWayType::Motorway_Link:
@@ -116,205 +86,137 @@ bool UStreetMapFactory::LoadFromOpenStreetMapXMLFile( UStreetMap* StreetMap, FSt
 				break;
 		}
 
-		if( RoadType != EStreetMapRoadType::Other )
-		{
-			// Require at least two points!
-			if( OSMWay.Nodes.Num() > 1 )
-			{
-				// Create a road for this way
-				OutRoadIndex = StreetMapRef.Roads.Num();
-				FStreetMapRoad& NewRoad = *new( StreetMapRef.Roads )FStreetMapRoad();
+		return RoadType;
+	};
 
-				FVector2D BoundsMin( TNumericLimits<float>::Max(), TNumericLimits<float>::Max() );
-				FVector2D BoundsMax( TNumericLimits<float>::Lowest(), TNumericLimits<float>::Lowest() );
+	// Copies all of a way's (already projected) points, and computes their bounds
+	auto GatherWayPoints = [](
+		const TArray<FVector2D>& NodePositions,
+		const FOSMFile::FOSMWayInfo& OSMWay,
+		TArray<FVector2D>& OutPoints,
+		FVector2D& OutBoundsMin,
+		FVector2D& OutBoundsMax )
+	{
+		FVector2D BoundsMin( TNumericLimits<float>::Max(), TNumericLimits<float>::Max() );
+		FVector2D BoundsMax( TNumericLimits<float>::Lowest(), TNumericLimits<float>::Lowest() );
 
-				NewRoad.RoadPoints.AddUninitialized( OSMWay.Nodes.Num() );
-				int32 CurRoadPoint = 0;
+		OutPoints.SetNumUninitialized( OSMWay.Nodes.Num() );
+		int32 CurPoint = 0;
 
-				// Set defaults for each node index on this road.  INDEX_NONE means the node is not valid, which may be the case
-				// for nodes that we filter out entirely.  This will be filled in by valid indices to nodes later on.
-				NewRoad.NodeIndices.AddUninitialized( OSMWay.Nodes.Num() );
-				for( int32& NodeIndex : NewRoad.NodeIndices )
+		for( const int32 OSMNodeIndex : OSMWay.Nodes )
+		{
+			const FVector2D NodePos = NodePositions[ OSMNodeIndex ];
+
+			// Update bounding box
+			{
+				if( NodePos.X < BoundsMin.X )
 				{
-					NodeIndex = INDEX_NONE;
+					BoundsMin.X = NodePos.X;
 				}
-
-
-				for( const FOSMFile::FOSMNodeInfo* OSMNodePtr : OSMWay.Nodes )
+				if( NodePos.Y < BoundsMin.Y )
 				{
-					const FOSMFile::FOSMNodeInfo& OSMNode = *OSMNodePtr;
-
-					// Transform all points relative to the center of the latitude/longitude bounds, so that
-					// we get as much precision as possible.
-					const double RelativeToLatitude = OSMFile.AverageLatitude;
-					const double RelativeToLongitude = OSMFile.AverageLongitude;
-					const FVector2D NodePos = ConvertLatLongToMetersRelative(
-						OSMNode.Latitude,
-						OSMNode.Longitude,
-						RelativeToLatitude,
-						RelativeToLongitude ) * OSMToCentimetersScaleFactor;
-
-					// Update bounding box
-					{
-						if( NodePos.X < BoundsMin.X )
-						{
-							BoundsMin.X = NodePos.X;
-						}
-						if( NodePos.Y < BoundsMin.Y )
-						{
-							BoundsMin.Y = NodePos.Y;
-						}
-						if( NodePos.X > BoundsMax.X )
-						{
-							BoundsMax.X = NodePos.X;
-						}
-						if( NodePos.Y > BoundsMax.Y )
-						{
-							BoundsMax.Y = NodePos.Y;
-						}
-					}
-
-					// Fill in the points
-					NewRoad.RoadPoints[ CurRoadPoint++ ] = NodePos;
+					BoundsMin.Y = NodePos.Y;
 				}
-
-
-				NewRoad.RoadName = OSMWay.Name;
-				if( NewRoad.RoadName.IsEmpty() )
+				if( NodePos.X > BoundsMax.X )
 				{
-					NewRoad.RoadName = OSMWay.Ref;
+					BoundsMax.X = NodePos.X;
+				}
+				if( NodePos.Y > BoundsMax.Y )
+				{
+					BoundsMax.Y = NodePos.Y;
 				}
-				NewRoad.RoadType = RoadType;
-				NewRoad.BoundsMin = BoundsMin;
-				NewRoad.BoundsMax = BoundsMax;
-
-				NewRoad.bIsOneWay = OSMWay.bIsOneWay;
-
-				StreetMapRef.BoundsMin.X = FMath::Min( StreetMapRef.BoundsMin.X, BoundsMin.X );
-				StreetMapRef.BoundsMin.Y = FMath::Min( StreetMapRef.BoundsMin.Y, BoundsMin.Y );
-				StreetMapRef.BoundsMax.X = FMath::Max( StreetMapRef.BoundsMax.X, BoundsMax.X );
-				StreetMapRef.BoundsMax.Y = FMath::Max( StreetMapRef.BoundsMax.Y, BoundsMax.Y );
-
-				return true;
-			}
-			else
-			{
-				// NOTE: Skipped adding road for way because it has less than 2 points
-				// @todo: Log this for the user as an import warning
 			}
+
+			// Fill in the points
+			OutPoints[ CurPoint++ ] = NodePos;
 		}
 
-		return false;
+		OutBoundsMin = BoundsMin;
+		OutBoundsMax = BoundsMax;
 	};
 
-
-	// Adds a building to the street map using the OpenStreetMap data, flattening the road's coordinates into our map's space
-	auto AddBuildingForWay = [ConvertLatLongToMetersRelative, OSMToCentimetersScaleFactor]( 
-		const FOSMFile& OSMFile, 
-		UStreetMap& StreetMapRef, 
-		const FOSMFile::FOSMWayInfo& OSMWay ) -> bool
+	// Fills in a road using the OpenStreetMap data, flattening the road's coordinates into our map's space.  Only touches
+	// the road itself, so roads can be filled in on any thread.
+	auto FillRoadForWay = [GatherWayPoints](
+		const TArray<FVector2D>& NodePositions,
+		const FOSMFile::FOSMWayInfo& OSMWay,
+		const EStreetMapRoadType RoadType,
+		FStreetMapRoad& NewRoad )
 	{
-		if( OSMWay.WayType == FOSMFile::EOSMWayType::Building )
-		{
-			// Require at least three points so that we don't have degenerate polygon!
-			if( OSMWay.Nodes.Num() > 2 )
-			{
-				// Create a building for this way
-				FStreetMapBuilding& NewBuilding = *new( StreetMapRef.Buildings )FStreetMapBuilding();
-
-				FVector2D BoundsMin( TNumericLimits<float>::Max(), TNumericLimits<float>::Max() );
-				FVector2D BoundsMax( TNumericLimits<float>::Lowest(), TNumericLimits<float>::Lowest() );
-
-				NewBuilding.BuildingPoints.AddUninitialized( OSMWay.Nodes.Num() );
-				int32 CurBuildingPoint = 0;
+		GatherWayPoints( NodePositions, OSMWay, NewRoad.RoadPoints, NewRoad.BoundsMin, NewRoad.BoundsMax );
 
-				for( const FOSMFile::FOSMNodeInfo* OSMNodePtr : OSMWay.Nodes )
-				{
-					const FOSMFile::FOSMNodeInfo& OSMNode = *OSMNodePtr;
-
-					// Transform all points relative to the center of the latitude/longitude bounds, so that
-					// we get as much precision as possible.
-					const double RelativeToLatitude = OSMFile.AverageLatitude;
-					const double RelativeToLongitude = OSMFile.AverageLongitude;
-					const FVector2D NodePos = ConvertLatLongToMetersRelative(
-						OSMNode.Latitude,
-						OSMNode.Longitude,
-						RelativeToLatitude,
-						RelativeToLongitude ) * OSMToCentimetersScaleFactor;
-
-					// Update bounding box
-					{
-						if( NodePos.X < BoundsMin.X )
-						{
-							BoundsMin.X = NodePos.X;
-						}
-						if( NodePos.Y < BoundsMin.Y )
-						{
-							BoundsMin.Y = NodePos.Y;
-						}
-						if( NodePos.X > BoundsMax.X )
-						{
-							BoundsMax.X = NodePos.X;
-						}
-						if( NodePos.Y > BoundsMax.Y )
-						{
-							BoundsMax.Y = NodePos.Y;
-						}
-					}
-
-					// Fill in the points
-					NewBuilding.BuildingPoints[ CurBuildingPoint++ ] = NodePos;
-				}
+		// Set defaults for each node index on this road.  INDEX_NONE means the node is not valid, which may be the case
+		// for nodes that we filter out entirely.  This will be filled in by valid indices to nodes later on.
+		NewRoad.NodeIndices.Init( INDEX_NONE, OSMWay.Nodes.Num() );
 
-				// Make sure the building ended up with a closed polygon, then remove the final (redundant) point
-				const bool bIsClosed = NewBuilding.BuildingPoints[ 0 ].Equals( NewBuilding.BuildingPoints[ NewBuilding.BuildingPoints.Num() - 1 ], KINDA_SMALL_NUMBER );
-				if( bIsClosed )
-				{
-					// Remove the final redundant point
-					NewBuilding.BuildingPoints.Pop();
-				}
-				else
-				{
-					// Wasn't expecting to have an unclosed shape.  Our tolerances might be off, or the data was malformed.
-					// Either way, it shouldn't be a problem as we'll close the shape ourselves below.
-					// @todo: Log this for the user as an import warning
-				}
+		NewRoad.RoadName = OSMWay.Name;
+		if( NewRoad.RoadName.IsEmpty() )
+		{
+			NewRoad.RoadName = OSMWay.Ref;
+		}
+		NewRoad.RoadType = RoadType;
 
-				NewBuilding.BuildingName = OSMWay.Name;
-				if( NewBuilding.BuildingName.IsEmpty() )
-				{
-					NewBuilding.BuildingName = OSMWay.Ref;
-				}
+		NewRoad.bIsOneWay = OSMWay.bIsOneWay;
+	};
 
-				NewBuilding.Height = OSMWay.Height * OSMToCentimetersScaleFactor;
-				NewBuilding.BuildingLevels = OSMWay.BuildingLevels;
 
-				NewBuilding.BoundsMin = BoundsMin;
-				NewBuilding.BoundsMax = BoundsMax;
+	// Fills in a building using the OpenStreetMap data, flattening the building's coordinates into our map's space.  Only
+	// touches the building itself, so buildings can be filled in on any thread.
+	const TArray<float> SimplificationTolerances = FStreetMapMeshBuildSettings::GetDefaultSimplificationTolerances();
+	auto FillBuildingForWay = [GatherWayPoints, OSMToCentimetersScaleFactor, &SimplificationTolerances](
+		const TArray<FVector2D>& NodePositions,
+		const FOSMFile::FOSMWayInfo& OSMWay,
+		FStreetMapBuilding& NewBuilding )
+	{
+		GatherWayPoints( NodePositions, OSMWay, NewBuilding.BuildingPoints, NewBuilding.BoundsMin, NewBuilding.BoundsMax );
 
-				StreetMapRef.BoundsMin.X = FMath::Min( StreetMapRef.BoundsMin.X, BoundsMin.X );
-				StreetMapRef.BoundsMin.Y = FMath::Min( StreetMapRef.BoundsMin.Y, BoundsMin.Y );
-				StreetMapRef.BoundsMax.X = FMath::Max( StreetMapRef.BoundsMax.X, BoundsMax.X );
-				StreetMapRef.BoundsMax.Y = FMath::Max( StreetMapRef.BoundsMax.Y, BoundsMax.Y );
+		// Make sure the building ended up with a closed polygon, then remove the final (redundant) point
+		const bool bIsClosed = NewBuilding.BuildingPoints[ 0 ].Equals( NewBuilding.BuildingPoints[ NewBuilding.BuildingPoints.Num() - 1 ], KINDA_SMALL_NUMBER );
+		if( bIsClosed )
+		{
+			// Remove the final redundant point
+			NewBuilding.BuildingPoints.Pop();
+		}
+		else
+		{
+			// Wasn't expecting to have an unclosed shape.  Our tolerances might be off, or the data was malformed.
+			// Either way, it shouldn't be a problem as we'll close the shape ourselves below.
+			// @todo: Log this for the user as an import warning
+		}
 
-				return true;
-			}
-			else
-			{
-				// NOTE: Skipped adding building for way because it has less than 3 points
-				// @todo: Log this for the user as an import warning
-			}
+		NewBuilding.BuildingName = OSMWay.Name;
+		if( NewBuilding.BuildingName.IsEmpty() )
+		{
+			NewBuilding.BuildingName = OSMWay.Ref;
 		}
 
-		return false;
+		NewBuilding.Height = OSMWay.Height * OSMToCentimetersScaleFactor;
+		NewBuilding.BuildingLevels = OSMWay.BuildingLevels;
+
+		// Triangulate the building now, and simplify it for the default levels of detail, so that it doesn't need to happen
+		// every time a mesh is built
+		NewBuilding.Triangulate();
+		NewBuilding.BuildSimplifiedOutlines( SimplificationTolerances );
 	};
 
 
-	// Load up the OSM file.  It's in XML format.
+	// Only keep the ways that we'll turn into roads or buildings.  The OSM file will then skip loading every node that
+	// isn't referenced by those ways, such as points of interest and address points.
+	FOSMFile::FWayFilter WayFilter;
+	if( bOnlyImportReferencedNodes )
+	{
+		WayFilter = [GetRoadTypeForWayType]( const FOSMFile::FOSMWayInfo& OSMWay ) -> bool
+		{
+			return OSMWay.WayType == FOSMFile::EOSMWayType::Building || GetRoadTypeForWayType( OSMWay.WayType ) != EStreetMapRoadType::Other;
+		};
+	}
+
+	// Load up the OSM file.  It's either in XML or PBF format.
 	FOSMFile OSMFile;
-	if( !OSMFile.LoadOpenStreetMapFile( OSMFilePath, bIsFilePathActuallyTextBuffer, FeedbackContext ) )
+	if( !OSMFile.LoadOpenStreetMapFile( OSMFilePath, WayFilter, FeedbackContext ) )
 	{
-		// Loading failed.  The actual error message will be sent to the FeedbackContext's log.
+		// Loading failed.  The actual error message will be sent to the FeedbackContext's log, unless the user canceled.
+		bOutWasCanceled = OSMFile.WasCanceled();
 		return false;
 	}
 
@@ -325,48 +227,146 @@ bool UStreetMapFactory::LoadFromOpenStreetMapXMLFile( UStreetMap* StreetMap, FSt
 	//        in integral grid cells with coordinates relative to their cell.  Of course, there will be many
 	//        other considerations for handling huge maps (loading, rendering, collision, etc.)
 
-	// Maps OSMWayInfos to the RoadIndex we created for that way
-	TMap< const FOSMFile::FOSMWayInfo*, int32 > OSMWayToRoadIndexMap;
-
-	StreetMap->BoundsMin = FVector2D( TNumericLimits<float>::Max(), TNumericLimits<float>::Max() );
-	StreetMap->BoundsMax = FVector2D( TNumericLimits<float>::Lowest(), TNumericLimits<float>::Lowest() );
-
-	for( const FOSMFile::FOSMWayInfo* OSMWay : OSMFile.Ways )
+	// Figure out which ways will become roads and buildings up front, so that each one has a known index and can be
+	// filled in independently of all the others.  Maps each OSM way (by index) to the road or building we created for
+	// that way, or INDEX_NONE if we didn't create one.
+	const int32 NumOSMWays = OSMFile.Ways.Num();
+	TArray< int32 > OSMWayIndexToRoadIndex;
+	TArray< int32 > OSMWayIndexToBuildingIndex;
+	OSMWayIndexToRoadIndex.Init( INDEX_NONE, NumOSMWays );
+	OSMWayIndexToBuildingIndex.Init( INDEX_NONE, NumOSMWays );
+
+	int32 NumRoads = 0;
+	int32 NumBuildings = 0;
+	for( int32 OSMWayIndex = 0; OSMWayIndex < NumOSMWays; ++OSMWayIndex )
 	{
+		const FOSMFile::FOSMWayInfo& OSMWay = *OSMFile.Ways[ OSMWayIndex ];
+
 		// Handle buildings differently than roads
-		if( OSMWay->WayType == FOSMFile::EOSMWayType::Building )
+		if( OSMWay.WayType == FOSMFile::EOSMWayType::Building )
 		{
-			if( AddBuildingForWay( OSMFile, *StreetMap, *OSMWay ) )
+			// Require at least three points so that we don't have degenerate polygon!
+			if( OSMWay.Nodes.Num() > 2 )
 			{
-				// ...
+				OSMWayIndexToBuildingIndex[ OSMWayIndex ] = NumBuildings++;
+			}
+			else
+			{
+				// NOTE: Skipped adding building for way because it has less than 3 points
+				// @todo: Log this for the user as an import warning
 			}
 		}
-		else
+		else if( GetRoadTypeForWayType( OSMWay.WayType ) != EStreetMapRoadType::Other )
+		{
+			// Require at least two points!
+			if( OSMWay.Nodes.Num() > 1 )
+			{
+				OSMWayIndexToRoadIndex[ OSMWayIndex ] = NumRoads++;
+			}
+			else
+			{
+				// NOTE: Skipped adding road for way because it has less than 2 points
+				// @todo: Log this for the user as an import warning
+			}
+		}
+	}
+
+	StreetMap->Roads.SetNum( NumRoads );
+	StreetMap->Buildings.SetNum( NumBuildings );
+
+	// Project every node into our map's space up front, in parallel batches.  Nodes that are shared by several ways are
+	// only projected once.  All points are transformed relative to the center of the latitude/longitude bounds, so that
+	// we get as much precision as possible.
+	const int32 NumOSMNodes = OSMFile.GetNodeCount();
+	TArray< FVector2D > NodePositions;
+	NodePositions.SetNumUninitialized( NumOSMNodes );
+	{
+		const int32 NodesPerBatch = 16 * 1024;
+		ParallelFor( FMath::DivideAndRoundUp( NumOSMNodes, NodesPerBatch ), [&]( const int32 BatchIndex )
+		{
+			const int32 FirstNodeIndex = BatchIndex * NodesPerBatch;
+			FStreetMapProjection::ProjectLatLongs(
+				OSMFile.NodeLatitudes.GetData() + FirstNodeIndex,
+				OSMFile.NodeLongitudes.GetData() + FirstNodeIndex,
+				FMath::Min( NodesPerBatch, NumOSMNodes - FirstNodeIndex ),
+				OSMFile.AverageLatitude,
+				OSMFile.AverageLongitude,
+				OSMToCentimetersScaleFactor,
+				NodePositions.GetData() + FirstNodeIndex );
+		} );
+	}
+
+	// Convert the ways in parallel.  Ways are processed in batches, and each batch accumulates its own bounds so that
+	// threads never need to share anything but the (read only) OSM file.
+	const int32 WaysPerBatch = 1024;
+	const int32 NumBatches = FMath::DivideAndRoundUp( NumOSMWays, WaysPerBatch );
+
+	TArray< FBox2D > BatchBounds;
+	BatchBounds.Init( FBox2D( ForceInit ), NumBatches );
+
+	ParallelFor( NumBatches, [&]( const int32 BatchIndex )
+	{
+		FBox2D& Bounds = BatchBounds[ BatchIndex ];
+
+		const int32 EndOSMWayIndex = FMath::Min( ( BatchIndex + 1 ) * WaysPerBatch, NumOSMWays );
+		for( int32 OSMWayIndex = BatchIndex * WaysPerBatch; OSMWayIndex < EndOSMWayIndex; ++OSMWayIndex )
 		{
-			int32 RoadIndex = INDEX_NONE;
-			if( AddRoadForWay( OSMFile, *StreetMap, *OSMWay, RoadIndex ) )
+			const FOSMFile::FOSMWayInfo& OSMWay = *OSMFile.Ways[ OSMWayIndex ];
+
+			const int32 RoadIndex = OSMWayIndexToRoadIndex[ OSMWayIndex ];
+			if( RoadIndex != INDEX_NONE )
 			{
-				OSMWayToRoadIndexMap.Add( OSMWay, RoadIndex );
+				FStreetMapRoad& NewRoad = StreetMap->Roads[ RoadIndex ];
+				FillRoadForWay( NodePositions, OSMWay, GetRoadTypeForWayType( OSMWay.WayType ), NewRoad );
+				Bounds += FBox2D( NewRoad.BoundsMin, NewRoad.BoundsMax );
+			}
+
+			const int32 BuildingIndex = OSMWayIndexToBuildingIndex[ OSMWayIndex ];
+			if( BuildingIndex != INDEX_NONE )
+			{
+				FStreetMapBuilding& NewBuilding = StreetMap->Buildings[ BuildingIndex ];
+				FillBuildingForWay( NodePositions, OSMWay, NewBuilding );
+				Bounds += FBox2D( NewBuilding.BoundsMin, NewBuilding.BoundsMax );
 			}
 		}
+	} );
+
+	FBox2D MapBounds( ForceInit );
+	for( const FBox2D& Bounds : BatchBounds )
+	{
+		MapBounds += Bounds;
 	}
 
-	for( const auto& NodeMapHashPair : OSMFile.NodeMap )
+	if( MapBounds.bIsValid )
+	{
+		StreetMap->BoundsMin = MapBounds.Min;
+		StreetMap->BoundsMax = MapBounds.Max;
+	}
+	else
 	{
-		const FOSMFile::FOSMNodeInfo& OSMNode = *NodeMapHashPair.Value;
+		StreetMap->BoundsMin = FVector2D( TNumericLimits<float>::Max(), TNumericLimits<float>::Max() );
+		StreetMap->BoundsMax = FVector2D( TNumericLimits<float>::Lowest(), TNumericLimits<float>::Lowest() );
+	}
+
+	// Remember where the map is on the globe, so that latitudes and longitudes can be projected the same way later on
+	StreetMap->SetGeographicOrigin( OSMFile.AverageLatitude, OSMFile.AverageLongitude, OSMToCentimetersScaleFactor );
+
+	for( int32 OSMNodeIndex = 0; OSMNodeIndex < NumOSMNodes; ++OSMNodeIndex )
+	{
+		const int32 FirstWayRef = OSMFile.NodeWayRefStarts[ OSMNodeIndex ];
+		const int32 EndWayRef = OSMFile.NodeWayRefStarts[ OSMNodeIndex + 1 ];
 
 		// Any ways touching this node?
-		if( OSMNode.WayRefs.Num() > 0 )
+		if( EndWayRef > FirstWayRef )
 		{
 			FStreetMapNode NewNode;
 
-			for( const FOSMFile::FOSMWayRef& OSMWayRef : OSMNode.WayRefs )
+			for( int32 WayRefIndex = FirstWayRef; WayRefIndex < EndWayRef; ++WayRefIndex )
 			{
-				const int32* FoundRoundIndexPtr = OSMWayToRoadIndexMap.Find( OSMWayRef.Way );
-				if( FoundRoundIndexPtr != nullptr )
+				const FOSMFile::FOSMWayRef& OSMWayRef = OSMFile.NodeWayRefs[ WayRefIndex ];
+				const int32 FoundRoadIndex = OSMWayIndexToRoadIndex[ OSMWayRef.WayIndex ];
+				if( FoundRoadIndex != INDEX_NONE )
 				{
-					const int32 FoundRoadIndex = *FoundRoundIndexPtr;
-
 					FStreetMapRoadRef RoadRef;
 					RoadRef.RoadIndex = FoundRoadIndex;
 
@@ -432,6 +432,14 @@ bool UStreetMapFactory::LoadFromOpenStreetMapXMLFile( UStreetMap* StreetMap, FSt
 		ensure( bHasNodeAtBeginning && bHasNodeAtEnd );
 	}
 
+	StreetMap->BuildRoadGraph();
+	StreetMap->BuildSpatialIndex();
+
+	if( bBuildContractionHierarchy )
+	{
+		StreetMap->BuildContractionHierarchy();
+	}
+
 	return true;
 }
 
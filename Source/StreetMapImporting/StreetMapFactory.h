@@ -18,15 +18,25 @@ public:
 	/** UStreetMapFactory constructor */
 	UStreetMapFactory( const class FObjectInitializer& ObjectInitializer );
 
+	/** When enabled, the file is read twice: once to find the nodes used by roads and buildings, and once to load only those
+	    nodes.  This takes a little longer, but greatly reduces the memory needed to import large files. */
+	UPROPERTY( EditAnywhere, Category = "StreetMap" )
+	uint32 bOnlyImportReferencedNodes : 1;
+
+	/** When enabled, a contraction hierarchy is built over the roads and saved with the street map.  This makes finding
+	    routes many times faster, but makes importing large maps take noticeably longer. */
+	UPROPERTY( EditAnywhere, Category = "StreetMap" )
+	uint32 bBuildContractionHierarchy : 1;
+
 protected:
 
 	// UFactory overrides
-	virtual UObject* FactoryCreateText( UClass* Class, UObject* Parent, FName Name, EObjectFlags Flags, UObject* Context, const TCHAR* Type, const TCHAR*& Buffer, const TCHAR* BufferEnd, FFeedbackContext* Warn ) override;
-
-	/** Loads the street map from an OpenStreetMap XML file.  Note that in the case of the file path containing the XML data, the string must be mutable for us to parse it quickly. */
-	bool LoadFromOpenStreetMapXMLFile( class UStreetMap* StreetMap, FString& OSMFilePath, const bool bIsFilePathActuallyTextBuffer, class FFeedbackContext* FeedbackContext );
+	virtual UObject* FactoryCreateFile( UClass* Class, UObject* Parent, FName Name, EObjectFlags Flags, const FString& Filename, const TCHAR* Parms, FFeedbackContext* Warn, bool& bOutOperationCanceled ) override;
 
-	/** Static: Latitude/longitude scale factor */
-	static const double LatitudeLongitudeScale;
+	/**
+	 * Loads the street map from an OpenStreetMap XML or PBF file.  The file is streamed from disk rather than loaded into memory
+	 * up front.  bOutWasCanceled is set if loading failed because the user canceled it.
+	 */
+	bool LoadFromOpenStreetMapFile( class UStreetMap* StreetMap, const FString& OSMFilePath, class FFeedbackContext* FeedbackContext, bool& bOutWasCanceled );
 };
 
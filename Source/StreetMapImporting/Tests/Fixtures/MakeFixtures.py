@@ -0,0 +1,162 @@
+# Copyright 2017 Mike Fricker. All Rights Reserved.
+#
+# Writes the same small map as both OpenStreetMap XML and PBF, for the importer's automation tests.  Run it from this
+# directory after changing the map; the tests check for exactly this data.
+
+import struct
+import zlib
+
+# ID, latitude, longitude.  Coordinates are whole multiples of the PBF granularity (100 nanodegrees).
+DENSE_NODES = [
+	( 100, 40.7128000, -74.0060000 ),
+	( 101, 40.7130500, -74.0055000 ),
+	( 102, 40.7127500, -74.0049000 ),
+	( 105, 40.7135000, -74.0062500 ),
+	( 110, 40.7122000, -74.0071000 ),
+]
+
+# Stored as a plain (not dense) node, in a group of its own
+PLAIN_NODES = [
+	( 200, -33.8688000, 151.2093000 ),
+]
+
+# ID, node refs, tags.  Node 999 isn't in the file, like ways that cross the edge of a clipped extract.
+WAYS = [
+	( 1, [ 100, 101, 102 ], [ ( "highway", "residential" ), ( "name", "Église Street" ), ( "oneway", "yes" ) ] ),
+	( 2, [ 102, 105, 110 ], [ ( "highway", "primary" ), ( "ref", "A1" ), ( "oneway", "no" ) ] ),
+	( 3, [ 100, 105, 110, 200, 100 ], [ ( "building", "yes" ), ( "height", "12.5" ), ( "building:levels", "4" ) ] ),
+	( 4, [ 101, 999, 102 ], [ ( "highway", "footway" ), ( "surface", "paved" ) ] ),
+]
+
+
+def varint( Value ):
+	Out = bytearray()
+	while True:
+		Byte = Value & 0x7F
+		Value >>= 7
+		if Value:
+			Out.append( Byte | 0x80 )
+		else:
+			Out.append( Byte )
+			return bytes( Out )
+
+def zigzag( Value ):
+	return ( Value << 1 ) ^ ( Value >> 63 )
+
+def key( Field, WireType ):
+	return varint( ( Field << 3 ) | WireType )
+
+def field_varint( Field, Value ):
+	return key( Field, 0 ) + varint( Value )
+
+def field_bytes( Field, Data ):
+	return key( Field, 2 ) + varint( len( Data ) ) + Data
+
+def packed_sint( Field, Values ):
+	return field_bytes( Field, b"".join( varint( zigzag( Value ) ) for Value in Values ) )
+
+def packed_uint( Field, Values ):
+	return field_bytes( Field, b"".join( varint( Value ) for Value in Values ) )
+
+def deltas( Values ):
+	Previous = 0
+	Out = []
+	for Value in Values:
+		Out.append( Value - Previous )
+		Previous = Value
+	return Out
+
+def fixed( Degrees ):
+	return int( round( Degrees * 10000000 ) )
+
+
+def write_blob( File, BlobType, Payload ):
+	Blob = field_varint( 2, len( Payload ) ) + field_bytes( 3, zlib.compress( Payload ) )
+	Header = field_bytes( 1, BlobType.encode() ) + field_varint( 3, len( Blob ) )
+	File.write( struct.pack( ">I", len( Header ) ) + Header + Blob )
+
+
+def write_pbf( Path ):
+	Strings = [ "" ]
+	def string_index( String ):
+		if String not in Strings:
+			Strings.append( String )
+		return Strings.index( String )
+
+	DenseNodes = ( packed_sint( 1, deltas( [ Node[ 0 ] for Node in DENSE_NODES ] ) ) +
+		packed_sint( 8, deltas( [ fixed( Node[ 1 ] ) for Node in DENSE_NODES ] ) ) +
+		packed_sint( 9, deltas( [ fixed( Node[ 2 ] ) for Node in DENSE_NODES ] ) ) )
+	DenseGroup = field_bytes( 2, DenseNodes )
+
+	PlainGroup = b"".join( field_bytes( 1,
+		key( 1, 0 ) + varint( zigzag( Node[ 0 ] ) ) +
+		key( 8, 0 ) + varint( zigzag( fixed( Node[ 1 ] ) ) ) +
+		key( 9, 0 ) + varint( zigzag( fixed( Node[ 2 ] ) ) ) ) for Node in PLAIN_NODES )
+
+	WayGroup = b"".join( field_bytes( 3,
+		field_varint( 1, Way[ 0 ] ) +
+		packed_uint( 2, [ string_index( Tag[ 0 ] ) for Tag in Way[ 2 ] ] ) +
+		packed_uint( 3, [ string_index( Tag[ 1 ] ) for Tag in Way[ 2 ] ] ) +
+		packed_sint( 8, deltas( Way[ 1 ] ) ) ) for Way in WAYS )
+
+	StringTable = b"".join( field_bytes( 1, String.encode( "utf-8" ) ) for String in Strings )
+	Block = field_bytes( 1, StringTable ) + field_bytes( 2, DenseGroup ) + field_bytes( 2, PlainGroup ) + field_bytes( 2, WayGroup ) + field_varint( 17, 100 )
+
+	Header = field_bytes( 4, b"OsmSchema-V0.6" ) + field_bytes( 4, b"DenseNodes" ) + field_bytes( 16, b"StreetMap fixture" )
+
+	with open( Path, "wb" ) as File:
+		write_blob( File, "OSMHeader", Header )
+		write_blob( File, "OSMData", Block )
+
+
+def write_xml( Path ):
+	def escape( String ):
+		return String.replace( "&", "&amp;" ).replace( "\"", "&quot;" ).replace( "<", "&lt;" )
+
+	Lines = [ "<?xml version='1.0' encoding='UTF-8'?>", "<osm version=\"0.6\" generator=\"StreetMap fixture\">" ]
+	for Node in DENSE_NODES + PLAIN_NODES:
+		Lines.append( "  <node id=\"%d\" lat=\"%.7f\" lon=\"%.7f\"/>" % Node )
+	for Way in WAYS:
+		Lines.append( "  <way id=\"%d\">" % Way[ 0 ] )
+		for NodeRef in Way[ 1 ]:
+			Lines.append( "    <nd ref=\"%d\"/>" % NodeRef )
+		for Tag in Way[ 2 ]:
+			Lines.append( "    <tag k=\"%s\" v=\"%s\"/>" % ( escape( Tag[ 0 ] ), escape( Tag[ 1 ] ) ) )
+		Lines.append( "  </way>" )
+	Lines.append( "</osm>" )
+
+	with open( Path, "w", encoding="utf-8", newline="\n" ) as File:
+		File.write( "\n".join( Lines ) + "\n" )
+
+
+def write_unsorted_xml( Path ):
+	# Like a file saved by an editor such as JOSM: new objects have negative IDs, nodes aren't sorted, nodes and ways are
+	# interleaved, and a way can reference a node that comes after it
+	Lines = [ "<?xml version='1.0' encoding='UTF-8'?>", "<osm version=\"0.6\" generator=\"StreetMap fixture\">",
+		"  <node id=\"-1\" lat=\"51.5007000\" lon=\"-0.1246000\"/>",
+		"  <node id=\"-5\" lat=\"51.5010000\" lon=\"-0.1240000\"/>",
+		"  <way id=\"-10\">",
+		"    <nd ref=\"-1\"/>",
+		"    <nd ref=\"-5\"/>",
+		"    <tag k=\"highway\" v=\"service\"/>",
+		"  </way>",
+		"  <node id=\"-3\" lat=\"51.5003000\" lon=\"-0.1250000\"/>",
+		"  <node id=\"7\" lat=\"51.5001000\" lon=\"-0.1255000\"/>",
+		"  <way id=\"-11\">",
+		"    <nd ref=\"-3\"/>",
+		"    <nd ref=\"7\"/>",
+		"    <nd ref=\"-1\"/>",
+		"    <nd ref=\"-42\"/>",
+		"    <nd ref=\"-20\"/>",
+		"    <tag k=\"highway\" v=\"tertiary\"/>",
+		"  </way>",
+		"  <node id=\"-20\" lat=\"51.4999000\" lon=\"-0.1260000\"/>",
+		"</osm>" ]
+
+	with open( Path, "w", encoding="utf-8", newline="\n" ) as File:
+		File.write( "\n".join( Lines ) + "\n" )
+
+
+write_pbf( "Fixture.osm.pbf" )
+write_xml( "Fixture.osm" )
+write_unsorted_xml( "Unsorted.osm" )
@@ -0,0 +1,212 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapImporting.h"
+#include "OSMFile.h"
+#include "IPluginManager.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+namespace OSMFileTests
+{
+	/** Gets the path to one of the files written by Tests/Fixtures/MakeFixtures.py */
+	static FString GetFixturePath( const TCHAR* FileName )
+	{
+		return IPluginManager::Get().FindPlugin( TEXT( "StreetMap" ) )->GetBaseDir() / TEXT( "Source/StreetMapImporting/Tests/Fixtures" ) / FileName;
+	}
+
+	struct FExpectedNode
+	{
+		int64 ID;
+		double Latitude;
+		double Longitude;
+	};
+
+	/** The fixture's nodes, in file order.  The last one isn't stored as a dense node in the PBF file. */
+	static const FExpectedNode ExpectedNodes[] =
+	{
+		{ 100, 40.7128000, -74.0060000 },
+		{ 101, 40.7130500, -74.0055000 },
+		{ 102, 40.7127500, -74.0049000 },
+		{ 105, 40.7135000, -74.0062500 },
+		{ 110, 40.7122000, -74.0071000 },
+		{ 200, -33.8688000, 151.2093000 },
+	};
+
+	/** PBF coordinates are in units of 100 nanodegrees, so anything closer than this is the same coordinate */
+	static const double CoordinateTolerance = 1e-8;
+
+	/** Gets the IDs of the nodes on a way */
+	static TArray<int64> GetWayNodeIDs( const FOSMFile& OSMFile, const FOSMFile::FOSMWayInfo& Way )
+	{
+		TArray<int64> NodeIDs;
+		for( const int32 NodeIndex : Way.Nodes )
+		{
+			NodeIDs.Add( OSMFile.NodeIDs[ NodeIndex ] );
+		}
+		return NodeIDs;
+	}
+
+	/** Checks that the fixture was loaded with all of its nodes and ways */
+	static void TestFixtureContents( FAutomationTestBase& Test, const FOSMFile& OSMFile )
+	{
+		if( !Test.TestEqual( TEXT( "Node count" ), OSMFile.GetNodeCount(), (int32)ARRAY_COUNT( ExpectedNodes ) ) )
+		{
+			return;
+		}
+
+		for( int32 NodeIndex = 0; NodeIndex < OSMFile.GetNodeCount(); ++NodeIndex )
+		{
+			const FExpectedNode& Expected = ExpectedNodes[ NodeIndex ];
+			Test.TestEqual( *FString::Printf( TEXT( "Node %i ID" ), NodeIndex ), OSMFile.NodeIDs[ NodeIndex ], Expected.ID );
+			Test.TestEqual( *FString::Printf( TEXT( "Node %i latitude" ), NodeIndex ), OSMFile.NodeLatitudes[ NodeIndex ], Expected.Latitude, CoordinateTolerance );
+			Test.TestEqual( *FString::Printf( TEXT( "Node %i longitude" ), NodeIndex ), OSMFile.NodeLongitudes[ NodeIndex ], Expected.Longitude, CoordinateTolerance );
+		}
+
+		if( !Test.TestEqual( TEXT( "Way count" ), OSMFile.Ways.Num(), 4 ) )
+		{
+			return;
+		}
+
+		const FOSMFile::FOSMWayInfo& Street = *OSMFile.Ways[ 0 ];
+		Test.TestTrue( TEXT( "Street node refs" ), GetWayNodeIDs( OSMFile, Street ) == TArray<int64>( { 100, 101, 102 } ) );
+		Test.TestTrue( TEXT( "Street type" ), Street.WayType == FOSMFile::EOSMWayType::Residential );
+		Test.TestEqual( TEXT( "Street name" ), *Street.Name, TEXT( "\u00C9glise Street" ) );
+		Test.TestTrue( TEXT( "Street is one way" ), Street.bIsOneWay == 1 );
+
+		const FOSMFile::FOSMWayInfo& Highway = *OSMFile.Ways[ 1 ];
+		Test.TestTrue( TEXT( "Highway node refs" ), GetWayNodeIDs( OSMFile, Highway ) == TArray<int64>( { 102, 105, 110 } ) );
+		Test.TestTrue( TEXT( "Highway type" ), Highway.WayType == FOSMFile::EOSMWayType::Primary );
+		Test.TestEqual( TEXT( "Highway ref" ), *Highway.Ref, TEXT( "A1" ) );
+		Test.TestFalse( TEXT( "Highway is one way" ), Highway.bIsOneWay == 1 );
+
+		const FOSMFile::FOSMWayInfo& Building = *OSMFile.Ways[ 2 ];
+		Test.TestTrue( TEXT( "Building node refs" ), GetWayNodeIDs( OSMFile, Building ) == TArray<int64>( { 100, 105, 110, 200, 100 } ) );
+		Test.TestTrue( TEXT( "Building type" ), Building.WayType == FOSMFile::EOSMWayType::Building );
+		Test.TestEqual( TEXT( "Building height" ), Building.Height, 12.5 );
+		Test.TestEqual( TEXT( "Building levels" ), Building.BuildingLevels, 4 );
+
+		// Node 999 isn't in the file, so it's skipped
+		const FOSMFile::FOSMWayInfo& Footway = *OSMFile.Ways[ 3 ];
+		Test.TestTrue( TEXT( "Footway node refs" ), GetWayNodeIDs( OSMFile, Footway ) == TArray<int64>( { 101, 102 } ) );
+		Test.TestTrue( TEXT( "Footway type" ), Footway.WayType == FOSMFile::EOSMWayType::Footway );
+
+		// Node 100 is on the street and (twice) on the building
+		const int32 FirstWayRef = OSMFile.NodeWayRefStarts[ 0 ];
+		Test.TestEqual( TEXT( "Way refs of node 100" ), OSMFile.NodeWayRefStarts[ 1 ] - FirstWayRef, 3 );
+	}
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FOSMFilePbfTest, "StreetMap.Importing.OSMFile.Pbf", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter )
+
+bool FOSMFilePbfTest::RunTest( const FString& Parameters )
+{
+	FOSMFile OSMFile;
+	if( !TestTrue( TEXT( "Loaded PBF fixture" ), OSMFile.LoadOpenStreetMapFile( OSMFileTests::GetFixturePath( TEXT( "Fixture.osm.pbf" ) ), nullptr, nullptr ) ) )
+	{
+		return false;
+	}
+
+	OSMFileTests::TestFixtureContents( *this, OSMFile );
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FOSMFileXmlTest, "StreetMap.Importing.OSMFile.Xml", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter )
+
+bool FOSMFileXmlTest::RunTest( const FString& Parameters )
+{
+	FOSMFile OSMFile;
+	if( !TestTrue( TEXT( "Loaded XML fixture" ), OSMFile.LoadOpenStreetMapFile( OSMFileTests::GetFixturePath( TEXT( "Fixture.osm" ) ), nullptr, nullptr ) ) )
+	{
+		return false;
+	}
+
+	OSMFileTests::TestFixtureContents( *this, OSMFile );
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FOSMFilePbfMatchesXmlTest, "StreetMap.Importing.OSMFile.PbfMatchesXml", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter )
+
+bool FOSMFilePbfMatchesXmlTest::RunTest( const FString& Parameters )
+{
+	// Load both with the referenced nodes filter too, so the two pass load of each format is covered
+	const FOSMFile::FWayFilter OnlyBuildings = []( const FOSMFile::FOSMWayInfo& Way )
+	{
+		return Way.WayType == FOSMFile::EOSMWayType::Building;
+	};
+
+	for( const FOSMFile::FWayFilter& WayFilter : { FOSMFile::FWayFilter(), OnlyBuildings } )
+	{
+		FOSMFile PbfFile, XmlFile;
+		if( !TestTrue( TEXT( "Loaded PBF fixture" ), PbfFile.LoadOpenStreetMapFile( OSMFileTests::GetFixturePath( TEXT( "Fixture.osm.pbf" ) ), WayFilter, nullptr ) ) ||
+			!TestTrue( TEXT( "Loaded XML fixture" ), XmlFile.LoadOpenStreetMapFile( OSMFileTests::GetFixturePath( TEXT( "Fixture.osm" ) ), WayFilter, nullptr ) ) )
+		{
+			return false;
+		}
+
+		TestTrue( TEXT( "Node IDs match" ), PbfFile.NodeIDs == XmlFile.NodeIDs );
+		if( PbfFile.GetNodeCount() == XmlFile.GetNodeCount() )
+		{
+			for( int32 NodeIndex = 0; NodeIndex < PbfFile.GetNodeCount(); ++NodeIndex )
+			{
+				TestEqual( TEXT( "Latitudes match" ), PbfFile.NodeLatitudes[ NodeIndex ], XmlFile.NodeLatitudes[ NodeIndex ], OSMFileTests::CoordinateTolerance );
+				TestEqual( TEXT( "Longitudes match" ), PbfFile.NodeLongitudes[ NodeIndex ], XmlFile.NodeLongitudes[ NodeIndex ], OSMFileTests::CoordinateTolerance );
+			}
+		}
+		TestEqual( TEXT( "Average latitudes match" ), PbfFile.AverageLatitude, XmlFile.AverageLatitude, OSMFileTests::CoordinateTolerance );
+		TestEqual( TEXT( "Average longitudes match" ), PbfFile.AverageLongitude, XmlFile.AverageLongitude, OSMFileTests::CoordinateTolerance );
+
+		if( TestEqual( TEXT( "Way counts match" ), PbfFile.Ways.Num(), XmlFile.Ways.Num() ) )
+		{
+			for( int32 WayIndex = 0; WayIndex < PbfFile.Ways.Num(); ++WayIndex )
+			{
+				const FOSMFile::FOSMWayInfo& PbfWay = *PbfFile.Ways[ WayIndex ];
+				const FOSMFile::FOSMWayInfo& XmlWay = *XmlFile.Ways[ WayIndex ];
+				TestTrue( TEXT( "Way node refs match" ), OSMFileTests::GetWayNodeIDs( PbfFile, PbfWay ) == OSMFileTests::GetWayNodeIDs( XmlFile, XmlWay ) );
+				TestTrue( TEXT( "Way types match" ), PbfWay.WayType == XmlWay.WayType );
+				TestEqual( TEXT( "Way names match" ), *PbfWay.Name, *XmlWay.Name );
+				TestEqual( TEXT( "Way refs match" ), *PbfWay.Ref, *XmlWay.Ref );
+				TestEqual( TEXT( "Way heights match" ), PbfWay.Height, XmlWay.Height );
+				TestEqual( TEXT( "Way building levels match" ), PbfWay.BuildingLevels, XmlWay.BuildingLevels );
+				TestTrue( TEXT( "Way one way flags match" ), PbfWay.bIsOneWay == XmlWay.bIsOneWay );
+			}
+		}
+
+		TestTrue( TEXT( "Node way refs match" ), PbfFile.NodeWayRefStarts == XmlFile.NodeWayRefStarts );
+	}
+
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FOSMFileUnsortedTest, "StreetMap.Importing.OSMFile.Unsorted", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter )
+
+bool FOSMFileUnsortedTest::RunTest( const FString& Parameters )
+{
+	FOSMFile OSMFile;
+	if( !TestTrue( TEXT( "Loaded unsorted fixture" ), OSMFile.LoadOpenStreetMapFile( OSMFileTests::GetFixturePath( TEXT( "Unsorted.osm" ) ), nullptr, nullptr ) ) )
+	{
+		return false;
+	}
+
+	TestTrue( TEXT( "Node IDs in file order" ), OSMFile.NodeIDs == TArray<int64>( { -1, -5, -3, 7, -20 } ) );
+	if( !TestEqual( TEXT( "Way count" ), OSMFile.Ways.Num(), 2 ) )
+	{
+		return false;
+	}
+
+	TestTrue( TEXT( "First way node refs" ), OSMFileTests::GetWayNodeIDs( OSMFile, *OSMFile.Ways[ 0 ] ) == TArray<int64>( { -1, -5 } ) );
+
+	// Node -42 isn't in the file, and node -20 comes after the way
+	TestTrue( TEXT( "Second way node refs" ), OSMFileTests::GetWayNodeIDs( OSMFile, *OSMFile.Ways[ 1 ] ) == TArray<int64>( { -3, 7, -1, -20 } ) );
+	TestEqual( TEXT( "Way refs of node -1" ), OSMFile.NodeWayRefStarts[ 1 ] - OSMFile.NodeWayRefStarts[ 0 ], 2 );
+	TestEqual( TEXT( "Way refs of node -20" ), OSMFile.NodeWayRefStarts[ 5 ] - OSMFile.NodeWayRefStarts[ 4 ], 1 );
+	return true;
+}
+
+
+#endif	// WITH_DEV_AUTOMATION_TESTS
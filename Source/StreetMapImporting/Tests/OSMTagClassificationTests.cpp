@@ -0,0 +1,200 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapImporting.h"
+#include "OSMFile.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+namespace OSMTagClassificationTests
+{
+	struct FTag
+	{
+		const TCHAR* Key;
+		const TCHAR* Value;
+	};
+
+	/** Tags as they turn up on ways in a typical city extract: lots of tags we don't care about, mixed in with the ones we do */
+	static const FTag Tags[] =
+	{
+		{ TEXT( "highway" ), TEXT( "residential" ) },
+		{ TEXT( "name" ), TEXT( "Main Street" ) },
+		{ TEXT( "surface" ), TEXT( "asphalt" ) },
+		{ TEXT( "maxspeed" ), TEXT( "25 mph" ) },
+		{ TEXT( "lanes" ), TEXT( "2" ) },
+		{ TEXT( "oneway" ), TEXT( "yes" ) },
+		{ TEXT( "tiger:county" ), TEXT( "Kings, NY" ) },
+		{ TEXT( "highway" ), TEXT( "service" ) },
+		{ TEXT( "service" ), TEXT( "driveway" ) },
+		{ TEXT( "building" ), TEXT( "yes" ) },
+		{ TEXT( "addr:housenumber" ), TEXT( "221" ) },
+		{ TEXT( "addr:street" ), TEXT( "Baker Street" ) },
+		{ TEXT( "height" ), TEXT( "12.5" ) },
+		{ TEXT( "building:levels" ), TEXT( "4" ) },
+		{ TEXT( "source" ), TEXT( "survey" ) },
+		{ TEXT( "highway" ), TEXT( "footway" ) },
+		{ TEXT( "footway" ), TEXT( "sidewalk" ) },
+		{ TEXT( "highway" ), TEXT( "primary" ) },
+		{ TEXT( "ref" ), TEXT( "A1" ) },
+		{ TEXT( "HIGHWAY" ), TEXT( "Motorway_Link" ) },
+		{ TEXT( "highway" ), TEXT( "bus_stop" ) },
+		{ TEXT( "amenity" ), TEXT( "parking" ) },
+		{ TEXT( "building" ), TEXT( "house" ) },
+		{ TEXT( "highway" ), TEXT( "tertiary_link" ) },
+	};
+
+	struct FWayTypeTag
+	{
+		const TCHAR* Key;
+		const TCHAR* Value;
+		FOSMFile::EOSMWayType WayType;
+	};
+
+	/** Every way type tag, in the order the importer used to compare them one by one */
+	static const FWayTypeTag WayTypeTags[] =
+	{
+		{ TEXT( "highway" ), TEXT( "motorway" ), FOSMFile::EOSMWayType::Motorway },
+		{ TEXT( "highway" ), TEXT( "motorway_link" ), FOSMFile::EOSMWayType::Motorway_Link },
+		{ TEXT( "highway" ), TEXT( "trunk" ), FOSMFile::EOSMWayType::Trunk },
+		{ TEXT( "highway" ), TEXT( "trunk_link" ), FOSMFile::EOSMWayType::Trunk_Link },
+		{ TEXT( "highway" ), TEXT( "primary" ), FOSMFile::EOSMWayType::Primary },
+		{ TEXT( "highway" ), TEXT( "primary_link" ), FOSMFile::EOSMWayType::Primary_Link },
+		{ TEXT( "highway" ), TEXT( "secondary" ), FOSMFile::EOSMWayType::Secondary },
+		{ TEXT( "highway" ), TEXT( "secondary_link" ), FOSMFile::EOSMWayType::Secondary_Link },
+		{ TEXT( "highway" ), TEXT( "tertiary" ), FOSMFile::EOSMWayType::Tertiary },
+		{ TEXT( "highway" ), TEXT( "tertiary_link" ), FOSMFile::EOSMWayType::Tertiary_Link },
+		{ TEXT( "highway" ), TEXT( "residential" ), FOSMFile::EOSMWayType::Residential },
+		{ TEXT( "highway" ), TEXT( "service" ), FOSMFile::EOSMWayType::Service },
+		{ TEXT( "highway" ), TEXT( "unclassified" ), FOSMFile::EOSMWayType::Unclassified },
+		{ TEXT( "highway" ), TEXT( "living_street" ), FOSMFile::EOSMWayType::Living_Street },
+		{ TEXT( "highway" ), TEXT( "pedestrian" ), FOSMFile::EOSMWayType::Pedestrian },
+		{ TEXT( "highway" ), TEXT( "track" ), FOSMFile::EOSMWayType::Track },
+		{ TEXT( "highway" ), TEXT( "bus_guideway" ), FOSMFile::EOSMWayType::Bus_Guideway },
+		{ TEXT( "highway" ), TEXT( "raceway" ), FOSMFile::EOSMWayType::Raceway },
+		{ TEXT( "highway" ), TEXT( "road" ), FOSMFile::EOSMWayType::Road },
+		{ TEXT( "highway" ), TEXT( "footway" ), FOSMFile::EOSMWayType::Footway },
+		{ TEXT( "highway" ), TEXT( "cycleway" ), FOSMFile::EOSMWayType::Cycleway },
+		{ TEXT( "highway" ), TEXT( "bridleway" ), FOSMFile::EOSMWayType::Bridleway },
+		{ TEXT( "highway" ), TEXT( "steps" ), FOSMFile::EOSMWayType::Steps },
+		{ TEXT( "highway" ), TEXT( "path" ), FOSMFile::EOSMWayType::Path },
+		{ TEXT( "highway" ), TEXT( "proposed" ), FOSMFile::EOSMWayType::Proposed },
+		{ TEXT( "highway" ), TEXT( "construction" ), FOSMFile::EOSMWayType::Construction },
+		{ TEXT( "building" ), nullptr, FOSMFile::EOSMWayType::Building },
+	};
+
+	/** The way tags used to be classified: a case insensitive comparison against every known tag, one after another */
+	static bool ClassifyWithLinearScan( const TCHAR* Key, const TCHAR* Value, FOSMFile::EOSMWayType& OutWayType )
+	{
+		bool bIsWayTypeKey = false;
+		for( const FWayTypeTag& WayTypeTag : WayTypeTags )
+		{
+			if( !FCString::Stricmp( WayTypeTag.Key, Key ) )
+			{
+				bIsWayTypeKey = true;
+				if( WayTypeTag.Value == nullptr || !FCString::Stricmp( WayTypeTag.Value, Value ) )
+				{
+					OutWayType = WayTypeTag.WayType;
+					return true;
+				}
+			}
+		}
+
+		if( bIsWayTypeKey )
+		{
+			OutWayType = FOSMFile::EOSMWayType::Other;
+		}
+		return bIsWayTypeKey;
+	}
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FOSMTagClassificationTest, "StreetMap.Importing.TagClassification", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter )
+
+bool FOSMTagClassificationTest::RunTest( const FString& Parameters )
+{
+	using namespace OSMTagClassificationTests;
+
+	FOSMFile OSMFile;
+
+	// Every way type tag, plus the everyday tags, must classify the same way as comparing against every known tag
+	TArray<FTag> TagsToCheck( Tags, ARRAY_COUNT( Tags ) );
+	for( const FWayTypeTag& WayTypeTag : WayTypeTags )
+	{
+		TagsToCheck.Add( FTag{ WayTypeTag.Key, WayTypeTag.Value != nullptr ? WayTypeTag.Value : TEXT( "commercial" ) } );
+	}
+
+	for( const FTag& Tag : TagsToCheck )
+	{
+		FOSMFile::FOSMWayInfo* Way = OSMFile.BeginWay();
+		OSMFile.ApplyWayTag( *Way, Tag.Key, Tag.Value );
+
+		FOSMFile::EOSMWayType ExpectedWayType = FOSMFile::EOSMWayType::Other;
+		ClassifyWithLinearScan( Tag.Key, Tag.Value, ExpectedWayType );
+		TestTrue( *FString::Printf( TEXT( "%s=%s" ), Tag.Key, Tag.Value ), Way->WayType == ExpectedWayType );
+
+		delete Way;
+	}
+
+	// The other tags we care about
+	FOSMFile::FOSMWayInfo* Way = OSMFile.BeginWay();
+	OSMFile.ApplyWayTag( *Way, TEXT( "Name" ), TEXT( "Main Street" ) );
+	OSMFile.ApplyWayTag( *Way, TEXT( "ref" ), TEXT( "A1" ) );
+	OSMFile.ApplyWayTag( *Way, TEXT( "height" ), TEXT( "12.5" ) );
+	OSMFile.ApplyWayTag( *Way, TEXT( "building:levels" ), TEXT( "4" ) );
+	OSMFile.ApplyWayTag( *Way, TEXT( "oneway" ), TEXT( "YES" ) );
+	TestEqual( TEXT( "name" ), *Way->Name, TEXT( "Main Street" ) );
+	TestEqual( TEXT( "ref" ), *Way->Ref, TEXT( "A1" ) );
+	TestEqual( TEXT( "height" ), Way->Height, 12.5 );
+	TestEqual( TEXT( "building:levels" ), Way->BuildingLevels, 4 );
+	TestTrue( TEXT( "oneway" ), Way->bIsOneWay == 1 );
+	delete Way;
+
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FOSMTagClassificationBenchmark, "StreetMap.Importing.TagClassification.Benchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter )
+
+bool FOSMTagClassificationBenchmark::RunTest( const FString& Parameters )
+{
+	using namespace OSMTagClassificationTests;
+
+	const int32 NumPasses = 100000;
+	const int32 NumTags = NumPasses * ARRAY_COUNT( Tags );
+
+	FOSMFile OSMFile;
+	FOSMFile::FOSMWayInfo* Way = OSMFile.BeginWay();
+
+	const double HashedStartTime = FPlatformTime::Seconds();
+	for( int32 Pass = 0; Pass < NumPasses; ++Pass )
+	{
+		for( const FTag& Tag : Tags )
+		{
+			OSMFile.ApplyWayTag( *Way, Tag.Key, Tag.Value );
+		}
+	}
+	const double HashedSeconds = FPlatformTime::Seconds() - HashedStartTime;
+
+	// Only classifies way types, so it does a little less work than ApplyWayTag()
+	int32 NumWayTypeTags = 0;
+	const double LinearStartTime = FPlatformTime::Seconds();
+	for( int32 Pass = 0; Pass < NumPasses; ++Pass )
+	{
+		for( const FTag& Tag : Tags )
+		{
+			NumWayTypeTags += ClassifyWithLinearScan( Tag.Key, Tag.Value, Way->WayType ) ? 1 : 0;
+		}
+	}
+	const double LinearSeconds = FPlatformTime::Seconds() - LinearStartTime;
+
+	delete Way;
+
+	AddInfo( FString::Printf( TEXT( "Hashed lookup: %.1f ns per tag (%i tags)" ), HashedSeconds * 1e9 / NumTags, NumTags ) );
+	AddInfo( FString::Printf( TEXT( "Linear Stricmp scan: %.1f ns per tag (%i of them way types)" ), LinearSeconds * 1e9 / NumTags, NumWayTypeTags ) );
+	AddInfo( FString::Printf( TEXT( "Speedup: %.2fx" ), LinearSeconds / FMath::Max( HashedSeconds, 1e-9 ) ) );
+	return true;
+}
+
+
+#endif	// WITH_DEV_AUTOMATION_TESTS
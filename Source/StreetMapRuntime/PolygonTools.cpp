@@ -3,75 +3,1007 @@
 #include "PolygonTools.h"
 
 
-// Based off "Efficient Polygon Triangulation" algorithm by John W. Ratcliff (http://flipcode.net/archives/Efficient_Polygon_Triangulation.shtml)
-bool FPolygonTools::TriangulatePolygon( const TArray<FVector2D>& Polygon, TArray<int32>& TempIndices, TArray<int32>& TriangulatedIndices, bool& OutWindsClockwise )
+/**
+ * Ear clipping triangulator, based off the "earcut" algorithm by Mapbox (https://github.com/mapbox/earcut, ISC license.)
+ *
+ * The polygon is kept in a doubly linked list of vertices, so removing an ear is O(1).  For larger polygons, vertices are
+ * also linked in z-order (Morton curve) order, so that checking whether any vertex lies inside a candidate ear only needs to
+ * look at the vertices whose z-order falls within the ear's bounding box, rather than at every vertex in the polygon.
+ * Holes are joined to the outer contour with bridge edges before clipping, and polygons that can't be clipped cleanly
+ * (self intersections, degenerate points) are cured or split into smaller polygons instead of failing.
+ *
+ * Vertices are stored in an array and linked by index, so that a triangulation only needs a single allocation.
+ */
+class FEarClipper
 {
-	checkSlow( &TempIndices != &TriangulatedIndices );
-	TriangulatedIndices.Reset();
-	OutWindsClockwise = false;
 
-	int32 NumVertices = Polygon.Num();
-	if( NumVertices < 3 )
+public:
+
+	FEarClipper( const TArray<FVector2D>& InPoints, TArray<int32>& InTriangulatedIndices )
+		: Points( InPoints ),
+		  TriangulatedIndices( InTriangulatedIndices ),
+		  MinX( 0.0 ),
+		  MinY( 0.0 ),
+		  InvSize( 0.0 )
 	{
-		return false;
 	}
 
-	// Allocate and initialize a list of vertex indices for the new polygon
-	TempIndices.SetNumUninitialized( NumVertices );
-	int32* VertexIndices = TempIndices.GetData();
+	/** Triangulates the polygon */
+	void Triangulate( const TArray<int32>& HoleStartIndices )
+	{
+		const int32 OuterEnd = HoleStartIndices.Num() > 0 ? HoleStartIndices[ 0 ] : Points.Num();
+
+		Nodes.Reserve( Points.Num() + HoleStartIndices.Num() * 2 + 8 );
+		int32 OuterNode = LinkContour( 0, OuterEnd, true );
+		if( OuterNode == INDEX_NONE || Nodes[ OuterNode ].Next == Nodes[ OuterNode ].Prev )
+		{
+			return;
+		}
+
+		if( HoleStartIndices.Num() > 0 )
+		{
+			OuterNode = EliminateHoles( HoleStartIndices, OuterNode );
+		}
+
+		// Small polygons are faster to triangulate without the z-order hash
+		if( Points.Num() > 80 )
+		{
+			double MaxX = MinX = Points[ 0 ].X;
+			double MaxY = MinY = Points[ 0 ].Y;
+			for( int32 PointIndex = 1; PointIndex < OuterEnd; ++PointIndex )
+			{
+				MinX = FMath::Min( MinX, (double)Points[ PointIndex ].X );
+				MinY = FMath::Min( MinY, (double)Points[ PointIndex ].Y );
+				MaxX = FMath::Max( MaxX, (double)Points[ PointIndex ].X );
+				MaxY = FMath::Max( MaxY, (double)Points[ PointIndex ].Y );
+			}
+
+			// Coordinates are scaled into a 15-bit range for computing the z-order
+			InvSize = FMath::Max( MaxX - MinX, MaxY - MinY );
+			InvSize = InvSize != 0.0 ? 32767.0 / InvSize : 0.0;
+		}
+
+		ClipEars( OuterNode, 0 );
+	}
+
+
+private:
+
+	struct FNode
+	{
+		/** Index of the vertex in the original point array */
+		int32 PointIndex;
+
+		double X;
+		double Y;
+
+		/** Previous and next vertices in the polygon */
+		int32 Prev;
+		int32 Next;
+
+		/** Z-order curve value of this vertex */
+		int32 Z;
+
+		/** Previous and next vertices in z-order, or INDEX_NONE */
+		int32 PrevZ;
+		int32 NextZ;
+
+		/** True for a "hole" that is just a single point */
+		bool bIsSteiner;
+	};
 
-	// We want a counter-clockwise polygon
-	OutWindsClockwise = Area( Polygon ) < 0.0f;
-	if( !OutWindsClockwise )
+	/** Creates a circular linked list from a range of points, in the specified winding order.  Returns the last node. */
+	int32 LinkContour( const int32 Start, const int32 End, const bool bCounterClockwise )
 	{
-		for( int32 PointIndex = 0; PointIndex < NumVertices; PointIndex++ )
+		double SignedArea = 0.0;
+		for( int32 I = Start, J = End - 1; I < End; J = I++ )
+		{
+			SignedArea += ( (double)Points[ J ].X - Points[ I ].X ) * ( (double)Points[ I ].Y + Points[ J ].Y );
+		}
+
+		int32 Last = INDEX_NONE;
+		if( bCounterClockwise == ( SignedArea > 0.0 ) )
+		{
+			for( int32 PointIndex = Start; PointIndex < End; ++PointIndex )
+			{
+				Last = InsertNode( PointIndex, Last );
+			}
+		}
+		else
 		{
-			VertexIndices[ PointIndex ] = PointIndex;
+			for( int32 PointIndex = End - 1; PointIndex >= Start; --PointIndex )
+			{
+				Last = InsertNode( PointIndex, Last );
+			}
 		}
+
+		if( Last != INDEX_NONE && Equals( Last, Nodes[ Last ].Next ) )
+		{
+			const int32 Next = Nodes[ Last ].Next;
+			RemoveNode( Last );
+			Last = Next;
+		}
+
+		return Last;
 	}
-	else
+
+	/** Removes duplicate and collinear points */
+	int32 FilterPoints( const int32 Start, int32 End = INDEX_NONE )
 	{
-		for( int32 PointIndex = 0; PointIndex < NumVertices; PointIndex++ )
+		if( Start == INDEX_NONE )
+		{
+			return Start;
+		}
+		if( End == INDEX_NONE )
+		{
+			End = Start;
+		}
+
+		int32 P = Start;
+		bool bAgain;
+		do
+		{
+			bAgain = false;
+
+			const FNode& Node = Nodes[ P ];
+			if( !Node.bIsSteiner && ( Equals( P, Node.Next ) || Area( Node.Prev, P, Node.Next ) == 0.0 ) )
+			{
+				RemoveNode( P );
+				P = End = Node.Prev;
+				if( P == Nodes[ P ].Next )
+				{
+					break;
+				}
+				bAgain = true;
+			}
+			else
+			{
+				P = Node.Next;
+			}
+		}
+		while( bAgain || P != End );
+
+		return End;
+	}
+
+	/** Main ear clipping loop */
+	void ClipEars( int32 Ear, const int32 Pass )
+	{
+		if( Ear == INDEX_NONE )
+		{
+			return;
+		}
+
+		// Interlink the polygon nodes in z-order
+		if( Pass == 0 && InvSize != 0.0 )
+		{
+			IndexCurve( Ear );
+		}
+
+		int32 Stop = Ear;
+
+		// Iterate through ears, slicing them one by one
+		while( Nodes[ Ear ].Prev != Nodes[ Ear ].Next )
+		{
+			const int32 Prev = Nodes[ Ear ].Prev;
+			const int32 Next = Nodes[ Ear ].Next;
+
+			if( InvSize != 0.0 ? IsEarHashed( Ear ) : IsEar( Ear ) )
+			{
+				// Output the triangle as indices into the original polygon array
+				TriangulatedIndices.Add( Nodes[ Prev ].PointIndex );
+				TriangulatedIndices.Add( Nodes[ Ear ].PointIndex );
+				TriangulatedIndices.Add( Nodes[ Next ].PointIndex );
+
+				RemoveNode( Ear );
+
+				// Skipping the next vertex leads to less sliver triangles
+				Ear = Nodes[ Next ].Next;
+				Stop = Ear;
+				continue;
+			}
+
+			Ear = Next;
+
+			// If we looped through the whole remaining polygon and can't find any more ears
+			if( Ear == Stop )
+			{
+				if( Pass == 0 )
+				{
+					// Try filtering points and slicing again
+					ClipEars( FilterPoints( Ear ), 1 );
+				}
+				else if( Pass == 1 )
+				{
+					// If this didn't work, try curing all small self-intersections locally
+					Ear = CureLocalIntersections( FilterPoints( Ear ) );
+					ClipEars( Ear, 2 );
+				}
+				else if( Pass == 2 )
+				{
+					// As a last resort, try splitting the remaining polygon into two
+					SplitAndClipEars( Ear );
+				}
+
+				break;
+			}
+		}
+	}
+
+	/** Checks whether a polygon node forms a valid ear with its neighbors */
+	bool IsEar( const int32 Ear ) const
+	{
+		const FNode& A = Nodes[ Nodes[ Ear ].Prev ];
+		const FNode& B = Nodes[ Ear ];
+		const FNode& C = Nodes[ B.Next ];
+
+		if( Area( A, B, C ) >= 0.0 )
+		{
+			// Reflex, can't be an ear
+			return false;
+		}
+
+		// Triangle bounding box
+		const double X0 = FMath::Min3( A.X, B.X, C.X );
+		const double Y0 = FMath::Min3( A.Y, B.Y, C.Y );
+		const double X1 = FMath::Max3( A.X, B.X, C.X );
+		const double Y1 = FMath::Max3( A.Y, B.Y, C.Y );
+
+		// Now make sure we don't have other points inside the potential ear
+		for( int32 P = C.Next; P != B.Prev; P = Nodes[ P ].Next )
 		{
-			VertexIndices[ PointIndex ] = ( NumVertices - 1 ) - PointIndex;
+			const FNode& Node = Nodes[ P ];
+			if( Node.X >= X0 && Node.X <= X1 && Node.Y >= Y0 && Node.Y <= Y1 &&
+				PointInTriangle( A.X, A.Y, B.X, B.Y, C.X, C.Y, Node.X, Node.Y ) &&
+				Area( Node.Prev, P, Node.Next ) >= 0.0 )
+			{
+				return false;
+			}
 		}
+
+		return true;
 	}
 
-	// Remove NumVertices-2 vertices, creating one triangle every time 
-	int32 ErrorDetectionCounter = 2 * NumVertices;
-	for( int32 V = NumVertices - 1; NumVertices > 2; )
+	/** Same as IsEar(), but only looks at the nodes within the ear's z-order range */
+	bool IsEarHashed( const int32 Ear ) const
 	{
-		// If we loop, it is probably a non-simple polygon
-		if( --ErrorDetectionCounter <= 0 )
+		const int32 AIndex = Nodes[ Ear ].Prev;
+		const int32 CIndex = Nodes[ Ear ].Next;
+		const FNode& A = Nodes[ AIndex ];
+		const FNode& B = Nodes[ Ear ];
+		const FNode& C = Nodes[ CIndex ];
+
+		if( Area( A, B, C ) >= 0.0 )
 		{
-			// Bad polygon!  This can happen if there are adjacent points that are exactly overlapping
+			// Reflex, can't be an ear
 			return false;
 		}
 
-		// Three consecutive vertices in current polygon, <u,v,w>
-		const int32 U = ( V < NumVertices ) ? V : 0;
-		V = ( ( U + 1 ) < NumVertices ) ? U + 1 : 0;
-		const int32 W = ( ( V + 1 ) < NumVertices ) ? V + 1 : 0;
+		// Triangle bounding box
+		const double X0 = FMath::Min3( A.X, B.X, C.X );
+		const double Y0 = FMath::Min3( A.Y, B.Y, C.Y );
+		const double X1 = FMath::Max3( A.X, B.X, C.X );
+		const double Y1 = FMath::Max3( A.Y, B.Y, C.Y );
+
+		// Z-order range for the current triangle bounding box
+		const int32 MinZ = ZOrder( X0, Y0 );
+		const int32 MaxZ = ZOrder( X1, Y1 );
+
+		auto IsBlocking = [&]( const int32 P ) -> bool
+		{
+			const FNode& Node = Nodes[ P ];
+			return Node.X >= X0 && Node.X <= X1 && Node.Y >= Y0 && Node.Y <= Y1 &&
+				P != AIndex && P != CIndex &&
+				PointInTriangle( A.X, A.Y, B.X, B.Y, C.X, C.Y, Node.X, Node.Y ) &&
+				Area( Node.Prev, P, Node.Next ) >= 0.0;
+		};
+
+		int32 P = B.PrevZ;
+		int32 N = B.NextZ;
+
+		// Look for points inside the triangle in both directions
+		while( P != INDEX_NONE && Nodes[ P ].Z >= MinZ && N != INDEX_NONE && Nodes[ N ].Z <= MaxZ )
+		{
+			if( IsBlocking( P ) )
+			{
+				return false;
+			}
+			P = Nodes[ P ].PrevZ;
+
+			if( IsBlocking( N ) )
+			{
+				return false;
+			}
+			N = Nodes[ N ].NextZ;
+		}
+
+		// Look for remaining points in decreasing z-order
+		while( P != INDEX_NONE && Nodes[ P ].Z >= MinZ )
+		{
+			if( IsBlocking( P ) )
+			{
+				return false;
+			}
+			P = Nodes[ P ].PrevZ;
+		}
+
+		// Look for remaining points in increasing z-order
+		while( N != INDEX_NONE && Nodes[ N ].Z <= MaxZ )
+		{
+			if( IsBlocking( N ) )
+			{
+				return false;
+			}
+			N = Nodes[ N ].NextZ;
+		}
+
+		return true;
+	}
+
+	/** Goes through all polygon nodes and cures small local self-intersections */
+	int32 CureLocalIntersections( int32 Start )
+	{
+		if( Start == INDEX_NONE )
+		{
+			return Start;
+		}
+
+		int32 P = Start;
+		do
+		{
+			const int32 A = Nodes[ P ].Prev;
+			const int32 B = Nodes[ Nodes[ P ].Next ].Next;
+
+			if( !Equals( A, B ) && Intersects( A, P, Nodes[ P ].Next, B ) && LocallyInside( A, B ) && LocallyInside( B, A ) )
+			{
+				TriangulatedIndices.Add( Nodes[ A ].PointIndex );
+				TriangulatedIndices.Add( Nodes[ P ].PointIndex );
+				TriangulatedIndices.Add( Nodes[ B ].PointIndex );
+
+				// Remove two nodes involved
+				RemoveNode( Nodes[ P ].Next );
+				RemoveNode( P );
+
+				P = Start = B;
+			}
+			P = Nodes[ P ].Next;
+		}
+		while( P != Start );
+
+		return FilterPoints( P );
+	}
+
+	/** Tries splitting the polygon into two and triangulating them independently */
+	void SplitAndClipEars( const int32 Start )
+	{
+		// Look for a valid diagonal that divides the polygon into two
+		int32 A = Start;
+		do
+		{
+			int32 B = Nodes[ Nodes[ A ].Next ].Next;
+			while( B != Nodes[ A ].Prev )
+			{
+				if( Nodes[ A ].PointIndex != Nodes[ B ].PointIndex && IsValidDiagonal( A, B ) )
+				{
+					// Split the polygon in two by the diagonal
+					int32 C = SplitPolygon( A, B );
+
+					// Filter collinear points around the cuts
+					A = FilterPoints( A, Nodes[ A ].Next );
+					C = FilterPoints( C, Nodes[ C ].Next );
+
+					// Run earcut on each half
+					ClipEars( A, 0 );
+					ClipEars( C, 0 );
+					return;
+				}
+				B = Nodes[ B ].Next;
+			}
+			A = Nodes[ A ].Next;
+		}
+		while( A != Start );
+	}
+
+	/** Links every hole into the outer loop, producing a single-ring polygon without holes */
+	int32 EliminateHoles( const TArray<int32>& HoleStartIndices, int32 OuterNode )
+	{
+		TArray<int32, TInlineAllocator<16>> Queue;
+
+		for( int32 HoleIndex = 0; HoleIndex < HoleStartIndices.Num(); ++HoleIndex )
+		{
+			const int32 Start = HoleStartIndices[ HoleIndex ];
+			const int32 End = HoleIndex < HoleStartIndices.Num() - 1 ? HoleStartIndices[ HoleIndex + 1 ] : Points.Num();
+			const int32 List = LinkContour( Start, End, false );
+			if( List != INDEX_NONE )
+			{
+				if( List == Nodes[ List ].Next )
+				{
+					Nodes[ List ].bIsSteiner = true;
+				}
+				Queue.Add( GetLeftmost( List ) );
+			}
+		}
+
+		Queue.Sort( [this]( const int32 A, const int32 B ) { return Nodes[ A ].X < Nodes[ B ].X; } );
+
+		// Process holes from left to right
+		for( const int32 Hole : Queue )
+		{
+			OuterNode = EliminateHole( Hole, OuterNode );
+		}
+
+		return OuterNode;
+	}
+
+	/** Finds a bridge between a hole and the outer polygon, and links the hole into it */
+	int32 EliminateHole( const int32 Hole, const int32 OuterNode )
+	{
+		const int32 Bridge = FindHoleBridge( Hole, OuterNode );
+		if( Bridge == INDEX_NONE )
+		{
+			return OuterNode;
+		}
+
+		const int32 BridgeReverse = SplitPolygon( Bridge, Hole );
+
+		// Filter collinear points around the cuts
+		FilterPoints( BridgeReverse, Nodes[ BridgeReverse ].Next );
+		return FilterPoints( Bridge, Nodes[ Bridge ].Next );
+	}
+
+	/** David Eberly's algorithm for finding a bridge between a hole and the outer polygon */
+	int32 FindHoleBridge( const int32 Hole, const int32 OuterNode ) const
+	{
+		const double HX = Nodes[ Hole ].X;
+		const double HY = Nodes[ Hole ].Y;
+		double QX = -MAX_dbl;
+		int32 M = INDEX_NONE;
+
+		// Find a segment intersected by a ray from the hole's leftmost point to the left.  The segment's endpoint with the
+		// lesser x will be a potential connection point.
+		int32 P = OuterNode;
+		do
+		{
+			const FNode& Node = Nodes[ P ];
+			const FNode& NextNode = Nodes[ Node.Next ];
+			if( HY <= Node.Y && HY >= NextNode.Y && NextNode.Y != Node.Y )
+			{
+				const double X = Node.X + ( HY - Node.Y ) * ( NextNode.X - Node.X ) / ( NextNode.Y - Node.Y );
+				if( X <= HX && X > QX )
+				{
+					QX = X;
+					M = Node.X < NextNode.X ? P : Node.Next;
+					if( X == HX )
+					{
+						// The hole touches the outer segment, so pick the leftmost endpoint
+						return M;
+					}
+				}
+			}
+			P = Node.Next;
+		}
+		while( P != OuterNode );
+
+		if( M == INDEX_NONE )
+		{
+			return INDEX_NONE;
+		}
+
+		// Look for points inside the triangle of hole point, segment intersection and endpoint.  If there are no points
+		// found, we have a valid connection.  Otherwise choose the point of the minimum angle with the ray as the
+		// connection point.
+		const int32 Stop = M;
+		const double MX = Nodes[ M ].X;
+		const double MY = Nodes[ M ].Y;
+		double TanMin = MAX_dbl;
+
+		P = M;
+		do
+		{
+			const FNode& Node = Nodes[ P ];
+			if( HX >= Node.X && Node.X >= MX && HX != Node.X &&
+				PointInTriangle( HY < MY ? HX : QX, HY, MX, MY, HY < MY ? QX : HX, HY, Node.X, Node.Y ) )
+			{
+				const double Tan = FMath::Abs( HY - Node.Y ) / ( HX - Node.X );
+				if( LocallyInside( P, Hole ) &&
+					( Tan < TanMin || ( Tan == TanMin && ( Node.X > Nodes[ M ].X || ( Node.X == Nodes[ M ].X && SectorContainsSector( M, P ) ) ) ) ) )
+				{
+					M = P;
+					TanMin = Tan;
+				}
+			}
+			P = Node.Next;
+		}
+		while( P != Stop );
+
+		return M;
+	}
+
+	/** Whether sector in vertex M contains sector in vertex P in the same coordinates */
+	bool SectorContainsSector( const int32 M, const int32 P ) const
+	{
+		return Area( Nodes[ M ].Prev, M, Nodes[ P ].Prev ) < 0.0 && Area( Nodes[ P ].Next, M, Nodes[ M ].Next ) < 0.0;
+	}
+
+	/** Interlinks polygon nodes in z-order */
+	void IndexCurve( const int32 Start )
+	{
+		int32 P = Start;
+		do
+		{
+			FNode& Node = Nodes[ P ];
+			if( Node.Z == 0 )
+			{
+				Node.Z = ZOrder( Node.X, Node.Y );
+			}
+			Node.PrevZ = Node.Prev;
+			Node.NextZ = Node.Next;
+			P = Node.Next;
+		}
+		while( P != Start );
+
+		Nodes[ Nodes[ P ].PrevZ ].NextZ = INDEX_NONE;
+		Nodes[ P ].PrevZ = INDEX_NONE;
+
+		SortLinked( P );
+	}
+
+	/** Simon Tatham's linked list merge sort algorithm (http://www.chiark.greenend.org.uk/~sgtatham/algorithms/listsort.html) */
+	int32 SortLinked( int32 List )
+	{
+		int32 InSize = 1;
+		int32 NumMerges;
 
-		if( Snip( Polygon, U, V, W, NumVertices, VertexIndices ) )
+		do
 		{
-			// Output triangle as indices into the original polygon array
-			TriangulatedIndices.Add( VertexIndices[ U ] );
-			TriangulatedIndices.Add( VertexIndices[ V ] );
-			TriangulatedIndices.Add( VertexIndices[ W ] );
+			int32 P = List;
+			int32 Tail = INDEX_NONE;
+			List = INDEX_NONE;
+			NumMerges = 0;
+
+			while( P != INDEX_NONE )
+			{
+				++NumMerges;
+				int32 Q = P;
+				int32 PSize = 0;
+				for( int32 I = 0; I < InSize; ++I )
+				{
+					++PSize;
+					Q = Nodes[ Q ].NextZ;
+					if( Q == INDEX_NONE )
+					{
+						break;
+					}
+				}
+
+				int32 QSize = InSize;
+				while( PSize > 0 || ( QSize > 0 && Q != INDEX_NONE ) )
+				{
+					int32 E;
+					if( PSize != 0 && ( QSize == 0 || Q == INDEX_NONE || Nodes[ P ].Z <= Nodes[ Q ].Z ) )
+					{
+						E = P;
+						P = Nodes[ P ].NextZ;
+						--PSize;
+					}
+					else
+					{
+						E = Q;
+						Q = Nodes[ Q ].NextZ;
+						--QSize;
+					}
+
+					if( Tail != INDEX_NONE )
+					{
+						Nodes[ Tail ].NextZ = E;
+					}
+					else
+					{
+						List = E;
+					}
+
+					Nodes[ E ].PrevZ = Tail;
+					Tail = E;
+				}
+
+				P = Q;
+			}
+
+			Nodes[ Tail ].NextZ = INDEX_NONE;
+			InSize *= 2;
+		}
+		while( NumMerges > 1 );
+
+		return List;
+	}
+
+	/** Z-order of a point given coords and inverse of the longer side of data bbox */
+	int32 ZOrder( const double InX, const double InY ) const
+	{
+		// Coords are transformed into non-negative 15-bit integer range
+		uint32 X = (uint32)( ( InX - MinX ) * InvSize );
+		uint32 Y = (uint32)( ( InY - MinY ) * InvSize );
+
+		X = ( X | ( X << 8 ) ) & 0x00FF00FF;
+		X = ( X | ( X << 4 ) ) & 0x0F0F0F0F;
+		X = ( X | ( X << 2 ) ) & 0x33333333;
+		X = ( X | ( X << 1 ) ) & 0x55555555;
+
+		Y = ( Y | ( Y << 8 ) ) & 0x00FF00FF;
+		Y = ( Y | ( Y << 4 ) ) & 0x0F0F0F0F;
+		Y = ( Y | ( Y << 2 ) ) & 0x33333333;
+		Y = ( Y | ( Y << 1 ) ) & 0x55555555;
+
+		return (int32)( X | ( Y << 1 ) );
+	}
 
-			/* Remove V from remaining polygon */
-			for( int32 S = V, T = V + 1; T < NumVertices; S++, T++ )
+	/** Finds the leftmost node of a polygon ring */
+	int32 GetLeftmost( const int32 Start ) const
+	{
+		int32 P = Start;
+		int32 Leftmost = Start;
+		do
+		{
+			if( Nodes[ P ].X < Nodes[ Leftmost ].X || ( Nodes[ P ].X == Nodes[ Leftmost ].X && Nodes[ P ].Y < Nodes[ Leftmost ].Y ) )
 			{
-				VertexIndices[ S ] = VertexIndices[ T ]; 
+				Leftmost = P;
 			}
-			NumVertices--;
+			P = Nodes[ P ].Next;
+		}
+		while( P != Start );
+
+		return Leftmost;
+	}
+
+	/** Checks if a point lies within a convex triangle */
+	static bool PointInTriangle( const double AX, const double AY, const double BX, const double BY, const double CX, const double CY, const double PX, const double PY )
+	{
+		return ( CX - PX ) * ( AY - PY ) >= ( AX - PX ) * ( CY - PY ) &&
+			( AX - PX ) * ( BY - PY ) >= ( BX - PX ) * ( AY - PY ) &&
+			( BX - PX ) * ( CY - PY ) >= ( CX - PX ) * ( BY - PY );
+	}
+
+	/** Checks if a diagonal between two polygon nodes is valid (lies in polygon interior) */
+	bool IsValidDiagonal( const int32 A, const int32 B ) const
+	{
+		const FNode& NodeA = Nodes[ A ];
+		const FNode& NodeB = Nodes[ B ];
+
+		// Doesn't intersect other edges
+		return Nodes[ NodeA.Next ].PointIndex != NodeB.PointIndex && Nodes[ NodeA.Prev ].PointIndex != NodeB.PointIndex && !IntersectsPolygon( A, B ) &&
+			// Locally visible, and does not create opposite-facing sectors
+			( ( LocallyInside( A, B ) && LocallyInside( B, A ) && MiddleInside( A, B ) && ( Area( NodeA.Prev, A, NodeB.Prev ) != 0.0 || Area( A, NodeB.Prev, B ) != 0.0 ) ) ||
+			// Special zero-length case
+			( Equals( A, B ) && Area( NodeA.Prev, A, NodeA.Next ) > 0.0 && Area( NodeB.Prev, B, NodeB.Next ) > 0.0 ) );
+	}
+
+	/** Signed area of a triangle */
+	static double Area( const FNode& P, const FNode& Q, const FNode& R )
+	{
+		return ( Q.Y - P.Y ) * ( R.X - Q.X ) - ( Q.X - P.X ) * ( R.Y - Q.Y );
+	}
+
+	double Area( const int32 P, const int32 Q, const int32 R ) const
+	{
+		return Area( Nodes[ P ], Nodes[ Q ], Nodes[ R ] );
+	}
+
+	/** Checks if two points are equal */
+	bool Equals( const int32 P1, const int32 P2 ) const
+	{
+		return Nodes[ P1 ].X == Nodes[ P2 ].X && Nodes[ P1 ].Y == Nodes[ P2 ].Y;
+	}
+
+	/** Checks if two segments intersect */
+	bool Intersects( const int32 P1, const int32 Q1, const int32 P2, const int32 Q2 ) const
+	{
+		const int32 O1 = (int32)FMath::Sign( Area( P1, Q1, P2 ) );
+		const int32 O2 = (int32)FMath::Sign( Area( P1, Q1, Q2 ) );
+		const int32 O3 = (int32)FMath::Sign( Area( P2, Q2, P1 ) );
+		const int32 O4 = (int32)FMath::Sign( Area( P2, Q2, Q1 ) );
+
+		if( O1 != O2 && O3 != O4 )
+		{
+			// General case
+			return true;
+		}
+
+		// Collinear cases
+		return ( O1 == 0 && OnSegment( P1, P2, Q1 ) ) ||
+			( O2 == 0 && OnSegment( P1, Q2, Q1 ) ) ||
+			( O3 == 0 && OnSegment( P2, P1, Q2 ) ) ||
+			( O4 == 0 && OnSegment( P2, Q1, Q2 ) );
+	}
+
+	/** For collinear points P, Q, R, checks if point Q lies on segment PR */
+	bool OnSegment( const int32 P, const int32 Q, const int32 R ) const
+	{
+		const FNode& NodeP = Nodes[ P ];
+		const FNode& NodeQ = Nodes[ Q ];
+		const FNode& NodeR = Nodes[ R ];
+		return NodeQ.X <= FMath::Max( NodeP.X, NodeR.X ) && NodeQ.X >= FMath::Min( NodeP.X, NodeR.X ) &&
+			NodeQ.Y <= FMath::Max( NodeP.Y, NodeR.Y ) && NodeQ.Y >= FMath::Min( NodeP.Y, NodeR.Y );
+	}
+
+	/** Checks if a polygon diagonal intersects any polygon segments */
+	bool IntersectsPolygon( const int32 A, const int32 B ) const
+	{
+		const int32 AIndex = Nodes[ A ].PointIndex;
+		const int32 BIndex = Nodes[ B ].PointIndex;
+
+		int32 P = A;
+		do
+		{
+			const int32 Next = Nodes[ P ].Next;
+			if( Nodes[ P ].PointIndex != AIndex && Nodes[ Next ].PointIndex != AIndex &&
+				Nodes[ P ].PointIndex != BIndex && Nodes[ Next ].PointIndex != BIndex &&
+				Intersects( P, Next, A, B ) )
+			{
+				return true;
+			}
+			P = Next;
+		}
+		while( P != A );
+
+		return false;
+	}
+
+	/** Checks if a polygon diagonal is locally inside the polygon */
+	bool LocallyInside( const int32 A, const int32 B ) const
+	{
+		const FNode& NodeA = Nodes[ A ];
+		return Area( NodeA.Prev, A, NodeA.Next ) < 0.0 ?
+			Area( A, B, NodeA.Next ) >= 0.0 && Area( A, NodeA.Prev, B ) >= 0.0 :
+			Area( A, B, NodeA.Prev ) < 0.0 || Area( A, NodeA.Next, B ) < 0.0;
+	}
+
+	/** Checks if the middle point of a polygon diagonal is inside the polygon */
+	bool MiddleInside( const int32 A, const int32 B ) const
+	{
+		const double PX = ( Nodes[ A ].X + Nodes[ B ].X ) * 0.5;
+		const double PY = ( Nodes[ A ].Y + Nodes[ B ].Y ) * 0.5;
+		bool bInside = false;
+
+		int32 P = A;
+		do
+		{
+			const FNode& Node = Nodes[ P ];
+			const FNode& NextNode = Nodes[ Node.Next ];
+			if( ( ( Node.Y > PY ) != ( NextNode.Y > PY ) ) && NextNode.Y != Node.Y &&
+				( PX < ( NextNode.X - Node.X ) * ( PY - Node.Y ) / ( NextNode.Y - Node.Y ) + Node.X ) )
+			{
+				bInside = !bInside;
+			}
+			P = Node.Next;
+		}
+		while( P != A );
+
+		return bInside;
+	}
+
+	/** Links two polygon vertices with a bridge.  If the vertices belong to the same ring, it splits the polygon into two.
+	    If one belongs to the outer ring and another to a hole, it merges it into a single ring.  Returns the new copy of B. */
+	int32 SplitPolygon( const int32 A, const int32 B )
+	{
+		const int32 A2 = AddNode( Nodes[ A ].PointIndex );
+		const int32 B2 = AddNode( Nodes[ B ].PointIndex );
+		const int32 AN = Nodes[ A ].Next;
+		const int32 BP = Nodes[ B ].Prev;
+
+		Nodes[ A ].Next = B;
+		Nodes[ B ].Prev = A;
+
+		Nodes[ A2 ].Next = AN;
+		Nodes[ AN ].Prev = A2;
+
+		Nodes[ B2 ].Next = A2;
+		Nodes[ A2 ].Prev = B2;
+
+		Nodes[ BP ].Next = B2;
+		Nodes[ B2 ].Prev = BP;
+
+		return B2;
+	}
+
+	/** Creates a new, unlinked node for a point */
+	int32 AddNode( const int32 PointIndex )
+	{
+		const int32 NodeIndex = Nodes.AddUninitialized();
+		FNode& Node = Nodes[ NodeIndex ];
+		Node.PointIndex = PointIndex;
+		Node.X = Points[ PointIndex ].X;
+		Node.Y = Points[ PointIndex ].Y;
+		Node.Prev = INDEX_NONE;
+		Node.Next = INDEX_NONE;
+		Node.Z = 0;
+		Node.PrevZ = INDEX_NONE;
+		Node.NextZ = INDEX_NONE;
+		Node.bIsSteiner = false;
+		return NodeIndex;
+	}
+
+	/** Creates a node and optionally links it with the previous one (in a circular doubly linked list) */
+	int32 InsertNode( const int32 PointIndex, const int32 Last )
+	{
+		const int32 P = AddNode( PointIndex );
+
+		if( Last == INDEX_NONE )
+		{
+			Nodes[ P ].Prev = P;
+			Nodes[ P ].Next = P;
+		}
+		else
+		{
+			Nodes[ P ].Next = Nodes[ Last ].Next;
+			Nodes[ P ].Prev = Last;
+			Nodes[ Nodes[ Last ].Next ].Prev = P;
+			Nodes[ Last ].Next = P;
+		}
 
-			// Reset error detection counter
-			ErrorDetectionCounter = 2 * NumVertices;
+		return P;
+	}
+
+	/** Unlinks a node from the polygon, and from the z-order list */
+	void RemoveNode( const int32 P )
+	{
+		const FNode& Node = Nodes[ P ];
+		Nodes[ Node.Next ].Prev = Node.Prev;
+		Nodes[ Node.Prev ].Next = Node.Next;
+
+		if( Node.PrevZ != INDEX_NONE )
+		{
+			Nodes[ Node.PrevZ ].NextZ = Node.NextZ;
+		}
+		if( Node.NextZ != INDEX_NONE )
+		{
+			Nodes[ Node.NextZ ].PrevZ = Node.PrevZ;
 		}
 	}
 
-	return true;
+
+private:
+
+	/** The points we're triangulating */
+	const TArray<FVector2D>& Points;
+
+	/** Output triangles, as indices into Points */
+	TArray<int32>& TriangulatedIndices;
+
+	/** All polygon nodes.  Nodes are never freed, just unlinked. */
+	TArray<FNode, TInlineAllocator<64>> Nodes;
+
+	/** Bounds and scale used to compute z-order values.  InvSize is zero if we're not using the z-order hash. */
+	double MinX;
+	double MinY;
+	double InvSize;
+};
+
+
+bool FPolygonTools::TriangulatePolygon( const TArray<FVector2D>& Polygon, TArray<int32>& TriangulatedIndices, bool& OutWindsClockwise )
+{
+	static const TArray<int32> NoHoles;
+	return TriangulatePolygonWithHoles( Polygon, NoHoles, TriangulatedIndices, OutWindsClockwise );
 }
 
+
+bool FPolygonTools::TriangulatePolygonWithHoles( const TArray<FVector2D>& Points, const TArray<int32>& HoleStartIndices, TArray<int32>& TriangulatedIndices, bool& OutWindsClockwise )
+{
+	TriangulatedIndices.Reset();
+	OutWindsClockwise = false;
+
+	const int32 NumOuterPoints = HoleStartIndices.Num() > 0 ? HoleStartIndices[ 0 ] : Points.Num();
+	if( NumOuterPoints < 3 )
+	{
+		return false;
+	}
+
+	double HalfArea = 0.0;
+	for( int32 P = NumOuterPoints - 1, Q = 0; Q < NumOuterPoints; P = Q++ )
+	{
+		HalfArea += (double)Points[ P ].X * Points[ Q ].Y - (double)Points[ Q ].X * Points[ P ].Y;
+	}
+	OutWindsClockwise = HalfArea < 0.0;
+
+	FEarClipper EarClipper( Points, TriangulatedIndices );
+	EarClipper.Triangulate( HoleStartIndices );
+
+	return TriangulatedIndices.Num() > 0;
+}
+
+
+void FPolygonTools::SimplifyPolyline( const TArray<FVector2D>& Points, const float Tolerance, const bool bIsClosed, TArray<FVector2D>& OutSimplifiedPoints )
+{
+	OutSimplifiedPoints.Reset();
+
+	const int32 NumPoints = Points.Num();
+	if( NumPoints <= ( bIsClosed ? 3 : 2 ) || Tolerance <= 0.0f )
+	{
+		OutSimplifiedPoints = Points;
+		return;
+	}
+
+	// Closed polygons are split at the point that is furthest from the first point, and both halves are simplified as
+	// open polylines.  The second half ends back at the first point, so indices past the last point wrap around.
+	int32 LastIndex = NumPoints - 1;
+	int32 SplitIndex = INDEX_NONE;
+	if( bIsClosed )
+	{
+		float MaxDistanceSquared = -1.0f;
+		for( int32 PointIndex = 1; PointIndex < NumPoints; ++PointIndex )
+		{
+			const float DistanceSquared = FVector2D::DistSquared( Points[ 0 ], Points[ PointIndex ] );
+			if( DistanceSquared > MaxDistanceSquared )
+			{
+				MaxDistanceSquared = DistanceSquared;
+				SplitIndex = PointIndex;
+			}
+		}
+		LastIndex = NumPoints;
+	}
+
+	TArray<bool, TInlineAllocator<256>> KeepPoints;
+	KeepPoints.SetNumZeroed( NumPoints );
+	KeepPoints[ 0 ] = true;
+	KeepPoints[ LastIndex % NumPoints ] = true;
+
+	// Ranges of points that still need to be simplified.  Using our own stack instead of recursion, so that very long
+	// polylines can't overflow the call stack.
+	TArray<TPair<int32, int32>, TInlineAllocator<64>> Ranges;
+	if( SplitIndex != INDEX_NONE )
+	{
+		KeepPoints[ SplitIndex ] = true;
+		Ranges.Add( TPair<int32, int32>( 0, SplitIndex ) );
+		Ranges.Add( TPair<int32, int32>( SplitIndex, LastIndex ) );
+	}
+	else
+	{
+		Ranges.Add( TPair<int32, int32>( 0, LastIndex ) );
+	}
+
+	const float ToleranceSquared = Tolerance * Tolerance;
+	while( Ranges.Num() > 0 )
+	{
+		const TPair<int32, int32> Range = Ranges.Pop( false );
+
+		const FVector2D Start = Points[ Range.Key % NumPoints ];
+		const FVector2D End = Points[ Range.Value % NumPoints ];
+		const FVector2D StartToEnd = End - Start;
+		const float LengthSquared = StartToEnd.SizeSquared();
+
+		// Find the point that is furthest from the line segment between the ends of the range
+		float MaxDistanceSquared = -1.0f;
+		int32 FurthestIndex = INDEX_NONE;
+		for( int32 PointIndex = Range.Key + 1; PointIndex < Range.Value; ++PointIndex )
+		{
+			const FVector2D StartToPoint = Points[ PointIndex % NumPoints ] - Start;
+			const float Alpha = LengthSquared > SMALL_NUMBER ? FMath::Clamp( ( StartToPoint | StartToEnd ) / LengthSquared, 0.0f, 1.0f ) : 0.0f;
+			const float DistanceSquared = ( StartToPoint - StartToEnd * Alpha ).SizeSquared();
+			if( DistanceSquared > MaxDistanceSquared )
+			{
+				MaxDistanceSquared = DistanceSquared;
+				FurthestIndex = PointIndex;
+			}
+		}
+
+		if( FurthestIndex != INDEX_NONE && MaxDistanceSquared > ToleranceSquared )
+		{
+			KeepPoints[ FurthestIndex % NumPoints ] = true;
+			Ranges.Add( TPair<int32, int32>( Range.Key, FurthestIndex ) );
+			Ranges.Add( TPair<int32, int32>( FurthestIndex, Range.Value ) );
+		}
+	}
+
+	for( int32 PointIndex = 0; PointIndex < NumPoints; ++PointIndex )
+	{
+		if( KeepPoints[ PointIndex ] )
+		{
+			OutSimplifiedPoints.Add( Points[ PointIndex ] );
+		}
+	}
+
+	// A polygon needs at least three points.  If it collapsed any further, it was smaller than the tolerance anyway.
+	if( bIsClosed && OutSimplifiedPoints.Num() < 3 )
+	{
+		OutSimplifiedPoints.Reset();
+	}
+}
@@ -9,8 +9,23 @@ class FPolygonTools
 
 public:
 
-	/** Triangulate a polygon given a list of contour points, then places results as indices into the original polygon array.  Does not support polygons with holes. */
-	static bool TriangulatePolygon( const TArray<FVector2D>& Polygon, TArray<int32>& TempIndices, TArray<int32>& TriangulatedIndices, bool& OutWindsClockwise );
+	/** Triangulate a polygon given a list of contour points, then places results as indices into the original polygon array.  Either winding order is accepted, and triangles are always output counter-clockwise. */
+	static bool TriangulatePolygon( const TArray<FVector2D>& Polygon, TArray<int32>& TriangulatedIndices, bool& OutWindsClockwise );
+
+	/**
+	 * Triangulate a polygon with holes.  Points contains the outer contour followed by the contour of each hole, and HoleStartIndices
+	 * has the index of the first point of each hole.  Results are placed in TriangulatedIndices as indices into the Points array.
+	 * OutWindsClockwise is set for the outer contour.
+	 */
+	static bool TriangulatePolygonWithHoles( const TArray<FVector2D>& Points, const TArray<int32>& HoleStartIndices, TArray<int32>& TriangulatedIndices, bool& OutWindsClockwise );
+
+	/**
+	 * Simplifies a polyline using the Douglas-Peucker algorithm, keeping only the points needed so that the result never strays
+	 * further than Tolerance from the original.  The first and last points are always kept.  If bIsClosed is set, the points
+	 * are treated as a polygon (with an implicit edge from the last point back to the first), and polygons that collapse to fewer
+	 * than three points come back empty.
+	 */
+	static void SimplifyPolyline( const TArray<FVector2D>& Points, const float Tolerance, const bool bIsClosed, TArray<FVector2D>& OutSimplifiedPoints );
 
 	/** Compute area of a polygon */
 	static inline float Area( const TArray<FVector2D>& Polygon );
@@ -20,12 +35,6 @@ public:
 
 	/** Given a 2D polygon and a point, determines whether the point is inside the polygon.  Supports convex polygons.  If the point is exactly on the polygon boundary, the return value could be either false or true. */
 	static inline bool IsPointInsidePolygon( const TArray<FVector2D>& Polygon, const FVector2D Point );
-
-
-private:
-
-	/** Clips a polygon */
-	static inline bool Snip( const TArray<FVector2D>& Polygon, const int32 U, const int32 V, const int32 W, const int32 PointCount, const int32* VertexIndices );
 };
 
 
@@ -79,38 +88,3 @@ bool FPolygonTools::IsPointInsidePolygon( const TArray<FVector2D>& Polygon, cons
 
 	return bIsInside;
 }
-
-
-bool FPolygonTools::Snip( const TArray<FVector2D>& Polygon, const int32 U, const int32 V, const int32 W, const int32 PointCount, const int32* VertexIndices )
-{
-	const FVector2D A = Polygon[ VertexIndices[ U ] ];
-	const FVector2D B = Polygon[ VertexIndices[ V ] ];
-	const FVector2D C = Polygon[ VertexIndices[ W ] ];
-
-	if( SMALL_NUMBER > ( ( ( B.X - A.X ) * ( C.Y - A.Y ) ) - ( ( B.Y - A.Y ) * ( C.X - A.X ) ) ) &&
-
-		// Don't fail because of degenerate points
-		( A - B ).SizeSquared() > SMALL_NUMBER &&
-		( A - C ).SizeSquared() > SMALL_NUMBER &&
-		( C - A ).SizeSquared() > SMALL_NUMBER )
-	{
-		return false;
-	}
-
-	for( int32 PointIndex = 0; PointIndex < PointCount; ++PointIndex )
-	{
-		if( ( PointIndex == U ) || ( PointIndex == V ) || ( PointIndex == W ) )
-		{
-			continue;
-		}
-
-		if( IsPointInsideTriangle( A, B, C, Polygon[ VertexIndices[ PointIndex ] ] ) )
-		{
-			return false;
-		}
-	}
-
-	return true;
-}
-
-
@@ -1,6 +1,9 @@
 // Copyright 2017 Mike Fricker. All Rights Reserved.
 
 #include "StreetMap.h"
+#include "PolygonTools.h"
+#include "StreetMapProjection.h"
+#include "Async/ParallelFor.h"
 
 
 UStreetMap::UStreetMap()
@@ -25,3 +28,200 @@ void UStreetMap::GetAssetRegistryTags( TArray<FAssetRegistryTag>& OutTags ) cons
 
 	Super::GetAssetRegistryTags( OutTags );
 }
+
+
+void UStreetMap::PostLoad()
+{
+	Super::PostLoad();
+
+	// Buildings are triangulated and simplified when they're imported, but street maps that were imported by older versions
+	// of the plugin don't have triangulated or simplified buildings yet.  Do it once now, so that building meshes doesn't have to.
+	const TArray<float> SimplificationTolerances = FStreetMapMeshBuildSettings::GetDefaultSimplificationTolerances();
+	ParallelFor( Buildings.Num(), [this, &SimplificationTolerances]( const int32 BuildingIndex )
+	{
+		FStreetMapBuilding& Building = Buildings[ BuildingIndex ];
+		if( !Building.bIsTriangulated )
+		{
+			Building.Triangulate();
+		}
+		Building.BuildSimplifiedOutlines( SimplificationTolerances );
+	} );
+
+	BuildRoadGraph();
+	BuildSpatialIndex();
+}
+
+
+void UStreetMap::BuildRoadGraph()
+{
+	// The road graph measures connections with these, so they need to be cached first
+	ParallelFor( Roads.Num(), [this]( const int32 RoadIndex )
+	{
+		Roads[ RoadIndex ].CachePointPositionsAlongRoad();
+	} );
+
+	RoadGraph.Build( *this );
+
+	// Scratch space is sized for the old graph
+	Router.Reset();
+}
+
+
+void UStreetMap::BuildSpatialIndex()
+{
+	SpatialIndex.Build( *this );
+}
+
+
+void UStreetMap::BuildContractionHierarchy()
+{
+	ContractionHierarchy.Build( RoadGraph );
+}
+
+
+bool UStreetMap::FindRoute( int32 StartNodeIndex, int32 EndNodeIndex, FStreetMapRoute& OutRoute, EStreetMapRouteAlgorithm Algorithm ) const
+{
+	// The road graph isn't saved with the street map, so it has to have been built since the roads were loaded or changed
+	if( !ensureMsgf( HasRoadGraph(), TEXT( "BuildRoadGraph() must be called after changing roads or nodes" ) ) )
+	{
+		return false;
+	}
+
+	if( Algorithm == EStreetMapRouteAlgorithm::ContractionHierarchy )
+	{
+		if( HasContractionHierarchy() )
+		{
+			return Router.FindRoute( ContractionHierarchy, StartNodeIndex, EndNodeIndex, OutRoute );
+		}
+		Algorithm = EStreetMapRouteAlgorithm::AStar;
+	}
+	return Router.FindRoute( RoadGraph, StartNodeIndex, EndNodeIndex, Algorithm, OutRoute );
+}
+
+
+bool UStreetMap::ComputeCostMatrix( const TArray<int32>& SourceNodeIndices, const TArray<int32>& TargetNodeIndices, FStreetMapCostMatrix& OutCostMatrix ) const
+{
+	if( !ensureMsgf( HasRoadGraph(), TEXT( "BuildRoadGraph() must be called after changing roads or nodes" ) ) )
+	{
+		return false;
+	}
+
+	if( HasContractionHierarchy() )
+	{
+		return Router.ComputeCostMatrix( ContractionHierarchy, SourceNodeIndices, TargetNodeIndices, OutCostMatrix );
+	}
+	return Router.ComputeCostMatrix( RoadGraph, SourceNodeIndices, TargetNodeIndices, OutCostMatrix );
+}
+
+
+bool UStreetMap::MatchTrace( const TArray<FVector2D>& Positions, const FStreetMapMapMatchingSettings& Settings, TArray<FStreetMapMatchedPoint>& OutMatchedPoints ) const
+{
+	if( !ensureMsgf( HasRoadGraph(), TEXT( "BuildRoadGraph() must be called after changing roads or nodes" ) ) )
+	{
+		return false;
+	}
+
+	return Router.MatchTrace( *this, Positions, Settings, OutMatchedPoints );
+}
+
+
+bool UStreetMap::MatchGeographicTrace( const TArray<double>& Latitudes, const TArray<double>& Longitudes, const FStreetMapMapMatchingSettings& Settings, TArray<FStreetMapMatchedPoint>& OutMatchedPoints ) const
+{
+	OutMatchedPoints.Reset();
+	if( !HasGeographicOrigin() || !ensure( Latitudes.Num() == Longitudes.Num() ) || !ensureMsgf( HasRoadGraph(), TEXT( "BuildRoadGraph() must be called after changing roads or nodes" ) ) )
+	{
+		return false;
+	}
+
+	TArray<FVector2D> Positions;
+	Positions.SetNumUninitialized( Latitudes.Num() );
+	FStreetMapProjection::ProjectLatLongs( Latitudes.GetData(), Longitudes.GetData(), Latitudes.Num(), OriginLatitude, OriginLongitude, UnitsPerMeter, Positions.GetData() );
+
+	return Router.MatchTrace( *this, Positions, Settings, OutMatchedPoints );
+}
+
+
+FVector2D UStreetMap::ProjectLatLong( const double Latitude, const double Longitude ) const
+{
+	return FStreetMapProjection::ProjectLatLong( Latitude, Longitude, OriginLatitude, OriginLongitude, UnitsPerMeter );
+}
+
+
+void FStreetMapRoad::CachePointPositionsAlongRoad()
+{
+	PointPositionsAlongRoad.SetNumUninitialized( RoadPoints.Num() );
+
+	float PositionAlongRoad = 0.0f;
+	for( int32 PointIndex = 0; PointIndex < RoadPoints.Num(); ++PointIndex )
+	{
+		if( PointIndex > 0 )
+		{
+			PositionAlongRoad += ( RoadPoints[ PointIndex ] - RoadPoints[ PointIndex - 1 ] ).Size();
+		}
+		PointPositionsAlongRoad[ PointIndex ] = PositionAlongRoad;
+	}
+}
+
+
+void FStreetMapBuilding::Triangulate()
+{
+	bool bNewWindsClockwise = false;
+	if( !FPolygonTools::TriangulatePolygon( BuildingPoints, /* Out */ TriangulatedIndices, /* Out */ bNewWindsClockwise ) )
+	{
+		// @todo: Triangulation failed for some reason, possibly due to degenerate polygons.  We can
+		//        probably improve the algorithm to avoid this happening.
+		TriangulatedIndices.Reset();
+	}
+	TriangulatedIndices.Shrink();
+
+	bWindsClockwise = bNewWindsClockwise;
+	bIsTriangulated = true;
+}
+
+
+void FStreetMapBuilding::BuildSimplifiedOutlines( const TArray<float>& SimplificationTolerances )
+{
+	for( const float SimplificationTolerance : SimplificationTolerances )
+	{
+		if( FindSimplifiedOutline( SimplificationTolerance ) != nullptr )
+		{
+			continue;
+		}
+
+		FStreetMapBuildingOutline& Outline = SimplifiedOutlines[ SimplifiedOutlines.AddDefaulted() ];
+		Outline.SimplificationTolerance = SimplificationTolerance;
+		FPolygonTools::SimplifyPolyline( BuildingPoints, SimplificationTolerance, true, /* Out */ Outline.Points );
+
+		bool bNewWindsClockwise = false;
+		if( !FPolygonTools::TriangulatePolygon( Outline.Points, /* Out */ Outline.TriangulatedIndices, /* Out */ bNewWindsClockwise ) )
+		{
+			Outline.TriangulatedIndices.Reset();
+		}
+		Outline.Points.Shrink();
+		Outline.TriangulatedIndices.Shrink();
+		Outline.bWindsClockwise = bNewWindsClockwise;
+	}
+}
+
+
+const FStreetMapBuildingOutline* FStreetMapBuilding::FindSimplifiedOutline( const float SimplificationTolerance ) const
+{
+	return SimplifiedOutlines.FindByPredicate( [SimplificationTolerance]( const FStreetMapBuildingOutline& Outline )
+	{
+		return Outline.SimplificationTolerance == SimplificationTolerance;
+	} );
+}
+
+
+TArray<float> FStreetMapMeshBuildSettings::GetDefaultSimplificationTolerances()
+{
+	TArray<float> SimplificationTolerances;
+	for( const FStreetMapMeshLODSettings& LODSettings : FStreetMapMeshBuildSettings().LODs )
+	{
+		if( LODSettings.SimplificationTolerance > 0.0f )
+		{
+			SimplificationTolerances.AddUnique( LODSettings.SimplificationTolerance );
+		}
+	}
+	return SimplificationTolerances;
+}
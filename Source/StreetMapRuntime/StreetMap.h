@@ -2,6 +2,10 @@
 #pragma once
 
 #include "StreetMapRuntime.h"
+#include "StreetMapRoadGraph.h"
+#include "StreetMapRouting.h"
+#include "StreetMapSpatialIndex.h"
+#include "Algo/BinarySearch.h"
 #include "EditorFramework/AssetImportData.h"
 #include "StreetMap.generated.h"
 
@@ -35,6 +39,57 @@ public:
 
 };
 
+/** Mesh generation settings for a lower level of detail, used when the street map is further away */
+USTRUCT(BlueprintType)
+struct STREETMAPRUNTIME_API FStreetMapMeshLODSettings
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+
+	/**
+	* This level of detail is used for tiles that are smaller than this on screen.  This is the radius of a tile's bounds
+	* relative to its distance from the viewer, which is the fraction of the screen it covers with a 90 degree field of view.
+	*/
+	UPROPERTY(Category = StreetMap, EditAnywhere, meta = (ClampMin = "0", UIMin = "0", UIMax = "1"))
+		float ScreenSize;
+
+	/** How far simplified road and building outlines may stray from the originals */
+	UPROPERTY(Category = StreetMap, EditAnywhere, meta = (ClampMin = "0", UIMin = "0"))
+		float SimplificationTolerance;
+
+	/** If false, only highways and major roads are drawn */
+	UPROPERTY(Category = StreetMap, EditAnywhere)
+		uint32 bWantMinorRoads : 1;
+
+	/** If false, only building roofs are drawn */
+	UPROPERTY(Category = StreetMap, EditAnywhere)
+		uint32 bWantBuildingWalls : 1;
+
+	/** Buildings with a smaller footprint than this are not drawn */
+	UPROPERTY(Category = StreetMap, EditAnywhere, meta = (ClampMin = "0", UIMin = "0"))
+		float MinBuildingArea;
+
+	FStreetMapMeshLODSettings() :
+		ScreenSize(0.0f),
+		SimplificationTolerance(0.0f),
+		bWantMinorRoads(true),
+		bWantBuildingWalls(true),
+		MinBuildingArea(0.0f)
+	{
+	}
+
+	FStreetMapMeshLODSettings(float InScreenSize, float InSimplificationTolerance, bool bInWantMinorRoads, bool bInWantBuildingWalls, float InMinBuildingArea) :
+		ScreenSize(InScreenSize),
+		SimplificationTolerance(InSimplificationTolerance),
+		bWantMinorRoads(bInWantMinorRoads),
+		bWantBuildingWalls(bInWantBuildingWalls),
+		MinBuildingArea(InMinBuildingArea)
+	{
+	}
+
+};
+
 /** Mesh generation settings */
 USTRUCT(BlueprintType)
 struct STREETMAPRUNTIME_API FStreetMapMeshBuildSettings
@@ -47,6 +102,10 @@ public:
 	UPROPERTY(Category = StreetMap, EditAnywhere, meta = (ClampMin = "0", UIMin = "0"), DisplayName = "Road Vertical Offset")
 		float RoadOffesetZ;
 
+	/** If true, a patch is drawn where roads meet, to fill in the gaps between the ends of the roads */
+	UPROPERTY(Category = StreetMap, EditAnywhere, DisplayName = "Fill Road Junctions")
+		uint32 bWantRoadJunctions : 1;
+
 	/** if true buildings mesh will be 3D instead of flat representation. */
 	UPROPERTY(Category = StreetMap, EditAnywhere, DisplayName = "Create 3D Buildings")
 		uint32 bWant3DBuildings : 1;
@@ -96,12 +155,47 @@ public:
 	UPROPERTY(Category = StreetMap, EditAnywhere)
 		FLinearColor BuildingBorderLinearColor;
 
+	/**
+	* If true, mesh vertices are stored without tangents.  This is only a minor saving: vertices shrink from 28 to 24 bytes,
+	* about 14% of the vertex memory and upload bandwidth, since positions are still full precision.  Materials used on the
+	* street map can't use normal maps in that case.
+	*/
+	UPROPERTY(Category = StreetMap, EditAnywhere, meta = (DisplayName = "Want Compact Vertices (Minor Saving)"))
+		uint32 bWantCompactVertices : 1;
+
+	/**
+	* If true, lit 3D buildings with rectangular footprints are drawn as instances of a box mesh, stretched to fit each building,
+	* instead of being part of the generated mesh.  Instanced buildings use the street map's material, with the building fill
+	* color as their vertex color.  When the mesh is saved as a static mesh asset, they are generated like any other building.
+	*/
+	UPROPERTY(Category = StreetMap, EditAnywhere)
+		uint32 bWantInstancedBuildings : 1;
+
+	/** Box mesh that is instanced for rectangular buildings.  Defaults to the engine's cube if not set. */
+	UPROPERTY(Category = StreetMap, EditAnywhere, meta = (EditCondition = "bWantInstancedBuildings"))
+		class UStaticMesh* InstancedBuildingMesh;
+
 	/** Buildings border vertical offset */
 	UPROPERTY(Category = StreetMap, EditAnywhere, meta = (ClampMin = "0", UIMin = "0"))
 		float BuildingBorderZ;
 
+	/**
+	* Size of the square tiles the mesh is split into.  Every tile is a separate mesh section with its own bounds, so tiles
+	* that are off-screen can be culled.  Zero puts the whole street map into a single mesh section.
+	*/
+	UPROPERTY(Category = StreetMap, EditAnywhere, meta = (ClampMin = "0", UIMin = "0"))
+		float TileSize;
+
+	/**
+	* Lower levels of detail that each tile switches to as it gets smaller on screen, from most to least detailed.
+	* Every level is generated for every tile, so each one adds to the memory used by the mesh.
+	*/
+	UPROPERTY(Category = StreetMap, EditAnywhere)
+		TArray<FStreetMapMeshLODSettings> LODs;
+
 	FStreetMapMeshBuildSettings() :
 		RoadOffesetZ(0.0f),
+		bWantRoadJunctions(true),
 		bWant3DBuildings(true),
 		bWantLitBuildings(true),
 		StreetThickness(800.0f),
@@ -112,10 +206,19 @@ public:
 		HighwayColor(FLinearColor(0.25f, 0.95f, 0.25f)),
 		BuildingBorderThickness(20.0f),
 		BuildingBorderLinearColor(0.85f, 0.85f, 0.85f),
-		BuildingBorderZ(10.0f)
+		bWantCompactVertices(false),
+		bWantInstancedBuildings(false),
+		InstancedBuildingMesh(nullptr),
+		BuildingBorderZ(10.0f),
+		TileSize(100000.0f)
 	{
+		LODs.Add(FStreetMapMeshLODSettings(0.3f, 100.0f, true, true, 0.0f));
+		LODs.Add(FStreetMapMeshLODSettings(0.1f, 500.0f, false, false, 400.0f * 100.0f * 100.0f));
 	}
 
+	/** Simplification tolerances of the default levels of detail.  Buildings are simplified for these ahead of time. */
+	static TArray<float> GetDefaultSimplificationTolerances();
+
 };
 
 
@@ -174,6 +277,11 @@ struct STREETMAPRUNTIME_API FStreetMapRoad
 	UPROPERTY( Category=StreetMap, EditAnywhere )
 	uint8 bIsOneWay : 1;
 
+	/** Distance along the road to each of its points, starting with zero at the first point.  This isn't saved; it's cached by
+	    UStreetMap::BuildRoadGraph() when the street map is loaded or imported, so that positions along the road can be found
+	    without walking the road. */
+	TArray<float> PointPositionsAlongRoad;
+
 
 	/** Returns this node's index */
 	inline int32 GetRoadIndex( const class UStreetMap& StreetMap ) const;
@@ -184,6 +292,19 @@ struct STREETMAPRUNTIME_API FStreetMapRoad
 	/** Gets the node for the specified point, or the node that comes next after that if the specified point doesn't have a node */
 	inline const struct FStreetMapNode& GetNodeAtPointIndexOrLater( const class UStreetMap& StreetMap, const int32 PointIndex, int32& OutNodeAtPointIndex ) const;
 
+	/** Caches the distance along the road to each of its points.  Must be called after changing the road's points. */
+	void CachePointPositionsAlongRoad();
+
+	/** Returns true if the distances along the road to its points are cached for its current points */
+	inline bool HasPointPositionsAlongRoad() const
+	{
+		return PointPositionsAlongRoad.Num() == RoadPoints.Num();
+	}
+
+	/** Finds the segment of the road that a position along the road is on.  Returns the index of the point that starts the segment.
+	    Positions before the start or past the end of the road are on the first or last segment. */
+	inline int32 FindSegmentForPositionAlongRoad( const float PositionAlongRoad ) const;
+
 	/** Computes the total length of this road by following along all of it's points */
 	float ComputeLengthOfRoad( const class UStreetMap& StreetMap ) const;
 
@@ -203,7 +324,8 @@ struct STREETMAPRUNTIME_API FStreetMapRoad
 	/** Given a node that exists on this road, computes the position along this road of that node */
 	float FindPositionAlongRoadForNode( const class UStreetMap& StreetMap, const int32 PointIndexForNode ) const;
 
-	/** Computes the location of a point along this road, given a distance along this road from the road's beginning */
+	/** Computes the location of a point along this road, given a distance along this road from the road's beginning.  Positions
+	    before the start or past the end of the road are clamped to the road's ends. */
 	FVector2D MakeLocationAlongRoad( const class UStreetMap& StreetMap, const float PositionAlongRoad ) const;
 
 	/** @return True if this is a one way road */
@@ -250,7 +372,8 @@ struct STREETMAPRUNTIME_API FStreetMapNode
 
 
 	///
-	/// Utility functions which may be useful for pathfinding algorithms (not used internally.)
+	/// Utility functions for pathfinding.  Connections come from the street map's road graph (see UStreetMap::BuildRoadGraph()),
+	/// the same one that UStreetMap::FindRoute() searches, so it must be built before these are used.
 	///
 
 	/** Pathfinding: Given a node that is known to connect to this node via some road, searches for the road and returns it */
@@ -270,6 +393,36 @@ struct STREETMAPRUNTIME_API FStreetMapNode
 };
 
 
+/** A building's outline, simplified for a lower level of detail */
+USTRUCT()
+struct STREETMAPRUNTIME_API FStreetMapBuildingOutline
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** The level of detail's simplification tolerance that the outline was simplified with */
+	UPROPERTY()
+	float SimplificationTolerance;
+
+	/** Polygon points of the simplified outline */
+	UPROPERTY()
+	TArray<FVector2D> Points;
+
+	/** Triangles that fill in the simplified outline, as indices into Points.  Empty if triangulation failed. */
+	UPROPERTY()
+	TArray<int32> TriangulatedIndices;
+
+	/** True if Points wind clockwise */
+	UPROPERTY()
+	uint8 bWindsClockwise : 1;
+
+	FStreetMapBuildingOutline()
+		: SimplificationTolerance( 0.0f ),
+		  bWindsClockwise( false )
+	{
+	}
+};
+
+
 /** A building */
 USTRUCT( BlueprintType )
 struct STREETMAPRUNTIME_API FStreetMapBuilding
@@ -301,6 +454,34 @@ struct STREETMAPRUNTIME_API FStreetMapBuilding
 	/** 2D bounds (max) of this building's points */
 	UPROPERTY( Category=StreetMap, EditAnywhere )
 	FVector2D BoundsMax;
+
+	/** Triangles that fill in the building's polygon, as indices into BuildingPoints.  These are computed when the building
+	    is imported, so that we don't need to triangulate every time the mesh is built.  Empty if triangulation failed. */
+	UPROPERTY()
+	TArray<int32> TriangulatedIndices;
+
+	/** True if BuildingPoints wind clockwise */
+	UPROPERTY()
+	uint8 bWindsClockwise : 1;
+
+	/** True if TriangulatedIndices and bWindsClockwise have been computed.  Buildings imported by older versions of the plugin won't have these. */
+	UPROPERTY()
+	uint8 bIsTriangulated : 1;
+
+	/** Simplified and triangulated outlines for lower levels of detail, one per simplification tolerance.  Like
+	    TriangulatedIndices, these are computed ahead of time so that building the mesh only has to read them. */
+	UPROPERTY()
+	TArray<FStreetMapBuildingOutline> SimplifiedOutlines;
+
+
+	/** Triangulates this building's polygon, filling in TriangulatedIndices and bWindsClockwise */
+	void Triangulate();
+
+	/** Simplifies and triangulates this building's outline for each of these simplification tolerances that it doesn't have an outline for yet */
+	void BuildSimplifiedOutlines( const TArray<float>& SimplificationTolerances );
+
+	/** Returns the outline that was simplified with this tolerance, or nullptr if there isn't one */
+	const FStreetMapBuildingOutline* FindSimplifiedOutline( const float SimplificationTolerance ) const;
 };
 
 
@@ -317,6 +498,7 @@ public:
 
 	// UObject overrides
 	virtual void GetAssetRegistryTags( TArray<FAssetRegistryTag>& OutTags ) const override;
+	virtual void PostLoad() override;
 	
 	/** Gets the roads in this street map (read only) */
 	const TArray<FStreetMapRoad>& GetRoads() const
@@ -354,6 +536,111 @@ public:
 		return Buildings;
 	}
 
+	/** Gets the connections between nodes, for pathfinding */
+	const FStreetMapRoadGraph& GetRoadGraph() const
+	{
+		return RoadGraph;
+	}
+
+	/** Rebuilds the connections between nodes, and the cached distances along roads.  This must be called after changing roads or nodes. */
+	void BuildRoadGraph();
+
+	/** Returns true if the road graph has been built for the current nodes.  It isn't saved, so it's rebuilt when the street map is loaded. */
+	bool HasRoadGraph() const
+	{
+		return RoadGraph.GetNumNodes() == Nodes.Num();
+	}
+
+	/**
+	 * Finds the cheapest route between two nodes, respecting one way roads.  Safe to call from any thread, as long as
+	 * the roads aren't changing at the same time.
+	 *
+	 * @param	StartNodeIndex		Node to start from
+	 * @param	EndNodeIndex		Node to get to
+	 * @param	OutRoute			The route that was found.  Empty if there is no route.
+	 * @param	Algorithm			How to search
+	 *
+	 * @return	True if there is a route between the nodes
+	 */
+	UFUNCTION( BlueprintCallable, Category=StreetMap )
+	bool FindRoute( int32 StartNodeIndex, int32 EndNodeIndex, FStreetMapRoute& OutRoute, EStreetMapRouteAlgorithm Algorithm = EStreetMapRouteAlgorithm::AStar ) const;
+
+	/** Gets the spatial index, for finding roads, nodes and buildings near a location or inside an area */
+	const FStreetMapSpatialIndex& GetSpatialIndex() const
+	{
+		return SpatialIndex;
+	}
+
+	/** Rebuilds the spatial index.  This must be called after changing roads, nodes or buildings, and after BuildRoadGraph(). */
+	void BuildSpatialIndex();
+
+	/** Gets the contraction hierarchy used for fast routing.  Empty unless one was built. */
+	const FStreetMapContractionHierarchy& GetContractionHierarchy() const
+	{
+		return ContractionHierarchy;
+	}
+
+	/** Returns true if the street map has a contraction hierarchy for its current roads.  Hierarchies built before the roads last changed are ignored. */
+	bool HasContractionHierarchy() const
+	{
+		return ContractionHierarchy.IsBuiltFrom( RoadGraph );
+	}
+
+	/**
+	 * Builds a contraction hierarchy over the road graph, so that routes can be found much faster.  This can take a while
+	 * for large maps.  The hierarchy is saved with the street map.  It must be rebuilt after changing roads or nodes.
+	 */
+	void BuildContractionHierarchy();
+
+	/**
+	 * Finds the cost of the cheapest route from every source node to every target node, respecting one way roads.  Uses
+	 * the contraction hierarchy if the street map has one, which is much faster.  Searches are spread across worker
+	 * threads.  Safe to call from any thread, as long as the roads aren't changing at the same time.
+	 *
+	 * @param	SourceNodeIndices	Nodes to start from
+	 * @param	TargetNodeIndices	Nodes to get to
+	 * @param	OutCostMatrix		Cost from every source to every target.  Empty if any of the nodes don't exist.
+	 *
+	 * @return	True if the costs were found
+	 */
+	UFUNCTION( BlueprintCallable, Category=StreetMap )
+	bool ComputeCostMatrix( const TArray<int32>& SourceNodeIndices, const TArray<int32>& TargetNodeIndices, FStreetMapCostMatrix& OutCostMatrix ) const;
+
+	/**
+	 * Works out which roads a vehicle drove along from a trace of recorded positions, and where on those roads it was at
+	 * each position.  Noisy positions are matched to the roads that make the most sense for the trace as a whole, rather
+	 * than to whatever road each one happens to be nearest.  Safe to call from any thread, as long as the roads aren't
+	 * changing at the same time.
+	 *
+	 * @param	Positions			Recorded positions, in street map space, in the order they were recorded
+	 * @param	Settings			Tunables for matching
+	 * @param	OutMatchedPoints	Where each recorded position was matched to, one for each position.  Positions with no roads nearby aren't matched.
+	 *
+	 * @return	True if any position was matched to a road
+	 */
+	UFUNCTION( BlueprintCallable, Category=StreetMap )
+	bool MatchTrace( const TArray<FVector2D>& Positions, const FStreetMapMapMatchingSettings& Settings, TArray<FStreetMapMatchedPoint>& OutMatchedPoints ) const;
+
+	/** Same as MatchTrace(), but for positions recorded as latitudes and longitudes.  Returns false if the street map doesn't know where on the globe it is. */
+	bool MatchGeographicTrace( const TArray<double>& Latitudes, const TArray<double>& Longitudes, const FStreetMapMapMatchingSettings& Settings, TArray<FStreetMapMatchedPoint>& OutMatchedPoints ) const;
+
+	/** Returns true if the street map knows where on the globe it is, so latitudes and longitudes can be converted to street map space */
+	bool HasGeographicOrigin() const
+	{
+		return UnitsPerMeter > 0.0f;
+	}
+
+	/** Converts a latitude and longitude to street map space.  Only valid if the street map has a geographic origin. */
+	FVector2D ProjectLatLong( const double Latitude, const double Longitude ) const;
+
+	/** Sets where on the globe street map space is centered, and its scale.  The importer does this; the roads must already be projected this way. */
+	void SetGeographicOrigin( const double InOriginLatitude, const double InOriginLongitude, const float InUnitsPerMeter )
+	{
+		OriginLatitude = InOriginLatitude;
+		OriginLongitude = InOriginLongitude;
+		UnitsPerMeter = InUnitsPerMeter;
+	}
+
 	/** Gets the bounding box of the map */
 	FVector2D GetBoundsMin() const
 	{
@@ -387,6 +674,31 @@ protected:
 	UPROPERTY( Category=StreetMap, VisibleAnywhere)
 	FVector2D BoundsMax;
 
+	/** Latitude that street map space is centered on */
+	UPROPERTY( Category=StreetMap, VisibleAnywhere )
+	double OriginLatitude;
+
+	/** Longitude that street map space is centered on */
+	UPROPERTY( Category=StreetMap, VisibleAnywhere )
+	double OriginLongitude;
+
+	/** Street map units in a meter.  Zero for street maps imported before this was recorded, which can't convert latitudes and longitudes. */
+	UPROPERTY( Category=StreetMap, VisibleAnywhere )
+	float UnitsPerMeter;
+
+	/** Connections between nodes.  Built from the roads and nodes when the street map is loaded or imported. */
+	FStreetMapRoadGraph RoadGraph;
+
+	/** Spatial index over roads, nodes and buildings.  Built when the street map is loaded or imported. */
+	FStreetMapSpatialIndex SpatialIndex;
+
+	/** Contraction hierarchy over the road graph, for fast routing.  Only built when asked for. */
+	UPROPERTY()
+	FStreetMapContractionHierarchy ContractionHierarchy;
+
+	/** Finds routes over the road graph, reusing scratch space between searches */
+	FStreetMapRouter Router;
+
 #if WITH_EDITORONLY_DATA
 	/** Importing data and options used for this mesh */
 	UPROPERTY( VisibleAnywhere, Instanced, Category=ImportSettings )
@@ -441,81 +753,73 @@ inline const FStreetMapNode& FStreetMapRoad::GetNodeAtPointIndexOrLater( const U
 }
 
 
-inline float FStreetMapRoad::ComputeLengthOfRoad( const class UStreetMap& StreetMap ) const
+inline int32 FStreetMapRoad::FindSegmentForPositionAlongRoad( const float PositionAlongRoad ) const
 {
-	// @todo: Performance: We could cache the road's total length at load time to avoid having to compute it,
-	//        or we could save it right into the asset file
+	checkf( HasPointPositionsAlongRoad(), TEXT( "Positions along roads must be cached before they are used.  See UStreetMap::BuildRoadGraph()." ) );
+	checkSlow( RoadPoints.Num() > 1 );
 
-	return ComputeDistanceBetweenNodesOnRoad( StreetMap, 0, this->NodeIndices.Num() - 1 );
+	// The segment ends at the first point that is at least as far along as the position.  Past the end of the road, there
+	// isn't one, so the last segment is used.
+	const int32 SegmentEndPointIndex = FMath::Clamp( Algo::LowerBound( PointPositionsAlongRoad, PositionAlongRoad ), 1, PointPositionsAlongRoad.Num() - 1 );
+	return SegmentEndPointIndex - 1;
 }
 
 
-inline float FStreetMapRoad::ComputeDistanceBetweenNodesOnRoad( const class UStreetMap& StreetMap, const int32 NodePointIndexA, const int32 NodePointIndexB ) const
+inline float FStreetMapRoad::ComputeLengthOfRoad( const class UStreetMap& StreetMap ) const
 {
-	float TotalDistanceSoFar = 0.0f;
+	checkf( HasPointPositionsAlongRoad(), TEXT( "Positions along roads must be cached before they are used.  See UStreetMap::BuildRoadGraph()." ) );
+	return PointPositionsAlongRoad.Num() > 0 ? PointPositionsAlongRoad.Last() : 0.0f;
+}
 
+
+inline float FStreetMapRoad::ComputeDistanceBetweenNodesOnRoad( const class UStreetMap& StreetMap, const int32 NodePointIndexA, const int32 NodePointIndexB ) const
+{
 	// NOTE: It is very important that we use the actual road point indices here and not nodes directly, because the same node can appear
 	// more than once on a single road!
 
-	// @todo: Performance: We can cache distances between connected nodes rather than computing them every time.  This
-	//        can be computed at load time or at import time (and stored in the asset).  Most of the other functions
-	//        in this class that perform Size() computations could be changed to use cached distances also!
+	checkf( HasPointPositionsAlongRoad(), TEXT( "Positions along roads must be cached before they are used.  See UStreetMap::BuildRoadGraph()." ) );
 
 	const int32 SmallerPointIndex = FMath::Max( 0, FMath::Min( NodePointIndexA, NodePointIndexB ) );
 	const int32 LargerPointIndex = FMath::Min( RoadPoints.Num() - 1, FMath::Max( NodePointIndexA, NodePointIndexB ) );
 
-	for( int32 PointIndex = SmallerPointIndex; PointIndex < LargerPointIndex; ++PointIndex )
-	{
-		const FVector2D PointLocation = RoadPoints[ PointIndex ];
-		const FVector2D NextPointLocation = RoadPoints[ PointIndex + 1 ];
-
-		const float DistanceBetweenPoints = ( NextPointLocation - PointLocation ).Size();
-			
-		TotalDistanceSoFar += DistanceBetweenPoints;
-	}
+	const float DistanceBetweenNodes = LargerPointIndex > SmallerPointIndex ? PointPositionsAlongRoad[ LargerPointIndex ] - PointPositionsAlongRoad[ SmallerPointIndex ] : 0.0f;
 	
 	// @todo: Malformed data can cause this assertion to trigger.  This could be a single road with at least two adjacent nodes
 	//        at the exact same location.  We need to filter this out at load time probably.
-	// check( TotalDistanceSoFar > 0.0f );
+	// check( DistanceBetweenNodes > 0.0f );
 
-	return TotalDistanceSoFar;
+	return DistanceBetweenNodes;
 }
 
 
 inline void FStreetMapRoad::FindEarlierAndLaterNodesForPositionAlongRoad( const class UStreetMap& StreetMap, const float PositionAlongRoad, const FStreetMapNode*& OutEarlierNode, float& OutEarlierNodePositionAlongRoad, const FStreetMapNode*& OutLaterNode, float& OutLaterNodePositionAlongRoad ) const
 {
-	float CurrentPointPositionAlongRoad = 0.0f;
-
 	const FStreetMapNode* EarlierStreetMapNode = nullptr;
 	const FStreetMapNode* LaterStreetMapNode = nullptr;
 
+	// The later node is the first one at or past the end of the segment the position is on, and the earlier node is the
+	// last one before that
 	const int32 NumPoints = RoadPoints.Num();
-	for( int32 CurrentPointIndex = 0; CurrentPointIndex < NumPoints - 1; ++CurrentPointIndex )
+	int32 LaterPointIndex = FindSegmentForPositionAlongRoad( PositionAlongRoad ) + 1;
+	while( LaterPointIndex < NumPoints && NodeIndices[ LaterPointIndex ] == INDEX_NONE )
 	{
-		if( this->NodeIndices[ CurrentPointIndex ] != INDEX_NONE )
-		{
-			EarlierStreetMapNode = &StreetMap.GetNodes()[ this->NodeIndices[ CurrentPointIndex ] ];
-			OutEarlierNodePositionAlongRoad = CurrentPointPositionAlongRoad;
-		}
-
-		const int32 NextPointIndex = CurrentPointIndex + 1;
-		const FVector2D CurrentPointLocation = RoadPoints[ CurrentPointIndex ];
-		const FVector2D NextPointLocation = RoadPoints[ NextPointIndex ];
+		++LaterPointIndex;
+	}
 
-		const float DistanceBetweenPoints = ( NextPointLocation - CurrentPointLocation ).Size();
-		const float NextPointPositionAlongRoad = CurrentPointPositionAlongRoad + DistanceBetweenPoints;
+	if( LaterPointIndex < NumPoints )
+	{
+		LaterStreetMapNode = &StreetMap.GetNodes()[ this->NodeIndices[ LaterPointIndex ] ];
+		OutLaterNodePositionAlongRoad = PointPositionsAlongRoad[ LaterPointIndex ];
 
-		if( NextPointPositionAlongRoad >= PositionAlongRoad )
+		for( int32 EarlierPointIndex = LaterPointIndex - 1; EarlierPointIndex >= 0; --EarlierPointIndex )
 		{
-			if( NodeIndices[ NextPointIndex ] != INDEX_NONE )
+			if( this->NodeIndices[ EarlierPointIndex ] != INDEX_NONE )
 			{
-				LaterStreetMapNode = &StreetMap.GetNodes()[ this->NodeIndices[ NextPointIndex ] ];
-				OutLaterNodePositionAlongRoad = NextPointPositionAlongRoad;
+				EarlierStreetMapNode = &StreetMap.GetNodes()[ this->NodeIndices[ EarlierPointIndex ] ];
+				OutEarlierNodePositionAlongRoad = PointPositionsAlongRoad[ EarlierPointIndex ];
 				break;
 			}
 		}
-			
-		CurrentPointPositionAlongRoad = NextPointPositionAlongRoad;
 	}
 
 	check( EarlierStreetMapNode != nullptr && LaterStreetMapNode != nullptr );
@@ -555,54 +859,24 @@ inline void FStreetMapRoad::FindEarlierAndLaterNodes( const class UStreetMap& St
 
 inline float FStreetMapRoad::FindPositionAlongRoadForNode( const class UStreetMap& StreetMap, const int32 PointIndexForNode ) const
 {
-	float CurrentPointPositionAlongRoad = 0.0f;
-
-	bool bFoundLocation = false;
-	const int32 NumPoints = RoadPoints.Num();
-	for( int32 CurrentPointIndex = 0; CurrentPointIndex < PointIndexForNode; ++CurrentPointIndex )
-	{
-		const FVector2D CurrentPointLocation = RoadPoints[ CurrentPointIndex ];
-		const FVector2D NextPointLocation = RoadPoints[ CurrentPointIndex + 1 ];
-
-		const float DistanceBetweenPoints = ( NextPointLocation - CurrentPointLocation ).Size();
-		const float NextPointPositionAlongRoad = CurrentPointPositionAlongRoad + DistanceBetweenPoints;
-
-		CurrentPointPositionAlongRoad = NextPointPositionAlongRoad;
-	}
-
-	return CurrentPointPositionAlongRoad;
+	checkf( HasPointPositionsAlongRoad(), TEXT( "Positions along roads must be cached before they are used.  See UStreetMap::BuildRoadGraph()." ) );
+	return PointPositionsAlongRoad[ PointIndexForNode ];
 }
 
 
 inline FVector2D FStreetMapRoad::MakeLocationAlongRoad( const class UStreetMap& StreetMap, const float PositionAlongRoad ) const
 {
-	FVector2D LocationAlongRoad = FVector2D::ZeroVector;
-	float CurrentPointPositionAlongRoad = 0.0f;
+	checkf( HasPointPositionsAlongRoad(), TEXT( "Positions along roads must be cached before they are used.  See UStreetMap::BuildRoadGraph()." ) );
 
-	bool bFoundLocation = false;
-	const int32 NumPoints = RoadPoints.Num();
-	for( int32 CurrentPointIndex = 0; CurrentPointIndex < NumPoints - 1; ++CurrentPointIndex )
-	{
-		const FVector2D CurrentPointLocation = RoadPoints[ CurrentPointIndex ];
-		const FVector2D NextPointLocation = RoadPoints[ CurrentPointIndex + 1 ];
+	// Clamped to the road, so that the location stays between the ends of the segment that the position is on
+	const float ClampedPositionAlongRoad = FMath::Clamp( PositionAlongRoad, 0.0f, PointPositionsAlongRoad.Last() );
+	const int32 PointIndex = FindSegmentForPositionAlongRoad( ClampedPositionAlongRoad );
 
-		const float DistanceBetweenPoints = ( NextPointLocation - CurrentPointLocation ).Size();
-		const float NextPointPositionAlongRoad = CurrentPointPositionAlongRoad + DistanceBetweenPoints;
+	const float PointPositionAlongRoad = PointPositionsAlongRoad[ PointIndex ];
+	const float DistanceBetweenPoints = PointPositionsAlongRoad[ PointIndex + 1 ] - PointPositionAlongRoad;
+	const float LerpAlpha = DistanceBetweenPoints > 0.0f ? ( ClampedPositionAlongRoad - PointPositionAlongRoad ) / DistanceBetweenPoints : 0.0f;
 
-		if( NextPointPositionAlongRoad >= PositionAlongRoad )
-		{
-			const float LerpAlpha = ( PositionAlongRoad - CurrentPointPositionAlongRoad ) / DistanceBetweenPoints;
-			LocationAlongRoad = FMath::Lerp( CurrentPointLocation, NextPointLocation, LerpAlpha );
-			bFoundLocation = true;
-			break;
-		}
-			
-		CurrentPointPositionAlongRoad = NextPointPositionAlongRoad;
-	}
-
-	check( bFoundLocation == true );
-
-	return LocationAlongRoad;
+	return FMath::Lerp( RoadPoints[ PointIndex ], RoadPoints[ PointIndex + 1 ], LerpAlpha );
 }
 
 
@@ -644,227 +918,57 @@ inline FVector2D FStreetMapNode::GetLocation( const UStreetMap& StreetMap ) cons
 
 inline const FStreetMapRoad& FStreetMapNode::GetShortestCostRoadToNode( UStreetMap& StreetMap, const FStreetMapNode& OtherNode, const bool bIsTravelingForward, int32& OutPointIndexOnRoad ) const
 {
-	const FStreetMapRoad* ConnectingRoad = nullptr;
+	checkf( StreetMap.HasRoadGraph(), TEXT( "The street map's road graph must be built before its nodes' connections are used.  See UStreetMap::BuildRoadGraph()." ) );
 
-	float BestConnectionCost = TNumericLimits<float>::Max();
-	int32 BestConnectionIndex = INDEX_NONE;
-	int32 BestConnectionPointIndex = INDEX_NONE;
+	const FStreetMapRoadGraphEdge* BestEdge = nullptr;
 
-	const int32 ConnectionCount = GetConnectionCount( StreetMap, bIsTravelingForward );
-	for( int32 ConnectionIndex = 0; ConnectionIndex < ConnectionCount; ++ConnectionIndex )
+	const int32 OtherNodeIndex = OtherNode.GetNodeIndex( StreetMap );
+	for( const FStreetMapRoadGraphEdge& Edge : StreetMap.GetRoadGraph().GetEdges( GetNodeIndex( StreetMap ), bIsTravelingForward ) )
 	{
-		int32 MyPointIndexOnRoad;
-		int32 ConnectedNodePointIndexOnRoad;
-
-		const FStreetMapRoad* CurrentConnectingRoad;
-		const FStreetMapNode* ConnectedNode = GetConnection( StreetMap, ConnectionIndex, bIsTravelingForward, /* Out */ &CurrentConnectingRoad, /* Out */ &MyPointIndexOnRoad, /* Out */ &ConnectedNodePointIndexOnRoad );
-		if( ConnectedNode == &OtherNode )
+		// The two nodes are usually only connected by a single road, but there might be more than one
+		if( Edge.NodeIndex == OtherNodeIndex && ( BestEdge == nullptr || Edge.Cost < BestEdge->Cost ) )
 		{
-			if( BestConnectionIndex != INDEX_NONE )
-			{
-				// We evaluate cost lazily, only in the unusual case of the two nodes being connected by multiple roads
-				BestConnectionCost = GetConnectionCost( StreetMap, BestConnectionIndex, bIsTravelingForward );
-				if( GetConnectionCost( StreetMap, ConnectionIndex, bIsTravelingForward ) < BestConnectionCost )
-				{
-					ConnectingRoad = CurrentConnectingRoad;
-					BestConnectionIndex = ConnectionIndex;
-					BestConnectionPointIndex = MyPointIndexOnRoad;
-				}
-			}
-			else
-			{
-				ConnectingRoad = CurrentConnectingRoad;
-				BestConnectionIndex = ConnectionIndex;
-				BestConnectionPointIndex = MyPointIndexOnRoad;
-			}
+			BestEdge = &Edge;
 		}
 	}
 
-	check( ConnectingRoad != nullptr );
-	OutPointIndexOnRoad = BestConnectionPointIndex;
-	return *ConnectingRoad;
+	check( BestEdge != nullptr );
+	OutPointIndexOnRoad = BestEdge->PointIndexOnRoad;
+	return StreetMap.GetRoads()[ BestEdge->RoadIndex ];
 }
 
 inline int32 FStreetMapNode::GetConnectionCount( const UStreetMap& StreetMap, const bool bIsTravelingForward ) const
 {
-	// NOTE: We're iterating here in the exact same order as in the GetConnection() function below!  That's critically important!
-	int32 TotalConnections = 0;
-	for( const FStreetMapRoadRef& RoadRef : RoadRefs )
-	{
-		const FStreetMapRoad& Road = StreetMap.GetRoads()[ RoadRef.RoadIndex ];
-		
-		if( RoadRef.RoadPointIndex > 0 && ( !bIsTravelingForward || !Road.IsOneWay() ) )
-		{
-			// We connect to a node earlier up this road
-			++TotalConnections;
-		}
-
-		if( RoadRef.RoadPointIndex < ( Road.NodeIndices.Num() - 1 ) && ( bIsTravelingForward || !Road.IsOneWay() ) )
-		{
-			// We connect to a node further down this road
-			++TotalConnections;
-		}
-	}
-
-	return TotalConnections;
+	checkf( StreetMap.HasRoadGraph(), TEXT( "The street map's road graph must be built before its nodes' connections are used.  See UStreetMap::BuildRoadGraph()." ) );
+	return StreetMap.GetRoadGraph().GetEdges( GetNodeIndex( StreetMap ), bIsTravelingForward ).Num();
 }
 
 
 inline const FStreetMapNode* FStreetMapNode::GetConnection( const UStreetMap& StreetMap, const int32 ConnectionIndex, const bool bIsTravelingForward, const FStreetMapRoad** OutConnectingRoad, int32* OutPointIndexOnRoad, int32* OutConnectedNodePointIndexOnRoad ) const
 {
+	checkf( StreetMap.HasRoadGraph(), TEXT( "The street map's road graph must be built before its nodes' connections are used.  See UStreetMap::BuildRoadGraph()." ) );
+
+	const FStreetMapRoadGraphEdge& Edge = StreetMap.GetRoadGraph().GetEdges( GetNodeIndex( StreetMap ), bIsTravelingForward )[ ConnectionIndex ];
 	if( OutConnectingRoad != nullptr )
 	{
-		*OutConnectingRoad = nullptr;
+		*OutConnectingRoad = &StreetMap.GetRoads()[ Edge.RoadIndex ];
 	}
-	const FStreetMapNode* ConnectedNode = nullptr;
-
-	// @todo: Performance: We can improve performance by caching additional connectivity information right on
-	//        the node itself.  This function would be a hot spot for any sort of pathfinding computation
-
-	// NOTE: We're iterating here in the exact same order as in the GetConnectionCount() function above!  That's critically important!
-	int32 CurrentConnectionIndex = 0;
-	for( const FStreetMapRoadRef& RoadRef : RoadRefs )
+	if( OutPointIndexOnRoad != nullptr )
 	{
-		const FStreetMapRoad& Road = StreetMap.GetRoads()[ RoadRef.RoadIndex ];
-		
-		// @todo: Performance: We could avoid the "while" loops below by not storing INDEX_NONEs in the NodeIndices array,
-		//        but instead mapping them to points by going through the node itself, then back to a road
-
-		if( RoadRef.RoadPointIndex > 0 && ( !bIsTravelingForward || !Road.IsOneWay() ) )
-		{
-			// We connect to an earlier node up this road
-			if( CurrentConnectionIndex == ConnectionIndex )
-			{
-				int32 EarlierNodeRoadPointIndex = RoadRef.RoadPointIndex - 1;
-				while( Road.NodeIndices[ EarlierNodeRoadPointIndex ] == INDEX_NONE )
-				{
-					--EarlierNodeRoadPointIndex;
-				}
-				const int32 EarlierNodeIndex = Road.NodeIndices[ EarlierNodeRoadPointIndex ];
-
-				const FStreetMapNode& EarlierNode = StreetMap.GetNodes()[ EarlierNodeIndex ];
-				ConnectedNode = &EarlierNode;
-				if( OutConnectingRoad != nullptr )
-				{
-					*OutConnectingRoad = &Road;
-				}
-				if( OutPointIndexOnRoad != nullptr )
-				{
-					*OutPointIndexOnRoad = RoadRef.RoadPointIndex;
-				}
-				if( OutConnectedNodePointIndexOnRoad != nullptr )
-				{
-					*OutConnectedNodePointIndexOnRoad = EarlierNodeRoadPointIndex;
-				}
-
-				// Got it!
-				break;
-			}
-
-			++CurrentConnectionIndex;
-		}
-
-		if( RoadRef.RoadPointIndex < ( Road.NodeIndices.Num() - 1 ) && ( bIsTravelingForward || !Road.IsOneWay() ) )
-		{
-			// We connect to node further down this road
-			if( CurrentConnectionIndex == ConnectionIndex )
-			{
-				int32 LaterNodeRoadPointIndex = RoadRef.RoadPointIndex + 1;
-				while( Road.NodeIndices[ LaterNodeRoadPointIndex ] == INDEX_NONE )
-				{
-					++LaterNodeRoadPointIndex;
-				}
-				const int32 LaterNodeIndex = Road.NodeIndices[ LaterNodeRoadPointIndex ];
-
-				const FStreetMapNode& LaterNode = StreetMap.GetNodes()[ LaterNodeIndex ];
-				ConnectedNode = &LaterNode;
-				if( OutConnectingRoad != nullptr )
-				{
-					*OutConnectingRoad = &Road;
-				}
-				if( OutPointIndexOnRoad != nullptr )
-				{
-					*OutPointIndexOnRoad = RoadRef.RoadPointIndex;
-				}
-				if( OutConnectedNodePointIndexOnRoad != nullptr )
-				{
-					*OutConnectedNodePointIndexOnRoad = LaterNodeRoadPointIndex;
-				}
-
-				// Got it!
-				break;
-			}
-
-			++CurrentConnectionIndex;
-		}
+		*OutPointIndexOnRoad = Edge.PointIndexOnRoad;
+	}
+	if( OutConnectedNodePointIndexOnRoad != nullptr )
+	{
+		*OutConnectedNodePointIndexOnRoad = Edge.ConnectedNodePointIndexOnRoad;
 	}
 
-	check( ConnectedNode != nullptr );
-	return ConnectedNode;
+	return &StreetMap.GetNodes()[ Edge.NodeIndex ];
 }
 
 
 inline float FStreetMapNode::GetConnectionCost( const UStreetMap& StreetMap, const int32 ConnectionIndex, const bool bIsTravelingForward ) const
 {
-	/////////////////////////////////////////////////////////
-	// Tweakables for connection cost estimation
-	//
-	const float MaxSpeedLimit = 120.0f;	// 120 Km/hr
-	const float HighwaySpeed = 110.0f;
-	const float HighwayTrafficFactor = 0.0;
-	const float MajorRoadSpeed = 70.0f;
-	const float MajorRoadTrafficFactor = 0.2f;
-	const float StreetSpeed = 40.0f;
-	const float StreetTrafficFactor = 1.0f;
-	/////////////////////////////////////////////////////////
-
-	// @todo: Street map pathfinding is a grand art in itself, and estimating cost of connections is
-	//        a very complicated problem.  We're only doing some basic estimates for now, but in the
-	//        future we could consider taking into account the cost of different types of turns and
-	//        intersections, lane counts, actual speed limits, etc.
-
-	int32 MyPointIndexOnRoad;
-	int32 ConnectedNodePointIndexOnRoad;
-
-	const FStreetMapRoad* ConnectingRoad = nullptr;
-	const FStreetMapNode& ConnectedNode = *GetConnection( StreetMap, ConnectionIndex, bIsTravelingForward, /* Out */ &ConnectingRoad, /* Out */ &MyPointIndexOnRoad, /* Out */ &ConnectedNodePointIndexOnRoad );
-
-	const float DistanceBetweenNodes = ConnectingRoad->ComputeDistanceBetweenNodesOnRoad( StreetMap, MyPointIndexOnRoad, ConnectedNodePointIndexOnRoad );
-	
-	float TotalCost = DistanceBetweenNodes;
-
-	// Apply some scaling to the cost of traveling between these nodes
-	{
-		float SpeedLimit = 0.0f;
-		float TrafficFactor = 0.0f;
-		switch( ConnectingRoad->RoadType )
-		{
-			case EStreetMapRoadType::Highway:
-				SpeedLimit = HighwaySpeed;
-				TrafficFactor = HighwayTrafficFactor;
-				break;
-
-			case EStreetMapRoadType::MajorRoad:
-				SpeedLimit = MajorRoadSpeed;
-				TrafficFactor = MajorRoadTrafficFactor;
-				break;
-
-			case EStreetMapRoadType::Street:
-			case EStreetMapRoadType::Other:
-				SpeedLimit = StreetSpeed;
-				TrafficFactor = StreetTrafficFactor;
-				break;
-
-			default:
-				check( 0 );
-				break;
-		}
-
-		const float RoadSpeedCostScale = ( 1.0f - ( SpeedLimit / MaxSpeedLimit ) );
-		TotalCost *= 1.0f + RoadSpeedCostScale * 15.0f * ( 0.5f + TrafficFactor * 0.5f );
-	}
-
-	return TotalCost;
+	// Costs are worked out when the road graph is built.  See FStreetMapRoadGraph::ComputeConnectionCost().
+	checkf( StreetMap.HasRoadGraph(), TEXT( "The street map's road graph must be built before its nodes' connections are used.  See UStreetMap::BuildRoadGraph()." ) );
+	return StreetMap.GetRoadGraph().GetEdges( GetNodeIndex( StreetMap ), bIsTravelingForward )[ ConnectionIndex ].Cost;
 }
-
-
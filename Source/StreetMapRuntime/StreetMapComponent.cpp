@@ -1,14 +1,22 @@
 // Copyright 2017 Mike Fricker. All Rights Reserved.
 
 #include "StreetMapComponent.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "StaticMeshResources.h"
+#include "ComponentRecreateRenderStateContext.h"
 
 
 UStreetMapComponent::UStreetMapComponent(const FObjectInitializer& ObjectInitializer)
 	: URuntimeMeshComponent(ObjectInitializer),
 	  StreetMap(nullptr)
 {
-	// We don't currently need to be ticked.  This can be overridden in a derived class though.
-	PrimaryComponentTick.bCanEverTick = false;
+	// We only need to be ticked to switch between levels of detail, and only once we have a mesh with more than one
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	bTickInEditor = true;
 	this->bAutoActivate = false;	// NOTE: Components instantiated through C++ are not automatically active, so they'll only tick once and then go to sleep!
 
 	// We don't currently need InitializeComponent() to be called on us.  This can be overridden in a
@@ -23,272 +31,1836 @@ UStreetMapComponent::UStreetMapComponent(const FObjectInitializer& ObjectInitial
 
 	static ConstructorHelpers::FObjectFinder<UMaterialInterface> DefaultMaterialAsset(TEXT("/StreetMap/StreetMapDefaultMaterial"));
 	StreetMapDefaultMaterial = DefaultMaterialAsset.Object;
+
+	static ConstructorHelpers::FObjectFinder<UStaticMesh> DefaultInstancedBuildingMeshAsset(TEXT("/Engine/BasicShapes/Cube"));
+	DefaultInstancedBuildingMesh = DefaultInstancedBuildingMeshAsset.Object;
+}
+
+
+void UStreetMapComponent::SetStreetMap(class UStreetMap* NewStreetMap, bool bClearPreviousMeshIfAny /*= false*/, bool bRebuildMesh /*= false */)
+{
+	if (StreetMap != NewStreetMap)
+	{
+		StreetMap = NewStreetMap;
+
+		if (bClearPreviousMeshIfAny)
+			ClearMesh();
+
+		if (bRebuildMesh)
+		{
+			// Don't stall the game while a new map is built
+			const UWorld* World = GetWorld();
+			if (World != nullptr && World->IsGameWorld())
+			{
+				BuildMeshAsync();
+			}
+			else
+			{
+				BuildMesh();
+			}
+		}
+	}
+}
+
+
+void UStreetMapComponent::BeginDestroy()
+{
+	// Mesh builds might still be reading their street maps, so wait for them to stop before anything is freed
+	CancelMeshBuild();
+	for (const TSharedPtr<FStreetMapAsyncMeshBuild, ESPMode::ThreadSafe>& Build : RunningMeshBuilds)
+	{
+		Build->bCancelled = true;
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(Build->Task);
+	}
+	RunningMeshBuilds.Empty();
+
+	Super::BeginDestroy();
+}
+
+
+void UStreetMapComponent::AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector)
+{
+	UStreetMapComponent* This = CastChecked<UStreetMapComponent>(InThis);
+	for (const TSharedPtr<FStreetMapAsyncMeshBuild, ESPMode::ThreadSafe>& Build : This->RunningMeshBuilds)
+	{
+		Collector.AddReferencedObject(Build->StreetMap, This);
+		Collector.AddReferencedObject(Build->InstancedBuildingMesh, This);
+	}
+
+	Super::AddReferencedObjects(InThis, Collector);
+}
+
+
+/** Writes the geometry for a single road segment or building into its own range of a tile's (preallocated) mesh buffers */
+struct FStreetMapMeshWriter
+{
+	FStreetMapMeshWriter( TArray<FStreetMapVertex>& InVertices, TArray<int32>& InIndices, const int32 FirstVertexIndex, const int32 FirstIndexIndex )
+		: Vertices( InVertices ),
+		  Indices( InIndices ),
+		  NextVertexIndex( FirstVertexIndex ),
+		  NextIndexIndex( FirstIndexIndex )
+	{
+	}
+
+	/** Adds a vertex, returning its index in the vertex buffer */
+	int32 AddVertex( const FVector& Position, const FVector2D& UV0, const FVector& Tangent, const FVector& Normal, const FColor& Color )
+	{
+		const int32 VertexIndex = NextVertexIndex++;
+
+		FStreetMapVertex& NewVertex = *new( Vertices.GetData() + VertexIndex )FStreetMapVertex();
+		NewVertex.Position = Position;
+		NewVertex.UV0 = UV0;
+		NewVertex.Tangent = Tangent;
+		NewVertex.Normal = Normal;
+		NewVertex.Color = Color;
+
+		return VertexIndex;
+	}
+
+	/** Adds a triangle made of vertices that were already added */
+	void AddTriangle( const int32 VertexIndexA, const int32 VertexIndexB, const int32 VertexIndexC )
+	{
+		int32* TriangleIndices = Indices.GetData() + NextIndexIndex;
+		TriangleIndices[ 0 ] = VertexIndexA;
+		TriangleIndices[ 1 ] = VertexIndexB;
+		TriangleIndices[ 2 ] = VertexIndexC;
+		NextIndexIndex += 3;
+	}
+
+	TArray<FStreetMapVertex>& Vertices;
+	TArray<int32>& Indices;
+
+	/** Where the next vertex and index will be written */
+	int32 NextVertexIndex;
+	int32 NextIndexIndex;
+};
+
+
+/** A single piece of the street map mesh (a stretch of road, a whole building or a road junction), and where it goes in the mesh */
+struct FStreetMapMeshItem
+{
+	/** Road index, or the number of roads plus the building index for buildings, or the number of roads and buildings plus
+	    the node index for road junctions */
+	int32 ElementIndex;
+
+	/** For roads, the first and last points of the stretch of road */
+	int32 FirstPointIndex;
+	int32 LastPointIndex;
+
+	/** The tile that this item's geometry is written to */
+	int32 TileIndex;
+
+	/** Where this item's vertices and indices start in its tile's mesh buffers */
+	int32 FirstVertexIndex;
+	int32 FirstIndexIndex;
+};
+
+
+/** Adds a 2D line to the raw mesh */
+static void AddThick2DLine( FStreetMapMeshWriter& Writer, const FVector2D Start, const FVector2D End, const float Z, const float Thickness, const FColor& StartColor, const FColor& EndColor )
+{
+	const float HalfThickness = Thickness * 0.5f;
+
+	const FVector2D LineDirection = ( End - Start ).GetSafeNormal();
+	const FVector2D RightVector( -LineDirection.Y, LineDirection.X );
+	const FVector Tangent( LineDirection, 0.0f );
+
+	const int32 BottomLeftVertexIndex = Writer.AddVertex( FVector( Start - RightVector * HalfThickness, Z ), FVector2D( 0.0f, 0.0f ), Tangent, FVector::UpVector, StartColor );
+	const int32 BottomRightVertexIndex = Writer.AddVertex( FVector( Start + RightVector * HalfThickness, Z ), FVector2D( 1.0f, 0.0f ), Tangent, FVector::UpVector, StartColor );
+	const int32 TopRightVertexIndex = Writer.AddVertex( FVector( End + RightVector * HalfThickness, Z ), FVector2D( 1.0f, 1.0f ), Tangent, FVector::UpVector, EndColor );
+	const int32 TopLeftVertexIndex = Writer.AddVertex( FVector( End - RightVector * HalfThickness, Z ), FVector2D( 0.0f, 1.0f ), Tangent, FVector::UpVector, EndColor );
+
+	Writer.AddTriangle( BottomLeftVertexIndex, BottomRightVertexIndex, TopRightVertexIndex );
+	Writer.AddTriangle( BottomLeftVertexIndex, TopRightVertexIndex, TopLeftVertexIndex );
+}
+
+
+/** Roads are beveled at points where a mitered join would stick out more than this many times the road's half thickness */
+static const float RoadMiterLimit = 2.0f;
+
+/** Number of sides of the polygons that fill in road junctions */
+static const int32 NumRoadJunctionSides = 8;
+
+
+/** Describes how the edges of a road meet at one of the road's points */
+struct FStreetMapRoadJoin
+{
+	/** Offset from the road point to the right edge of the road, at the end of the incoming segment and at the start of the
+	    outgoing segment.  These are the same unless the join is beveled. */
+	FVector2D IncomingOffset;
+	FVector2D OutgoingOffset;
+
+	/** Direction of the road at the end of the incoming segment and at the start of the outgoing segment */
+	FVector2D IncomingDirection;
+	FVector2D OutgoingDirection;
+
+	/** True if this is a sharp corner, which needs separate vertices for the incoming and outgoing segments */
+	bool bIsBeveled;
+};
+
+
+/** Works out how the edges of a road meet at a point on the road */
+static FStreetMapRoadJoin ComputeRoadJoin( const TArray<FVector2D>& RoadPoints, const int32 PointIndex, const float HalfThickness )
+{
+	FStreetMapRoadJoin Join;
+
+	const int32 NumPoints = RoadPoints.Num();
+	Join.IncomingDirection = PointIndex > 0 ? ( RoadPoints[ PointIndex ] - RoadPoints[ PointIndex - 1 ] ).GetSafeNormal() : FVector2D::ZeroVector;
+	Join.OutgoingDirection = PointIndex < NumPoints - 1 ? ( RoadPoints[ PointIndex + 1 ] - RoadPoints[ PointIndex ] ).GetSafeNormal() : FVector2D::ZeroVector;
+
+	// Ends of the road (and points next to zero length segments) just continue the one segment that we have
+	if( Join.IncomingDirection.IsZero() )
+	{
+		Join.IncomingDirection = Join.OutgoingDirection;
+	}
+	else if( Join.OutgoingDirection.IsZero() )
+	{
+		Join.OutgoingDirection = Join.IncomingDirection;
+	}
+
+	const FVector2D IncomingRightVector( -Join.IncomingDirection.Y, Join.IncomingDirection.X );
+	const FVector2D OutgoingRightVector( -Join.OutgoingDirection.Y, Join.OutgoingDirection.X );
+
+	// The miter direction is halfway between the segments' right vectors.  The sharper the corner, the further out the
+	// miter has to go to keep the road's thickness, so very sharp corners are beveled instead.
+	const FVector2D MiterVector = ( IncomingRightVector + OutgoingRightVector ).GetSafeNormal();
+	const float MiterCosine = MiterVector | IncomingRightVector;
+	Join.bIsBeveled = MiterCosine < 1.0f / RoadMiterLimit;
+
+	if( Join.bIsBeveled )
+	{
+		Join.IncomingOffset = IncomingRightVector * HalfThickness;
+		Join.OutgoingOffset = OutgoingRightVector * HalfThickness;
+	}
+	else
+	{
+		Join.IncomingOffset = Join.OutgoingOffset = MiterVector * ( HalfThickness / MiterCosine );
+	}
+
+	return Join;
+}
+
+
+/** Counts the pairs of vertices across a stretch of road.  Every point has one, except for beveled corners which have two. */
+static int32 CountRoadRibbonVertexPairs( const TArray<FVector2D>& RoadPoints, const int32 FirstPointIndex, const int32 LastPointIndex, const float HalfThickness )
+{
+	int32 NumVertexPairs = 1;
+	for( int32 PointIndex = FirstPointIndex + 1; PointIndex <= LastPointIndex; ++PointIndex )
+	{
+		NumVertexPairs += ComputeRoadJoin( RoadPoints, PointIndex, HalfThickness ).bIsBeveled ? 2 : 1;
+	}
+	return NumVertexPairs;
+}
+
+
+/**
+ * Adds a stretch of road to the raw mesh, as a ribbon with one pair of vertices across the road at every point, shared by the
+ * segments on either side.  Corners are mitered, or beveled if they're too sharp.  A beveled corner at the end of the stretch
+ * belongs to this stretch, so the next stretch starts with the outgoing side of that corner.
+ */
+static void AddRoadRibbon( FStreetMapMeshWriter& Writer, const TArray<FVector2D>& RoadPoints, const int32 FirstPointIndex, const int32 LastPointIndex, const float Z, const float Thickness, const FColor& Color )
+{
+	const float HalfThickness = Thickness * 0.5f;
+
+	// Texture coordinates run along the road, one unit for every road thickness
+	float DistanceAlongRoad = 0.0f;
+	for( int32 PointIndex = 1; PointIndex <= FirstPointIndex; ++PointIndex )
+	{
+		DistanceAlongRoad += FVector2D::Distance( RoadPoints[ PointIndex - 1 ], RoadPoints[ PointIndex ] );
+	}
+
+	// The two vertex pairs at a beveled corner cross over each other, so one of the triangles that fills in the corner
+	// would face down.  Those are flipped around, so that every triangle winds the same way as a straight road's.
+	auto AddRibbonTriangle = [&]( const int32 VertexIndexA, const int32 VertexIndexB, const int32 VertexIndexC )
+	{
+		const FVector2D A( Writer.Vertices[ VertexIndexA ].Position );
+		const FVector2D B( Writer.Vertices[ VertexIndexB ].Position );
+		const FVector2D C( Writer.Vertices[ VertexIndexC ].Position );
+		if( ( ( B - A ) ^ ( C - A ) ) > 0.0f )
+		{
+			Writer.AddTriangle( VertexIndexA, VertexIndexC, VertexIndexB );
+		}
+		else
+		{
+			Writer.AddTriangle( VertexIndexA, VertexIndexB, VertexIndexC );
+		}
+	};
+
+	int32 PreviousLeftVertexIndex = INDEX_NONE;
+	int32 PreviousRightVertexIndex = INDEX_NONE;
+	auto AddVertexPair = [&]( const FVector2D& Point, const FVector2D& RightOffset, const FVector2D& Direction )
+	{
+		const float V = DistanceAlongRoad / Thickness;
+		const FVector Tangent( Direction, 0.0f );
+		const int32 LeftVertexIndex = Writer.AddVertex( FVector( Point - RightOffset, Z ), FVector2D( 0.0f, V ), Tangent, FVector::UpVector, Color );
+		const int32 RightVertexIndex = Writer.AddVertex( FVector( Point + RightOffset, Z ), FVector2D( 1.0f, V ), Tangent, FVector::UpVector, Color );
+
+		if( PreviousLeftVertexIndex != INDEX_NONE )
+		{
+			AddRibbonTriangle( PreviousLeftVertexIndex, PreviousRightVertexIndex, RightVertexIndex );
+			AddRibbonTriangle( PreviousLeftVertexIndex, RightVertexIndex, LeftVertexIndex );
+		}
+
+		PreviousLeftVertexIndex = LeftVertexIndex;
+		PreviousRightVertexIndex = RightVertexIndex;
+	};
+
+	for( int32 PointIndex = FirstPointIndex; PointIndex <= LastPointIndex; ++PointIndex )
+	{
+		if( PointIndex > FirstPointIndex )
+		{
+			DistanceAlongRoad += FVector2D::Distance( RoadPoints[ PointIndex - 1 ], RoadPoints[ PointIndex ] );
+		}
+
+		const FStreetMapRoadJoin Join = ComputeRoadJoin( RoadPoints, PointIndex, HalfThickness );
+		if( !Join.bIsBeveled )
+		{
+			AddVertexPair( RoadPoints[ PointIndex ], Join.IncomingOffset, ( Join.IncomingDirection + Join.OutgoingDirection ).GetSafeNormal() );
+		}
+		else
+		{
+			if( PointIndex > FirstPointIndex )
+			{
+				AddVertexPair( RoadPoints[ PointIndex ], Join.IncomingOffset, Join.IncomingDirection );
+			}
+			AddVertexPair( RoadPoints[ PointIndex ], Join.OutgoingOffset, Join.OutgoingDirection );
+		}
+	}
+}
+
+
+/** Adds a filled polygon to the raw mesh, to cover up the gaps where roads meet */
+static void AddRoadJunction( FStreetMapMeshWriter& Writer, const FVector2D Center, const float Z, const float Radius, const FColor& Color )
+{
+	const int32 CenterVertexIndex = Writer.AddVertex( FVector( Center, Z ), FVector2D( 0.5f, 0.5f ), FVector::ForwardVector, FVector::UpVector, Color );
+
+	const int32 FirstRimVertexIndex = Writer.NextVertexIndex;
+	for( int32 SideIndex = 0; SideIndex < NumRoadJunctionSides; ++SideIndex )
+	{
+		float Sin, Cos;
+		FMath::SinCos( &Sin, &Cos, ( 2.0f * PI * SideIndex ) / NumRoadJunctionSides );
+		Writer.AddVertex( FVector( Center + FVector2D( Cos, Sin ) * Radius, Z ), FVector2D( 0.5f + Cos * 0.5f, 0.5f + Sin * 0.5f ), FVector::ForwardVector, FVector::UpVector, Color );
+	}
+
+	for( int32 SideIndex = 0; SideIndex < NumRoadJunctionSides; ++SideIndex )
+	{
+		Writer.AddTriangle( CenterVertexIndex, FirstRimVertexIndex + ( SideIndex + 1 ) % NumRoadJunctionSides, FirstRimVertexIndex + SideIndex );
+	}
+}
+
+
+/**
+ * Checks whether a building's footprint is a rectangle, and if it is, works out where the rectangle is.  Rectangular
+ * buildings all have the same shape once they're moved, rotated and stretched into place, so they can be drawn as
+ * instances of a single box mesh.
+ */
+static bool FindRectangularFootprint( const TArray<FVector2D>& Points, FVector2D& OutCenter, FVector2D& OutLengthAxis, float& OutLength, float& OutWidth )
+{
+	// How far corners can be from right angles (as a cosine), and how different opposite sides can be (as a fraction)
+	const float MaxCornerCosine = 0.05f;
+	const float MaxSideLengthDifference = 0.05f;
+
+	if( Points.Num() != 4 )
+	{
+		return false;
+	}
+
+	FVector2D Sides[ 4 ];
+	float SideLengths[ 4 ];
+	for( int32 SideIndex = 0; SideIndex < 4; ++SideIndex )
+	{
+		Sides[ SideIndex ] = Points[ ( SideIndex + 1 ) % 4 ] - Points[ SideIndex ];
+		SideLengths[ SideIndex ] = Sides[ SideIndex ].Size();
+		if( SideLengths[ SideIndex ] < KINDA_SMALL_NUMBER )
+		{
+			return false;
+		}
+		Sides[ SideIndex ] /= SideLengths[ SideIndex ];
+	}
+
+	for( int32 SideIndex = 0; SideIndex < 4; ++SideIndex )
+	{
+		if( FMath::Abs( Sides[ SideIndex ] | Sides[ ( SideIndex + 1 ) % 4 ] ) > MaxCornerCosine )
+		{
+			return false;
+		}
+	}
+
+	for( int32 SideIndex = 0; SideIndex < 2; ++SideIndex )
+	{
+		const float LongerLength = FMath::Max( SideLengths[ SideIndex ], SideLengths[ SideIndex + 2 ] );
+		if( FMath::Abs( SideLengths[ SideIndex ] - SideLengths[ SideIndex + 2 ] ) > LongerLength * MaxSideLengthDifference )
+		{
+			return false;
+		}
+	}
+
+	OutCenter = ( Points[ 0 ] + Points[ 1 ] + Points[ 2 ] + Points[ 3 ] ) * 0.25f;
+	OutLengthAxis = ( Sides[ 0 ] - Sides[ 2 ] ).GetSafeNormal();
+	OutLength = ( SideLengths[ 0 ] + SideLengths[ 2 ] ) * 0.5f;
+	OutWidth = ( SideLengths[ 1 ] + SideLengths[ 3 ] ) * 0.5f;
+	return true;
+}
+
+
+/** Every part of the mesh, as a mask of EStreetMapMeshPart bits */
+static const uint32 AllMeshParts = ( 1 << MeshPart_Count ) - 1;
+
+/** The road parts of the mesh, as a mask of EStreetMapMeshPart bits */
+static const uint32 RoadMeshParts = ( 1 << MeshPart_Streets ) | ( 1 << MeshPart_MajorRoads ) | ( 1 << MeshPart_Highways );
+
+
+/** Returns the part of the mesh that a type of road goes in */
+static EStreetMapMeshPart GetRoadMeshPart( const EStreetMapRoadType RoadType )
+{
+	switch( RoadType )
+	{
+		case EStreetMapRoadType::Highway:
+			return MeshPart_Highways;
+
+		case EStreetMapRoadType::MajorRoad:
+			return MeshPart_MajorRoads;
+
+		default:
+			return MeshPart_Streets;
+	}
+}
+
+
+/** Returns the color of building tops and walls, which is a darker version of the building border color */
+static FColor GetBuildingFillColor( const FLinearColor& BuildingBorderLinearColor )
+{
+	return FLinearColor( BuildingBorderLinearColor * 0.33f ).CopyWithNewOpacity( 1.0f ).ToFColor( false );
+}
+
+
+/**
+ * Works out the bounds of a level of detail of a tile, and converts its vertices and indices to the formats that they're
+ * uploaded in
+ */
+static void FinishStreetMapMeshLOD( FStreetMapMeshLOD& TileLOD, const bool bWantCompactVertices )
+{
+	TileLOD.BoundingBox.Init();
+	for( const FStreetMapVertex& Vertex : TileLOD.Vertices )
+	{
+		TileLOD.BoundingBox += Vertex.Position;
+	}
+	for( const FStreetMapCompactVertex& CompactVertex : TileLOD.CompactVertices )
+	{
+		TileLOD.BoundingBox += CompactVertex.Position;
+	}
+
+	// The mesh is always generated with full vertices, and converted afterwards if compact vertices are wanted
+	if( bWantCompactVertices && TileLOD.Vertices.Num() > 0 )
+	{
+		TileLOD.CompactVertices.SetNumUninitialized( TileLOD.Vertices.Num() );
+		for( int32 VertexIndex = 0; VertexIndex < TileLOD.Vertices.Num(); ++VertexIndex )
+		{
+			const FStreetMapVertex& Vertex = TileLOD.Vertices[ VertexIndex ];
+			FStreetMapCompactVertex& CompactVertex = *new( TileLOD.CompactVertices.GetData() + VertexIndex )FStreetMapCompactVertex();
+			CompactVertex.Position = Vertex.Position;
+			CompactVertex.Normal = Vertex.Normal;
+			CompactVertex.Color = Vertex.Color;
+			CompactVertex.UV0 = Vertex.UV0;
+		}
+		TileLOD.Vertices.Empty();
+	}
+
+	// Most tiles have few enough vertices for 16-bit indices, which halves the size of their index buffers
+	if( TileLOD.Indices.Num() > 0 && TileLOD.GetNumVertices() <= (int32)MAX_uint16 + 1 )
+	{
+		TileLOD.Indices16.SetNumUninitialized( TileLOD.Indices.Num() );
+		for( int32 IndexIndex = 0; IndexIndex < TileLOD.Indices.Num(); ++IndexIndex )
+		{
+			TileLOD.Indices16[ IndexIndex ] = (uint16)TileLOD.Indices[ IndexIndex ];
+		}
+		TileLOD.Indices.Empty();
+	}
+}
+
+
+/**
+ * Fills in the parts of a mesh that weren't rebuilt from an older mesh.  Both meshes have to have been built with the same
+ * tile size, levels of detail and vertex format.  Every old tile keeps its index, so that its mesh sections keep theirs, and
+ * tiles that only have new parts in them are added after the old ones.
+ */
+static void MergeStreetMapMeshParts( FStreetMapMeshData& Mesh, const FStreetMapMeshData& OldMesh, const uint32 RebuiltParts )
+{
+	TMap< FIntPoint, int32 > NewTileIndicesByCoordinates;
+	for( int32 NewTileIndex = 0; NewTileIndex < Mesh.Tiles.Num(); ++NewTileIndex )
+	{
+		NewTileIndicesByCoordinates.Add( Mesh.Tiles[ NewTileIndex ].Coordinates, NewTileIndex );
+	}
+
+	TArray< FStreetMapMeshTile > NewTiles = MoveTemp( Mesh.Tiles );
+	TArray< bool > IsNewTileMerged;
+	IsNewTileMerged.SetNumZeroed( NewTiles.Num() );
+	Mesh.Tiles.Reset( FMath::Max( NewTiles.Num(), OldMesh.Tiles.Num() ) );
+	for( const FStreetMapMeshTile& OldTile : OldMesh.Tiles )
+	{
+		const int32* NewTileIndex = NewTileIndicesByCoordinates.Find( OldTile.Coordinates );
+		if( NewTileIndex != nullptr )
+		{
+			Mesh.Tiles.Add( MoveTemp( NewTiles[ *NewTileIndex ] ) );
+			IsNewTileMerged[ *NewTileIndex ] = true;
+		}
+		else
+		{
+			// Only old parts in this tile
+			FStreetMapMeshTile& NewTile = Mesh.Tiles[ Mesh.Tiles.AddDefaulted() ];
+			NewTile.Coordinates = OldTile.Coordinates;
+			NewTile.LODs.SetNum( OldTile.LODs.Num() );
+		}
+	}
+	for( int32 NewTileIndex = 0; NewTileIndex < NewTiles.Num(); ++NewTileIndex )
+	{
+		if( !IsNewTileMerged[ NewTileIndex ] )
+		{
+			Mesh.Tiles.Add( MoveTemp( NewTiles[ NewTileIndex ] ) );
+		}
+	}
+
+	ParallelFor( Mesh.Tiles.Num(), [&]( const int32 TileIndex )
+	{
+		FStreetMapMeshTile& Tile = Mesh.Tiles[ TileIndex ];
+		if( TileIndex >= OldMesh.Tiles.Num() )
+		{
+			return;
+		}
+
+		const FStreetMapMeshTile& OldTile = OldMesh.Tiles[ TileIndex ];
+		Tile.BoundingBox.Init();
+		for( int32 LODIndex = 0; LODIndex < Tile.LODs.Num(); ++LODIndex )
+		{
+			const FStreetMapMeshLOD& NewLOD = Tile.LODs[ LODIndex ];
+			const FStreetMapMeshLOD& OldLOD = OldTile.LODs[ LODIndex ];
+			const bool bHasCompactVertices = NewLOD.CompactVertices.Num() > 0 || OldLOD.CompactVertices.Num() > 0;
+
+			FStreetMapMeshLOD MergedLOD;
+			auto MergePart = [&]( auto& MergedVertices, const auto& SourceVertices, const FStreetMapMeshLOD& SourceLOD, const int32 Part )
+			{
+				const int32 SourceFirstVertexIndex = SourceLOD.PartFirstVertexIndices[ Part ];
+				const int32 MergedFirstVertexIndex = MergedVertices.Num();
+				MergedLOD.PartFirstVertexIndices[ Part ] = MergedFirstVertexIndex;
+				MergedLOD.PartFirstIndexIndices[ Part ] = MergedLOD.Indices.Num();
+
+				MergedVertices.Append( SourceVertices.GetData() + SourceFirstVertexIndex, SourceLOD.PartFirstVertexIndices[ Part + 1 ] - SourceFirstVertexIndex );
+				for( int32 IndexIndex = SourceLOD.PartFirstIndexIndices[ Part ]; IndexIndex < SourceLOD.PartFirstIndexIndices[ Part + 1 ]; ++IndexIndex )
+				{
+					const int32 SourceIndex = SourceLOD.Indices16.Num() > 0 ? (int32)SourceLOD.Indices16[ IndexIndex ] : SourceLOD.Indices[ IndexIndex ];
+					MergedLOD.Indices.Add( SourceIndex - SourceFirstVertexIndex + MergedFirstVertexIndex );
+				}
+			};
+
+			for( int32 Part = 0; Part < MeshPart_Count; ++Part )
+			{
+				const FStreetMapMeshLOD& SourceLOD = ( RebuiltParts & ( 1 << Part ) ) ? NewLOD : OldLOD;
+				if( bHasCompactVertices )
+				{
+					MergePart( MergedLOD.CompactVertices, SourceLOD.CompactVertices, SourceLOD, Part );
+				}
+				else
+				{
+					MergePart( MergedLOD.Vertices, SourceLOD.Vertices, SourceLOD, Part );
+				}
+			}
+			MergedLOD.PartFirstVertexIndices[ MeshPart_Count ] = MergedLOD.GetNumVertices();
+			MergedLOD.PartFirstIndexIndices[ MeshPart_Count ] = MergedLOD.Indices.Num();
+
+			FinishStreetMapMeshLOD( MergedLOD, bHasCompactVertices );
+			Tile.BoundingBox += MergedLOD.BoundingBox;
+			Tile.LODs[ LODIndex ] = MoveTemp( MergedLOD );
+		}
+	} );
+
+	if( !( RebuiltParts & ( 1 << MeshPart_Buildings ) ) )
+	{
+		Mesh.InstancedBuildingTransforms = OldMesh.InstancedBuildingTransforms;
+	}
+}
+
+
+/**
+ * Generates a street map mesh from raw street map data.  Roads and buildings are generated in parallel.  This doesn't touch
+ * the component at all, so that it can run on any thread.  Returns early if the build is cancelled.
+ *
+ * Only the parts of the mesh in PartsToBuild are generated.  The rest are copied from OldMesh, which must have been built with
+ * the same tile size, levels of detail and vertex format.
+ */
+static void GenerateStreetMapMesh( const UStreetMap* StreetMap, const FStreetMapMeshBuildSettings& MeshBuildSettings, const FBoxSphereBounds* InstancedBuildingMeshBounds, const uint32 PartsToBuild, const FStreetMapMeshData* OldMesh, const FThreadSafeBool& bCancelled, FStreetMapMeshData& OutMesh )
+{
+	OutMesh.BuildSettings = MeshBuildSettings;
+
+	TArray< FStreetMapMeshTile >& Tiles = OutMesh.Tiles;
+	TArray< float >& LODScreenSizes = OutMesh.LODScreenSizes;
+	TArray< FTransform >& InstancedBuildingTransforms = OutMesh.InstancedBuildingTransforms;
+
+	/////////////////////////////////////////////////////////
+	// Visual tweakables for generated Street Map mesh
+	//
+	const float RoadZ = MeshBuildSettings.RoadOffesetZ;
+	const bool bWantRoadJunctions = MeshBuildSettings.bWantRoadJunctions;
+	const bool bWantCompactVertices = MeshBuildSettings.bWantCompactVertices;
+	const bool bWant3DBuildings = MeshBuildSettings.bWant3DBuildings;
+	const bool bWantInstancedBuildings = InstancedBuildingMeshBounds != nullptr;
+	const float BuildingLevelFloorFactor = MeshBuildSettings.BuildingLevelFloorFactor;
+	const bool bWantLitBuildings = MeshBuildSettings.bWantLitBuildings;
+	const bool bWantBuildingBorderOnGround = !bWant3DBuildings;
+	const float StreetThickness = MeshBuildSettings.StreetThickness;
+	const FColor StreetColor = MeshBuildSettings.StreetColor.ToFColor( false );
+	const float MajorRoadThickness = MeshBuildSettings.MajorRoadThickness;
+	const FColor MajorRoadColor = MeshBuildSettings.MajorRoadColor.ToFColor( false );
+	const float HighwayThickness = MeshBuildSettings.HighwayThickness;
+	const FColor HighwayColor = MeshBuildSettings.HighwayColor.ToFColor( false );
+	const float BuildingBorderThickness = MeshBuildSettings.BuildingBorderThickness;
+	FLinearColor BuildingBorderLinearColor = MeshBuildSettings.BuildingBorderLinearColor;
+	const float BuildingBorderZ = MeshBuildSettings.BuildingBorderZ;
+	const FColor BuildingBorderColor( BuildingBorderLinearColor.ToFColor( false ) );
+	const FColor BuildingFillColor( GetBuildingFillColor( BuildingBorderLinearColor ) );
+	/////////////////////////////////////////////////////////
+
+	const float TileSize = MeshBuildSettings.TileSize;
+
+	// Full detail, followed by every lower level of detail
+	TArray< FStreetMapMeshLODSettings > LODSettingsList;
+	LODSettingsList.Add( FStreetMapMeshLODSettings() );
+	LODSettingsList.Append( MeshBuildSettings.LODs );
+	const int32 NumLODs = LODSettingsList.Num();
+
+	LODScreenSizes.Reset();
+	for( const FStreetMapMeshLODSettings& LODSettings : MeshBuildSettings.LODs )
+	{
+		LODScreenSizes.Add( LODSettings.ScreenSize );
+	}
+
+	if( StreetMap != nullptr )
+	{
+		const auto& Roads = StreetMap->GetRoads();
+		const auto& Nodes = StreetMap->GetNodes();
+		const auto& Buildings = StreetMap->GetBuildings();
+
+		const int32 NumRoads = Roads.Num();
+		const int32 NumNodes = Nodes.Num();
+		const int32 NumBuildings = Buildings.Num();
+
+		// The level of detail that is being generated.  Lower levels of detail use simplified road and building outlines,
+		// while full detail uses the street map's own outlines.
+		int32 LODIndex = 0;
+		const FStreetMapMeshLODSettings* LODSettings = nullptr;
+		bool bWantSimplifiedOutlines = false;
+		TArray< TArray< FVector2D > > SimplifiedRoadPoints;
+
+		// Buildings are triangulated, and simplified for the default levels of detail, when they're imported.  Only levels
+		// of detail with other simplification tolerances, and street maps that were built some other way, need to have
+		// their building outlines simplified and triangulated here.
+		TArray< const FStreetMapBuildingOutline* > SimplifiedBuildingOutlines;
+		TArray< FStreetMapBuildingOutline > LODBuildingOutlines;
+
+		auto GetRoadPoints = [&]( const int32 RoadIndex ) -> const TArray< FVector2D >&
+		{
+			return bWantSimplifiedOutlines ? SimplifiedRoadPoints[ RoadIndex ] : Roads[ RoadIndex ].RoadPoints;
+		};
+
+		auto GetBuildingPoints = [&]( const int32 BuildingIndex ) -> const TArray< FVector2D >&
+		{
+			return bWantSimplifiedOutlines ? SimplifiedBuildingOutlines[ BuildingIndex ]->Points : Buildings[ BuildingIndex ].BuildingPoints;
+		};
+
+		auto GetBuildingTriangulation = [&]( const int32 BuildingIndex, bool& OutWindsClockwise ) -> const TArray< int32 >&
+		{
+			const FStreetMapBuilding& Building = Buildings[ BuildingIndex ];
+			if( Building.bIsTriangulated && !bWantSimplifiedOutlines )
+			{
+				OutWindsClockwise = Building.bWindsClockwise;
+				return Building.TriangulatedIndices;
+			}
+
+			const FStreetMapBuildingOutline& Outline = bWantSimplifiedOutlines ? *SimplifiedBuildingOutlines[ BuildingIndex ] : LODBuildingOutlines[ BuildingIndex ];
+			OutWindsClockwise = Outline.bWindsClockwise;
+			return Outline.TriangulatedIndices;
+		};
+
+		auto WantRoad = [&]( const FStreetMapRoad& Road ) -> bool
+		{
+			return LODSettings->bWantMinorRoads || Road.RoadType == EStreetMapRoadType::Highway || Road.RoadType == EStreetMapRoadType::MajorRoad;
+		};
+
+		// Buildings that are drawn as instances aren't part of the generated mesh
+		TArray< bool > IsInstancedBuilding;
+
+		auto WantBuilding = [&]( const int32 BuildingIndex ) -> bool
+		{
+			if( IsInstancedBuilding.Num() > 0 && IsInstancedBuilding[ BuildingIndex ] )
+			{
+				return false;
+			}
+
+			const FStreetMapBuilding& Building = Buildings[ BuildingIndex ];
+			return LODSettings->MinBuildingArea <= 0.0f || FMath::Abs( FPolygonTools::Area( Building.BuildingPoints ) ) >= LODSettings->MinBuildingArea;
+		};
+
+		// Calculate fill Z for buildings.  Either use the defined height or extrapolate from building level count.
+		auto GetBuildingFillZ = [&]( const FStreetMapBuilding& Building ) -> float
+		{
+			float BuildingFillZ = 0.0f;
+			if( bWant3DBuildings )
+			{
+				if( Building.Height > 0 )
+				{
+					BuildingFillZ = Building.Height;
+				}
+				else if( Building.BuildingLevels > 0 )
+				{
+					BuildingFillZ = (float)Building.BuildingLevels * BuildingLevelFloorFactor;
+				}
+			}
+			return BuildingFillZ;
+		};
+
+		auto WantBuildingWalls = [&]( const FStreetMapBuilding& Building ) -> bool
+		{
+			return bWant3DBuildings && LODSettings->bWantBuildingWalls && ( Building.Height > KINDA_SMALL_NUMBER || Building.BuildingLevels > 0 );
+		};
+
+		// Counts the vertices and indices that a building's geometry needs
+		auto CountBuilding = [&]( const int32 BuildingIndex, int32& OutNumVertices, int32& OutNumIndices )
+		{
+			const FStreetMapBuilding& Building = Buildings[ BuildingIndex ];
+			const int32 NumPoints = GetBuildingPoints( BuildingIndex ).Num();
+
+			OutNumVertices = 0;
+			OutNumIndices = 0;
+
+			bool WindsClockwise;
+			const TArray< int32 >& TriangulatedVertexIndices = GetBuildingTriangulation( BuildingIndex, WindsClockwise );
+			if( TriangulatedVertexIndices.Num() > 0 )
+			{
+				// Top of building
+				OutNumVertices += NumPoints;
+				OutNumIndices += TriangulatedVertexIndices.Num();
+
+				if( WantBuildingWalls( Building ) )
+				{
+					// Lit walls have a quad of their own for every wall.  Unlit walls share the top vertices, and only
+					// need another set of vertices for the bottom.
+					OutNumVertices += bWantLitBuildings ? NumPoints * 4 : NumPoints;
+					OutNumIndices += NumPoints * 6;
+				}
+			}
+
+			// Building border
+			if( bWantBuildingBorderOnGround )
+			{
+				OutNumVertices += NumPoints * 4;
+				OutNumIndices += NumPoints * 6;
+			}
+		};
+
+		auto GetRoadStyle = [&]( const FStreetMapRoad& Road, float& OutThickness, FColor& OutColor )
+		{
+			OutThickness = StreetThickness;
+			OutColor = StreetColor;
+			switch( Road.RoadType )
+			{
+				case EStreetMapRoadType::Highway:
+					OutThickness = HighwayThickness;
+					OutColor = HighwayColor;
+					break;
+					
+				case EStreetMapRoadType::MajorRoad:
+					OutThickness = MajorRoadThickness;
+					OutColor = MajorRoadColor;
+					break;
+					
+				case EStreetMapRoadType::Street:
+				case EStreetMapRoadType::Other:
+					break;
+					
+				default:
+					check( 0 );
+					break;
+			}
+		};
+
+		// Counts the vertices and indices that a stretch of road needs
+		auto CountRoad = [&]( const int32 RoadIndex, const int32 FirstPointIndex, const int32 LastPointIndex, int32& OutNumVertices, int32& OutNumIndices )
+		{
+			float RoadThickness;
+			FColor RoadColor;
+			GetRoadStyle( Roads[ RoadIndex ], RoadThickness, RoadColor );
+
+			const int32 NumVertexPairs = CountRoadRibbonVertexPairs( GetRoadPoints( RoadIndex ), FirstPointIndex, LastPointIndex, RoadThickness * 0.5f );
+			OutNumVertices = NumVertexPairs * 2;
+			OutNumIndices = ( NumVertexPairs - 1 ) * 6;
+		};
+
+		// Junctions are drawn where at least two of the roads being drawn meet, matching the widest of those roads.  Returns
+		// false if there is no junction at the node.
+		auto GetRoadJunction = [&]( const int32 NodeIndex, FVector2D& OutCenter, float& OutThickness, FColor& OutColor, EStreetMapMeshPart& OutPart ) -> bool
+		{
+			int32 NumRoadsAtJunction = 0;
+			OutThickness = 0.0f;
+			for( const FStreetMapRoadRef& RoadRef : Nodes[ NodeIndex ].RoadRefs )
+			{
+				const FStreetMapRoad& Road = Roads[ RoadRef.RoadIndex ];
+				if( WantRoad( Road ) )
+				{
+					float RoadThickness;
+					FColor RoadColor;
+					GetRoadStyle( Road, RoadThickness, RoadColor );
+					if( NumRoadsAtJunction++ == 0 || RoadThickness > OutThickness )
+					{
+						OutCenter = Road.RoadPoints[ RoadRef.RoadPointIndex ];
+						OutThickness = RoadThickness;
+						OutColor = RoadColor;
+						OutPart = GetRoadMeshPart( Road.RoadType );
+					}
+				}
+			}
+			return NumRoadsAtJunction >= 2;
+		};
+
+		const int32 NumVerticesPerRoadJunction = NumRoadJunctionSides + 1;
+		const int32 NumIndicesPerRoadJunction = NumRoadJunctionSides * 3;
+
+		// Every stretch of road, building and road junction goes into the tile that its center falls in, and is given its
+		// own range of that tile's mesh buffers
+		TMap< FIntPoint, int32 > TileIndicesByCoordinates;
+		TArray< int32 > TileNumVertices;
+		TArray< int32 > TileNumIndices;
+		auto FindOrAddTile = [&]( const FVector2D& Position ) -> int32
+		{
+			const FIntPoint TileCoordinates = TileSize > 0.0f ?
+				FIntPoint( FMath::FloorToInt( Position.X / TileSize ), FMath::FloorToInt( Position.Y / TileSize ) ) :
+				FIntPoint::ZeroValue;
+
+			if( const int32* ExistingTileIndex = TileIndicesByCoordinates.Find( TileCoordinates ) )
+			{
+				return *ExistingTileIndex;
+			}
+
+			const int32 TileIndex = Tiles.AddDefaulted();
+			Tiles[ TileIndex ].Coordinates = TileCoordinates;
+			Tiles[ TileIndex ].LODs.SetNum( NumLODs );
+			TileNumVertices.Add( 0 );
+			TileNumIndices.Add( 0 );
+			TileIndicesByCoordinates.Add( TileCoordinates, TileIndex );
+			return TileIndex;
+		};
+
+		auto AddItem = [&]( TArray< FStreetMapMeshItem >& Items, const int32 ElementIndex, const int32 FirstPointIndex, const int32 LastPointIndex, const int32 TileIndex, const int32 NumVertices, const int32 NumIndices )
+		{
+			FStreetMapMeshItem& Item = Items[ Items.AddUninitialized() ];
+			Item.ElementIndex = ElementIndex;
+			Item.FirstPointIndex = FirstPointIndex;
+			Item.LastPointIndex = LastPointIndex;
+			Item.TileIndex = TileIndex;
+			Item.FirstVertexIndex = TileNumVertices[ Item.TileIndex ];
+			Item.FirstIndexIndex = TileNumIndices[ Item.TileIndex ];
+			TileNumVertices[ Item.TileIndex ] += NumVertices;
+			TileNumIndices[ Item.TileIndex ] += NumIndices;
+		};
+
+		// Generates the mesh for a stretch of road
+		auto AddRoad = [&]( FStreetMapMeshWriter& Writer, const int32 RoadIndex, const int32 FirstPointIndex, const int32 LastPointIndex )
+		{
+			float RoadThickness;
+			FColor RoadColor;
+			GetRoadStyle( Roads[ RoadIndex ], RoadThickness, RoadColor );
+			
+			AddRoadRibbon( 
+				Writer,
+				GetRoadPoints( RoadIndex ),
+				FirstPointIndex,
+				LastPointIndex,
+				RoadZ,
+				RoadThickness,
+				RoadColor );
+		};
+
+		// Generates the mesh for a building
+		auto AddBuilding = [&]( FStreetMapMeshWriter& Writer, const int32 BuildingIndex )
+		{
+			const FStreetMapBuilding& Building = Buildings[ BuildingIndex ];
+			const TArray< FVector2D >& BuildingPoints = GetBuildingPoints( BuildingIndex );
+			const int32 NumPoints = BuildingPoints.Num();
+
+			// Building mesh (or filled area, if the building has no height)
+			bool WindsClockwise;
+			const TArray< int32 >& TriangulatedVertexIndices = GetBuildingTriangulation( BuildingIndex, WindsClockwise );
+			if( TriangulatedVertexIndices.Num() > 0 )
+			{
+				// @todo: Performance: We could preprocess the building shapes so that the points always wind
+				//        in a consistent direction, so we can skip determining the winding above.
+
+				const float BuildingFillZ = GetBuildingFillZ( Building );
+
+				// Top of building
+				const int32 FirstTopVertexIndex = Writer.NextVertexIndex;
+				{
+					for( int32 PointIndex = 0; PointIndex < NumPoints; ++PointIndex )
+					{
+						Writer.AddVertex( FVector( BuildingPoints[ ( NumPoints - PointIndex ) - 1 ], BuildingFillZ ), FVector2D( 0.0f, 0.0f ), FVector::ForwardVector, FVector::UpVector, BuildingFillColor );
+					}
+					for( int32 TriangleIndex = 0; TriangleIndex < TriangulatedVertexIndices.Num(); TriangleIndex += 3 )
+					{
+						Writer.AddTriangle(
+							FirstTopVertexIndex + TriangulatedVertexIndices[ TriangleIndex ],
+							FirstTopVertexIndex + TriangulatedVertexIndices[ TriangleIndex + 1 ],
+							FirstTopVertexIndex + TriangulatedVertexIndices[ TriangleIndex + 2 ] );
+					}
+				}
+
+				if( WantBuildingWalls( Building ) )
+				{
+					// NOTE: Lit buildings can't share vertices beyond quads (all quads have their own face normals), so this uses a lot more geometry!
+					if( bWantLitBuildings )
+					{
+						// Create edges for the walls of the 3D buildings
+						for( int32 LeftPointIndex = 0; LeftPointIndex < NumPoints; ++LeftPointIndex )
+						{
+							const int32 RightPointIndex = ( LeftPointIndex + 1 ) % NumPoints;
+
+							const FVector TopLeft( BuildingPoints[ WindsClockwise ? RightPointIndex : LeftPointIndex ], BuildingFillZ );
+							const FVector TopRight( BuildingPoints[ WindsClockwise ? LeftPointIndex : RightPointIndex ], BuildingFillZ );
+							const FVector BottomRight( BuildingPoints[ WindsClockwise ? LeftPointIndex : RightPointIndex ], 0.0f );
+							const FVector BottomLeft( BuildingPoints[ WindsClockwise ? RightPointIndex : LeftPointIndex ], 0.0f );
+
+							const FVector FaceNormal = FVector::CrossProduct( ( TopLeft - BottomRight ).GetSafeNormal(), ( TopLeft - TopRight ).GetSafeNormal() );
+							const FVector ForwardVector = FVector::UpVector;
+							const FVector UpVector = FaceNormal;
+
+							const int32 TopLeftVertexIndex = Writer.AddVertex( TopLeft, FVector2D( 0.0f, 0.0f ), ForwardVector, UpVector, BuildingFillColor );
+							const int32 TopRightVertexIndex = Writer.AddVertex( TopRight, FVector2D( 0.0f, 0.0f ), ForwardVector, UpVector, BuildingFillColor );
+							const int32 BottomRightVertexIndex = Writer.AddVertex( BottomRight, FVector2D( 0.0f, 0.0f ), ForwardVector, UpVector, BuildingFillColor );
+							const int32 BottomLeftVertexIndex = Writer.AddVertex( BottomLeft, FVector2D( 0.0f, 0.0f ), ForwardVector, UpVector, BuildingFillColor );
+
+							Writer.AddTriangle( BottomLeftVertexIndex, TopLeftVertexIndex, BottomRightVertexIndex );
+							Writer.AddTriangle( BottomRightVertexIndex, TopLeftVertexIndex, TopRightVertexIndex );
+						}
+					}
+					else
+					{
+						// Create vertices for the bottom
+						const int32 FirstBottomVertexIndex = Writer.NextVertexIndex;
+						for( int32 PointIndex = 0; PointIndex < NumPoints; ++PointIndex )
+						{
+							Writer.AddVertex( FVector( BuildingPoints[ PointIndex ], 0.0f ), FVector2D( 0.0f, 0.0f ), FVector::ForwardVector, FVector::UpVector, BuildingFillColor );
+						}
+
+						// Create edges for the walls of the 3D buildings
+						for( int32 LeftPointIndex = 0; LeftPointIndex < NumPoints; ++LeftPointIndex )
+						{
+							const int32 RightPointIndex = ( LeftPointIndex + 1 ) % NumPoints;
+
+							const int32 BottomLeftVertexIndex = FirstBottomVertexIndex + LeftPointIndex;
+							const int32 BottomRightVertexIndex = FirstBottomVertexIndex + RightPointIndex;
+							const int32 TopRightVertexIndex = FirstTopVertexIndex + RightPointIndex;
+							const int32 TopLeftVertexIndex = FirstTopVertexIndex + LeftPointIndex;
+
+							Writer.AddTriangle( BottomLeftVertexIndex, TopLeftVertexIndex, BottomRightVertexIndex );
+							Writer.AddTriangle( BottomRightVertexIndex, TopLeftVertexIndex, TopRightVertexIndex );
+						}
+					}
+				}
+			}
+			else
+			{
+				// @todo: Triangulation failed for some reason, possibly due to degenerate polygons.  We can
+				//        probably improve the algorithm to avoid this happening.
+			}
+
+			// Building border
+			if( bWantBuildingBorderOnGround )
+			{
+				for( int32 PointIndex = 0; PointIndex < NumPoints; ++PointIndex )
+				{
+					AddThick2DLine(
+						Writer,
+						BuildingPoints[ PointIndex ],
+						BuildingPoints[ ( PointIndex + 1 ) % NumPoints ],
+						BuildingBorderZ,
+						BuildingBorderThickness,		// Thickness
+						BuildingBorderColor,
+						BuildingBorderColor );
+				}
+			}
+		};
+
+
+
+		const bool bWantRoads = ( PartsToBuild & RoadMeshParts ) != 0;
+		const bool bWantBuildings = ( PartsToBuild & ( 1 << MeshPart_Buildings ) ) != 0;
+
+		// Find the buildings with rectangular footprints, and work out how to stretch the instanced building mesh over them
+		if( bWantInstancedBuildings && bWantBuildings )
+		{
+			const FBoxSphereBounds MeshBounds = *InstancedBuildingMeshBounds;
+			const FVector MeshSize = MeshBounds.BoxExtent * 2.0f;
+
+			TArray< FTransform > BuildingTransforms;
+			BuildingTransforms.SetNum( NumBuildings );
+			IsInstancedBuilding.SetNumZeroed( NumBuildings );
+			ParallelFor( NumBuildings, [&]( const int32 BuildingIndex )
+			{
+				const FStreetMapBuilding& Building = Buildings[ BuildingIndex ];
+				const float BuildingFillZ = GetBuildingFillZ( Building );
+
+				FVector2D Center, LengthAxis;
+				float Length, Width;
+				if( BuildingFillZ > KINDA_SMALL_NUMBER && MeshSize.GetMin() > KINDA_SMALL_NUMBER &&
+					FindRectangularFootprint( Building.BuildingPoints, Center, LengthAxis, Length, Width ) )
+				{
+					const FQuat Rotation( FVector::UpVector, FMath::Atan2( LengthAxis.Y, LengthAxis.X ) );
+					const FVector Scale( Length / MeshSize.X, Width / MeshSize.Y, BuildingFillZ / MeshSize.Z );
+					const FVector Translation = FVector( Center, BuildingFillZ * 0.5f ) - Rotation.RotateVector( Scale * MeshBounds.Origin );
+
+					BuildingTransforms[ BuildingIndex ] = FTransform( Rotation, Translation, Scale );
+					IsInstancedBuilding[ BuildingIndex ] = true;
+				}
+			} );
+
+			for( int32 BuildingIndex = 0; BuildingIndex < NumBuildings; ++BuildingIndex )
+			{
+				if( IsInstancedBuilding[ BuildingIndex ] )
+				{
+					InstancedBuildingTransforms.Add( BuildingTransforms[ BuildingIndex ] );
+				}
+			}
+		}
+
+		TArray< FStreetMapMeshItem > Items;
+		for( LODIndex = 0; LODIndex < NumLODs; ++LODIndex )
+		{
+			if( bCancelled )
+			{
+				return;
+			}
+
+			LODSettings = &LODSettingsList[ LODIndex ];
+			bWantSimplifiedOutlines = LODSettings->SimplificationTolerance > 0.0f;
+
+			// Simplify and triangulate outlines for this level of detail, if needed
+			if( bWantSimplifiedOutlines && bWantRoads )
+			{
+				SimplifiedRoadPoints.Reset();
+				SimplifiedRoadPoints.SetNum( NumRoads );
+				ParallelFor( NumRoads, [&]( const int32 RoadIndex )
+				{
+					if( WantRoad( Roads[ RoadIndex ] ) )
+					{
+						FPolygonTools::SimplifyPolyline( Roads[ RoadIndex ].RoadPoints, LODSettings->SimplificationTolerance, false, /* Out */ SimplifiedRoadPoints[ RoadIndex ] );
+					}
+				} );
+
+			}
+
+			SimplifiedBuildingOutlines.Reset();
+			LODBuildingOutlines.Reset();
+			if( bWantBuildings && bWantSimplifiedOutlines )
+			{
+				// Use the outlines that were simplified ahead of time where there are any
+				SimplifiedBuildingOutlines.SetNumZeroed( NumBuildings );
+				bool bHasMissingOutlines = false;
+				for( int32 BuildingIndex = 0; BuildingIndex < NumBuildings; ++BuildingIndex )
+				{
+					SimplifiedBuildingOutlines[ BuildingIndex ] = Buildings[ BuildingIndex ].FindSimplifiedOutline( LODSettings->SimplificationTolerance );
+					bHasMissingOutlines |= SimplifiedBuildingOutlines[ BuildingIndex ] == nullptr;
+				}
+
+				if( bHasMissingOutlines )
+				{
+					LODBuildingOutlines.SetNum( NumBuildings );
+					ParallelFor( NumBuildings, [&]( const int32 BuildingIndex )
+					{
+						if( SimplifiedBuildingOutlines[ BuildingIndex ] == nullptr )
+						{
+							FStreetMapBuildingOutline& Outline = LODBuildingOutlines[ BuildingIndex ];
+							if( WantBuilding( BuildingIndex ) )
+							{
+								FPolygonTools::SimplifyPolyline( Buildings[ BuildingIndex ].BuildingPoints, LODSettings->SimplificationTolerance, true, /* Out */ Outline.Points );
+								bool WindsClockwise = false;
+								if( !FPolygonTools::TriangulatePolygon( Outline.Points, /* Out */ Outline.TriangulatedIndices, /* Out */ WindsClockwise ) )
+								{
+									Outline.TriangulatedIndices.Reset();
+								}
+								Outline.bWindsClockwise = WindsClockwise;
+							}
+							SimplifiedBuildingOutlines[ BuildingIndex ] = &Outline;
+						}
+					} );
+				}
+			}
+			else if( bWantBuildings && Buildings.ContainsByPredicate( []( const FStreetMapBuilding& Building ) { return !Building.bIsTriangulated; } ) )
+			{
+				LODBuildingOutlines.SetNum( NumBuildings );
+				ParallelFor( NumBuildings, [&]( const int32 BuildingIndex )
+				{
+					const FStreetMapBuilding& Building = Buildings[ BuildingIndex ];
+					if( WantBuilding( BuildingIndex ) && !Building.bIsTriangulated )
+					{
+						FStreetMapBuildingOutline& Outline = LODBuildingOutlines[ BuildingIndex ];
+						bool WindsClockwise = false;
+						if( !FPolygonTools::TriangulatePolygon( Building.BuildingPoints, /* Out */ Outline.TriangulatedIndices, /* Out */ WindsClockwise ) )
+						{
+							Outline.TriangulatedIndices.Reset();
+						}
+						Outline.bWindsClockwise = WindsClockwise;
+					}
+				} );
+			}
+
+
+			// Phase one: Count the vertices and indices that every stretch of road, building and road junction needs, and
+			// work out where they go in their tile's mesh buffers.  Each part of the mesh gets its own range of every tile's
+			// buffers.
+			TileNumVertices.Init( 0, Tiles.Num() );
+			TileNumIndices.Init( 0, Tiles.Num() );
+
+			Items.Reset();
+			for( int32 Part = 0; Part < MeshPart_Count; ++Part )
+			{
+				// Tiles that are added while this part is counted start out empty, which is where their ranges start too
+				for( int32 TileIndex = 0; TileIndex < Tiles.Num(); ++TileIndex )
+				{
+					Tiles[ TileIndex ].LODs[ LODIndex ].PartFirstVertexIndices[ Part ] = TileNumVertices[ TileIndex ];
+					Tiles[ TileIndex ].LODs[ LODIndex ].PartFirstIndexIndices[ Part ] = TileNumIndices[ TileIndex ];
+				}
+
+				if( !( PartsToBuild & ( 1 << Part ) ) )
+				{
+					continue;
+				}
+
+				if( Part == MeshPart_Buildings )
+				{
+					for( int32 BuildingIndex = 0; BuildingIndex < NumBuildings; ++BuildingIndex )
+					{
+						if( WantBuilding( BuildingIndex ) )
+						{
+							int32 NumVertices, NumIndices;
+							CountBuilding( BuildingIndex, NumVertices, NumIndices );
+							if( NumVertices > 0 )
+							{
+								const FBox2D BuildingBounds( GetBuildingPoints( BuildingIndex ) );
+								AddItem( Items, NumRoads + BuildingIndex, INDEX_NONE, INDEX_NONE, FindOrAddTile( BuildingBounds.GetCenter() ), NumVertices, NumIndices );
+							}
+						}
+					}
+					continue;
+				}
+
+				for( int32 RoadIndex = 0; RoadIndex < NumRoads; ++RoadIndex )
+				{
+					if( GetRoadMeshPart( Roads[ RoadIndex ].RoadType ) == Part && WantRoad( Roads[ RoadIndex ] ) )
+					{
+						// Roads are split into stretches of consecutive segments whose centers fall in the same tile
+						const TArray< FVector2D >& RoadPoints = GetRoadPoints( RoadIndex );
+						int32 FirstPointIndex = 0;
+						int32 StretchTileIndex = INDEX_NONE;
+						for( int32 PointIndex = 0; PointIndex < RoadPoints.Num() - 1; ++PointIndex )
+						{
+							const FVector2D SegmentCenter = ( RoadPoints[ PointIndex ] + RoadPoints[ PointIndex + 1 ] ) * 0.5f;
+							const int32 SegmentTileIndex = FindOrAddTile( SegmentCenter );
+							if( SegmentTileIndex != StretchTileIndex )
+							{
+								if( StretchTileIndex != INDEX_NONE )
+								{
+									int32 NumVertices, NumIndices;
+									CountRoad( RoadIndex, FirstPointIndex, PointIndex, NumVertices, NumIndices );
+									AddItem( Items, RoadIndex, FirstPointIndex, PointIndex, StretchTileIndex, NumVertices, NumIndices );
+								}
+								FirstPointIndex = PointIndex;
+								StretchTileIndex = SegmentTileIndex;
+							}
+						}
+
+						if( StretchTileIndex != INDEX_NONE )
+						{
+							const int32 LastPointIndex = RoadPoints.Num() - 1;
+							int32 NumVertices, NumIndices;
+							CountRoad( RoadIndex, FirstPointIndex, LastPointIndex, NumVertices, NumIndices );
+							AddItem( Items, RoadIndex, FirstPointIndex, LastPointIndex, StretchTileIndex, NumVertices, NumIndices );
+						}
+					}
+				}
+
+				if( bWantRoadJunctions )
+				{
+					for( int32 NodeIndex = 0; NodeIndex < NumNodes; ++NodeIndex )
+					{
+						FVector2D JunctionCenter;
+						float JunctionThickness;
+						FColor JunctionColor;
+						EStreetMapMeshPart JunctionPart;
+						if( GetRoadJunction( NodeIndex, JunctionCenter, JunctionThickness, JunctionColor, JunctionPart ) && JunctionPart == Part )
+						{
+							AddItem( Items, NumRoads + NumBuildings + NodeIndex, INDEX_NONE, INDEX_NONE, FindOrAddTile( JunctionCenter ), NumVerticesPerRoadJunction, NumIndicesPerRoadJunction );
+						}
+					}
+				}
+			}
+
+			for( int32 TileIndex = 0; TileIndex < Tiles.Num(); ++TileIndex )
+			{
+				Tiles[ TileIndex ].LODs[ LODIndex ].PartFirstVertexIndices[ MeshPart_Count ] = TileNumVertices[ TileIndex ];
+				Tiles[ TileIndex ].LODs[ LODIndex ].PartFirstIndexIndices[ MeshPart_Count ] = TileNumIndices[ TileIndex ];
+			}
+
+			for( int32 TileIndex = 0; TileIndex < Tiles.Num(); ++TileIndex )
+			{
+				Tiles[ TileIndex ].LODs[ LODIndex ].Vertices.SetNumUninitialized( TileNumVertices[ TileIndex ] );
+				Tiles[ TileIndex ].LODs[ LODIndex ].Indices.SetNumUninitialized( TileNumIndices[ TileIndex ] );
+			}
+
+
+			// Phase two: Fill in the tiles' mesh buffers in parallel.  Every item writes to its own range of its tile's
+			// buffers, so the batches don't need to share anything.
+			const int32 ItemsPerBatch = 1024;
+			const int32 NumBatches = FMath::DivideAndRoundUp( Items.Num(), ItemsPerBatch );
+
+			ParallelFor( NumBatches, [&]( const int32 BatchIndex )
+			{
+				const int32 EndItemIndex = FMath::Min( ( BatchIndex + 1 ) * ItemsPerBatch, Items.Num() );
+				for( int32 ItemIndex = BatchIndex * ItemsPerBatch; ItemIndex < EndItemIndex; ++ItemIndex )
+				{
+					const FStreetMapMeshItem& Item = Items[ ItemIndex ];
+					FStreetMapMeshLOD& TileLOD = Tiles[ Item.TileIndex ].LODs[ LODIndex ];
+
+					FStreetMapMeshWriter Writer( TileLOD.Vertices, TileLOD.Indices, Item.FirstVertexIndex, Item.FirstIndexIndex );
+					int32 NumVertices, NumIndices;
+					if( Item.ElementIndex < NumRoads )
+					{
+						AddRoad( Writer, Item.ElementIndex, Item.FirstPointIndex, Item.LastPointIndex );
+						CountRoad( Item.ElementIndex, Item.FirstPointIndex, Item.LastPointIndex, NumVertices, NumIndices );
+					}
+					else if( Item.ElementIndex < NumRoads + NumBuildings )
+					{
+						AddBuilding( Writer, Item.ElementIndex - NumRoads );
+						CountBuilding( Item.ElementIndex - NumRoads, NumVertices, NumIndices );
+					}
+					else
+					{
+						FVector2D JunctionCenter;
+						float JunctionThickness;
+						FColor JunctionColor;
+						EStreetMapMeshPart JunctionPart;
+						GetRoadJunction( Item.ElementIndex - NumRoads - NumBuildings, JunctionCenter, JunctionThickness, JunctionColor, JunctionPart );
+						AddRoadJunction( Writer, JunctionCenter, RoadZ, JunctionThickness * 0.5f, JunctionColor );
+						NumVertices = NumVerticesPerRoadJunction;
+						NumIndices = NumIndicesPerRoadJunction;
+					}
+
+					// Make sure we wrote exactly what we counted
+					checkSlow( Writer.NextVertexIndex == Item.FirstVertexIndex + NumVertices );
+					checkSlow( Writer.NextIndexIndex == Item.FirstIndexIndex + NumIndices );
+				}
+			} );
+		}
+
+		if( bCancelled )
+		{
+			return;
+		}
+
+		// Tight bounds for every tile, so that tiles outside of the view can be culled.  Vertices and indices are also
+		// converted to the formats that they're uploaded in here.
+		ParallelFor( Tiles.Num(), [&]( const int32 TileIndex )
+		{
+			FStreetMapMeshTile& Tile = Tiles[ TileIndex ];
+			Tile.BoundingBox.Init();
+			for( FStreetMapMeshLOD& TileLOD : Tile.LODs )
+			{
+				FinishStreetMapMeshLOD( TileLOD, bWantCompactVertices );
+				Tile.BoundingBox += TileLOD.BoundingBox;
+			}
+		} );
+	}
+
+	if( OldMesh != nullptr && !bCancelled )
+	{
+		MergeStreetMapMeshParts( OutMesh, *OldMesh, PartsToBuild );
+	}
+}
+
+
+void UStreetMapComponent::PublishMesh( FStreetMapMeshData& Mesh, UStaticMesh* InstancedBuildingMesh )
+{
+	ClearMesh();
+
+	Tiles = MoveTemp( Mesh.Tiles );
+	LODScreenSizes = MoveTemp( Mesh.LODScreenSizes );
+	InstancedBuildingTransforms = MoveTemp( Mesh.InstancedBuildingTransforms );
+	BuiltMeshBuildSettings = Mesh.BuildSettings;
+
+	CreateInstancedBuildings( InstancedBuildingMesh );
+
+	// One mesh section for every level of detail of every tile.  Only the most detailed one is visible to begin with.
+	for( int32 TileIndex = 0; TileIndex < Tiles.Num(); ++TileIndex )
+	{
+		Tiles[ TileIndex ].VisibleLODIndex = 0;
+		for( int32 LODIndex = 0; LODIndex < Tiles[ TileIndex ].LODs.Num(); ++LODIndex )
+		{
+			CreateTileMeshSection( TileIndex, LODIndex );
+		}
+	}
+
+	SetComponentTickEnabled( LODScreenSizes.Num() > 0 );
+	MarkRenderStateDirty();
+	AssignDefaultMaterialIfNeeded();
+	UpdateInstancedBuildingsAppearance();
+	Modify();
+
+	OnMeshBuilt.Broadcast( this );
+}
+
+
+void UStreetMapComponent::PublishMeshParts( FStreetMapMeshData& Mesh, const FStreetMapMeshData& OldMesh, UStaticMesh* InstancedBuildingMesh, const uint32 RebuiltParts, const uint32 RecoloredParts )
+{
+	CancelMeshBuild();
+
+	Tiles = MoveTemp( Mesh.Tiles );
+	LODScreenSizes = MoveTemp( Mesh.LODScreenSizes );
+	InstancedBuildingTransforms = MoveTemp( Mesh.InstancedBuildingTransforms );
+	BuiltMeshBuildSettings = Mesh.BuildSettings;
+
+	if( RebuiltParts & ( 1 << MeshPart_Buildings ) )
+	{
+		CreateInstancedBuildings( InstancedBuildingMesh );
+	}
+
+	const uint32 ChangedParts = RebuiltParts | RecoloredParts;
+	auto HasChangedParts = [ChangedParts]( const FStreetMapMeshLOD& TileLOD ) -> bool
+	{
+		for( int32 Part = 0; Part < MeshPart_Count; ++Part )
+		{
+			if( ( ChangedParts & ( 1 << Part ) ) && TileLOD.PartFirstIndexIndices[ Part + 1 ] > TileLOD.PartFirstIndexIndices[ Part ] )
+			{
+				return true;
+			}
+		}
+		return false;
+	};
+
+	// Tiles have the same indices as they did in the old mesh, so only the mesh sections that the rebuilt or recolored parts
+	// were in before, or are in now, have to be recreated
+	for( int32 TileIndex = 0; TileIndex < Tiles.Num(); ++TileIndex )
+	{
+		FStreetMapMeshTile& Tile = Tiles[ TileIndex ];
+		const FStreetMapMeshTile* OldTile = TileIndex < OldMesh.Tiles.Num() ? &OldMesh.Tiles[ TileIndex ] : nullptr;
+		Tile.VisibleLODIndex = OldTile != nullptr ? OldTile->VisibleLODIndex : 0;
+
+		for( int32 LODIndex = 0; LODIndex < Tile.LODs.Num(); ++LODIndex )
+		{
+			const FStreetMapMeshLOD* OldLOD = OldTile != nullptr && LODIndex < OldTile->LODs.Num() ? &OldTile->LODs[ LODIndex ] : nullptr;
+			if( !HasChangedParts( Tile.LODs[ LODIndex ] ) && ( OldLOD == nullptr || !HasChangedParts( *OldLOD ) ) )
+			{
+				continue;
+			}
+
+			if( Tile.LODs[ LODIndex ].GetNumIndices() > 0 )
+			{
+				CreateTileMeshSection( TileIndex, LODIndex );
+			}
+			else if( OldLOD != nullptr && OldLOD->GetNumIndices() > 0 )
+			{
+				// Everything that was in this section has gone
+				ClearMeshSection( GetMeshSectionIndex( TileIndex, LODIndex ) );
+			}
+		}
+	}
+
+	SetComponentTickEnabled( LODScreenSizes.Num() > 0 );
+	AssignDefaultMaterialIfNeeded();
+	if( ChangedParts & ( 1 << MeshPart_Buildings ) )
+	{
+		UpdateInstancedBuildingsAppearance();
+	}
+	Modify();
+
+	OnMeshBuilt.Broadcast( this );
+}
+
+
+void UStreetMapComponent::CreateInstancedBuildings( UStaticMesh* InstancedBuildingMesh )
+{
+	if( InstancedBuildingsComponent != nullptr )
+	{
+		InstancedBuildingsComponent->ClearInstances();
+	}
+
+	if( InstancedBuildingTransforms.Num() > 0 && InstancedBuildingMesh != nullptr )
+	{
+		if( InstancedBuildingsComponent == nullptr )
+		{
+			InstancedBuildingsComponent = NewObject<UHierarchicalInstancedStaticMeshComponent>( GetOwner(), NAME_None, RF_Transient );
+			InstancedBuildingsComponent->SetCollisionEnabled( ECollisionEnabled::NoCollision );
+			InstancedBuildingsComponent->SetupAttachment( this );
+			InstancedBuildingsComponent->RegisterComponent();
+		}
+
+		InstancedBuildingsComponent->SetStaticMesh( InstancedBuildingMesh );
+		InstancedBuildingsComponent->CastShadow = CastShadow;
+		for( const FTransform& InstanceTransform : InstancedBuildingTransforms )
+		{
+			InstancedBuildingsComponent->AddInstance( InstanceTransform );
+		}
+	}
+}
+
+
+void UStreetMapComponent::CreateTileMeshSection( const int32 TileIndex, const int32 LODIndex )
+{
+	FStreetMapMeshTile& Tile = Tiles[ TileIndex ];
+	FStreetMapMeshLOD& TileLOD = Tile.LODs[ LODIndex ];
+	if( TileLOD.GetNumIndices() > 0 )
+	{
+		const int32 SectionIndex = GetMeshSectionIndex( TileIndex, LODIndex );
+		auto CreateSection = [&]( auto& SectionVertices )
+		{
+			if( TileLOD.Indices16.Num() > 0 )
+			{
+				this->CreateMeshSection( SectionIndex, SectionVertices, TileLOD.Indices16, TileLOD.BoundingBox, false, EUpdateFrequency::Average, ESectionUpdateFlags::None );
+			}
+			else
+			{
+				this->CreateMeshSection( SectionIndex, SectionVertices, TileLOD.Indices, TileLOD.BoundingBox, false, EUpdateFrequency::Average, ESectionUpdateFlags::None );
+			}
+		};
+
+		if( TileLOD.CompactVertices.Num() > 0 )
+		{
+			CreateSection( TileLOD.CompactVertices );
+		}
+		else
+		{
+			CreateSection( TileLOD.Vertices );
+		}
+		this->SetMeshSectionVisible( SectionIndex, LODIndex == Tile.VisibleLODIndex );
+	}
+}
+
+
+void UStreetMapComponent::UpdateMeshLODs()
+{
+	const UWorld* World = GetWorld();
+	if( World == nullptr || World->ViewLocationsRenderedLastFrame.Num() == 0 || LODScreenSizes.Num() == 0 )
+	{
+		return;
+	}
+
+	const FTransform& ComponentTransform = GetComponentTransform();
+	for( int32 TileIndex = 0; TileIndex < Tiles.Num(); ++TileIndex )
+	{
+		FStreetMapMeshTile& Tile = Tiles[ TileIndex ];
+
+		// Size of the tile on screen, as seen from the closest view.  This is the same as the engine's screen size for
+		// static mesh levels of detail, assuming a 90 degree field of view.
+		const FBoxSphereBounds TileBounds = FBoxSphereBounds( Tile.BoundingBox ).TransformBy( ComponentTransform );
+		float ScreenSize = 0.0f;
+		for( const FVector& ViewLocation : World->ViewLocationsRenderedLastFrame )
+		{
+			const float Distance = FMath::Max( FVector::Dist( TileBounds.Origin, ViewLocation ), 1.0f );
+			ScreenSize = FMath::Max( ScreenSize, TileBounds.SphereRadius / Distance );
+		}
+
+		int32 NewLODIndex = 0;
+		while( NewLODIndex < LODScreenSizes.Num() && ScreenSize < LODScreenSizes[ NewLODIndex ] )
+		{
+			++NewLODIndex;
+		}
+		NewLODIndex = FMath::Min( NewLODIndex, Tile.LODs.Num() - 1 );
+
+		if( NewLODIndex != Tile.VisibleLODIndex )
+		{
+			if( Tile.LODs[ Tile.VisibleLODIndex ].GetNumIndices() > 0 )
+			{
+				this->SetMeshSectionVisible( GetMeshSectionIndex( TileIndex, Tile.VisibleLODIndex ), false );
+			}
+			if( Tile.LODs[ NewLODIndex ].GetNumIndices() > 0 )
+			{
+				this->SetMeshSectionVisible( GetMeshSectionIndex( TileIndex, NewLODIndex ), true );
+			}
+			Tile.VisibleLODIndex = NewLODIndex;
+		}
+	}
+}
+
+
+void UStreetMapComponent::TickComponent( float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction )
+{
+	Super::TickComponent( DeltaTime, TickType, ThisTickFunction );
+
+	UpdateMeshLODs();
+}
+
+
+#if WITH_EDITOR
+void UStreetMapComponent::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	// Check to see if the "StreetMap" property changed.
+	if (PropertyChangedEvent.Property != nullptr)
+	{
+		const FName PropertyName(PropertyChangedEvent.Property->GetFName());
+		if (PropertyName == GET_MEMBER_NAME_CHECKED(UStreetMapComponent, StreetMap))
+		{
+			FPropertyEditorModule& PropertyModule = FModuleManager::GetModuleChecked<FPropertyEditorModule>("PropertyEditor");
+			PropertyModule.NotifyCustomizationModuleChanged();
+		}
+	}
+
+	// Keep the mesh up to date while its settings are being tweaked
+	if (PropertyChangedEvent.MemberProperty != nullptr && PropertyChangedEvent.MemberProperty->GetFName() == GET_MEMBER_NAME_CHECKED(UStreetMapComponent, MeshBuildSettings))
+	{
+		UpdateMesh();
+	}
+
+	// Instanced buildings are drawn with our material too
+	if (PropertyChangedEvent.MemberProperty != nullptr && PropertyChangedEvent.MemberProperty->GetFName() == GET_MEMBER_NAME_CHECKED(UStreetMapComponent, OverrideMaterials))
+	{
+		UpdateInstancedBuildingsAppearance();
+	}
+
+	// Call the parent implementation of this function
+	Super::PostEditChangeProperty(PropertyChangedEvent);
 }
+#endif	// WITH_EDITOR
 
 
-void UStreetMapComponent::SetStreetMap(class UStreetMap* NewStreetMap, bool bClearPreviousMeshIfAny /*= false*/, bool bRebuildMesh /*= false */)
+UStaticMesh* UStreetMapComponent::GetInstancedBuildingMesh() const
 {
-	if (StreetMap != NewStreetMap)
+	// Instances need an actor to live in.  The instanced mesh has real normals, so it would stand out among unlit buildings.
+	if (!MeshBuildSettings.bWantInstancedBuildings || !MeshBuildSettings.bWant3DBuildings || !MeshBuildSettings.bWantLitBuildings || GetOwner() == nullptr)
 	{
-		StreetMap = NewStreetMap;
-
-		if (bClearPreviousMeshIfAny)
-			ClearMesh();
-
-		if (bRebuildMesh)
-			BuildMesh();
+		return nullptr;
 	}
+
+	return MeshBuildSettings.InstancedBuildingMesh != nullptr ? MeshBuildSettings.InstancedBuildingMesh : DefaultInstancedBuildingMesh;
 }
 
 
-void UStreetMapComponent::GenerateMesh()
+void UStreetMapComponent::UpdateInstancedBuildingsAppearance()
 {
-	/////////////////////////////////////////////////////////
-	// Visual tweakables for generated Street Map mesh
-	//
-	const float RoadZ = MeshBuildSettings.RoadOffesetZ;
-	const bool bWant3DBuildings = MeshBuildSettings.bWant3DBuildings;
-	const float BuildingLevelFloorFactor = MeshBuildSettings.BuildingLevelFloorFactor;
-	const bool bWantLitBuildings = MeshBuildSettings.bWantLitBuildings;
-	const bool bWantBuildingBorderOnGround = !bWant3DBuildings;
-	const float StreetThickness = MeshBuildSettings.StreetThickness;
-	const FColor StreetColor = MeshBuildSettings.StreetColor.ToFColor( false );
-	const float MajorRoadThickness = MeshBuildSettings.MajorRoadThickness;
-	const FColor MajorRoadColor = MeshBuildSettings.MajorRoadColor.ToFColor( false );
-	const float HighwayThickness = MeshBuildSettings.HighwayThickness;
-	const FColor HighwayColor = MeshBuildSettings.HighwayColor.ToFColor( false );
-	const float BuildingBorderThickness = MeshBuildSettings.BuildingBorderThickness;
-	FLinearColor BuildingBorderLinearColor = MeshBuildSettings.BuildingBorderLinearColor;
-	const float BuildingBorderZ = MeshBuildSettings.BuildingBorderZ;
-	const FColor BuildingBorderColor( BuildingBorderLinearColor.ToFColor( false ) );
-	const FColor BuildingFillColor( FLinearColor( BuildingBorderLinearColor * 0.33f ).CopyWithNewOpacity( 1.0f ).ToFColor( false ) );
-	/////////////////////////////////////////////////////////
-
-	if( StreetMap != nullptr )
+	if( InstancedBuildingsComponent == nullptr || InstancedBuildingsComponent->GetStaticMesh() == nullptr )
 	{
-		FBox MeshBoundingBox;
-		MeshBoundingBox.Init();
+		return;
+	}
 
-		const auto& Roads = StreetMap->GetRoads();
-		const auto& Nodes = StreetMap->GetNodes();
-		const auto& Buildings = StreetMap->GetBuildings();
+	// The vertex colors are about to be swapped out from under the render state
+	FComponentRecreateRenderStateContext RecreateRenderStateContext( InstancedBuildingsComponent );
+
+	for( int32 MaterialIndex = 0; MaterialIndex < InstancedBuildingsComponent->GetNumMaterials(); ++MaterialIndex )
+	{
+		InstancedBuildingsComponent->SetMaterial( MaterialIndex, GetMaterial( 0 ) );
+	}
 
-		// Handling all roads in the street map file
-		for( const auto& Road : Roads )
+	// Street map materials get their colors from the vertices, so every vertex of the instanced mesh is given the same color
+	// as the tops and walls of the buildings in the generated mesh
+	const FStaticMeshRenderData* RenderData = InstancedBuildingsComponent->GetStaticMesh()->RenderData.Get();
+	if( RenderData != nullptr )
+	{
+		const FColor BuildingFillColor = GetBuildingFillColor( BuiltMeshBuildSettings.BuildingBorderLinearColor );
+		const int32 NumLODs = RenderData->LODResources.Num();
+		InstancedBuildingsComponent->SetLODDataCount( NumLODs, NumLODs );
+		for( int32 LODIndex = 0; LODIndex < NumLODs; ++LODIndex )
 		{
-			float RoadThickness = StreetThickness;
-			FColor RoadColor = StreetColor;
-			switch( Road.RoadType )
-			{
-				case EStreetMapRoadType::Highway:
-					RoadThickness = HighwayThickness;
-					RoadColor = HighwayColor;
-					break;
-					
-				case EStreetMapRoadType::MajorRoad:
-					RoadThickness = MajorRoadThickness;
-					RoadColor = MajorRoadColor;
-					break;
-					
-				case EStreetMapRoadType::Street:
-				case EStreetMapRoadType::Other:
-					break;
-					
-				default:
-					check( 0 );
-					break;
-			}
-			
-			for( int32 PointIndex = 0; PointIndex < Road.RoadPoints.Num() - 1; ++PointIndex )
-			{
-				AddThick2DLine( 
-					Road.RoadPoints[ PointIndex ],
-					Road.RoadPoints[ PointIndex + 1 ],
-					RoadZ,
-					RoadThickness,
-					RoadColor,
-					RoadColor,
-					MeshBoundingBox );
-			}
+			FStaticMeshComponentLODInfo& LODInfo = InstancedBuildingsComponent->LODData[ LODIndex ];
+			LODInfo.ReleaseOverrideVertexColorsAndBlock();
+			LODInfo.OverrideVertexColors = new FColorVertexBuffer();
+			LODInfo.OverrideVertexColors->InitFromSingleColor( BuildingFillColor, RenderData->LODResources[ LODIndex ].GetNumVertices() );
+			BeginInitResource( LODInfo.OverrideVertexColors );
 		}
-		
-		TArray< int32 > TempIndices;
-		TArray< int32 > TriangulatedVertexIndices;
-		TArray< FVector > TempPoints;
-		for( int32 BuildingIndex = 0; BuildingIndex < Buildings.Num(); ++BuildingIndex )
-		{
-			const auto& Building = Buildings[ BuildingIndex ];
+	}
+}
 
-			// Building mesh (or filled area, if the building has no height)
 
-			// Triangulate this building
-			// @todo: Performance: Triangulating lots of building polygons is quite slow.  We could easily do this 
-			//        as part of the import process and store tessellated geometry instead of doing this at load time.
-			bool WindsClockwise;
-			if( FPolygonTools::TriangulatePolygon( Building.BuildingPoints, TempIndices, /* Out */ TriangulatedVertexIndices, /* Out */ WindsClockwise ) )
-			{
-				// @todo: Performance: We could preprocess the building shapes so that the points always wind
-				//        in a consistent direction, so we can skip determining the winding above.
+void UStreetMapComponent::BuildMesh()
+{
+	CancelMeshBuild();
+	RebuildMeshParts( AllMeshParts );
+}
 
-				const int32 FirstTopVertexIndex = this->Vertices.Num();
 
-				// calculate fill Z for buildings
-				// either use the defined height or extrapolate from building level count
-				float BuildingFillZ = 0.0f;
-				if (bWant3DBuildings) {
-					if (Building.Height > 0) {
-						BuildingFillZ = Building.Height;
-					}
-					else if (Building.BuildingLevels > 0) {
-						BuildingFillZ = (float)Building.BuildingLevels * BuildingLevelFloorFactor;
-					}
-				}		
+void UStreetMapComponent::RebuildMeshParts( const uint32 PartsToRebuild, const uint32 RecoloredParts )
+{
+	// Parts that aren't rebuilt are kept from the current mesh
+	FStreetMapMeshData OldMesh;
+	if( PartsToRebuild != AllMeshParts )
+	{
+		OldMesh.Tiles = MoveTemp( Tiles );
+		OldMesh.LODScreenSizes = MoveTemp( LODScreenSizes );
+		OldMesh.InstancedBuildingTransforms = MoveTemp( InstancedBuildingTransforms );
+		OldMesh.BuildSettings = BuiltMeshBuildSettings;
+	}
 
-				// Top of building
-				{
-					TempPoints.SetNum( Building.BuildingPoints.Num(), false );
-					for( int32 PointIndex = 0; PointIndex < Building.BuildingPoints.Num(); ++PointIndex )
-					{
-						TempPoints[ PointIndex ] = FVector( Building.BuildingPoints[ ( Building.BuildingPoints.Num() - PointIndex ) - 1 ], BuildingFillZ );
-					}
-					AddTriangles( TempPoints, TriangulatedVertexIndices, FVector::ForwardVector, FVector::UpVector, BuildingFillColor, MeshBoundingBox );
-				}
+	UStaticMesh* InstancedBuildingMesh = GetInstancedBuildingMesh();
+	const FBoxSphereBounds InstancedBuildingMeshBounds = InstancedBuildingMesh != nullptr ? InstancedBuildingMesh->GetBounds() : FBoxSphereBounds();
 
-				if( bWant3DBuildings && (Building.Height > KINDA_SMALL_NUMBER || Building.BuildingLevels > 0) )
-				{
-					// NOTE: Lit buildings can't share vertices beyond quads (all quads have their own face normals), so this uses a lot more geometry!
-					if( bWantLitBuildings )
-					{
-						// Create edges for the walls of the 3D buildings
-						for( int32 LeftPointIndex = 0; LeftPointIndex < Building.BuildingPoints.Num(); ++LeftPointIndex )
-						{
-							const int32 RightPointIndex = ( LeftPointIndex + 1 ) % Building.BuildingPoints.Num();
+	FStreetMapMeshData Mesh;
+	const FThreadSafeBool bNeverCancelled( false );
+	GenerateStreetMapMesh( StreetMap, MeshBuildSettings, InstancedBuildingMesh != nullptr ? &InstancedBuildingMeshBounds : nullptr, PartsToRebuild, PartsToRebuild != AllMeshParts ? &OldMesh : nullptr, bNeverCancelled, Mesh );
+	if( PartsToRebuild != AllMeshParts )
+	{
+		PublishMeshParts( Mesh, OldMesh, InstancedBuildingMesh, PartsToRebuild, RecoloredParts );
+	}
+	else
+	{
+		PublishMesh( Mesh, InstancedBuildingMesh );
+	}
+}
 
-							TempPoints.SetNum( 4, false );
 
-							const int32 TopLeftVertexIndex = 0;
-							TempPoints[ TopLeftVertexIndex ] = FVector( Building.BuildingPoints[ WindsClockwise ? RightPointIndex : LeftPointIndex ], BuildingFillZ );
+/**
+ * Works out what has to be done to a mesh that was built with OldSettings to bring it up to date with NewSettings.  Returns
+ * false if the whole mesh has to be rebuilt.
+ */
+static bool GetMeshPartsAffectedBySettings( const FStreetMapMeshBuildSettings& OldSettings, const FStreetMapMeshBuildSettings& NewSettings, uint32& OutPartsToRebuild, uint32& OutPartsToRecolor )
+{
+	OutPartsToRebuild = 0;
+	OutPartsToRecolor = 0;
 
-							const int32 TopRightVertexIndex = 1;
-							TempPoints[ TopRightVertexIndex ] = FVector( Building.BuildingPoints[ WindsClockwise ? LeftPointIndex : RightPointIndex ], BuildingFillZ );
+	// Colors can be patched into the existing vertices.  Building tops and borders can only be told apart by their colors,
+	// though, so if those were the same the buildings have to be rebuilt.
+	if( NewSettings.StreetColor != OldSettings.StreetColor )
+	{
+		OutPartsToRecolor |= 1 << MeshPart_Streets;
+	}
+	if( NewSettings.MajorRoadColor != OldSettings.MajorRoadColor )
+	{
+		OutPartsToRecolor |= 1 << MeshPart_MajorRoads;
+	}
+	if( NewSettings.HighwayColor != OldSettings.HighwayColor )
+	{
+		OutPartsToRecolor |= 1 << MeshPart_Highways;
+	}
+	if( NewSettings.BuildingBorderLinearColor != OldSettings.BuildingBorderLinearColor )
+	{
+		const bool bCanTellBuildingColorsApart = GetBuildingFillColor( OldSettings.BuildingBorderLinearColor ) != OldSettings.BuildingBorderLinearColor.ToFColor( false );
+		OutPartsToRebuild |= bCanTellBuildingColorsApart ? 0 : 1 << MeshPart_Buildings;
+		OutPartsToRecolor |= bCanTellBuildingColorsApart ? 1 << MeshPart_Buildings : 0;
+	}
 
-							const int32 BottomRightVertexIndex = 2;
-							TempPoints[ BottomRightVertexIndex ] = FVector( Building.BuildingPoints[ WindsClockwise ? LeftPointIndex : RightPointIndex ], 0.0f );
+	// Road thicknesses only affect roads of their own class, unless the roads are in a different order of thickness now.
+	// Junctions match the widest road that meets there, so they might belong to another class of road.
+	if( NewSettings.StreetThickness != OldSettings.StreetThickness )
+	{
+		OutPartsToRebuild |= 1 << MeshPart_Streets;
+	}
+	if( NewSettings.MajorRoadThickness != OldSettings.MajorRoadThickness )
+	{
+		OutPartsToRebuild |= 1 << MeshPart_MajorRoads;
+	}
+	if( NewSettings.HighwayThickness != OldSettings.HighwayThickness )
+	{
+		OutPartsToRebuild |= 1 << MeshPart_Highways;
+	}
 
-							const int32 BottomLeftVertexIndex = 3;
-							TempPoints[ BottomLeftVertexIndex ] = FVector( Building.BuildingPoints[ WindsClockwise ? RightPointIndex : LeftPointIndex ], 0.0f );
+	auto GetRoadThicknessOrder = []( const FStreetMapMeshBuildSettings& Settings ) -> uint32
+	{
+		auto Compare = []( const float A, const float B ) -> uint32
+		{
+			return A < B ? 0 : ( A > B ? 1 : 2 );
+		};
+		return Compare( Settings.StreetThickness, Settings.MajorRoadThickness ) |
+			( Compare( Settings.StreetThickness, Settings.HighwayThickness ) << 2 ) |
+			( Compare( Settings.MajorRoadThickness, Settings.HighwayThickness ) << 4 );
+	};
+
+	if( GetRoadThicknessOrder( NewSettings ) != GetRoadThicknessOrder( OldSettings ) ||
+		NewSettings.RoadOffesetZ != OldSettings.RoadOffesetZ ||
+		NewSettings.bWantRoadJunctions != OldSettings.bWantRoadJunctions )
+	{
+		OutPartsToRebuild |= RoadMeshParts;
+	}
 
+	if( NewSettings.bWant3DBuildings != OldSettings.bWant3DBuildings ||
+		NewSettings.BuildingLevelFloorFactor != OldSettings.BuildingLevelFloorFactor ||
+		NewSettings.bWantLitBuildings != OldSettings.bWantLitBuildings ||
+		NewSettings.BuildingBorderThickness != OldSettings.BuildingBorderThickness ||
+		NewSettings.bWantInstancedBuildings != OldSettings.bWantInstancedBuildings ||
+		NewSettings.InstancedBuildingMesh != OldSettings.InstancedBuildingMesh ||
+		NewSettings.BuildingBorderZ != OldSettings.BuildingBorderZ )
+	{
+		OutPartsToRebuild |= 1 << MeshPart_Buildings;
+	}
 
-							TempIndices.SetNum( 6, false );
+	// Anything else (the tile size, levels of detail or vertex format) needs the whole mesh to be rebuilt.  The settings
+	// that were checked above are set back to their old values, so that only the other settings are compared.
+	FStreetMapMeshBuildSettings OtherNewSettings = NewSettings;
+	OtherNewSettings.StreetColor = OldSettings.StreetColor;
+	OtherNewSettings.MajorRoadColor = OldSettings.MajorRoadColor;
+	OtherNewSettings.HighwayColor = OldSettings.HighwayColor;
+	OtherNewSettings.BuildingBorderLinearColor = OldSettings.BuildingBorderLinearColor;
+	OtherNewSettings.StreetThickness = OldSettings.StreetThickness;
+	OtherNewSettings.MajorRoadThickness = OldSettings.MajorRoadThickness;
+	OtherNewSettings.HighwayThickness = OldSettings.HighwayThickness;
+	OtherNewSettings.RoadOffesetZ = OldSettings.RoadOffesetZ;
+	OtherNewSettings.bWantRoadJunctions = OldSettings.bWantRoadJunctions;
+	OtherNewSettings.bWant3DBuildings = OldSettings.bWant3DBuildings;
+	OtherNewSettings.BuildingLevelFloorFactor = OldSettings.BuildingLevelFloorFactor;
+	OtherNewSettings.bWantLitBuildings = OldSettings.bWantLitBuildings;
+	OtherNewSettings.BuildingBorderThickness = OldSettings.BuildingBorderThickness;
+	OtherNewSettings.bWantInstancedBuildings = OldSettings.bWantInstancedBuildings;
+	OtherNewSettings.InstancedBuildingMesh = OldSettings.InstancedBuildingMesh;
+	OtherNewSettings.BuildingBorderZ = OldSettings.BuildingBorderZ;
+	if( !FStreetMapMeshBuildSettings::StaticStruct()->CompareScriptStruct( &OtherNewSettings, &OldSettings, PPF_None ) )
+	{
+		return false;
+	}
 
-							TempIndices[ 0 ] = BottomLeftVertexIndex;
-							TempIndices[ 1 ] = TopLeftVertexIndex;
-							TempIndices[ 2 ] = BottomRightVertexIndex;
+	OutPartsToRecolor &= ~OutPartsToRebuild;
+	return true;
+}
 
-							TempIndices[ 3 ] = BottomRightVertexIndex;
-							TempIndices[ 4 ] = TopLeftVertexIndex;
-							TempIndices[ 5 ] = TopRightVertexIndex;
 
-							const FVector FaceNormal = FVector::CrossProduct( ( TempPoints[ 0 ] - TempPoints[ 2 ] ).GetSafeNormal(), ( TempPoints[ 0 ] - TempPoints[ 1 ] ).GetSafeNormal() );
-							const FVector ForwardVector = FVector::UpVector;
-							const FVector UpVector = FaceNormal;
-							AddTriangles( TempPoints, TempIndices, ForwardVector, UpVector, BuildingFillColor, MeshBoundingBox );
-						}
-					}
-					else
-					{
-						// Create vertices for the bottom
-						const int32 FirstBottomVertexIndex = this->Vertices.Num();
-						for( int32 PointIndex = 0; PointIndex < Building.BuildingPoints.Num(); ++PointIndex )
-						{
-							const FVector2D Point = Building.BuildingPoints[ PointIndex ];
+void UStreetMapComponent::UpdateMesh()
+{
+	// A mesh that is still being built is already out of date, so start it again with the new settings
+	if( IsBuildingMesh() )
+	{
+		BuildMeshAsync();
+		return;
+	}
 
-							FStreetMapVertex& NewVertex = *new( this->Vertices )FStreetMapVertex();
-							NewVertex.Position = FVector( Point, 0.0f );
-							NewVertex.UV0 = FVector2D( 0.0f, 0.0f );
-							NewVertex.Tangent = FVector::ForwardVector;
-							NewVertex.Normal = FVector::UpVector;
-							NewVertex.Color = BuildingFillColor;
+	if( !HasValidMesh() )
+	{
+		return;
+	}
 
-							MeshBoundingBox += NewVertex.Position;
-						}
+	uint32 PartsToRebuild, PartsToRecolor;
+	if( !GetMeshPartsAffectedBySettings( BuiltMeshBuildSettings, MeshBuildSettings, PartsToRebuild, PartsToRecolor ) )
+	{
+		BuildMesh();
+		return;
+	}
 
-						// Create edges for the walls of the 3D buildings
-						for( int32 LeftPointIndex = 0; LeftPointIndex < Building.BuildingPoints.Num(); ++LeftPointIndex )
+	if( PartsToRecolor != 0 )
+	{
+		// Old and new colors of the vertices in each part
+		const FStreetMapMeshBuildSettings& OldSettings = BuiltMeshBuildSettings;
+		TArray< TPair< FColor, FColor >, TInlineAllocator< 2 > > ColorChanges[ MeshPart_Count ];
+		ColorChanges[ MeshPart_Streets ].Emplace( OldSettings.StreetColor.ToFColor( false ), MeshBuildSettings.StreetColor.ToFColor( false ) );
+		ColorChanges[ MeshPart_MajorRoads ].Emplace( OldSettings.MajorRoadColor.ToFColor( false ), MeshBuildSettings.MajorRoadColor.ToFColor( false ) );
+		ColorChanges[ MeshPart_Highways ].Emplace( OldSettings.HighwayColor.ToFColor( false ), MeshBuildSettings.HighwayColor.ToFColor( false ) );
+		ColorChanges[ MeshPart_Buildings ].Emplace( GetBuildingFillColor( OldSettings.BuildingBorderLinearColor ), GetBuildingFillColor( MeshBuildSettings.BuildingBorderLinearColor ) );
+		ColorChanges[ MeshPart_Buildings ].Emplace( OldSettings.BuildingBorderLinearColor.ToFColor( false ), MeshBuildSettings.BuildingBorderLinearColor.ToFColor( false ) );
+
+		TArray< bool > IsTileRecolored;
+		IsTileRecolored.SetNumZeroed( Tiles.Num() );
+		ParallelFor( Tiles.Num(), [&]( const int32 TileIndex )
+		{
+			for( FStreetMapMeshLOD& TileLOD : Tiles[ TileIndex ].LODs )
+			{
+				auto RecolorVertices = [&]( auto& Vertices )
+				{
+					for( int32 Part = 0; Part < MeshPart_Count; ++Part )
+					{
+						if( PartsToRecolor & ( 1 << Part ) )
 						{
-							const int32 RightPointIndex = ( LeftPointIndex + 1 ) % Building.BuildingPoints.Num();
-
-							const int32 BottomLeftVertexIndex = FirstBottomVertexIndex + LeftPointIndex;
-							const int32 BottomRightVertexIndex = FirstBottomVertexIndex + RightPointIndex;
-							const int32 TopRightVertexIndex = FirstTopVertexIndex + RightPointIndex;
-							const int32 TopLeftVertexIndex = FirstTopVertexIndex + LeftPointIndex;
-
-							this->Indices.Add( BottomLeftVertexIndex );
-							this->Indices.Add( TopLeftVertexIndex );
-							this->Indices.Add( BottomRightVertexIndex );
-
-							this->Indices.Add( BottomRightVertexIndex );
-							this->Indices.Add( TopLeftVertexIndex );
-							this->Indices.Add( TopRightVertexIndex );
+							for( int32 VertexIndex = TileLOD.PartFirstVertexIndices[ Part ]; VertexIndex < TileLOD.PartFirstVertexIndices[ Part + 1 ]; ++VertexIndex )
+							{
+								for( const TPair< FColor, FColor >& ColorChange : ColorChanges[ Part ] )
+								{
+									if( Vertices[ VertexIndex ].Color == ColorChange.Key )
+									{
+										Vertices[ VertexIndex ].Color = ColorChange.Value;
+										IsTileRecolored[ TileIndex ] = true;
+										break;
+									}
+								}
+							}
 						}
 					}
-				}
-			}
-			else
-			{
-				// @todo: Triangulation failed for some reason, possibly due to degenerate polygons.  We can
-				//        probably improve the algorithm to avoid this happening.
+				};
+
+				RecolorVertices( TileLOD.Vertices );
+				RecolorVertices( TileLOD.CompactVertices );
 			}
+		} );
 
-			// Building border
-			if( bWantBuildingBorderOnGround )
+		// Recolored sections are uploaded along with the rebuilt ones below, if there are any
+		if( PartsToRebuild == 0 )
+		{
+			for( int32 TileIndex = 0; TileIndex < Tiles.Num(); ++TileIndex )
 			{
-				for( int32 PointIndex = 0; PointIndex < Building.BuildingPoints.Num(); ++PointIndex )
+				if( IsTileRecolored[ TileIndex ] )
 				{
-					AddThick2DLine(
-						Building.BuildingPoints[ PointIndex ],
-						Building.BuildingPoints[ ( PointIndex + 1 ) % Building.BuildingPoints.Num() ],
-						BuildingBorderZ,
-						BuildingBorderThickness,		// Thickness
-						BuildingBorderColor,
-						BuildingBorderColor,
-						MeshBoundingBox );
+					for( int32 LODIndex = 0; LODIndex < Tiles[ TileIndex ].LODs.Num(); ++LODIndex )
+					{
+						CreateTileMeshSection( TileIndex, LODIndex );
+					}
 				}
 			}
 		}
 	}
 
-	this->CreateMeshSection(346, Vertices, Indices, false, EUpdateFrequency::Average, ESectionUpdateFlags::None);
+	if( PartsToRebuild != 0 )
+	{
+		RebuildMeshParts( PartsToRebuild, PartsToRecolor );
+	}
+	else
+	{
+		BuiltMeshBuildSettings = MeshBuildSettings;
+		if( PartsToRecolor & ( 1 << MeshPart_Buildings ) )
+		{
+			UpdateInstancedBuildingsAppearance();
+		}
+	}
 }
 
 
-#if WITH_EDITOR
-void UStreetMapComponent::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+void UStreetMapComponent::BuildMeshAsync()
 {
-	// Check to see if the "StreetMap" property changed.
-	if (PropertyChangedEvent.Property != nullptr)
+	// Any build that is already running is out of date now.  It will notice that it was cancelled and stop early.
+	CancelMeshBuild();
+
+	TSharedPtr<FStreetMapAsyncMeshBuild, ESPMode::ThreadSafe> Build = MakeShareable(new FStreetMapAsyncMeshBuild());
+	Build->StreetMap = StreetMap;
+	Build->InstancedBuildingMesh = GetInstancedBuildingMesh();
+	AsyncMeshBuild = Build;
+	RunningMeshBuilds.Add(Build);
+
+	// Settings are copied, so that they can be edited on the game thread while the mesh is being built
+	const FStreetMapMeshBuildSettings BuildSettings = MeshBuildSettings;
+	const bool bWantInstancedBuildings = Build->InstancedBuildingMesh != nullptr;
+	const FBoxSphereBounds InstancedBuildingMeshBounds = bWantInstancedBuildings ? Build->InstancedBuildingMesh->GetBounds() : FBoxSphereBounds();
+	TWeakObjectPtr<UStreetMapComponent> WeakThis(this);
+
+	Build->Task = FFunctionGraphTask::CreateAndDispatchWhenReady([Build, BuildSettings, bWantInstancedBuildings, InstancedBuildingMeshBounds, WeakThis]()
 	{
-		const FName PropertyName(PropertyChangedEvent.Property->GetFName());
-		if (PropertyName == GET_MEMBER_NAME_CHECKED(UStreetMapComponent, StreetMap))
+		GenerateStreetMapMesh(Build->StreetMap, BuildSettings, bWantInstancedBuildings ? &InstancedBuildingMeshBounds : nullptr, AllMeshParts, nullptr, Build->bCancelled, Build->Mesh);
+
+		// Mesh sections can only be created on the game thread.  Cancelled builds go there too, to let go of their street map.
+		AsyncTask(ENamedThreads::GameThread, [Build, WeakThis]()
 		{
-			FPropertyEditorModule& PropertyModule = FModuleManager::GetModuleChecked<FPropertyEditorModule>("PropertyEditor");
-			PropertyModule.NotifyCustomizationModuleChanged();
-		}
-	}
+			UStreetMapComponent* This = WeakThis.Get();
+			if (This != nullptr)
+			{
+				This->RunningMeshBuilds.Remove(Build);
+				if (This->AsyncMeshBuild == Build && !Build->bCancelled)
+				{
+					This->AsyncMeshBuild.Reset();
+					This->PublishMesh(Build->Mesh, Build->InstancedBuildingMesh);
+				}
+			}
+		});
+	}, TStatId(), nullptr, ENamedThreads::AnyBackgroundThreadNormalTask);
+}
 
-	// Call the parent implementation of this function
-	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+bool UStreetMapComponent::IsBuildingMesh() const
+{
+	return AsyncMeshBuild.IsValid();
 }
-#endif	// WITH_EDITOR
 
 
-void UStreetMapComponent::BuildMesh()
+void UStreetMapComponent::CancelMeshBuild()
 {
-	ClearMesh();
-	GenerateMesh();
-	MarkRenderStateDirty();
-	AssignDefaultMaterialIfNeeded();
-	Modify();
+	if (AsyncMeshBuild.IsValid())
+	{
+		AsyncMeshBuild->bCancelled = true;
+		AsyncMeshBuild.Reset();
+	}
 }
 
 
@@ -301,92 +1873,161 @@ void UStreetMapComponent::AssignDefaultMaterialIfNeeded()
 
 		this->SetMaterial(0, GetDefaultMaterial());
 	}
+
+	// Every tile and level of detail gets its own mesh section, but they should all look the same
+	for (int32 SectionIndex = 1; SectionIndex < GetNumMeshSections(); ++SectionIndex)
+	{
+		this->SetMaterial(SectionIndex, this->GetMaterial(0));
+	}
 }
 
 
 void UStreetMapComponent::ClearMesh()
 {
-	Vertices.Reset();
-	Indices.Reset();
-	ClearMeshSection(0);
+	CancelMeshBuild();
+
+	Tiles.Reset();
+	LODScreenSizes.Reset();
+	InstancedBuildingTransforms.Reset();
+	ClearAllMeshSections();
+
+	if (InstancedBuildingsComponent != nullptr)
+	{
+		InstancedBuildingsComponent->ClearInstances();
+	}
+	SetComponentTickEnabled(false);
 }
 
 
-void UStreetMapComponent::AddThick2DLine( const FVector2D Start, const FVector2D End, const float Z, const float Thickness, const FColor& StartColor, const FColor& EndColor, FBox& MeshBoundingBox )
+void UStreetMapComponent::GetRawMesh( TArray< FStreetMapVertex >& OutVertices, TArray< int32 >& OutIndices ) const
 {
-	const float HalfThickness = Thickness * 0.5f;
+	OutVertices.Reset();
+	OutIndices.Reset();
 
-	const FVector2D LineDirection = ( End - Start ).GetSafeNormal();
-	const FVector2D RightVector( -LineDirection.Y, LineDirection.X );
+	// Instanced buildings aren't in the cached mesh, so the buildings are generated again without instancing.  Only full
+	// detail is needed, and the roads are taken from the cached mesh as they are.
+	FStreetMapMeshData MeshWithoutInstances;
+	if( InstancedBuildingTransforms.Num() > 0 && StreetMap != nullptr )
+	{
+		FStreetMapMeshData FullDetailMesh;
+		for( const FStreetMapMeshTile& Tile : Tiles )
+		{
+			FStreetMapMeshTile& FullDetailTile = FullDetailMesh.Tiles[ FullDetailMesh.Tiles.AddDefaulted() ];
+			FullDetailTile.Coordinates = Tile.Coordinates;
+			FullDetailTile.BoundingBox = Tile.LODs[ 0 ].BoundingBox;
+			FullDetailTile.LODs.Add( Tile.LODs[ 0 ] );
+		}
 
-	const int32 BottomLeftVertexIndex = Vertices.Num();
-	FStreetMapVertex& BottomLeftVertex = *new( Vertices )FStreetMapVertex();
-
-	BottomLeftVertex.Position = FVector( Start - RightVector * HalfThickness, Z );
-	BottomLeftVertex.UV0 = FVector2D( 0.0f, 0.0f );
-	BottomLeftVertex.Tangent = FVector( LineDirection, 0.0f );
-	BottomLeftVertex.Normal = FVector::UpVector;
-	BottomLeftVertex.Color = StartColor;
-	MeshBoundingBox += BottomLeftVertex.Position;
-
-	const int32 BottomRightVertexIndex = Vertices.Num();
-	FStreetMapVertex& BottomRightVertex = *new( Vertices )FStreetMapVertex();
-	BottomRightVertex.Position = FVector( Start + RightVector * HalfThickness, Z );
-	BottomRightVertex.UV0 = FVector2D( 1.0f, 0.0f );
-	BottomRightVertex.Tangent = FVector( LineDirection, 0.0f );
-	BottomRightVertex.Normal = FVector::UpVector;
-	BottomRightVertex.Color = StartColor;
-	MeshBoundingBox += BottomRightVertex.Position;
-
-	const int32 TopRightVertexIndex = Vertices.Num();
-	FStreetMapVertex& TopRightVertex = *new( Vertices )FStreetMapVertex();
-	TopRightVertex.Position = FVector( End + RightVector * HalfThickness, Z );
-	TopRightVertex.UV0 = FVector2D( 1.0f, 1.0f );
-	TopRightVertex.Tangent = FVector( LineDirection, 0.0f );
-	TopRightVertex.Normal = FVector::UpVector;
-	TopRightVertex.Color = EndColor;
-	MeshBoundingBox += TopRightVertex.Position;
-
-	const int32 TopLeftVertexIndex = Vertices.Num();
-	FStreetMapVertex& TopLeftVertex = *new( Vertices )FStreetMapVertex();
-	TopLeftVertex.Position = FVector( End - RightVector * HalfThickness, Z );
-	TopLeftVertex.UV0 = FVector2D( 0.0f, 1.0f );
-	TopLeftVertex.Tangent = FVector( LineDirection, 0.0f );
-	TopLeftVertex.Normal = FVector::UpVector;
-	TopLeftVertex.Color = EndColor;
-	MeshBoundingBox += TopLeftVertex.Position;
-
-	Indices.Add( BottomLeftVertexIndex );
-	Indices.Add( BottomRightVertexIndex );
-	Indices.Add( TopRightVertexIndex );
-
-	Indices.Add( BottomLeftVertexIndex );
-	Indices.Add( TopRightVertexIndex );
-	Indices.Add( TopLeftVertexIndex );
-};
+		FStreetMapMeshBuildSettings FullDetailBuildSettings = BuiltMeshBuildSettings;
+		FullDetailBuildSettings.LODs.Reset();
+
+		const FThreadSafeBool bNeverCancelled( false );
+		GenerateStreetMapMesh( StreetMap, FullDetailBuildSettings, nullptr, 1 << MeshPart_Buildings, &FullDetailMesh, bNeverCancelled, MeshWithoutInstances );
+	}
+	const TArray< FStreetMapMeshTile >& RawMeshTiles = MeshWithoutInstances.Tiles.Num() > 0 ? MeshWithoutInstances.Tiles : Tiles;
+
+	int32 NumVertices = 0;
+	int32 NumIndices = 0;
+	for( const FStreetMapMeshTile& Tile : RawMeshTiles )
+	{
+		NumVertices += Tile.LODs[ 0 ].GetNumVertices();
+		NumIndices += Tile.LODs[ 0 ].GetNumIndices();
+	}
+	OutVertices.Reserve( NumVertices );
+	OutIndices.Reserve( NumIndices );
+
+	for( const FStreetMapMeshTile& Tile : RawMeshTiles )
+	{
+		const FStreetMapMeshLOD& TileLOD = Tile.LODs[ 0 ];
+
+		// Indices are relative to each tile's own vertices, so offset them to where the tile's vertices start
+		const int32 FirstVertexIndex = OutVertices.Num();
+		for( const int32 Index : TileLOD.Indices )
+		{
+			OutIndices.Add( FirstVertexIndex + Index );
+		}
+		for( const uint16 Index : TileLOD.Indices16 )
+		{
+			OutIndices.Add( FirstVertexIndex + Index );
+		}
+
+		OutVertices.Append( TileLOD.Vertices );
+
+		// Compact vertices don't have tangents.  Any vector along the surface will do for the raw mesh.
+		for( const FStreetMapCompactVertex& CompactVertex : TileLOD.CompactVertices )
+		{
+			FStreetMapVertex& Vertex = *new( OutVertices )FStreetMapVertex();
+			Vertex.Position = CompactVertex.Position;
+			Vertex.Normal = CompactVertex.Normal;
+			Vertex.Color = CompactVertex.Color;
+			Vertex.UV0 = CompactVertex.UV0;
+
+			const FVector Normal = CompactVertex.Normal.ToFVector();
+			Vertex.Tangent = FMath::Abs( Normal.Z ) < 0.9f ? FVector::CrossProduct( FVector::UpVector, Normal ).GetSafeNormal() : FVector::ForwardVector;
+		}
+	}
+}
 
 
-void UStreetMapComponent::AddTriangles( const TArray<FVector>& Points, const TArray<int32>& PointIndices, const FVector& ForwardVector, const FVector& UpVector, const FColor& Color, FBox& MeshBoundingBox )
+TArray< FStreetMapVertex > UStreetMapComponent::GetRawMeshVertices() const
 {
-	const int32 FirstVertexIndex = Vertices.Num();
+	TArray< FStreetMapVertex > Vertices;
+	TArray< int32 > Indices;
+	GetRawMesh( Vertices, Indices );
+	return Vertices;
+}
+
+
+TArray< int32 > UStreetMapComponent::GetRawMeshIndices() const
+{
+	TArray< FStreetMapVertex > Vertices;
+	TArray< int32 > Indices;
+	GetRawMesh( Vertices, Indices );
+	return Indices;
+}
+
 
-	for( FVector Point : Points )
+int32 UStreetMapComponent::GetNumMeshVertices() const
+{
+	int32 NumVertices = 0;
+	for( const FStreetMapMeshTile& Tile : Tiles )
 	{
-		FStreetMapVertex& NewVertex = *new( Vertices )FStreetMapVertex();
-		NewVertex.Position = Point;
-		NewVertex.UV0 = FVector2D( 0.0f, 0.0f );
-		NewVertex.Tangent = ForwardVector;
-		NewVertex.Normal = UpVector;
-		NewVertex.Color = Color;
+		NumVertices += Tile.LODs[ 0 ].GetNumVertices();
+	}
+	return NumVertices;
+}
 
-		MeshBoundingBox += NewVertex.Position;
+
+int32 UStreetMapComponent::GetNumMeshIndices() const
+{
+	int32 NumIndices = 0;
+	for( const FStreetMapMeshTile& Tile : Tiles )
+	{
+		NumIndices += Tile.LODs[ 0 ].GetNumIndices();
 	}
+	return NumIndices;
+}
 
-	for( int32 PointIndex : PointIndices )
+
+void UStreetMapComponent::GetNumMeshSectionsByIndexSize( int32& OutNum16BitSections, int32& OutNum32BitSections ) const
+{
+	OutNum16BitSections = 0;
+	OutNum32BitSections = 0;
+	for( const FStreetMapMeshTile& Tile : Tiles )
 	{
-		Indices.Add( FirstVertexIndex + PointIndex );
+		for( const FStreetMapMeshLOD& TileLOD : Tile.LODs )
+		{
+			if( TileLOD.Indices16.Num() > 0 )
+			{
+				++OutNum16BitSections;
+			}
+			else if( TileLOD.Indices.Num() > 0 )
+			{
+				++OutNum32BitSections;
+			}
+		}
 	}
-};
+}
 
 
 FString UStreetMapComponent::GetStreetMapAssetName() const
@@ -6,6 +6,8 @@
 #include "StreetMapRuntime.h"
 #include "StreetMapVertex.h"
 #include "RuntimeMeshComponent.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/ThreadSafeBool.h"
 
 #if WITH_EDITOR
 	#include "ModuleManager.h"
@@ -14,6 +16,132 @@
 
 #include "StreetMapComponent.generated.h"
 
+/**
+ * Parts of the street map mesh.  Every tile keeps each part in its own range of its mesh buffers, so that parts can be
+ * recolored or rebuilt on their own when the mesh build settings change.
+ */
+enum EStreetMapMeshPart
+{
+	/** Streets and other small roads, and the junctions where they're the widest road */
+	MeshPart_Streets,
+
+	/** Major roads, and the junctions where they're the widest road */
+	MeshPart_MajorRoads,
+
+	/** Highways, and the junctions where they're the widest road */
+	MeshPart_Highways,
+
+	/** Buildings and their borders */
+	MeshPart_Buildings,
+
+	MeshPart_Count
+};
+
+
+/** Cached mesh for one level of detail of a street map tile.  Every level of detail of every tile is its own mesh section. */
+struct FStreetMapMeshLOD
+{
+	FStreetMapMeshLOD()
+	{
+		FMemory::Memzero( PartFirstVertexIndices );
+		FMemory::Memzero( PartFirstIndexIndices );
+	}
+
+	/** Mesh vertices for all of the roads and buildings in this tile */
+	TArray<FStreetMapVertex> Vertices;
+
+	/** Mesh vertices, when the mesh was built with compact vertices.  Vertices is empty in that case. */
+	TArray<FStreetMapCompactVertex> CompactVertices;
+
+	/** Mesh triangle indices, relative to this level of detail's vertices */
+	TArray< int32 > Indices;
+
+	/** Mesh triangle indices, when there are few enough vertices for 16-bit indices.  Indices is empty in that case. */
+	TArray< uint16 > Indices16;
+
+	/** Bounds of this level of detail's vertices */
+	FBox BoundingBox;
+
+	/** Where each part of the mesh starts in the vertex buffer.  The last entry is the number of vertices. */
+	int32 PartFirstVertexIndices[ MeshPart_Count + 1 ];
+
+	/** Where each part of the mesh starts in the index buffer.  The last entry is the number of indices. */
+	int32 PartFirstIndexIndices[ MeshPart_Count + 1 ];
+
+	/** Returns the number of vertices, whichever format they're in */
+	int32 GetNumVertices() const
+	{
+		return Vertices.Num() + CompactVertices.Num();
+	}
+
+	/** Returns the number of triangle indices, whichever size they are */
+	int32 GetNumIndices() const
+	{
+		return Indices.Num() + Indices16.Num();
+	}
+};
+
+
+/** Cached mesh for one square tile of the street map */
+struct FStreetMapMeshTile
+{
+	/** Which tile this is, in multiples of the tile size */
+	FIntPoint Coordinates;
+
+	/** Full detail mesh, followed by every lower level of detail */
+	TArray< FStreetMapMeshLOD > LODs;
+
+	/** Bounds of all levels of detail */
+	FBox BoundingBox;
+
+	/** The level of detail that is currently visible */
+	int32 VisibleLODIndex;
+};
+
+
+/** Everything that is generated for a street map mesh.  This is kept apart from the component, so that it can be built on another thread. */
+struct FStreetMapMeshData
+{
+	/** Mesh tiles, with every level of detail */
+	TArray< FStreetMapMeshTile > Tiles;
+
+	/** Screen sizes that the lower levels of detail are used below */
+	TArray< float > LODScreenSizes;
+
+	/** Where each instanced building is */
+	TArray< FTransform > InstancedBuildingTransforms;
+
+	/** The settings that the mesh was built with */
+	FStreetMapMeshBuildSettings BuildSettings;
+};
+
+
+/** A mesh build that is running on another thread.  Shared between the component and the build task. */
+struct FStreetMapAsyncMeshBuild
+{
+	/** The street map being read.  The component keeps it from being garbage collected until the build has finished. */
+	UStreetMap* StreetMap;
+
+	/** The mesh being built */
+	FStreetMapMeshData Mesh;
+
+	/**
+	 * Mesh that is instanced for rectangular buildings, if any.  The component keeps it from being garbage collected until
+	 * the build has finished too, since those buildings are left out of the built mesh.
+	 */
+	class UStaticMesh* InstancedBuildingMesh;
+
+	/** Set when the build is no longer wanted.  The build stops as soon as it notices. */
+	FThreadSafeBool bCancelled;
+
+	/** The task that is building the mesh */
+	FGraphEventRef Task;
+};
+
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam( FStreetMapMeshBuiltSignature, class UStreetMapComponent*, StreetMapComponent );
+
+
 /**
  * Component that represents a section of street map roads and buildings
  */
@@ -39,19 +167,40 @@ public:
 	/** Returns true if we have valid cached mesh data from our assigned street map asset */
 	bool HasValidMesh() const
 	{
-		return Vertices.Num() != 0 && Indices.Num() != 0;
+		return Tiles.Num() != 0;
 	}
 
-	/** Returns Cached raw mesh vertices */
-	TArray< struct FStreetMapVertex > GetRawMeshVertices() const
+	/**
+	 * Gets the raw mesh for all tiles at full detail, with triangle indices into the vertices.  Instanced buildings are generated
+	 * as regular building geometry, so that every building is in the raw mesh.
+	 */
+	void GetRawMesh( TArray< struct FStreetMapVertex >& OutVertices, TArray< int32 >& OutIndices ) const;
+
+	/** Returns Cached raw mesh vertices, for all tiles at full detail.  See GetRawMesh(). */
+	TArray< struct FStreetMapVertex > GetRawMeshVertices() const;
+
+	 /** Returns Cached raw mesh triangle indices, for all tiles at full detail.  See GetRawMesh(). */
+	TArray< int32 > GetRawMeshIndices() const;
+
+	/** Returns the number of cached mesh vertices, for all tiles at full detail.  Instanced buildings aren't counted. */
+	int32 GetNumMeshVertices() const;
+
+	/** Returns the number of cached mesh triangle indices, for all tiles at full detail.  Instanced buildings aren't counted. */
+	int32 GetNumMeshIndices() const;
+
+	/** Returns the cached mesh tiles */
+	const TArray< FStreetMapMeshTile >& GetMeshTiles() const
 	{
-		return Vertices;
+		return Tiles;
 	}
 
-	 /** Returns Cached raw mesh triangle indices */
-	TArray< int32 > GetRawMeshIndices() const
+	/** Counts the mesh sections that use 16-bit and 32-bit triangle indices */
+	void GetNumMeshSectionsByIndexSize( int32& OutNum16BitSections, int32& OutNum32BitSections ) const;
+
+	/** Returns the mesh section used for a level of detail of a tile */
+	int32 GetMeshSectionIndex( const int32 TileIndex, const int32 LODIndex ) const
 	{
-		return Indices;
+		return TileIndex * ( LODScreenSizes.Num() + 1 ) + LODIndex;
 	}
 
 	/**
@@ -65,12 +214,12 @@ public:
 
 	/**
 	*	Returns sub-meshes count.
-	*	In this case we are creating one single mesh section, so it will return 1.
+	*	We create one mesh section for every level of detail of every tile that has any roads or buildings in it.
 	*	If cached mesh data are not valid , it will return 0.
 	*/
 	int32 GetNumMeshSections() const
 	{
-		return HasValidMesh() ? 1 : 0;
+		return Tiles.Num() * ( LODScreenSizes.Num() + 1 );
 	}
 
 	/**
@@ -78,7 +227,7 @@ public:
 	 *
 	 * @param NewStreetMap The street map to use
 	 *
-	 * @param bRebuildMesh : Rebuilds map mesh based on the new map asset
+	 * @param bRebuildMesh : Rebuilds map mesh based on the new map asset.  In game worlds the mesh is built in the background.
 	 *
 	 * @return Sets the street map object
 	 */
@@ -89,25 +238,79 @@ public:
 	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
 #endif
 
-	/** Wipes out our cached mesh data. Designed to be called on demand.*/
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	virtual void BeginDestroy() override;
+
+	static void AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector);
+
+	/** Wipes out our cached mesh data, and cancels any mesh build that is running. Designed to be called on demand.*/
 	void ClearMesh();
 
 	/** Rebuilds the graphics and physics mesh representation if we don't have one right now.  Designed to be called on demand. */
 	void BuildMesh();
 
+	/**
+	 * Brings the mesh up to date with the mesh build settings, redoing as little as possible.  Color changes are patched into
+	 * the existing vertices, and changes that only affect some parts of the mesh (one class of road, or buildings) only
+	 * regenerate those parts.  Anything else rebuilds the whole mesh.  Does nothing if there is no mesh yet.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		void UpdateMesh();
+
+	/**
+	 * Rebuilds the mesh on a background thread, without stalling the game.  The current mesh stays in place until the new one
+	 * is ready, then OnMeshBuilt is broadcast.  Starting another build cancels this one.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		void BuildMeshAsync();
+
+	/** Stops the mesh build that is running in the background, if there is one.  The current mesh is left as it is. */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		void CancelMeshBuild();
+
+	/** Returns true while a mesh is being built in the background */
+	UFUNCTION(BlueprintPure, Category = "StreetMap")
+		bool IsBuildingMesh() const;
+
+	/** Called whenever a new mesh has been built and is ready to be seen */
+	UPROPERTY(BlueprintAssignable, Category = "StreetMap")
+		FStreetMapMeshBuiltSignature OnMeshBuilt;
+
 protected:
 
 	/** Giving a default material to the mesh if no valid material is already assigned or materials array is empty. */
 	void AssignDefaultMaterialIfNeeded();
 
-	/** Generates a cached mesh from raw street map data */
-	void GenerateMesh();
+	/** Replaces the cached mesh with a newly generated one, and creates its mesh sections.  Must be called on the game thread. */
+	void PublishMesh( FStreetMapMeshData& Mesh, class UStaticMesh* InstancedBuildingMesh );
+
+	/**
+	 * Replaces the cached mesh with one that had some parts rebuilt and was merged with OldMesh, and recreates only the mesh
+	 * sections that the rebuilt or recolored parts were or are in.  Must be called on the game thread.
+	 */
+	void PublishMeshParts( FStreetMapMeshData& Mesh, const FStreetMapMeshData& OldMesh, class UStaticMesh* InstancedBuildingMesh, const uint32 RebuiltParts, const uint32 RecoloredParts );
+
+	/**
+	 * Regenerates some parts of the mesh (a mask of EStreetMapMeshPart bits), keeping the rest of the current mesh.  Parts whose
+	 * vertex colors were changed in the current mesh are uploaded too.
+	 */
+	void RebuildMeshParts( const uint32 PartsToRebuild, const uint32 RecoloredParts = 0 );
+
+	/** Replaces the instanced buildings with the cached instance transforms */
+	void CreateInstancedBuildings( class UStaticMesh* InstancedBuildingMesh );
+
+	/** Creates (or recreates) the mesh section for a level of detail of a tile from the cached mesh */
+	void CreateTileMeshSection( const int32 TileIndex, const int32 LODIndex );
+
+	/** Returns the mesh to instance for rectangular buildings, or nullptr if buildings shouldn't be instanced */
+	class UStaticMesh* GetInstancedBuildingMesh() const;
 
-	/** Adds a 2D line to the raw mesh */
-	void AddThick2DLine(const FVector2D Start, const FVector2D End, const float Z, const float Thickness, const FColor& StartColor, const FColor& EndColor, FBox& MeshBoundingBox);
+	/** Makes the instanced buildings look like the rest of the buildings: the same material, and the building fill color */
+	void UpdateInstancedBuildingsAppearance();
 
-	/** Adds 3D triangles to the raw mesh */
-	void AddTriangles(const TArray<FVector>& Points, const TArray<int32>& PointIndices, const FVector& ForwardVector, const FVector& UpVector, const FColor& Color, FBox& MeshBoundingBox);
+	/** Shows the level of detail of every tile that best matches its size on screen */
+	void UpdateMeshLODs();
 
 
 protected:
@@ -125,14 +328,34 @@ protected:
 	// Cached mesh representation
 	//
 
-	/** Cached raw mesh vertices */
-	TArray<FStreetMapVertex> Vertices;
+	/** Cached raw mesh, split into tiles */
+	TArray< FStreetMapMeshTile > Tiles;
 
-	/** Cached raw mesh triangle indices */
-	TArray< int32 > Indices;
+	/** Screen sizes that the cached mesh's lower levels of detail are used below */
+	TArray< float > LODScreenSizes;
+
+	/** The settings that the cached mesh was built with */
+	FStreetMapMeshBuildSettings BuiltMeshBuildSettings;
+
+	/** Where each instanced building is, relative to this component */
+	TArray< FTransform > InstancedBuildingTransforms;
+
+	/** Draws the buildings that are instanced, if there are any */
+	UPROPERTY(Transient)
+		class UHierarchicalInstancedStaticMeshComponent* InstancedBuildingsComponent;
+
+	/** Mesh build that is running in the background, if any */
+	TSharedPtr< FStreetMapAsyncMeshBuild, ESPMode::ThreadSafe > AsyncMeshBuild;
+
+	/** Every background mesh build that hasn't finished yet, including cancelled ones that haven't stopped yet */
+	TArray< TSharedPtr< FStreetMapAsyncMeshBuild, ESPMode::ThreadSafe > > RunningMeshBuilds;
 
 	/** Cached StreetMap DefaultMaterial */
 	UPROPERTY()
 		UMaterialInterface* StreetMapDefaultMaterial;
 
+	/** Mesh instanced for rectangular buildings, unless the mesh build settings have another one */
+	UPROPERTY()
+		class UStaticMesh* DefaultInstancedBuildingMesh;
+
 };
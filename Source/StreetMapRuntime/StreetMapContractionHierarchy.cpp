@@ -0,0 +1,333 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapContractionHierarchy.h"
+#include "Async/ParallelFor.h"
+
+
+/** Searches the graph that is left while contracting, to find out whether a shortcut is needed between two neighbors of a node */
+struct FStreetMapWitnessSearch
+{
+	/** A node waiting to be visited */
+	struct FQueuedNode
+	{
+		float Cost;
+		int32 NodeIndex;
+
+		bool operator<( const FQueuedNode& Other ) const
+		{
+			return Cost < Other.Cost;
+		}
+	};
+
+	/** Cheapest known cost of getting to every node the search has reached.  Witness searches are small, so this is sparse. */
+	TMap< int32, float > Costs;
+
+	/** Nodes whose cost is final */
+	TSet< int32 > SettledNodes;
+
+	/** Nodes waiting to be visited, as a heap with the cheapest on top */
+	TArray< FQueuedNode > Queue;
+
+	/**
+	 * Finds the cheapest routes from a node to its surroundings that don't go through the node being contracted.  Gives up
+	 * on routes that cost more than the shortcuts being considered, and after settling a limited number of nodes, in which
+	 * case some unneeded shortcuts may be added.  That only costs a little query speed.
+	 */
+	void Run( const TArray< TArray< FStreetMapContractionHierarchyEdge > >& OutEdges, const int32 StartNodeIndex, const int32 IgnoredNodeIndex, const float MaxCost, const int32 MaxSettledNodes )
+	{
+		Costs.Reset();
+		SettledNodes.Reset();
+		Queue.Reset();
+
+		Costs.Add( StartNodeIndex, 0.0f );
+		Queue.HeapPush( FQueuedNode{ 0.0f, StartNodeIndex } );
+
+		while( Queue.Num() > 0 && SettledNodes.Num() < MaxSettledNodes )
+		{
+			FQueuedNode QueuedNode;
+			Queue.HeapPop( QueuedNode, /* bAllowShrinking */ false );
+			if( QueuedNode.Cost > MaxCost )
+			{
+				break;
+			}
+
+			bool bWasAlreadySettled = false;
+			SettledNodes.Add( QueuedNode.NodeIndex, &bWasAlreadySettled );
+			if( bWasAlreadySettled )
+			{
+				continue;
+			}
+
+			for( const FStreetMapContractionHierarchyEdge& Edge : OutEdges[ QueuedNode.NodeIndex ] )
+			{
+				if( Edge.NodeIndex != IgnoredNodeIndex )
+				{
+					const float NewCost = QueuedNode.Cost + Edge.Cost;
+					const float* Cost = Costs.Find( Edge.NodeIndex );
+					if( Cost == nullptr || NewCost < *Cost )
+					{
+						Costs.Add( Edge.NodeIndex, NewCost );
+						Queue.HeapPush( FQueuedNode{ NewCost, Edge.NodeIndex } );
+					}
+				}
+			}
+		}
+	}
+
+	/** Returns the cheapest route cost found to a node.  Routes to nodes that weren't settled are real routes too, just maybe not the cheapest. */
+	float GetCost( const int32 NodeIndex ) const
+	{
+		const float* Cost = Costs.Find( NodeIndex );
+		return Cost != nullptr ? *Cost : TNumericLimits< float >::Max();
+	}
+};
+
+
+void FStreetMapContractionHierarchy::Build( const FStreetMapRoadGraph& Graph )
+{
+	/////////////////////////////////////////////////////////
+	// Tweakables for contraction
+	//
+	const int32 MaxWitnessSettledNodes = 500;
+	const int32 NodesPerPriorityBatch = 256;
+	/////////////////////////////////////////////////////////
+
+	const int32 NumNodes = Graph.GetNumNodes();
+
+	// The graph that is left to contract.  Every edge is in the list of the node it leaves from, and (with the node it
+	// leaves from as its NodeIndex) the list of the node it leads to.  When a node is contracted, it's taken out of its
+	// neighbors' lists, but its own lists are left alone.  All of its neighbors are still there then, so those are exactly
+	// its edges to more important nodes.
+	TArray< TArray< FStreetMapContractionHierarchyEdge > > OutEdges;
+	TArray< TArray< FStreetMapContractionHierarchyEdge > > InEdges;
+	OutEdges.SetNum( NumNodes );
+	InEdges.SetNum( NumNodes );
+
+	// Adds an edge between two nodes, unless there's one that is at least as cheap already
+	auto AddEdge = [&]( const int32 FromNodeIndex, FStreetMapContractionHierarchyEdge Edge )
+	{
+		const int32 ToNodeIndex = Edge.NodeIndex;
+		FStreetMapContractionHierarchyEdge* ExistingEdge = OutEdges[ FromNodeIndex ].FindByPredicate( [ToNodeIndex]( const FStreetMapContractionHierarchyEdge& OtherEdge ) { return OtherEdge.NodeIndex == ToNodeIndex; } );
+		if( ExistingEdge != nullptr )
+		{
+			if( ExistingEdge->Cost <= Edge.Cost )
+			{
+				return;
+			}
+			*ExistingEdge = Edge;
+		}
+		else
+		{
+			OutEdges[ FromNodeIndex ].Add( Edge );
+		}
+
+		Edge.NodeIndex = FromNodeIndex;
+		FStreetMapContractionHierarchyEdge* ExistingInEdge = InEdges[ ToNodeIndex ].FindByPredicate( [FromNodeIndex]( const FStreetMapContractionHierarchyEdge& OtherEdge ) { return OtherEdge.NodeIndex == FromNodeIndex; } );
+		if( ExistingInEdge != nullptr )
+		{
+			*ExistingInEdge = Edge;
+		}
+		else
+		{
+			InEdges[ ToNodeIndex ].Add( Edge );
+		}
+	};
+
+	for( int32 NodeIndex = 0; NodeIndex < NumNodes; ++NodeIndex )
+	{
+		for( const FStreetMapRoadGraphEdge& RoadGraphEdge : Graph.GetEdges( NodeIndex, true ) )
+		{
+			if( RoadGraphEdge.NodeIndex != NodeIndex )
+			{
+				FStreetMapContractionHierarchyEdge Edge;
+				Edge.NodeIndex = RoadGraphEdge.NodeIndex;
+				Edge.RoadIndex = RoadGraphEdge.RoadIndex;
+				Edge.FromPointIndexOnRoad = RoadGraphEdge.PointIndexOnRoad;
+				Edge.ToPointIndexOnRoad = RoadGraphEdge.ConnectedNodePointIndexOnRoad;
+				Edge.Cost = RoadGraphEdge.Cost;
+				Edge.Length = RoadGraphEdge.Length;
+				AddEdge( NodeIndex, Edge );
+			}
+		}
+	}
+
+	// Works out the shortcuts that contracting a node would need: one for every pair of neighbors whose cheapest route
+	// goes through the node.  Returns how many there are, and optionally what they are (paired with the node they leave from.)
+	auto FindShortcuts = [&]( const int32 NodeIndex, FStreetMapWitnessSearch& WitnessSearch, TArray< TPair< int32, FStreetMapContractionHierarchyEdge > >* OutShortcuts )
+	{
+		int32 NumShortcuts = 0;
+		for( const FStreetMapContractionHierarchyEdge& InEdge : InEdges[ NodeIndex ] )
+		{
+			float MaxCost = -1.0f;
+			for( const FStreetMapContractionHierarchyEdge& OutEdge : OutEdges[ NodeIndex ] )
+			{
+				if( OutEdge.NodeIndex != InEdge.NodeIndex )
+				{
+					MaxCost = FMath::Max( MaxCost, InEdge.Cost + OutEdge.Cost );
+				}
+			}
+			if( MaxCost < 0.0f )
+			{
+				continue;
+			}
+
+			WitnessSearch.Run( OutEdges, InEdge.NodeIndex, NodeIndex, MaxCost, MaxWitnessSettledNodes );
+
+			for( const FStreetMapContractionHierarchyEdge& OutEdge : OutEdges[ NodeIndex ] )
+			{
+				const float ShortcutCost = InEdge.Cost + OutEdge.Cost;
+				if( OutEdge.NodeIndex != InEdge.NodeIndex && WitnessSearch.GetCost( OutEdge.NodeIndex ) > ShortcutCost )
+				{
+					++NumShortcuts;
+					if( OutShortcuts != nullptr )
+					{
+						FStreetMapContractionHierarchyEdge Shortcut;
+						Shortcut.NodeIndex = OutEdge.NodeIndex;
+						Shortcut.MiddleNodeIndex = NodeIndex;
+						Shortcut.Cost = ShortcutCost;
+						Shortcut.Length = InEdge.Length + OutEdge.Length;
+						OutShortcuts->Emplace( InEdge.NodeIndex, Shortcut );
+					}
+				}
+			}
+		}
+		return NumShortcuts;
+	};
+
+	// Nodes that add the fewest shortcuts for the edges they take away are contracted first.  Counting neighbors that were
+	// contracted already spreads contraction evenly over the map, which keeps the hierarchy shallow.
+	TArray< int32 > NumContractedNeighbors;
+	NumContractedNeighbors.SetNumZeroed( NumNodes );
+	auto ComputePriority = [&]( const int32 NodeIndex, FStreetMapWitnessSearch& WitnessSearch )
+	{
+		return FindShortcuts( NodeIndex, WitnessSearch, nullptr ) - InEdges[ NodeIndex ].Num() - OutEdges[ NodeIndex ].Num() + NumContractedNeighbors[ NodeIndex ];
+	};
+
+	struct FQueuedNode
+	{
+		int32 Priority;
+		int32 NodeIndex;
+
+		bool operator<( const FQueuedNode& Other ) const
+		{
+			return Priority < Other.Priority;
+		}
+	};
+	TArray< FQueuedNode > Queue;
+	Queue.SetNumUninitialized( NumNodes );
+	{
+		// Working out the first priorities only reads the graph, so it can be done in parallel
+		const int32 NumBatches = FMath::DivideAndRoundUp( NumNodes, NodesPerPriorityBatch );
+		ParallelFor( NumBatches, [&]( const int32 BatchIndex )
+		{
+			FStreetMapWitnessSearch WitnessSearch;
+			const int32 EndNodeIndex = FMath::Min( ( BatchIndex + 1 ) * NodesPerPriorityBatch, NumNodes );
+			for( int32 NodeIndex = BatchIndex * NodesPerPriorityBatch; NodeIndex < EndNodeIndex; ++NodeIndex )
+			{
+				Queue[ NodeIndex ] = FQueuedNode{ ComputePriority( NodeIndex, WitnessSearch ), NodeIndex };
+			}
+		} );
+	}
+	Queue.Heapify();
+
+	NodeRanks.SetNumUninitialized( NumNodes );
+	int32 NextRank = 0;
+	FStreetMapWitnessSearch WitnessSearch;
+	TArray< TPair< int32, FStreetMapContractionHierarchyEdge > > Shortcuts;
+	while( Queue.Num() > 0 )
+	{
+		FQueuedNode QueuedNode;
+		Queue.HeapPop( QueuedNode, /* bAllowShrinking */ false );
+		const int32 NodeIndex = QueuedNode.NodeIndex;
+
+		// Priorities go stale as neighbors are contracted.  Only contract this node if it's still the best choice.
+		const int32 Priority = ComputePriority( NodeIndex, WitnessSearch );
+		if( Queue.Num() > 0 && Priority > Queue.HeapTop().Priority )
+		{
+			Queue.HeapPush( FQueuedNode{ Priority, NodeIndex } );
+			continue;
+		}
+
+		Shortcuts.Reset();
+		FindShortcuts( NodeIndex, WitnessSearch, &Shortcuts );
+
+		NodeRanks[ NodeIndex ] = NextRank++;
+
+		for( const FStreetMapContractionHierarchyEdge& InEdge : InEdges[ NodeIndex ] )
+		{
+			OutEdges[ InEdge.NodeIndex ].RemoveAllSwap( [NodeIndex]( const FStreetMapContractionHierarchyEdge& Edge ) { return Edge.NodeIndex == NodeIndex; } );
+			++NumContractedNeighbors[ InEdge.NodeIndex ];
+		}
+		for( const FStreetMapContractionHierarchyEdge& OutEdge : OutEdges[ NodeIndex ] )
+		{
+			InEdges[ OutEdge.NodeIndex ].RemoveAllSwap( [NodeIndex]( const FStreetMapContractionHierarchyEdge& Edge ) { return Edge.NodeIndex == NodeIndex; } );
+			++NumContractedNeighbors[ OutEdge.NodeIndex ];
+		}
+
+		for( const TPair< int32, FStreetMapContractionHierarchyEdge >& Shortcut : Shortcuts )
+		{
+			AddEdge( Shortcut.Key, Shortcut.Value );
+		}
+	}
+
+	// Every node's lists now hold its edges to more important nodes.  Pack them into flat arrays.
+	auto FlattenEdges = [NumNodes]( const TArray< TArray< FStreetMapContractionHierarchyEdge > >& NodeEdges, TArray< int32 >& OutFirstEdgeIndices, TArray< FStreetMapContractionHierarchyEdge >& OutFlatEdges )
+	{
+		OutFirstEdgeIndices.SetNumUninitialized( NumNodes + 1 );
+		int32 NumEdgesSoFar = 0;
+		for( int32 NodeIndex = 0; NodeIndex < NumNodes; ++NodeIndex )
+		{
+			OutFirstEdgeIndices[ NodeIndex ] = NumEdgesSoFar;
+			NumEdgesSoFar += NodeEdges[ NodeIndex ].Num();
+		}
+		OutFirstEdgeIndices[ NumNodes ] = NumEdgesSoFar;
+
+		OutFlatEdges.Reset( NumEdgesSoFar );
+		for( const TArray< FStreetMapContractionHierarchyEdge >& Edges : NodeEdges )
+		{
+			OutFlatEdges.Append( Edges );
+		}
+	};
+	FlattenEdges( OutEdges, FirstForwardEdgeIndices, ForwardEdges );
+	FlattenEdges( InEdges, FirstBackwardEdgeIndices, BackwardEdges );
+
+	RoadGraphChecksum = Graph.GetChecksum();
+}
+
+
+void FStreetMapContractionHierarchy::Reset()
+{
+	NodeRanks.Empty();
+	FirstForwardEdgeIndices.Empty();
+	ForwardEdges.Empty();
+	FirstBackwardEdgeIndices.Empty();
+	BackwardEdges.Empty();
+	RoadGraphChecksum = 0;
+}
+
+
+const FStreetMapContractionHierarchyEdge* FStreetMapContractionHierarchy::FindEdge( const int32 FromNodeIndex, const int32 ToNodeIndex ) const
+{
+	// Edges are kept by whichever of their nodes is less important
+	if( NodeRanks[ FromNodeIndex ] < NodeRanks[ ToNodeIndex ] )
+	{
+		for( const FStreetMapContractionHierarchyEdge& Edge : GetUpwardEdges( FromNodeIndex, true ) )
+		{
+			if( Edge.NodeIndex == ToNodeIndex )
+			{
+				return &Edge;
+			}
+		}
+	}
+	else
+	{
+		for( const FStreetMapContractionHierarchyEdge& Edge : GetUpwardEdges( ToNodeIndex, false ) )
+		{
+			if( Edge.NodeIndex == FromNodeIndex )
+			{
+				return &Edge;
+			}
+		}
+	}
+	return nullptr;
+}
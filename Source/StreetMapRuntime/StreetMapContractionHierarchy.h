@@ -0,0 +1,127 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "StreetMapRuntime.h"
+#include "StreetMapRoadGraph.h"
+#include "Containers/ArrayView.h"
+#include "StreetMapContractionHierarchy.generated.h"
+
+
+/**
+ * A connection in a contraction hierarchy.  Either follows a road between two neighboring nodes, or is a shortcut that
+ * stands in for the cheapest route through a less important node.
+ */
+USTRUCT()
+struct STREETMAPRUNTIME_API FStreetMapContractionHierarchyEdge
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** The node at the other end of this edge */
+	UPROPERTY()
+	int32 NodeIndex = INDEX_NONE;
+
+	/** For shortcuts, the node that the shortcut passes through.  INDEX_NONE for edges that follow a road. */
+	UPROPERTY()
+	int32 MiddleNodeIndex = INDEX_NONE;
+
+	/** For edges that follow a road, the road */
+	UPROPERTY()
+	int32 RoadIndex = INDEX_NONE;
+
+	/** For edges that follow a road, where the edge starts on the road, in the direction of travel */
+	UPROPERTY()
+	int32 FromPointIndexOnRoad = INDEX_NONE;
+
+	/** For edges that follow a road, where the edge ends on the road, in the direction of travel */
+	UPROPERTY()
+	int32 ToPointIndexOnRoad = INDEX_NONE;
+
+	/** Estimated cost of traveling the edge */
+	UPROPERTY()
+	float Cost = 0.0f;
+
+	/** Distance along the roads the edge stands for */
+	UPROPERTY()
+	float Length = 0.0f;
+};
+
+
+/**
+ * Contraction hierarchy over a street map's road graph, for answering route queries while visiting only a tiny part
+ * of the map.  Nodes are ranked by importance, and every node keeps only its edges to more important nodes, along with
+ * shortcuts that preserve the cheapest routes around the less important nodes that were removed.  A route query searches
+ * upward from both ends and meets at the most important node on the route.
+ *
+ * Building a hierarchy is slow for large maps, so it's done when the street map is imported (when asked for) and saved
+ * with the street map.
+ */
+USTRUCT()
+struct STREETMAPRUNTIME_API FStreetMapContractionHierarchy
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Builds the hierarchy over a road graph, replacing anything that was there */
+	void Build( const FStreetMapRoadGraph& Graph );
+
+	/** Empties the hierarchy */
+	void Reset();
+
+	/** Returns the number of nodes the hierarchy was built with.  Zero if it hasn't been built. */
+	int32 GetNumNodes() const
+	{
+		return NodeRanks.Num();
+	}
+
+	/** Returns true if the hierarchy was built from a road graph with the same connections as this one */
+	bool IsBuiltFrom( const FStreetMapRoadGraph& Graph ) const
+	{
+		return GetNumNodes() > 0 && GetNumNodes() == Graph.GetNumNodes() && RoadGraphChecksum == Graph.GetChecksum();
+	}
+
+	/** Returns how important a node is.  Higher ranks are more important. */
+	int32 GetNodeRank( const int32 NodeIndex ) const
+	{
+		return NodeRanks[ NodeIndex ];
+	}
+
+	/**
+	 * Returns a node's edges to more important nodes.  Traveling forward, edges lead from this node to the edge's node.
+	 * Traveling backward, edges lead from the edge's node to this node.
+	 */
+	TArrayView< const FStreetMapContractionHierarchyEdge > GetUpwardEdges( const int32 NodeIndex, const bool bIsTravelingForward ) const
+	{
+		const TArray< int32 >& FirstEdgeIndices = bIsTravelingForward ? FirstForwardEdgeIndices : FirstBackwardEdgeIndices;
+		const TArray< FStreetMapContractionHierarchyEdge >& Edges = bIsTravelingForward ? ForwardEdges : BackwardEdges;
+		return TArrayView< const FStreetMapContractionHierarchyEdge >( Edges.GetData() + FirstEdgeIndices[ NodeIndex ], FirstEdgeIndices[ NodeIndex + 1 ] - FirstEdgeIndices[ NodeIndex ] );
+	}
+
+	/** Finds the edge leading from one node to another, or nullptr if they aren't directly connected in the hierarchy */
+	const FStreetMapContractionHierarchyEdge* FindEdge( const int32 FromNodeIndex, const int32 ToNodeIndex ) const;
+
+
+private:
+
+	/** Importance of every node */
+	UPROPERTY()
+	TArray< int32 > NodeRanks;
+
+	/** Where each node's upward forward edges start.  There is one extra entry at the end. */
+	UPROPERTY()
+	TArray< int32 > FirstForwardEdgeIndices;
+
+	/** Every node's upward forward edges, one node after another */
+	UPROPERTY()
+	TArray< FStreetMapContractionHierarchyEdge > ForwardEdges;
+
+	/** Where each node's upward backward edges start.  There is one extra entry at the end. */
+	UPROPERTY()
+	TArray< int32 > FirstBackwardEdgeIndices;
+
+	/** Every node's upward backward edges, one node after another */
+	UPROPERTY()
+	TArray< FStreetMapContractionHierarchyEdge > BackwardEdges;
+
+	/** Checksum of the road graph the hierarchy was built from (see FStreetMapRoadGraph::GetChecksum()) */
+	UPROPERTY()
+	uint32 RoadGraphChecksum = 0;
+};
@@ -0,0 +1,227 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapRouting.h"
+#include "StreetMapRouteSearch.h"
+#include "Async/ParallelFor.h"
+
+
+/** Returns true if every node index is on a graph with this many nodes */
+static bool AreNodeIndicesValid( const TArray< int32 >& NodeIndices, const int32 NumNodes )
+{
+	for( const int32 NodeIndex : NodeIndices )
+	{
+		if( NodeIndex < 0 || NodeIndex >= NumNodes )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+/** Sizes a cost matrix for these sources and targets, with every target unreachable until a route to it is found */
+static void InitCostMatrix( const int32 NumSources, const int32 NumTargets, FStreetMapCostMatrix& OutCostMatrix )
+{
+	OutCostMatrix.NumSources = NumSources;
+	OutCostMatrix.NumTargets = NumTargets;
+	OutCostMatrix.Costs.Reset();
+	OutCostMatrix.Costs.Init( TNumericLimits< float >::Max(), NumSources * NumTargets );
+}
+
+
+bool FStreetMapRouter::ComputeCostMatrix( const FStreetMapRoadGraph& Graph, const TArray< int32 >& SourceNodeIndices, const TArray< int32 >& TargetNodeIndices, FStreetMapCostMatrix& OutCostMatrix ) const
+{
+	OutCostMatrix.Reset();
+
+	const int32 NumNodes = Graph.GetNumNodes();
+	if( !AreNodeIndicesValid( SourceNodeIndices, NumNodes ) || !AreNodeIndicesValid( TargetNodeIndices, NumNodes ) )
+	{
+		return false;
+	}
+
+	const int32 NumSources = SourceNodeIndices.Num();
+	const int32 NumTargets = TargetNodeIndices.Num();
+	InitCostMatrix( NumSources, NumTargets, OutCostMatrix );
+	if( NumSources == 0 || NumTargets == 0 )
+	{
+		return true;
+	}
+
+	// Mark the targets, so that each search can tell when it has reached all of them.  The same node can be asked for
+	// more than once.
+	TBitArray<> IsTargetNode( false, NumNodes );
+	int32 NumUniqueTargets = 0;
+	for( const int32 TargetNodeIndex : TargetNodeIndices )
+	{
+		if( !IsTargetNode[ TargetNodeIndex ] )
+		{
+			IsTargetNode[ TargetNodeIndex ] = true;
+			++NumUniqueTargets;
+		}
+	}
+
+	// Each source gets a Dijkstra search of its own.  Searches only share the (read only) graph, and each fills in its own row.
+	ParallelFor( NumSources, [&]( const int32 SourceIndex )
+	{
+		TUniquePtr< FStreetMapRouteSearchState > SearchState = AcquireSearchState();
+		FStreetMapRouteSearchDirection& Search = SearchState->Forward;
+
+		Search.Begin( NumNodes );
+		Search.Reach( SourceNodeIndices[ SourceIndex ], 0.0f, INDEX_NONE, 0.0f );
+
+		int32 NumUnsettledTargets = NumUniqueTargets;
+		for( int32 NodeIndex = Search.SettleNext(); NodeIndex != INDEX_NONE; NodeIndex = Search.SettleNext() )
+		{
+			if( IsTargetNode[ NodeIndex ] && --NumUnsettledTargets == 0 )
+			{
+				break;
+			}
+
+			const float NodeCost = Search.Costs[ NodeIndex ];
+			for( const FStreetMapRoadGraphEdge& Edge : Graph.GetEdges( NodeIndex, true ) )
+			{
+				const float NewCost = NodeCost + Edge.Cost;
+				if( !Search.IsSettled( Edge.NodeIndex ) && ( !Search.IsReached( Edge.NodeIndex ) || NewCost < Search.Costs[ Edge.NodeIndex ] ) )
+				{
+					Search.Reach( Edge.NodeIndex, NewCost, NodeIndex, NewCost );
+				}
+			}
+		}
+
+		float* Row = OutCostMatrix.Costs.GetData() + SourceIndex * NumTargets;
+		for( int32 TargetIndex = 0; TargetIndex < NumTargets; ++TargetIndex )
+		{
+			const int32 TargetNodeIndex = TargetNodeIndices[ TargetIndex ];
+			if( Search.IsSettled( TargetNodeIndex ) )
+			{
+				Row[ TargetIndex ] = Search.Costs[ TargetNodeIndex ];
+			}
+		}
+
+		ReleaseSearchState( MoveTemp( SearchState ) );
+	} );
+
+	return true;
+}
+
+
+bool FStreetMapRouter::ComputeCostMatrix( const FStreetMapContractionHierarchy& Hierarchy, const TArray< int32 >& SourceNodeIndices, const TArray< int32 >& TargetNodeIndices, FStreetMapCostMatrix& OutCostMatrix ) const
+{
+	OutCostMatrix.Reset();
+
+	const int32 NumNodes = Hierarchy.GetNumNodes();
+	if( !AreNodeIndicesValid( SourceNodeIndices, NumNodes ) || !AreNodeIndicesValid( TargetNodeIndices, NumNodes ) )
+	{
+		return false;
+	}
+
+	const int32 NumSources = SourceNodeIndices.Num();
+	const int32 NumTargets = TargetNodeIndices.Num();
+	InitCostMatrix( NumSources, NumTargets, OutCostMatrix );
+	if( NumSources == 0 || NumTargets == 0 )
+	{
+		return true;
+	}
+
+	struct FBucketEntry
+	{
+		int32 TargetIndex;
+		float Cost;
+	};
+
+	// Search up the hierarchy from every target, against the direction of travel.  Every node a search settles gets the
+	// cost of getting from that node up to the target.
+	// @todo: Stalling nodes that can be reached more cheaply from above would make the search spaces (and buckets) smaller
+	TArray< TArray< TPair< int32, float > > > TargetSearchSpaces;
+	TargetSearchSpaces.SetNum( NumTargets );
+	ParallelFor( NumTargets, [&]( const int32 TargetIndex )
+	{
+		TUniquePtr< FStreetMapRouteSearchState > SearchState = AcquireSearchState();
+		FStreetMapRouteSearchDirection& Search = SearchState->Backward;
+
+		Search.Begin( NumNodes );
+		Search.Reach( TargetNodeIndices[ TargetIndex ], 0.0f, INDEX_NONE, 0.0f );
+
+		TArray< TPair< int32, float > >& SearchSpace = TargetSearchSpaces[ TargetIndex ];
+		for( int32 NodeIndex = Search.SettleNext(); NodeIndex != INDEX_NONE; NodeIndex = Search.SettleNext() )
+		{
+			const float NodeCost = Search.Costs[ NodeIndex ];
+			SearchSpace.Emplace( NodeIndex, NodeCost );
+
+			for( const FStreetMapContractionHierarchyEdge& Edge : Hierarchy.GetUpwardEdges( NodeIndex, false ) )
+			{
+				const float NewCost = NodeCost + Edge.Cost;
+				if( !Search.IsSettled( Edge.NodeIndex ) && ( !Search.IsReached( Edge.NodeIndex ) || NewCost < Search.Costs[ Edge.NodeIndex ] ) )
+				{
+					Search.Reach( Edge.NodeIndex, NewCost, NodeIndex, NewCost );
+				}
+			}
+		}
+
+		ReleaseSearchState( MoveTemp( SearchState ) );
+	} );
+
+	// Gather the search spaces into a bucket for each node, laid out the same way as the graph's edges
+	TArray< int32 > FirstBucketEntryIndices;
+	TArray< FBucketEntry > BucketEntries;
+	{
+		FirstBucketEntryIndices.SetNumZeroed( NumNodes + 1 );
+		for( const TArray< TPair< int32, float > >& SearchSpace : TargetSearchSpaces )
+		{
+			for( const TPair< int32, float >& Settled : SearchSpace )
+			{
+				++FirstBucketEntryIndices[ Settled.Key + 1 ];
+			}
+		}
+		for( int32 NodeIndex = 0; NodeIndex < NumNodes; ++NodeIndex )
+		{
+			FirstBucketEntryIndices[ NodeIndex + 1 ] += FirstBucketEntryIndices[ NodeIndex ];
+		}
+
+		TArray< int32 > NextBucketEntryIndices( FirstBucketEntryIndices );
+		BucketEntries.SetNumUninitialized( FirstBucketEntryIndices[ NumNodes ] );
+		for( int32 TargetIndex = 0; TargetIndex < NumTargets; ++TargetIndex )
+		{
+			for( const TPair< int32, float >& Settled : TargetSearchSpaces[ TargetIndex ] )
+			{
+				BucketEntries[ NextBucketEntryIndices[ Settled.Key ]++ ] = FBucketEntry{ TargetIndex, Settled.Value };
+			}
+		}
+	}
+	TargetSearchSpaces.Empty();
+
+	// Search up the hierarchy from every source.  The cheapest route to a target goes up to some node in the target's
+	// search space, so checking the buckets of every node settled on the way up finds it.
+	ParallelFor( NumSources, [&]( const int32 SourceIndex )
+	{
+		TUniquePtr< FStreetMapRouteSearchState > SearchState = AcquireSearchState();
+		FStreetMapRouteSearchDirection& Search = SearchState->Forward;
+
+		Search.Begin( NumNodes );
+		Search.Reach( SourceNodeIndices[ SourceIndex ], 0.0f, INDEX_NONE, 0.0f );
+
+		float* Row = OutCostMatrix.Costs.GetData() + SourceIndex * NumTargets;
+		for( int32 NodeIndex = Search.SettleNext(); NodeIndex != INDEX_NONE; NodeIndex = Search.SettleNext() )
+		{
+			const float NodeCost = Search.Costs[ NodeIndex ];
+			for( int32 BucketEntryIndex = FirstBucketEntryIndices[ NodeIndex ]; BucketEntryIndex < FirstBucketEntryIndices[ NodeIndex + 1 ]; ++BucketEntryIndex )
+			{
+				const FBucketEntry& BucketEntry = BucketEntries[ BucketEntryIndex ];
+				Row[ BucketEntry.TargetIndex ] = FMath::Min( Row[ BucketEntry.TargetIndex ], NodeCost + BucketEntry.Cost );
+			}
+
+			for( const FStreetMapContractionHierarchyEdge& Edge : Hierarchy.GetUpwardEdges( NodeIndex, true ) )
+			{
+				const float NewCost = NodeCost + Edge.Cost;
+				if( !Search.IsSettled( Edge.NodeIndex ) && ( !Search.IsReached( Edge.NodeIndex ) || NewCost < Search.Costs[ Edge.NodeIndex ] ) )
+				{
+					Search.Reach( Edge.NodeIndex, NewCost, NodeIndex, NewCost );
+				}
+			}
+		}
+
+		ReleaseSearchState( MoveTemp( SearchState ) );
+	} );
+
+	return true;
+}
@@ -0,0 +1,290 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapRouting.h"
+#include "StreetMapRouteSearch.h"
+#include "StreetMap.h"
+
+
+/** A road that a recorded position could have been on */
+struct FStreetMapMatchCandidate
+{
+	/** Where on the road */
+	FStreetMapRoadSegmentHit Hit;
+
+	/** The nearest node before the candidate's position on the road, and how far back it is.  INDEX_NONE if there isn't one. */
+	int32 EarlierNodeIndex;
+	float EarlierNodeDistance;
+
+	/** The nearest node after the candidate's position on the road, and how far ahead it is.  INDEX_NONE if there isn't one. */
+	int32 LaterNodeIndex;
+	float LaterNodeDistance;
+
+	/** Log likelihood of the most likely sequence of candidates that ends with this one */
+	float Score;
+
+	/** The candidate before this one in that sequence.  INDEX_NONE if the sequence starts here. */
+	int32 ParentCandidateIndex;
+};
+
+
+/**
+ * Works out how far a vehicle would drive from one candidate to each of the candidates for the next position.  Only looks
+ * as far as the maximum distance; candidates further than that are left at the largest float.
+ */
+static void ComputeMatchRouteDistances( const UStreetMap& StreetMap, const FStreetMapMatchCandidate& From, const TArrayView< const FStreetMapMatchCandidate > ToCandidates, const float MaxRouteDistance, FStreetMapRouteSearchDirection& Search, TArray< float >& OutRouteDistances )
+{
+	const TArray<FStreetMapRoad>& Roads = StreetMap.GetRoads();
+	const FStreetMapRoadGraph& Graph = StreetMap.GetRoadGraph();
+	const bool bIsFromRoadOneWay = Roads[ From.Hit.RoadIndex ].IsOneWay();
+
+	OutRouteDistances.Reset();
+	OutRouteDistances.Init( TNumericLimits< float >::Max(), ToCandidates.Num() );
+
+	// Staying on the same road doesn't need a search.  This also covers candidates on the same stretch of road between two nodes.
+	for( int32 ToIndex = 0; ToIndex < ToCandidates.Num(); ++ToIndex )
+	{
+		const FStreetMapMatchCandidate& To = ToCandidates[ ToIndex ];
+		if( To.Hit.RoadIndex == From.Hit.RoadIndex )
+		{
+			const float Distance = To.Hit.PositionAlongRoad - From.Hit.PositionAlongRoad;
+			if( Distance >= 0.0f || !bIsFromRoadOneWay )
+			{
+				OutRouteDistances[ ToIndex ] = FMath::Abs( Distance );
+			}
+		}
+	}
+
+	// Otherwise, search the road graph outward from the nodes either side of where we start, until we've reached the nodes
+	// either side of every candidate or gone too far
+	Search.Begin( Graph.GetNumNodes() );
+	if( From.LaterNodeIndex != INDEX_NONE )
+	{
+		Search.Reach( From.LaterNodeIndex, From.LaterNodeDistance, INDEX_NONE, From.LaterNodeDistance );
+	}
+	if( !bIsFromRoadOneWay && From.EarlierNodeIndex != INDEX_NONE && ( !Search.IsReached( From.EarlierNodeIndex ) || From.EarlierNodeDistance < Search.Costs[ From.EarlierNodeIndex ] ) )
+	{
+		Search.Reach( From.EarlierNodeIndex, From.EarlierNodeDistance, INDEX_NONE, From.EarlierNodeDistance );
+	}
+
+	int32 NumUnsettledTargets = 0;
+	for( const FStreetMapMatchCandidate& To : ToCandidates )
+	{
+		NumUnsettledTargets += ( To.EarlierNodeIndex != INDEX_NONE ) ? 1 : 0;
+		NumUnsettledTargets += ( To.LaterNodeIndex != INDEX_NONE && !Roads[ To.Hit.RoadIndex ].IsOneWay() ) ? 1 : 0;
+	}
+
+	for( int32 NodeIndex = Search.SettleNext(); NodeIndex != INDEX_NONE && NumUnsettledTargets > 0; NodeIndex = Search.SettleNext() )
+	{
+		const float NodeDistance = Search.Costs[ NodeIndex ];
+		if( NodeDistance > MaxRouteDistance )
+		{
+			break;
+		}
+
+		for( const FStreetMapMatchCandidate& To : ToCandidates )
+		{
+			NumUnsettledTargets -= ( To.EarlierNodeIndex == NodeIndex ) ? 1 : 0;
+			NumUnsettledTargets -= ( To.LaterNodeIndex == NodeIndex && !Roads[ To.Hit.RoadIndex ].IsOneWay() ) ? 1 : 0;
+		}
+
+		for( const FStreetMapRoadGraphEdge& Edge : Graph.GetEdges( NodeIndex, true ) )
+		{
+			const float NewDistance = NodeDistance + Edge.Length;
+			if( !Search.IsSettled( Edge.NodeIndex ) && ( !Search.IsReached( Edge.NodeIndex ) || NewDistance < Search.Costs[ Edge.NodeIndex ] ) )
+			{
+				Search.Reach( Edge.NodeIndex, NewDistance, NodeIndex, NewDistance );
+			}
+		}
+	}
+
+	// Finish each route along the candidate's road.  Nodes that were only reached (not settled) have a usable, if maybe
+	// longer than necessary, distance.
+	for( int32 ToIndex = 0; ToIndex < ToCandidates.Num(); ++ToIndex )
+	{
+		const FStreetMapMatchCandidate& To = ToCandidates[ ToIndex ];
+		float& RouteDistance = OutRouteDistances[ ToIndex ];
+		if( To.EarlierNodeIndex != INDEX_NONE && Search.IsReached( To.EarlierNodeIndex ) )
+		{
+			RouteDistance = FMath::Min( RouteDistance, Search.Costs[ To.EarlierNodeIndex ] + To.EarlierNodeDistance );
+		}
+		if( To.LaterNodeIndex != INDEX_NONE && Search.IsReached( To.LaterNodeIndex ) && !Roads[ To.Hit.RoadIndex ].IsOneWay() )
+		{
+			RouteDistance = FMath::Min( RouteDistance, Search.Costs[ To.LaterNodeIndex ] + To.LaterNodeDistance );
+		}
+		if( RouteDistance > MaxRouteDistance )
+		{
+			RouteDistance = TNumericLimits< float >::Max();
+		}
+	}
+}
+
+
+bool FStreetMapRouter::MatchTrace( const UStreetMap& StreetMap, const TArray< FVector2D >& Positions, const FStreetMapMapMatchingSettings& Settings, TArray< FStreetMapMatchedPoint >& OutMatchedPoints ) const
+{
+	const TArray<FStreetMapRoad>& Roads = StreetMap.GetRoads();
+	const int32 NumPositions = Positions.Num();
+	const int32 MaxCandidatesPerPoint = FMath::Max( 1, Settings.MaxCandidatesPerPoint );
+	const float PositionErrorStandardDeviation = FMath::Max( 1.0f, Settings.PositionErrorStandardDeviation );
+	const float RouteDistanceDifferenceScale = FMath::Max( 1.0f, Settings.RouteDistanceDifferenceScale );
+
+	OutMatchedPoints.Reset();
+	OutMatchedPoints.SetNum( NumPositions );
+
+	// Gather the candidate roads near each position.  A road can pass near a position more than once, but only its nearest
+	// segment is worth considering.
+	TArray< FStreetMapMatchCandidate > Candidates;
+	TArray< int32 > FirstCandidateIndices;
+	FirstCandidateIndices.SetNumUninitialized( NumPositions + 1 );
+	{
+		TArray< FStreetMapRoadSegmentHit > Hits;
+		for( int32 PositionIndex = 0; PositionIndex < NumPositions; ++PositionIndex )
+		{
+			FirstCandidateIndices[ PositionIndex ] = Candidates.Num();
+
+			StreetMap.GetSpatialIndex().FindNearestRoads( StreetMap, Positions[ PositionIndex ], Settings.SearchRadius, MaxCandidatesPerPoint, Hits );
+			for( const FStreetMapRoadSegmentHit& Hit : Hits )
+			{
+				FStreetMapMatchCandidate& Candidate = Candidates[ Candidates.AddUninitialized() ];
+				Candidate.Hit = Hit;
+				Candidate.Score = -TNumericLimits< float >::Max();
+				Candidate.ParentCandidateIndex = INDEX_NONE;
+
+				const FStreetMapRoad& Road = Roads[ Hit.RoadIndex ];
+				int32 EarlierPointIndex = Hit.PointIndex;
+				while( EarlierPointIndex >= 0 && Road.NodeIndices[ EarlierPointIndex ] == INDEX_NONE )
+				{
+					--EarlierPointIndex;
+				}
+				int32 LaterPointIndex = Hit.PointIndex + 1;
+				while( LaterPointIndex < Road.NodeIndices.Num() && Road.NodeIndices[ LaterPointIndex ] == INDEX_NONE )
+				{
+					++LaterPointIndex;
+				}
+
+				Candidate.EarlierNodeIndex = ( EarlierPointIndex >= 0 ) ? Road.NodeIndices[ EarlierPointIndex ] : INDEX_NONE;
+				Candidate.EarlierNodeDistance = ( EarlierPointIndex >= 0 ) ? Hit.PositionAlongRoad - Road.PointPositionsAlongRoad[ EarlierPointIndex ] : 0.0f;
+				Candidate.LaterNodeIndex = ( LaterPointIndex < Road.NodeIndices.Num() ) ? Road.NodeIndices[ LaterPointIndex ] : INDEX_NONE;
+				Candidate.LaterNodeDistance = ( LaterPointIndex < Road.NodeIndices.Num() ) ? Road.PointPositionsAlongRoad[ LaterPointIndex ] - Hit.PositionAlongRoad : 0.0f;
+			}
+		}
+		FirstCandidateIndices[ NumPositions ] = Candidates.Num();
+	}
+
+	auto GetCandidates = [&Candidates, &FirstCandidateIndices]( const int32 PositionIndex )
+	{
+		return TArrayView< FStreetMapMatchCandidate >( Candidates.GetData() + FirstCandidateIndices[ PositionIndex ], FirstCandidateIndices[ PositionIndex + 1 ] - FirstCandidateIndices[ PositionIndex ] );
+	};
+
+	auto ComputeEmissionScore = [PositionErrorStandardDeviation]( const FStreetMapMatchCandidate& Candidate )
+	{
+		return -0.5f * FMath::Square( Candidate.Hit.Distance / PositionErrorStandardDeviation );
+	};
+
+	// Follows the most likely sequence back from the last position of a chain, filling in where each position was matched to
+	bool bAnyMatched = false;
+	auto FinishChain = [&]( const int32 LastPositionIndex )
+	{
+		int32 BestCandidateIndex = INDEX_NONE;
+		for( int32 CandidateIndex = FirstCandidateIndices[ LastPositionIndex ]; CandidateIndex < FirstCandidateIndices[ LastPositionIndex + 1 ]; ++CandidateIndex )
+		{
+			if( BestCandidateIndex == INDEX_NONE || Candidates[ CandidateIndex ].Score > Candidates[ BestCandidateIndex ].Score )
+			{
+				BestCandidateIndex = CandidateIndex;
+			}
+		}
+
+		int32 PositionIndex = LastPositionIndex;
+		for( int32 CandidateIndex = BestCandidateIndex; CandidateIndex != INDEX_NONE; CandidateIndex = Candidates[ CandidateIndex ].ParentCandidateIndex )
+		{
+			const FStreetMapRoadSegmentHit& Hit = Candidates[ CandidateIndex ].Hit;
+			FStreetMapMatchedPoint& MatchedPoint = OutMatchedPoints[ PositionIndex-- ];
+			MatchedPoint.RoadIndex = Hit.RoadIndex;
+			MatchedPoint.PointIndex = Hit.PointIndex;
+			MatchedPoint.Location = Hit.Location;
+			MatchedPoint.PositionAlongRoad = Hit.PositionAlongRoad;
+			MatchedPoint.Distance = Hit.Distance;
+			bAnyMatched = true;
+		}
+	};
+
+	// Viterbi.  Each candidate keeps the score of the most likely sequence ending with it, and which candidate came before.
+	TUniquePtr< FStreetMapRouteSearchState > SearchState = AcquireSearchState();
+	TArray< float > RouteDistances;
+
+	int32 ChainEndPositionIndex = INDEX_NONE;
+	for( int32 PositionIndex = 0; PositionIndex < NumPositions; ++PositionIndex )
+	{
+		const TArrayView< FStreetMapMatchCandidate > CurrentCandidates = GetCandidates( PositionIndex );
+		if( CurrentCandidates.Num() == 0 )
+		{
+			// Nothing nearby, so the position stays unmatched, and matching starts over after it
+			if( ChainEndPositionIndex != INDEX_NONE )
+			{
+				FinishChain( ChainEndPositionIndex );
+				ChainEndPositionIndex = INDEX_NONE;
+			}
+			continue;
+		}
+
+		bool bIsConnected = false;
+		if( ChainEndPositionIndex != INDEX_NONE )
+		{
+			const float StraightDistance = FVector2D::Distance( Positions[ PositionIndex - 1 ], Positions[ PositionIndex ] );
+			const float MaxRouteDistance = StraightDistance * Settings.MaxDetourFactor + 2.0f * Settings.SearchRadius;
+
+			const int32 FirstPreviousCandidateIndex = FirstCandidateIndices[ PositionIndex - 1 ];
+			for( int32 PreviousCandidateIndex = FirstPreviousCandidateIndex; PreviousCandidateIndex < FirstCandidateIndices[ PositionIndex ]; ++PreviousCandidateIndex )
+			{
+				const FStreetMapMatchCandidate& PreviousCandidate = Candidates[ PreviousCandidateIndex ];
+				if( PreviousCandidate.Score == -TNumericLimits< float >::Max() )
+				{
+					continue;
+				}
+
+				ComputeMatchRouteDistances( StreetMap, PreviousCandidate, CurrentCandidates, MaxRouteDistance, SearchState->Forward, RouteDistances );
+				for( int32 CurrentIndex = 0; CurrentIndex < CurrentCandidates.Num(); ++CurrentIndex )
+				{
+					if( RouteDistances[ CurrentIndex ] == TNumericLimits< float >::Max() )
+					{
+						continue;
+					}
+
+					FStreetMapMatchCandidate& Candidate = CurrentCandidates[ CurrentIndex ];
+					const float TransitionScore = -FMath::Abs( RouteDistances[ CurrentIndex ] - StraightDistance ) / RouteDistanceDifferenceScale;
+					const float Score = PreviousCandidate.Score + TransitionScore + ComputeEmissionScore( Candidate );
+					if( Score > Candidate.Score )
+					{
+						Candidate.Score = Score;
+						Candidate.ParentCandidateIndex = PreviousCandidateIndex;
+						bIsConnected = true;
+					}
+				}
+			}
+
+			if( !bIsConnected )
+			{
+				// No way to drive here from anywhere the last position could have been.  Keep what was matched so far,
+				// and start over.
+				FinishChain( ChainEndPositionIndex );
+			}
+		}
+
+		if( !bIsConnected )
+		{
+			for( FStreetMapMatchCandidate& Candidate : CurrentCandidates )
+			{
+				Candidate.Score = ComputeEmissionScore( Candidate );
+				Candidate.ParentCandidateIndex = INDEX_NONE;
+			}
+		}
+		ChainEndPositionIndex = PositionIndex;
+	}
+
+	if( ChainEndPositionIndex != INDEX_NONE )
+	{
+		FinishChain( ChainEndPositionIndex );
+	}
+
+	ReleaseSearchState( MoveTemp( SearchState ) );
+	return bAnyMatched;
+}
@@ -0,0 +1,70 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "StreetMapRuntime.h"
+#include "StreetMapMapMatching.generated.h"
+
+
+/** Tunables for matching recorded positions to roads.  Distances are in street map units (centimeters.) */
+USTRUCT( BlueprintType )
+struct STREETMAPRUNTIME_API FStreetMapMapMatchingSettings
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** How far from a recorded position to look for roads it could have been on */
+	UPROPERTY( Category=StreetMap, EditAnywhere, BlueprintReadWrite, meta=(ClampMin="0") )
+	float SearchRadius = 5000.0f;
+
+	/** Most roads to consider for each recorded position.  The nearest ones are kept. */
+	UPROPERTY( Category=StreetMap, EditAnywhere, BlueprintReadWrite, meta=(ClampMin="1") )
+	int32 MaxCandidatesPerPoint = 8;
+
+	/** How far off recorded positions typically are from where the vehicle really was */
+	UPROPERTY( Category=StreetMap, EditAnywhere, BlueprintReadWrite, meta=(ClampMin="1") )
+	float PositionErrorStandardDeviation = 500.0f;
+
+	/**
+	 * How much the distance driven between two positions is expected to differ from the straight line between them.  Larger
+	 * values tolerate more roundabout routes between positions.
+	 */
+	UPROPERTY( Category=StreetMap, EditAnywhere, BlueprintReadWrite, meta=(ClampMin="1") )
+	float RouteDistanceDifferenceScale = 500.0f;
+
+	/** Routes between two positions longer than this many times the straight line between them (plus the search radius) aren't considered */
+	UPROPERTY( Category=StreetMap, EditAnywhere, BlueprintReadWrite, meta=(ClampMin="1") )
+	float MaxDetourFactor = 3.0f;
+};
+
+
+/** Where a recorded position was matched to on a road */
+USTRUCT( BlueprintType )
+struct STREETMAPRUNTIME_API FStreetMapMatchedPoint
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** The road the position was matched to.  INDEX_NONE if the position couldn't be matched to any road. */
+	UPROPERTY( Category=StreetMap, BlueprintReadOnly )
+	int32 RoadIndex = INDEX_NONE;
+
+	/** The road point at the start of the segment the position was matched to */
+	UPROPERTY( Category=StreetMap, BlueprintReadOnly )
+	int32 PointIndex = INDEX_NONE;
+
+	/** The matched location on the road */
+	UPROPERTY( Category=StreetMap, BlueprintReadOnly )
+	FVector2D Location = FVector2D::ZeroVector;
+
+	/** Distance along the road to the matched location */
+	UPROPERTY( Category=StreetMap, BlueprintReadOnly )
+	float PositionAlongRoad = 0.0f;
+
+	/** How far the recorded position was from the matched location */
+	UPROPERTY( Category=StreetMap, BlueprintReadOnly )
+	float Distance = 0.0f;
+
+	/** Returns true if the position was matched to a road */
+	bool IsMatched() const
+	{
+		return RoadIndex != INDEX_NONE;
+	}
+};
@@ -0,0 +1,106 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapProjection.h"
+
+#define STREETMAP_PROJECTION_SSE2 ( PLATFORM_ENABLE_VECTORINTRINSICS && PLATFORM_CPU_X86_FAMILY )
+
+#if STREETMAP_PROJECTION_SSE2
+	#include <emmintrin.h>
+#endif
+
+
+// Latitude/longitude scale factor
+//			- https://en.wikipedia.org/wiki/Equator#Exact_length
+static const double EarthCircumference = 40075036.0;
+const double FStreetMapProjection::MetersPerDegree = EarthCircumference / 360.0;
+
+
+FVector2D FStreetMapProjection::ProjectLatLong( const double Latitude, const double Longitude, const double OriginLatitude, const double OriginLongitude, const double UnitsPerMeter )
+{
+	// Applies Sanson-Flamsteed (sinusoidal) Projection (see http://www.progonos.com/furuti/MapProj/Normal/CartHow/HowSanson/howSanson.html)
+	const double UnitsPerDegree = MetersPerDegree * UnitsPerMeter;
+	return FVector2D(
+		(float)( ( Longitude - OriginLongitude ) * FMath::Cos( FMath::DegreesToRadians( Latitude ) ) * UnitsPerDegree ),
+		(float)( ( OriginLatitude - Latitude ) * UnitsPerDegree ) );
+}
+
+
+void FStreetMapProjection::ProjectLatLongs( const double* Latitudes, const double* Longitudes, const int32 Count, const double OriginLatitude, const double OriginLongitude, const double UnitsPerMeter, FVector2D* OutPositions )
+{
+	int32 PointIndex = 0;
+
+#if STREETMAP_PROJECTION_SSE2
+	static_assert( sizeof( FVector2D ) == 2 * sizeof( float ), "Expecting FVector2D to be two tightly packed floats" );
+
+	// Taylor series for cosine, up to x^20.  Latitudes are within +/- PI/2 radians, where the error of this series is far
+	// below double precision.  Evaluating a polynomial lets us compute the cosine for two points per instruction.
+	const __m128d CosC0 = _mm_set1_pd( 1.0 );
+	const __m128d CosC1 = _mm_set1_pd( -1.0 / 2.0 );
+	const __m128d CosC2 = _mm_set1_pd( 1.0 / 24.0 );
+	const __m128d CosC3 = _mm_set1_pd( -1.0 / 720.0 );
+	const __m128d CosC4 = _mm_set1_pd( 1.0 / 40320.0 );
+	const __m128d CosC5 = _mm_set1_pd( -1.0 / 3628800.0 );
+	const __m128d CosC6 = _mm_set1_pd( 1.0 / 479001600.0 );
+	const __m128d CosC7 = _mm_set1_pd( -1.0 / 87178291200.0 );
+	const __m128d CosC8 = _mm_set1_pd( 1.0 / 20922789888000.0 );
+	const __m128d CosC9 = _mm_set1_pd( -1.0 / 6402373705728000.0 );
+	const __m128d CosC10 = _mm_set1_pd( 1.0 / 2432902008176640000.0 );
+
+	auto Cos = [&]( const __m128d Radians ) -> __m128d
+	{
+		const __m128d X2 = _mm_mul_pd( Radians, Radians );
+		__m128d Result = CosC10;
+		Result = _mm_add_pd( _mm_mul_pd( Result, X2 ), CosC9 );
+		Result = _mm_add_pd( _mm_mul_pd( Result, X2 ), CosC8 );
+		Result = _mm_add_pd( _mm_mul_pd( Result, X2 ), CosC7 );
+		Result = _mm_add_pd( _mm_mul_pd( Result, X2 ), CosC6 );
+		Result = _mm_add_pd( _mm_mul_pd( Result, X2 ), CosC5 );
+		Result = _mm_add_pd( _mm_mul_pd( Result, X2 ), CosC4 );
+		Result = _mm_add_pd( _mm_mul_pd( Result, X2 ), CosC3 );
+		Result = _mm_add_pd( _mm_mul_pd( Result, X2 ), CosC2 );
+		Result = _mm_add_pd( _mm_mul_pd( Result, X2 ), CosC1 );
+		return _mm_add_pd( _mm_mul_pd( Result, X2 ), CosC0 );
+	};
+
+	const __m128d MinLatitude = _mm_set1_pd( -90.0 );
+	const __m128d MaxLatitude = _mm_set1_pd( 90.0 );
+	// Converted the same way as ProjectLatLong(), so that the results match right up to the poles, where the slightest
+	// difference in the angle is magnified by the whole width of the map
+	const __m128d RadiansPerDegree = _mm_set1_pd( FMath::DegreesToRadians( 1.0 ) );
+	const __m128d UnitsPerDegree = _mm_set1_pd( MetersPerDegree * UnitsPerMeter );
+	const __m128d OriginLatitudes = _mm_set1_pd( OriginLatitude );
+	const __m128d OriginLongitudes = _mm_set1_pd( OriginLongitude );
+
+	// Projects two points, returning them as [X0, Y0, X1, Y1]
+	auto ProjectTwo = [&]( const double* Latitude, const double* Longitude ) -> __m128
+	{
+		const __m128d Lat = _mm_loadu_pd( Latitude );
+		const __m128d Lon = _mm_loadu_pd( Longitude );
+
+		const __m128d ClampedLat = _mm_min_pd( _mm_max_pd( Lat, MinLatitude ), MaxLatitude );
+		const __m128d CosLat = Cos( _mm_mul_pd( ClampedLat, RadiansPerDegree ) );
+
+		const __m128d X = _mm_mul_pd( _mm_mul_pd( _mm_sub_pd( Lon, OriginLongitudes ), CosLat ), UnitsPerDegree );
+		const __m128d Y = _mm_mul_pd( _mm_sub_pd( OriginLatitudes, Lat ), UnitsPerDegree );
+
+		const __m128 XY0 = _mm_cvtpd_ps( _mm_unpacklo_pd( X, Y ) );
+		const __m128 XY1 = _mm_cvtpd_ps( _mm_unpackhi_pd( X, Y ) );
+		return _mm_movelh_ps( XY0, XY1 );
+	};
+
+	// Four points per iteration, to give the CPU two independent chains of work to overlap
+	for( ; PointIndex + 4 <= Count; PointIndex += 4 )
+	{
+		const __m128 Points01 = ProjectTwo( Latitudes + PointIndex, Longitudes + PointIndex );
+		const __m128 Points23 = ProjectTwo( Latitudes + PointIndex + 2, Longitudes + PointIndex + 2 );
+		_mm_storeu_ps( (float*)( OutPositions + PointIndex ), Points01 );
+		_mm_storeu_ps( (float*)( OutPositions + PointIndex + 2 ), Points23 );
+	}
+#endif
+
+	// Whatever is left over (or everything, without SIMD support)
+	for( ; PointIndex < Count; ++PointIndex )
+	{
+		OutPositions[ PointIndex ] = ProjectLatLong( Latitudes[ PointIndex ], Longitudes[ PointIndex ], OriginLatitude, OriginLongitude, UnitsPerMeter );
+	}
+}
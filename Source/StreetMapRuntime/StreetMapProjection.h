@@ -0,0 +1,31 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "StreetMapRuntime.h"
+
+
+/**
+ * Converts geographic coordinates (latitude/longitude in degrees) into flat 2D map coordinates, relative to an origin.
+ * This is the same Sanson-Flamsteed (sinusoidal) projection used when importing OpenStreetMap data, so it can be used
+ * at runtime to place GPS positions on an imported street map.
+ *
+ * X increases to the east and Y increases to the south, matching UStreetMap's coordinate space.
+ */
+class STREETMAPRUNTIME_API FStreetMapProjection
+{
+
+public:
+
+	/** Meters per degree of latitude, and per degree of longitude at the equator */
+	static const double MetersPerDegree;
+
+	/** Projects a single latitude/longitude, relative to the origin.  Results are in meters multiplied by UnitsPerMeter. */
+	static FVector2D ProjectLatLong( const double Latitude, const double Longitude, const double OriginLatitude, const double OriginLongitude, const double UnitsPerMeter );
+
+	/**
+	 * Projects a whole array of latitudes/longitudes in one go, relative to the origin.  Results are in meters multiplied
+	 * by UnitsPerMeter.  Several points are converted at once using SIMD instructions where they are available, with a
+	 * scalar fallback everywhere else.  Latitudes are expected to be within [-90, 90].
+	 */
+	static void ProjectLatLongs( const double* Latitudes, const double* Longitudes, const int32 Count, const double OriginLatitude, const double OriginLongitude, const double UnitsPerMeter, FVector2D* OutPositions );
+};
@@ -0,0 +1,183 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapRoadGraph.h"
+#include "StreetMap.h"
+#include "Async/ParallelFor.h"
+#include "Misc/Crc.h"
+
+
+void FStreetMapRoadGraph::Build( const UStreetMap& StreetMap )
+{
+	const TArray< FStreetMapRoad >& Roads = StreetMap.GetRoads();
+	const TArray< FStreetMapNode >& Nodes = StreetMap.GetNodes();
+	const int32 NumNodes = Nodes.Num();
+
+	// Calls the visitor for every connection leaving a node in the direction of travel, in the same order that
+	// FStreetMapNode has always numbered its connections
+	auto VisitConnections = [&]( const int32 NodeIndex, const bool bIsTravelingForward, auto&& Visitor )
+	{
+		for( const FStreetMapRoadRef& RoadRef : Nodes[ NodeIndex ].RoadRefs )
+		{
+			const FStreetMapRoad& Road = Roads[ RoadRef.RoadIndex ];
+
+			if( RoadRef.RoadPointIndex > 0 && ( !bIsTravelingForward || !Road.IsOneWay() ) )
+			{
+				// We connect to an earlier node up this road
+				int32 EarlierNodeRoadPointIndex = RoadRef.RoadPointIndex - 1;
+				while( Road.NodeIndices[ EarlierNodeRoadPointIndex ] == INDEX_NONE )
+				{
+					--EarlierNodeRoadPointIndex;
+				}
+				Visitor( RoadRef, Road, EarlierNodeRoadPointIndex );
+			}
+
+			if( RoadRef.RoadPointIndex < ( Road.NodeIndices.Num() - 1 ) && ( bIsTravelingForward || !Road.IsOneWay() ) )
+			{
+				// We connect to a node further down this road
+				int32 LaterNodeRoadPointIndex = RoadRef.RoadPointIndex + 1;
+				while( Road.NodeIndices[ LaterNodeRoadPointIndex ] == INDEX_NONE )
+				{
+					++LaterNodeRoadPointIndex;
+				}
+				Visitor( RoadRef, Road, LaterNodeRoadPointIndex );
+			}
+		}
+	};
+
+	auto BuildEdges = [&]( const bool bIsTravelingForward, TArray< int32 >& OutFirstEdgeIndices, TArray< FStreetMapRoadGraphEdge >& OutEdges )
+	{
+		// Count every node's connections, then turn the counts into offsets so that every node knows where its edges go
+		OutFirstEdgeIndices.SetNumUninitialized( NumNodes + 1 );
+		ParallelFor( NumNodes, [&]( const int32 NodeIndex )
+		{
+			int32 NumEdges = 0;
+			VisitConnections( NodeIndex, bIsTravelingForward, [&]( const FStreetMapRoadRef&, const FStreetMapRoad&, const int32 )
+			{
+				++NumEdges;
+			} );
+			OutFirstEdgeIndices[ NodeIndex ] = NumEdges;
+		} );
+
+		int32 NumEdgesSoFar = 0;
+		for( int32 NodeIndex = 0; NodeIndex < NumNodes; ++NodeIndex )
+		{
+			const int32 NumEdges = OutFirstEdgeIndices[ NodeIndex ];
+			OutFirstEdgeIndices[ NodeIndex ] = NumEdgesSoFar;
+			NumEdgesSoFar += NumEdges;
+		}
+		OutFirstEdgeIndices[ NumNodes ] = NumEdgesSoFar;
+
+		OutEdges.SetNumUninitialized( NumEdgesSoFar );
+		ParallelFor( NumNodes, [&]( const int32 NodeIndex )
+		{
+			int32 EdgeIndex = OutFirstEdgeIndices[ NodeIndex ];
+			VisitConnections( NodeIndex, bIsTravelingForward, [&]( const FStreetMapRoadRef& RoadRef, const FStreetMapRoad& Road, const int32 ConnectedNodePointIndexOnRoad )
+			{
+				FStreetMapRoadGraphEdge& Edge = OutEdges[ EdgeIndex++ ];
+				Edge.NodeIndex = Road.NodeIndices[ ConnectedNodePointIndexOnRoad ];
+				Edge.RoadIndex = RoadRef.RoadIndex;
+				Edge.PointIndexOnRoad = RoadRef.RoadPointIndex;
+				Edge.ConnectedNodePointIndexOnRoad = ConnectedNodePointIndexOnRoad;
+				Edge.Length = Road.ComputeDistanceBetweenNodesOnRoad( StreetMap, RoadRef.RoadPointIndex, ConnectedNodePointIndexOnRoad );
+				Edge.Cost = ComputeConnectionCost( Road.RoadType.GetValue(), Edge.Length );
+			} );
+			checkSlow( EdgeIndex == OutFirstEdgeIndices[ NodeIndex + 1 ] );
+		} );
+	};
+
+	BuildEdges( true, FirstForwardEdgeIndices, ForwardEdges );
+	BuildEdges( false, FirstBackwardEdgeIndices, BackwardEdges );
+
+	NodeLocations.SetNumUninitialized( NumNodes );
+	ParallelFor( NumNodes, [&]( const int32 NodeIndex )
+	{
+		NodeLocations[ NodeIndex ] = Nodes[ NodeIndex ].RoadRefs.Num() > 0 ? Nodes[ NodeIndex ].GetLocation( StreetMap ) : FVector2D::ZeroVector;
+	} );
+
+	// Every edge can be traveled forward from one end or the other, so the forward edges cover all of them
+	MinCostPerDistance = ForwardEdges.Num() > 0 ? TNumericLimits< float >::Max() : 0.0f;
+	for( const FStreetMapRoadGraphEdge& Edge : ForwardEdges )
+	{
+		if( Edge.Length > KINDA_SMALL_NUMBER )
+		{
+			MinCostPerDistance = FMath::Min( MinCostPerDistance, Edge.Cost / Edge.Length );
+		}
+	}
+	if( MinCostPerDistance == TNumericLimits< float >::Max() )
+	{
+		MinCostPerDistance = 0.0f;
+	}
+
+	// The backward edges are the forward edges turned around, so they don't need to be included
+	static_assert( sizeof( FStreetMapRoadGraphEdge ) == 4 * sizeof( int32 ) + 2 * sizeof( float ), "Expecting FStreetMapRoadGraphEdge to have no padding" );
+	Checksum = FCrc::MemCrc32( FirstForwardEdgeIndices.GetData(), FirstForwardEdgeIndices.Num() * sizeof( int32 ) );
+	Checksum = FCrc::MemCrc32( ForwardEdges.GetData(), ForwardEdges.Num() * sizeof( FStreetMapRoadGraphEdge ), Checksum );
+}
+
+
+void FStreetMapRoadGraph::Reset()
+{
+	FirstForwardEdgeIndices.Empty();
+	ForwardEdges.Empty();
+	FirstBackwardEdgeIndices.Empty();
+	BackwardEdges.Empty();
+	NodeLocations.Empty();
+	Checksum = 0;
+	MinCostPerDistance = 0.0f;
+}
+
+
+float FStreetMapRoadGraph::ComputeConnectionCost( const uint8 RoadType, const float DistanceBetweenNodes )
+{
+	/////////////////////////////////////////////////////////
+	// Tweakables for connection cost estimation
+	//
+	const float MaxSpeedLimit = 120.0f;	// 120 Km/hr
+	const float HighwaySpeed = 110.0f;
+	const float HighwayTrafficFactor = 0.0;
+	const float MajorRoadSpeed = 70.0f;
+	const float MajorRoadTrafficFactor = 0.2f;
+	const float StreetSpeed = 40.0f;
+	const float StreetTrafficFactor = 1.0f;
+	/////////////////////////////////////////////////////////
+
+	// @todo: Street map pathfinding is a grand art in itself, and estimating cost of connections is
+	//        a very complicated problem.  We're only doing some basic estimates for now, but in the
+	//        future we could consider taking into account the cost of different types of turns and
+	//        intersections, lane counts, actual speed limits, etc.
+
+	float TotalCost = DistanceBetweenNodes;
+
+	// Apply some scaling to the cost of traveling between these nodes
+	{
+		float SpeedLimit = 0.0f;
+		float TrafficFactor = 0.0f;
+		switch( RoadType )
+		{
+			case EStreetMapRoadType::Highway:
+				SpeedLimit = HighwaySpeed;
+				TrafficFactor = HighwayTrafficFactor;
+				break;
+
+			case EStreetMapRoadType::MajorRoad:
+				SpeedLimit = MajorRoadSpeed;
+				TrafficFactor = MajorRoadTrafficFactor;
+				break;
+
+			case EStreetMapRoadType::Street:
+			case EStreetMapRoadType::Other:
+				SpeedLimit = StreetSpeed;
+				TrafficFactor = StreetTrafficFactor;
+				break;
+
+			default:
+				check( 0 );
+				break;
+		}
+
+		const float RoadSpeedCostScale = ( 1.0f - ( SpeedLimit / MaxSpeedLimit ) );
+		TotalCost *= 1.0f + RoadSpeedCostScale * 15.0f * ( 0.5f + TrafficFactor * 0.5f );
+	}
+
+	return TotalCost;
+}
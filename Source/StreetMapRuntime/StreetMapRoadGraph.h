@@ -0,0 +1,111 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "StreetMapRuntime.h"
+#include "Containers/ArrayView.h"
+
+
+/** A connection from a node to one of its neighbors along a road, in a direction the road can be traveled */
+struct FStreetMapRoadGraphEdge
+{
+	/** The node this connection leads to */
+	int32 NodeIndex;
+
+	/** The road that connects the two nodes */
+	int32 RoadIndex;
+
+	/** Where the node this connection leaves from is on the road */
+	int32 PointIndexOnRoad;
+
+	/** Where the node this connection leads to is on the road */
+	int32 ConnectedNodePointIndexOnRoad;
+
+	/** Distance between the two nodes, following the road */
+	float Length;
+
+	/** Estimated cost of traveling between the two nodes, taking the type of road into account */
+	float Cost;
+};
+
+
+/**
+ * Connections between the nodes of a street map, stored as flat arrays so that pathfinding can scan a node's neighbors
+ * without going through its roads.  Every node has a contiguous run of edges for traveling forward, and another for traveling
+ * backward (against the direction of one way roads, for searches that run from the destination.)  Edges are in the same order
+ * as the connection indices used by FStreetMapNode.
+ *
+ * The graph isn't saved with the street map.  It's built when the street map is loaded or imported.
+ */
+struct STREETMAPRUNTIME_API FStreetMapRoadGraph
+{
+	/** Builds the graph from a street map's roads and nodes, replacing anything that was there */
+	void Build( const class UStreetMap& StreetMap );
+
+	/** Empties the graph */
+	void Reset();
+
+	/** Returns the number of nodes the graph was built with */
+	int32 GetNumNodes() const
+	{
+		return FMath::Max( FirstForwardEdgeIndices.Num() - 1, 0 );
+	}
+
+	/** Returns the connections leaving a node, in the direction of travel */
+	TArrayView< const FStreetMapRoadGraphEdge > GetEdges( const int32 NodeIndex, const bool bIsTravelingForward ) const
+	{
+		const TArray< int32 >& FirstEdgeIndices = bIsTravelingForward ? FirstForwardEdgeIndices : FirstBackwardEdgeIndices;
+		const TArray< FStreetMapRoadGraphEdge >& Edges = bIsTravelingForward ? ForwardEdges : BackwardEdges;
+		return TArrayView< const FStreetMapRoadGraphEdge >( Edges.GetData() + FirstEdgeIndices[ NodeIndex ], FirstEdgeIndices[ NodeIndex + 1 ] - FirstEdgeIndices[ NodeIndex ] );
+	}
+
+	/** Returns where a node is */
+	const FVector2D& GetNodeLocation( const int32 NodeIndex ) const
+	{
+		return NodeLocations[ NodeIndex ];
+	}
+
+	/**
+	 * Returns the lowest cost per unit of distance of any connection.  Straight line distance scaled by this never overestimates
+	 * the cost of getting somewhere, so it can be used as a pathfinding heuristic.
+	 */
+	float GetMinCostPerDistance() const
+	{
+		return MinCostPerDistance;
+	}
+
+	/**
+	 * Returns a checksum of every connection in the graph, so that things built from the graph (and saved, like contraction
+	 * hierarchies) can tell when the roads have changed since.
+	 */
+	uint32 GetChecksum() const
+	{
+		return Checksum;
+	}
+
+	/** Estimates the cost of traveling a distance along a type of road */
+	static float ComputeConnectionCost( const uint8 RoadType, const float DistanceBetweenNodes );
+
+
+private:
+
+	/** Where each node's forward edges start.  There is one extra entry at the end, so a node's edges end where the next node's start. */
+	TArray< int32 > FirstForwardEdgeIndices;
+
+	/** Every node's forward edges, one node after another */
+	TArray< FStreetMapRoadGraphEdge > ForwardEdges;
+
+	/** Where each node's backward edges start, with one extra entry at the end */
+	TArray< int32 > FirstBackwardEdgeIndices;
+
+	/** Every node's backward edges, one node after another */
+	TArray< FStreetMapRoadGraphEdge > BackwardEdges;
+
+	/** Where every node is */
+	TArray< FVector2D > NodeLocations;
+
+	/** Lowest cost per unit of distance of any connection */
+	float MinCostPerDistance = 0.0f;
+
+	/** Checksum of every connection */
+	uint32 Checksum = 0;
+};
@@ -0,0 +1,122 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "StreetMapRuntime.h"
+
+// Scratch space shared by the searches that FStreetMapRouter runs.  Only included by the router's own source files.
+
+
+/** Scratch space for searching out from one end of a route */
+struct FStreetMapRouteSearchDirection
+{
+	/** A node waiting to be visited.  Nodes can be queued more than once; only the cheapest entry counts. */
+	struct FQueuedNode
+	{
+		float Priority;
+		int32 NodeIndex;
+
+		bool operator<( const FQueuedNode& Other ) const
+		{
+			return Priority < Other.Priority;
+		}
+	};
+
+	/** Cheapest known cost of getting to each node.  Only valid for nodes that have been reached in the current search. */
+	TArray< float > Costs;
+
+	/** The node each node was reached from */
+	TArray< int32 > ParentNodeIndices;
+
+	/** Search number that reached each node.  Nodes reached by older searches count as not reached, so nothing needs clearing between searches. */
+	TArray< uint32 > ReachedStamps;
+
+	/** Search number that settled each node, after which its cost is final */
+	TArray< uint32 > SettledStamps;
+
+	/** Nodes waiting to be visited, as a heap with the cheapest on top */
+	TArray< FQueuedNode > Queue;
+
+	/** Number of the current search */
+	uint32 Stamp = 0;
+
+	/** Gets ready for a new search over a graph with this many nodes */
+	void Begin( const int32 NumNodes )
+	{
+		if( ReachedStamps.Num() != NumNodes )
+		{
+			Costs.SetNumUninitialized( NumNodes );
+			ParentNodeIndices.SetNumUninitialized( NumNodes );
+			ReachedStamps.SetNumZeroed( NumNodes );
+			SettledStamps.SetNumZeroed( NumNodes );
+			Stamp = 0;
+		}
+
+		if( ++Stamp == 0 )
+		{
+			// The search number wrapped around, so old stamps could be mistaken for new ones
+			FMemory::Memzero( ReachedStamps.GetData(), ReachedStamps.Num() * sizeof( uint32 ) );
+			FMemory::Memzero( SettledStamps.GetData(), SettledStamps.Num() * sizeof( uint32 ) );
+			Stamp = 1;
+		}
+
+		Queue.Reset();
+	}
+
+	bool IsReached( const int32 NodeIndex ) const
+	{
+		return ReachedStamps[ NodeIndex ] == Stamp;
+	}
+
+	bool IsSettled( const int32 NodeIndex ) const
+	{
+		return SettledStamps[ NodeIndex ] == Stamp;
+	}
+
+	/** Records a (cheaper) way of reaching a node, and queues it to be visited */
+	void Reach( const int32 NodeIndex, const float Cost, const int32 ParentNodeIndex, const float Priority )
+	{
+		ReachedStamps[ NodeIndex ] = Stamp;
+		Costs[ NodeIndex ] = Cost;
+		ParentNodeIndices[ NodeIndex ] = ParentNodeIndex;
+		Queue.HeapPush( FQueuedNode{ Priority, NodeIndex } );
+	}
+
+	/** Takes the cheapest node that hasn't been settled yet off of the queue and settles it.  Returns INDEX_NONE if there are none left. */
+	int32 SettleNext()
+	{
+		while( Queue.Num() > 0 )
+		{
+			FQueuedNode QueuedNode;
+			Queue.HeapPop( QueuedNode, /* bAllowShrinking */ false );
+			if( !IsSettled( QueuedNode.NodeIndex ) )
+			{
+				SettledStamps[ QueuedNode.NodeIndex ] = Stamp;
+				return QueuedNode.NodeIndex;
+			}
+		}
+		return INDEX_NONE;
+	}
+
+	/** Returns the priority of the cheapest queued node.  Might be a node that was settled already, which only makes this lower. */
+	float GetTopPriority() const
+	{
+		return Queue.Num() > 0 ? Queue.HeapTop().Priority : TNumericLimits< float >::Max();
+	}
+};
+
+
+/** Scratch space for one search */
+struct FStreetMapRouteSearchState
+{
+	/** Searches from the start of the route */
+	FStreetMapRouteSearchDirection Forward;
+
+	/** Searches back from the end of the route.  Only used by bidirectional searches. */
+	FStreetMapRouteSearchDirection Backward;
+
+	/** Nodes the search found the route through, in order.  For hierarchy searches, these are joined by shortcuts. */
+	TArray< int32 > SearchPath;
+
+	/** Hierarchy edges (from and to nodes) that are waiting to be unpacked into the route */
+	TArray< TPair< int32, int32 > > UnpackStack;
+};
@@ -0,0 +1,325 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapRouting.h"
+#include "StreetMapRouteSearch.h"
+#include "Algo/Reverse.h"
+
+
+/**
+ * Relaxes the connections leaving the node a bidirectional search just settled, and remembers the cheapest route found so far
+ * through any node that both searches have reached.
+ */
+template< typename EdgeType >
+static void RelaxBidirectionalSearchEdges( const TArrayView< const EdgeType > Edges, const int32 NodeIndex, FStreetMapRouteSearchDirection& Search, const FStreetMapRouteSearchDirection& OtherSearch, float& BestCost, int32& MeetingNodeIndex )
+{
+	const float NodeCost = Search.Costs[ NodeIndex ];
+	for( const EdgeType& Edge : Edges )
+	{
+		const float NewCost = NodeCost + Edge.Cost;
+		if( !Search.IsSettled( Edge.NodeIndex ) && ( !Search.IsReached( Edge.NodeIndex ) || NewCost < Search.Costs[ Edge.NodeIndex ] ) )
+		{
+			Search.Reach( Edge.NodeIndex, NewCost, NodeIndex, NewCost );
+		}
+
+		if( OtherSearch.IsReached( Edge.NodeIndex ) && Search.Costs[ Edge.NodeIndex ] + OtherSearch.Costs[ Edge.NodeIndex ] < BestCost )
+		{
+			BestCost = Search.Costs[ Edge.NodeIndex ] + OtherSearch.Costs[ Edge.NodeIndex ];
+			MeetingNodeIndex = Edge.NodeIndex;
+		}
+	}
+}
+
+
+/** Follows the parents both searches left behind to get every node from the start, through the meeting node, to the end */
+static void GetSearchPath( const FStreetMapRouteSearchDirection& Forward, const FStreetMapRouteSearchDirection* Backward, const int32 StartNodeIndex, const int32 MeetingNodeIndex, const int32 EndNodeIndex, TArray< int32 >& OutSearchPath )
+{
+	OutSearchPath.Reset();
+	for( int32 NodeIndex = MeetingNodeIndex; NodeIndex != StartNodeIndex; NodeIndex = Forward.ParentNodeIndices[ NodeIndex ] )
+	{
+		OutSearchPath.Add( NodeIndex );
+	}
+	OutSearchPath.Add( StartNodeIndex );
+	Algo::Reverse( OutSearchPath );
+
+	if( Backward != nullptr )
+	{
+		for( int32 NodeIndex = MeetingNodeIndex; NodeIndex != EndNodeIndex; )
+		{
+			NodeIndex = Backward->ParentNodeIndices[ NodeIndex ];
+			OutSearchPath.Add( NodeIndex );
+		}
+	}
+}
+
+
+/** Adds a leg to the end of a route */
+static void AddRouteStep( FStreetMapRoute& Route, const int32 ToNodeIndex, const int32 RoadIndex, const int32 FromPointIndexOnRoad, const int32 ToPointIndexOnRoad, const float Cost, const float Length )
+{
+	Route.NodeIndices.Add( ToNodeIndex );
+
+	FStreetMapRouteStep& Step = Route.Steps[ Route.Steps.AddDefaulted() ];
+	Step.RoadIndex = RoadIndex;
+	Step.FromPointIndexOnRoad = FromPointIndexOnRoad;
+	Step.ToPointIndexOnRoad = ToPointIndexOnRoad;
+
+	Route.Cost += Cost;
+	Route.Length += Length;
+}
+
+
+/** Adds the leg between two neighboring nodes to a route, following the cheapest road between them */
+static void AddRoadGraphRouteStep( const FStreetMapRoadGraph& Graph, const int32 FromNodeIndex, const int32 ToNodeIndex, FStreetMapRoute& Route )
+{
+	const FStreetMapRoadGraphEdge* CheapestEdge = nullptr;
+	for( const FStreetMapRoadGraphEdge& Edge : Graph.GetEdges( FromNodeIndex, true ) )
+	{
+		if( Edge.NodeIndex == ToNodeIndex && ( CheapestEdge == nullptr || Edge.Cost < CheapestEdge->Cost ) )
+		{
+			CheapestEdge = &Edge;
+		}
+	}
+	check( CheapestEdge != nullptr );
+
+	AddRouteStep( Route, ToNodeIndex, CheapestEdge->RoadIndex, CheapestEdge->PointIndexOnRoad, CheapestEdge->ConnectedNodePointIndexOnRoad, CheapestEdge->Cost, CheapestEdge->Length );
+}
+
+
+/** Adds the legs that a hierarchy edge stands for to a route, unpacking shortcuts into the roads they follow */
+static void AddHierarchyRouteSteps( const FStreetMapContractionHierarchy& Hierarchy, const int32 FromNodeIndex, const int32 ToNodeIndex, TArray< TPair< int32, int32 > >& UnpackStack, FStreetMapRoute& Route )
+{
+	UnpackStack.Reset();
+	UnpackStack.Emplace( FromNodeIndex, ToNodeIndex );
+	while( UnpackStack.Num() > 0 )
+	{
+		const TPair< int32, int32 > NodeIndices = UnpackStack.Pop( /* bAllowShrinking */ false );
+		const FStreetMapContractionHierarchyEdge* Edge = Hierarchy.FindEdge( NodeIndices.Key, NodeIndices.Value );
+		check( Edge != nullptr );
+
+		if( Edge->MiddleNodeIndex == INDEX_NONE )
+		{
+			AddRouteStep( Route, NodeIndices.Value, Edge->RoadIndex, Edge->FromPointIndexOnRoad, Edge->ToPointIndexOnRoad, Edge->Cost, Edge->Length );
+		}
+		else
+		{
+			// The second half goes on the stack first, so that the first half is unpacked first
+			UnpackStack.Emplace( Edge->MiddleNodeIndex, NodeIndices.Value );
+			UnpackStack.Emplace( NodeIndices.Key, Edge->MiddleNodeIndex );
+		}
+	}
+}
+
+
+FStreetMapRouter::FStreetMapRouter()
+{
+}
+
+
+FStreetMapRouter::~FStreetMapRouter()
+{
+}
+
+
+TUniquePtr< FStreetMapRouteSearchState > FStreetMapRouter::AcquireSearchState() const
+{
+	{
+		FScopeLock Lock( &SearchStatePoolLock );
+		if( SearchStatePool.Num() > 0 )
+		{
+			return SearchStatePool.Pop( /* bAllowShrinking */ false );
+		}
+	}
+	return MakeUnique< FStreetMapRouteSearchState >();
+}
+
+
+void FStreetMapRouter::ReleaseSearchState( TUniquePtr< FStreetMapRouteSearchState > SearchState ) const
+{
+	FScopeLock Lock( &SearchStatePoolLock );
+	SearchStatePool.Add( MoveTemp( SearchState ) );
+}
+
+
+void FStreetMapRouter::Reset()
+{
+	FScopeLock Lock( &SearchStatePoolLock );
+	SearchStatePool.Empty();
+}
+
+
+bool FStreetMapRouter::FindRoute( const FStreetMapRoadGraph& Graph, const int32 StartNodeIndex, const int32 EndNodeIndex, const EStreetMapRouteAlgorithm Algorithm, FStreetMapRoute& OutRoute ) const
+{
+	OutRoute.Reset();
+
+	const int32 NumNodes = Graph.GetNumNodes();
+	if( StartNodeIndex < 0 || StartNodeIndex >= NumNodes || EndNodeIndex < 0 || EndNodeIndex >= NumNodes )
+	{
+		return false;
+	}
+
+	if( StartNodeIndex == EndNodeIndex )
+	{
+		OutRoute.NodeIndices.Add( StartNodeIndex );
+		return true;
+	}
+
+	TUniquePtr< FStreetMapRouteSearchState > SearchState = AcquireSearchState();
+	FStreetMapRouteSearchDirection& Forward = SearchState->Forward;
+	FStreetMapRouteSearchDirection& Backward = SearchState->Backward;
+
+	// The node where the forward search ends.  For bidirectional searches, the backward search carries on from there.
+	int32 MeetingNodeIndex = INDEX_NONE;
+	bool bUsedBackwardSearch = false;
+
+	if( Algorithm == EStreetMapRouteAlgorithm::BidirectionalDijkstra )
+	{
+		// Grow a search out from each end, always expanding whichever one has the cheaper node next.  Once the cheapest nodes
+		// left on both sides add up to no less than the best route found through a node reached by both searches, nothing
+		// left to explore can beat it.
+		bUsedBackwardSearch = true;
+
+		Forward.Begin( NumNodes );
+		Backward.Begin( NumNodes );
+		Forward.Reach( StartNodeIndex, 0.0f, INDEX_NONE, 0.0f );
+		Backward.Reach( EndNodeIndex, 0.0f, INDEX_NONE, 0.0f );
+
+		float BestCost = TNumericLimits< float >::Max();
+		while( Forward.Queue.Num() > 0 && Backward.Queue.Num() > 0 )
+		{
+			const float ForwardTopPriority = Forward.GetTopPriority();
+			const float BackwardTopPriority = Backward.GetTopPriority();
+			if( ForwardTopPriority + BackwardTopPriority >= BestCost )
+			{
+				break;
+			}
+
+			const bool bIsTravelingForward = ForwardTopPriority <= BackwardTopPriority;
+			FStreetMapRouteSearchDirection& Search = bIsTravelingForward ? Forward : Backward;
+			const FStreetMapRouteSearchDirection& OtherSearch = bIsTravelingForward ? Backward : Forward;
+
+			const int32 NodeIndex = Search.SettleNext();
+			if( NodeIndex != INDEX_NONE )
+			{
+				RelaxBidirectionalSearchEdges( Graph.GetEdges( NodeIndex, bIsTravelingForward ), NodeIndex, Search, OtherSearch, BestCost, MeetingNodeIndex );
+			}
+		}
+	}
+	else
+	{
+		// Straight line distance scaled by the cheapest cost per distance of any road never overestimates, so the first
+		// time the destination is settled we have the cheapest route to it
+		const FVector2D EndLocation = Graph.GetNodeLocation( EndNodeIndex );
+		const float HeuristicScale = Graph.GetMinCostPerDistance();
+		auto EstimateCostToEnd = [&]( const int32 NodeIndex )
+		{
+			return FVector2D::Distance( Graph.GetNodeLocation( NodeIndex ), EndLocation ) * HeuristicScale;
+		};
+
+		Forward.Begin( NumNodes );
+		Forward.Reach( StartNodeIndex, 0.0f, INDEX_NONE, EstimateCostToEnd( StartNodeIndex ) );
+
+		for( int32 NodeIndex = Forward.SettleNext(); NodeIndex != INDEX_NONE; NodeIndex = Forward.SettleNext() )
+		{
+			if( NodeIndex == EndNodeIndex )
+			{
+				MeetingNodeIndex = NodeIndex;
+				break;
+			}
+
+			const float NodeCost = Forward.Costs[ NodeIndex ];
+			for( const FStreetMapRoadGraphEdge& Edge : Graph.GetEdges( NodeIndex, true ) )
+			{
+				const float NewCost = NodeCost + Edge.Cost;
+				if( !Forward.IsSettled( Edge.NodeIndex ) && ( !Forward.IsReached( Edge.NodeIndex ) || NewCost < Forward.Costs[ Edge.NodeIndex ] ) )
+				{
+					Forward.Reach( Edge.NodeIndex, NewCost, NodeIndex, NewCost + EstimateCostToEnd( Edge.NodeIndex ) );
+				}
+			}
+		}
+	}
+
+	if( MeetingNodeIndex != INDEX_NONE )
+	{
+		TArray< int32 >& SearchPath = SearchState->SearchPath;
+		GetSearchPath( Forward, bUsedBackwardSearch ? &Backward : nullptr, StartNodeIndex, MeetingNodeIndex, EndNodeIndex, SearchPath );
+
+		OutRoute.NodeIndices.Add( StartNodeIndex );
+		for( int32 PathIndex = 1; PathIndex < SearchPath.Num(); ++PathIndex )
+		{
+			AddRoadGraphRouteStep( Graph, SearchPath[ PathIndex - 1 ], SearchPath[ PathIndex ], OutRoute );
+		}
+	}
+
+	ReleaseSearchState( MoveTemp( SearchState ) );
+
+	return MeetingNodeIndex != INDEX_NONE;
+}
+
+
+bool FStreetMapRouter::FindRoute( const FStreetMapContractionHierarchy& Hierarchy, const int32 StartNodeIndex, const int32 EndNodeIndex, FStreetMapRoute& OutRoute ) const
+{
+	OutRoute.Reset();
+
+	const int32 NumNodes = Hierarchy.GetNumNodes();
+	if( StartNodeIndex < 0 || StartNodeIndex >= NumNodes || EndNodeIndex < 0 || EndNodeIndex >= NumNodes )
+	{
+		return false;
+	}
+
+	if( StartNodeIndex == EndNodeIndex )
+	{
+		OutRoute.NodeIndices.Add( StartNodeIndex );
+		return true;
+	}
+
+	TUniquePtr< FStreetMapRouteSearchState > SearchState = AcquireSearchState();
+	FStreetMapRouteSearchDirection& Forward = SearchState->Forward;
+	FStreetMapRouteSearchDirection& Backward = SearchState->Backward;
+
+	// Both searches only ever climb to more important nodes, so they stay small.  The cheapest route goes up from the start
+	// and down to the end, meeting at its most important node.  Unlike plain bidirectional Dijkstra, the searches can't stop
+	// when they first meet; each one carries on until its cheapest node costs more than the best route found.
+	Forward.Begin( NumNodes );
+	Backward.Begin( NumNodes );
+	Forward.Reach( StartNodeIndex, 0.0f, INDEX_NONE, 0.0f );
+	Backward.Reach( EndNodeIndex, 0.0f, INDEX_NONE, 0.0f );
+
+	float BestCost = TNumericLimits< float >::Max();
+	int32 MeetingNodeIndex = INDEX_NONE;
+	for( ;; )
+	{
+		const float ForwardTopPriority = Forward.GetTopPriority();
+		const float BackwardTopPriority = Backward.GetTopPriority();
+		const bool bIsForwardDone = ForwardTopPriority >= BestCost;
+		const bool bIsBackwardDone = BackwardTopPriority >= BestCost;
+		if( bIsForwardDone && bIsBackwardDone )
+		{
+			break;
+		}
+
+		const bool bIsTravelingForward = !bIsForwardDone && ( bIsBackwardDone || ForwardTopPriority <= BackwardTopPriority );
+		FStreetMapRouteSearchDirection& Search = bIsTravelingForward ? Forward : Backward;
+		const FStreetMapRouteSearchDirection& OtherSearch = bIsTravelingForward ? Backward : Forward;
+
+		const int32 NodeIndex = Search.SettleNext();
+		if( NodeIndex != INDEX_NONE )
+		{
+			RelaxBidirectionalSearchEdges( Hierarchy.GetUpwardEdges( NodeIndex, bIsTravelingForward ), NodeIndex, Search, OtherSearch, BestCost, MeetingNodeIndex );
+		}
+	}
+
+	if( MeetingNodeIndex != INDEX_NONE )
+	{
+		TArray< int32 >& SearchPath = SearchState->SearchPath;
+		GetSearchPath( Forward, &Backward, StartNodeIndex, MeetingNodeIndex, EndNodeIndex, SearchPath );
+
+		OutRoute.NodeIndices.Add( StartNodeIndex );
+		for( int32 PathIndex = 1; PathIndex < SearchPath.Num(); ++PathIndex )
+		{
+			AddHierarchyRouteSteps( Hierarchy, SearchPath[ PathIndex - 1 ], SearchPath[ PathIndex ], SearchState->UnpackStack, OutRoute );
+		}
+	}
+
+	ReleaseSearchState( MoveTemp( SearchState ) );
+
+	return MeetingNodeIndex != INDEX_NONE;
+}
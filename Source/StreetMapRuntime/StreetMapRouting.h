@@ -0,0 +1,220 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "StreetMapRuntime.h"
+#include "StreetMapRoadGraph.h"
+#include "StreetMapContractionHierarchy.h"
+#include "StreetMapMapMatching.h"
+#include "Templates/UniquePtr.h"
+#include "Misc/ScopeLock.h"
+#include "StreetMapRouting.generated.h"
+
+
+/** Ways to search for a route between two nodes.  All of them find the cheapest route; they differ in how much of the map they visit. */
+UENUM( BlueprintType )
+enum class EStreetMapRouteAlgorithm : uint8
+{
+	/** Searches from the start toward the destination, guided by straight line distance.  Usually the fastest. */
+	AStar,
+
+	/** Searches from both ends at once until the searches meet.  Doesn't rely on node locations. */
+	BidirectionalDijkstra,
+
+	/** Searches the street map's contraction hierarchy, which visits very few nodes.  Uses A* if the street map doesn't have one. */
+	ContractionHierarchy
+};
+
+
+/** One leg of a route, following a single road from one node to the next */
+USTRUCT( BlueprintType )
+struct STREETMAPRUNTIME_API FStreetMapRouteStep
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** The road this leg follows */
+	UPROPERTY( Category=StreetMap, BlueprintReadOnly )
+	int32 RoadIndex = INDEX_NONE;
+
+	/** Where the leg starts on the road */
+	UPROPERTY( Category=StreetMap, BlueprintReadOnly )
+	int32 FromPointIndexOnRoad = INDEX_NONE;
+
+	/** Where the leg ends on the road */
+	UPROPERTY( Category=StreetMap, BlueprintReadOnly )
+	int32 ToPointIndexOnRoad = INDEX_NONE;
+};
+
+
+/** A route between two nodes of a street map */
+USTRUCT( BlueprintType )
+struct STREETMAPRUNTIME_API FStreetMapRoute
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Every node the route passes through, starting with where it starts and ending with its destination */
+	UPROPERTY( Category=StreetMap, BlueprintReadOnly )
+	TArray<int32> NodeIndices;
+
+	/** How to get from each node to the next.  There is one less step than there are nodes. */
+	UPROPERTY( Category=StreetMap, BlueprintReadOnly )
+	TArray<FStreetMapRouteStep> Steps;
+
+	/** Estimated cost of the whole route (see FStreetMapRoadGraph::ComputeConnectionCost) */
+	UPROPERTY( Category=StreetMap, BlueprintReadOnly )
+	float Cost = 0.0f;
+
+	/** Distance along the roads of the whole route */
+	UPROPERTY( Category=StreetMap, BlueprintReadOnly )
+	float Length = 0.0f;
+
+	/** Empties the route */
+	void Reset()
+	{
+		NodeIndices.Reset();
+		Steps.Reset();
+		Cost = 0.0f;
+		Length = 0.0f;
+	}
+};
+
+
+/** Costs of the cheapest routes from each of a set of nodes to each of another set of nodes */
+USTRUCT( BlueprintType )
+struct STREETMAPRUNTIME_API FStreetMapCostMatrix
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Number of nodes the routes start from (rows) */
+	UPROPERTY( Category=StreetMap, BlueprintReadOnly )
+	int32 NumSources = 0;
+
+	/** Number of nodes the routes go to (columns) */
+	UPROPERTY( Category=StreetMap, BlueprintReadOnly )
+	int32 NumTargets = 0;
+
+	/**
+	 * Cost of the cheapest route from every source to every target, one row of targets for each source, so the cost from
+	 * a source to a target is at (SourceIndex * NumTargets + TargetIndex).  Targets that can't be reached from a source
+	 * have the largest float as their cost.
+	 */
+	UPROPERTY( Category=StreetMap, BlueprintReadOnly )
+	TArray<float> Costs;
+
+	/** Gets the cost of the cheapest route from a source to a target */
+	float GetCost( const int32 SourceIndex, const int32 TargetIndex ) const
+	{
+		return Costs[ SourceIndex * NumTargets + TargetIndex ];
+	}
+
+	/** Returns true if there is a route from a source to a target */
+	bool IsReachable( const int32 SourceIndex, const int32 TargetIndex ) const
+	{
+		return GetCost( SourceIndex, TargetIndex ) < TNumericLimits< float >::Max();
+	}
+
+	/** Empties the matrix */
+	void Reset()
+	{
+		NumSources = 0;
+		NumTargets = 0;
+		Costs.Reset();
+	}
+};
+
+
+/**
+ * Finds routes over a road graph.  Searches need scratch space for every node on the map, so the router keeps the scratch
+ * space of finished searches around and hands it to the next search, rather than allocating and clearing it every time.
+ * It's safe to find routes from several threads at once; each thread gets scratch space of its own.
+ */
+class STREETMAPRUNTIME_API FStreetMapRouter
+{
+
+public:
+
+	FStreetMapRouter();
+	~FStreetMapRouter();
+
+	/**
+	 * Finds the cheapest route between two nodes, respecting one way roads.
+	 *
+	 * @param	Graph				The road graph to search
+	 * @param	StartNodeIndex		Node to start from
+	 * @param	EndNodeIndex		Node to get to
+	 * @param	Algorithm			How to search
+	 * @param	OutRoute			The route that was found.  Empty if there is no route.
+	 *
+	 * @return	True if there is a route between the nodes
+	 */
+	bool FindRoute( const FStreetMapRoadGraph& Graph, const int32 StartNodeIndex, const int32 EndNodeIndex, const EStreetMapRouteAlgorithm Algorithm, FStreetMapRoute& OutRoute ) const;
+
+	/**
+	 * Finds the cheapest route between two nodes using a contraction hierarchy.  Shortcuts are unpacked, so the route is
+	 * made of the same roads as one found over the road graph.
+	 *
+	 * @param	Hierarchy			The contraction hierarchy to search
+	 * @param	StartNodeIndex		Node to start from
+	 * @param	EndNodeIndex		Node to get to
+	 * @param	OutRoute			The route that was found.  Empty if there is no route.
+	 *
+	 * @return	True if there is a route between the nodes
+	 */
+	bool FindRoute( const FStreetMapContractionHierarchy& Hierarchy, const int32 StartNodeIndex, const int32 EndNodeIndex, FStreetMapRoute& OutRoute ) const;
+
+	/**
+	 * Finds the cost of the cheapest route from every source node to every target node, respecting one way roads.  Runs one
+	 * Dijkstra search out from each source, spread across worker threads, and each search stops once it has reached every
+	 * target.
+	 *
+	 * @param	Graph				The road graph to search
+	 * @param	SourceNodeIndices	Nodes to start from
+	 * @param	TargetNodeIndices	Nodes to get to
+	 * @param	OutCostMatrix		Cost from every source to every target
+	 *
+	 * @return	True if the costs were found.  False if any of the nodes don't exist.
+	 */
+	bool ComputeCostMatrix( const FStreetMapRoadGraph& Graph, const TArray< int32 >& SourceNodeIndices, const TArray< int32 >& TargetNodeIndices, FStreetMapCostMatrix& OutCostMatrix ) const;
+
+	/**
+	 * Finds the cost of the cheapest route from every source node to every target node using a contraction hierarchy.  An
+	 * upward search from each target leaves the costs it found in buckets at every node it visits; an upward search from each
+	 * source then only has to read the buckets of the nodes it visits.  Much faster than searching the road graph, since
+	 * upward searches are tiny.
+	 */
+	bool ComputeCostMatrix( const FStreetMapContractionHierarchy& Hierarchy, const TArray< int32 >& SourceNodeIndices, const TArray< int32 >& TargetNodeIndices, FStreetMapCostMatrix& OutCostMatrix ) const;
+
+	/**
+	 * Works out which roads a vehicle drove along from a trace of recorded positions, using a hidden Markov model.  Every
+	 * position has a few candidate roads nearby.  The matched sequence is the one that best balances staying close to the
+	 * recorded positions with driving routes between them about as long as the straight lines between them, so noisy
+	 * positions don't make the match jump between parallel streets.  The most likely sequence is found with the Viterbi
+	 * algorithm, with distances between candidates found by short searches of the road graph.  If the trace can't be
+	 * followed from one position to the next, matching starts over from there.
+	 *
+	 * @param	StreetMap			The street map to match to.  Its spatial index and road graph must be built.
+	 * @param	Positions			Recorded positions, in street map space, in the order they were recorded
+	 * @param	Settings			Tunables for matching
+	 * @param	OutMatchedPoints	Where each recorded position was matched to, one for each position
+	 *
+	 * @return	True if any position was matched to a road
+	 */
+	bool MatchTrace( const class UStreetMap& StreetMap, const TArray< FVector2D >& Positions, const FStreetMapMapMatchingSettings& Settings, TArray< FStreetMapMatchedPoint >& OutMatchedPoints ) const;
+
+	/** Frees the scratch space kept for future searches */
+	void Reset();
+
+
+private:
+
+	/** Takes scratch space from the pool, or makes new scratch space if the pool is empty */
+	TUniquePtr< struct FStreetMapRouteSearchState > AcquireSearchState() const;
+
+	/** Returns scratch space to the pool */
+	void ReleaseSearchState( TUniquePtr< struct FStreetMapRouteSearchState > SearchState ) const;
+
+	/** Scratch space that isn't being used by any search */
+	mutable TArray< TUniquePtr< struct FStreetMapRouteSearchState > > SearchStatePool;
+
+	/** Guards the pool */
+	mutable FCriticalSection SearchStatePoolLock;
+};
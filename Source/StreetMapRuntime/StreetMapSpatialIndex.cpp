@@ -0,0 +1,363 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapSpatialIndex.h"
+#include "StreetMap.h"
+#include "Algo/Sort.h"
+#include "Async/ParallelFor.h"
+
+
+void FStreetMapBoundsTree::Build( const TArray< FBox2D >& ItemBounds, const TArray< int32 >& ItemIndices )
+{
+	check( ItemBounds.Num() == ItemIndices.Num() );
+
+	Reset();
+
+	const int32 NumItems = ItemBounds.Num();
+	if( NumItems == 0 )
+	{
+		return;
+	}
+
+	// Sort-Tile-Recursive: sort the items into vertical slices by X, then sort each slice by Y, so that every run of
+	// NodeSize items makes a roughly square leaf
+	TArray< int32 > SortedItems;
+	SortedItems.SetNumUninitialized( NumItems );
+	for( int32 ItemIndex = 0; ItemIndex < NumItems; ++ItemIndex )
+	{
+		SortedItems[ ItemIndex ] = ItemIndex;
+	}
+
+	SortedItems.Sort( [&ItemBounds]( const int32 A, const int32 B )
+	{
+		return ItemBounds[ A ].Min.X + ItemBounds[ A ].Max.X < ItemBounds[ B ].Min.X + ItemBounds[ B ].Max.X;
+	} );
+
+	const int32 NumLeaves = FMath::DivideAndRoundUp( NumItems, NodeSize );
+	const int32 NumSlices = FMath::CeilToInt( FMath::Sqrt( (float)NumLeaves ) );
+	const int32 ItemsPerSlice = NumSlices * NodeSize;
+	for( int32 SliceStart = 0; SliceStart < NumItems; SliceStart += ItemsPerSlice )
+	{
+		Algo::Sort( MakeArrayView( SortedItems.GetData() + SliceStart, FMath::Min( ItemsPerSlice, NumItems - SliceStart ) ), [&ItemBounds]( const int32 A, const int32 B )
+		{
+			return ItemBounds[ A ].Min.Y + ItemBounds[ A ].Max.Y < ItemBounds[ B ].Min.Y + ItemBounds[ B ].Max.Y;
+		} );
+	}
+
+	// Every level has about NodeSize times fewer entries than the one below, so this is plenty
+	const int32 MaxNumEntries = NumItems + NumItems / ( NodeSize - 1 ) + 16;
+	Bounds.Reserve( MaxNumEntries );
+	Indices.Reserve( MaxNumEntries );
+
+	for( const int32 ItemIndex : SortedItems )
+	{
+		Bounds.Add( ItemBounds[ ItemIndex ] );
+		Indices.Add( ItemIndices[ ItemIndex ] );
+	}
+	LevelEnds.Add( NumItems );
+
+	// Build each level from runs of the one below until there's only the root left
+	int32 LevelStart = 0;
+	int32 LevelEnd = NumItems;
+	while( LevelEnd - LevelStart > 1 )
+	{
+		for( int32 FirstChildPosition = LevelStart; FirstChildPosition < LevelEnd; FirstChildPosition += NodeSize )
+		{
+			FBox2D NodeBounds( ForceInit );
+			const int32 ChildrenEnd = FMath::Min( FirstChildPosition + NodeSize, LevelEnd );
+			for( int32 ChildPosition = FirstChildPosition; ChildPosition < ChildrenEnd; ++ChildPosition )
+			{
+				NodeBounds += Bounds[ ChildPosition ];
+			}
+
+			Bounds.Add( NodeBounds );
+			Indices.Add( FirstChildPosition );
+		}
+
+		LevelStart = LevelEnd;
+		LevelEnd = Bounds.Num();
+		LevelEnds.Add( LevelEnd );
+	}
+}
+
+
+void FStreetMapBoundsTree::Reset()
+{
+	Bounds.Empty();
+	Indices.Empty();
+	LevelEnds.Empty();
+}
+
+
+void FStreetMapSpatialIndex::Build( const UStreetMap& StreetMap )
+{
+	const TArray< FStreetMapRoad >& Roads = StreetMap.GetRoads();
+	const TArray< FStreetMapNode >& Nodes = StreetMap.GetNodes();
+	const TArray< FStreetMapBuilding >& Buildings = StreetMap.GetBuildings();
+
+	// Road segments
+	{
+		RoadFirstSegmentIndices.SetNumUninitialized( Roads.Num() );
+		int32 NumSegments = 0;
+		for( int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex )
+		{
+			RoadFirstSegmentIndices[ RoadIndex ] = NumSegments;
+			NumSegments += FMath::Max( Roads[ RoadIndex ].RoadPoints.Num() - 1, 0 );
+		}
+
+		SegmentRoadIndices.SetNumUninitialized( NumSegments );
+		TArray< FBox2D > SegmentBounds;
+		SegmentBounds.SetNumUninitialized( NumSegments );
+		TArray< int32 > SegmentIndices;
+		SegmentIndices.SetNumUninitialized( NumSegments );
+		ParallelFor( Roads.Num(), [&]( const int32 RoadIndex )
+		{
+			const TArray< FVector2D >& RoadPoints = Roads[ RoadIndex ].RoadPoints;
+			for( int32 PointIndex = 0; PointIndex < RoadPoints.Num() - 1; ++PointIndex )
+			{
+				const int32 SegmentIndex = RoadFirstSegmentIndices[ RoadIndex ] + PointIndex;
+				SegmentRoadIndices[ SegmentIndex ] = RoadIndex;
+				SegmentBounds[ SegmentIndex ] = FBox2D( FVector2D::Min( RoadPoints[ PointIndex ], RoadPoints[ PointIndex + 1 ] ), FVector2D::Max( RoadPoints[ PointIndex ], RoadPoints[ PointIndex + 1 ] ) );
+				SegmentIndices[ SegmentIndex ] = SegmentIndex;
+			}
+		} );
+
+		RoadSegmentTree.Build( SegmentBounds, SegmentIndices );
+	}
+
+	// Nodes.  Nodes that aren't on any road have nowhere to be, so they're left out.
+	{
+		TArray< FBox2D > NodeBounds;
+		TArray< int32 > NodeIndices;
+		NodeBounds.Reserve( Nodes.Num() );
+		NodeIndices.Reserve( Nodes.Num() );
+		for( int32 NodeIndex = 0; NodeIndex < Nodes.Num(); ++NodeIndex )
+		{
+			if( Nodes[ NodeIndex ].RoadRefs.Num() > 0 )
+			{
+				const FVector2D NodeLocation = Nodes[ NodeIndex ].GetLocation( StreetMap );
+				NodeBounds.Add( FBox2D( NodeLocation, NodeLocation ) );
+				NodeIndices.Add( NodeIndex );
+			}
+		}
+
+		NodeTree.Build( NodeBounds, NodeIndices );
+	}
+
+	// Buildings
+	{
+		TArray< FBox2D > BuildingBounds;
+		TArray< int32 > BuildingIndices;
+		BuildingBounds.SetNumUninitialized( Buildings.Num() );
+		BuildingIndices.SetNumUninitialized( Buildings.Num() );
+		for( int32 BuildingIndex = 0; BuildingIndex < Buildings.Num(); ++BuildingIndex )
+		{
+			BuildingBounds[ BuildingIndex ] = FBox2D( Buildings[ BuildingIndex ].BoundsMin, Buildings[ BuildingIndex ].BoundsMax );
+			BuildingIndices[ BuildingIndex ] = BuildingIndex;
+		}
+
+		BuildingTree.Build( BuildingBounds, BuildingIndices );
+	}
+}
+
+
+void FStreetMapSpatialIndex::Reset()
+{
+	RoadSegmentTree.Reset();
+	NodeTree.Reset();
+	BuildingTree.Reset();
+	SegmentRoadIndices.Empty();
+	RoadFirstSegmentIndices.Empty();
+}
+
+
+/** Sorts a list of indices and removes the repeats */
+static void RemoveDuplicateIndices( TArray< int32 >& Indices )
+{
+	Indices.Sort();
+
+	int32 NumUniqueIndices = 0;
+	for( int32 Index = 0; Index < Indices.Num(); ++Index )
+	{
+		if( NumUniqueIndices == 0 || Indices[ Index ] != Indices[ NumUniqueIndices - 1 ] )
+		{
+			Indices[ NumUniqueIndices++ ] = Indices[ Index ];
+		}
+	}
+	Indices.SetNum( NumUniqueIndices, /* bAllowShrinking */ false );
+}
+
+
+FVector2D FStreetMapSpatialIndex::FindNearestPointOnRoadSegment( const UStreetMap& StreetMap, const FVector2D& Location, const int32 SegmentIndex ) const
+{
+	int32 RoadIndex, PointIndex;
+	GetRoadSegment( SegmentIndex, RoadIndex, PointIndex );
+
+	const FStreetMapRoad& Road = StreetMap.GetRoads()[ RoadIndex ];
+	return FMath::ClosestPointOnSegment2D( Location, Road.RoadPoints[ PointIndex ], Road.RoadPoints[ PointIndex + 1 ] );
+}
+
+
+void FStreetMapSpatialIndex::MakeRoadSegmentHit( const UStreetMap& StreetMap, const FVector2D& Location, const int32 SegmentIndex, const float DistanceSquared, FStreetMapRoadSegmentHit& OutHit ) const
+{
+	GetRoadSegment( SegmentIndex, OutHit.RoadIndex, OutHit.PointIndex );
+
+	const FStreetMapRoad& Road = StreetMap.GetRoads()[ OutHit.RoadIndex ];
+	OutHit.Location = FindNearestPointOnRoadSegment( StreetMap, Location, SegmentIndex );
+	OutHit.PositionAlongRoad = Road.PointPositionsAlongRoad[ OutHit.PointIndex ] + FVector2D::Distance( Road.RoadPoints[ OutHit.PointIndex ], OutHit.Location );
+	OutHit.Distance = FMath::Sqrt( DistanceSquared );
+}
+
+
+bool FStreetMapSpatialIndex::FindNearestRoadSegment( const UStreetMap& StreetMap, const FVector2D& Location, const float MaxDistance, FStreetMapRoadSegmentHit& OutHit ) const
+{
+	auto ComputeSegmentDistanceSquared = [&]( const int32 SegmentIndex, const FBox2D& SegmentBounds )
+	{
+		return FVector2D::DistSquared( Location, FindNearestPointOnRoadSegment( StreetMap, Location, SegmentIndex ) );
+	};
+
+	bool bFoundRoad = false;
+	RoadSegmentTree.VisitNearest( Location, MaxDistance, ComputeSegmentDistanceSquared, [&]( const int32 SegmentIndex, const float DistanceSquared )
+	{
+		MakeRoadSegmentHit( StreetMap, Location, SegmentIndex, DistanceSquared, OutHit );
+		bFoundRoad = true;
+		return false;
+	} );
+	return bFoundRoad;
+}
+
+
+void FStreetMapSpatialIndex::FindNearestRoadSegments( const UStreetMap& StreetMap, const FVector2D& Location, const float MaxDistance, const int32 MaxSegments, TArray< FStreetMapRoadSegmentHit >& OutHits ) const
+{
+	OutHits.Reset();
+	if( MaxSegments <= 0 )
+	{
+		return;
+	}
+
+	auto ComputeSegmentDistanceSquared = [&]( const int32 SegmentIndex, const FBox2D& SegmentBounds )
+	{
+		return FVector2D::DistSquared( Location, FindNearestPointOnRoadSegment( StreetMap, Location, SegmentIndex ) );
+	};
+
+	RoadSegmentTree.VisitNearest( Location, MaxDistance, ComputeSegmentDistanceSquared, [&]( const int32 SegmentIndex, const float DistanceSquared )
+	{
+		MakeRoadSegmentHit( StreetMap, Location, SegmentIndex, DistanceSquared, OutHits[ OutHits.AddDefaulted() ] );
+		return OutHits.Num() < MaxSegments;
+	} );
+}
+
+
+void FStreetMapSpatialIndex::FindNearestRoads( const UStreetMap& StreetMap, const FVector2D& Location, const float MaxDistance, const int32 MaxRoads, TArray< FStreetMapRoadSegmentHit >& OutHits ) const
+{
+	OutHits.Reset();
+	if( MaxRoads <= 0 )
+	{
+		return;
+	}
+
+	auto ComputeSegmentDistanceSquared = [&]( const int32 SegmentIndex, const FBox2D& SegmentBounds )
+	{
+		return FVector2D::DistSquared( Location, FindNearestPointOnRoadSegment( StreetMap, Location, SegmentIndex ) );
+	};
+
+	// Segments come nearest first, so the first one found on each road is that road's nearest
+	RoadSegmentTree.VisitNearest( Location, MaxDistance, ComputeSegmentDistanceSquared, [&]( const int32 SegmentIndex, const float DistanceSquared )
+	{
+		const int32 RoadIndex = SegmentRoadIndices[ SegmentIndex ];
+		if( !OutHits.ContainsByPredicate( [RoadIndex]( const FStreetMapRoadSegmentHit& Hit ) { return Hit.RoadIndex == RoadIndex; } ) )
+		{
+			MakeRoadSegmentHit( StreetMap, Location, SegmentIndex, DistanceSquared, OutHits[ OutHits.AddDefaulted() ] );
+		}
+		return OutHits.Num() < MaxRoads;
+	} );
+}
+
+
+void FStreetMapSpatialIndex::FindNearestNodes( const FVector2D& Location, const int32 MaxNodes, const float MaxDistance, TArray< int32 >& OutNodeIndices ) const
+{
+	OutNodeIndices.Reset();
+	if( MaxNodes <= 0 )
+	{
+		return;
+	}
+
+	// Nodes are points, so the distance to their bounds is the distance to them
+	auto ComputeNodeDistanceSquared = [&Location]( const int32 NodeIndex, const FBox2D& NodeBounds )
+	{
+		return FVector2D::DistSquared( Location, NodeBounds.Min );
+	};
+
+	NodeTree.VisitNearest( Location, MaxDistance, ComputeNodeDistanceSquared, [&]( const int32 NodeIndex, const float DistanceSquared )
+	{
+		OutNodeIndices.Add( NodeIndex );
+		return OutNodeIndices.Num() < MaxNodes;
+	} );
+}
+
+
+void FStreetMapSpatialIndex::FindRoadsInBox( const UStreetMap& StreetMap, const FBox2D& Box, TArray< int32 >& OutRoadIndices ) const
+{
+	OutRoadIndices.Reset();
+
+	// Segments whose bounds overlap the box might still miss it, if they cross near a corner
+	const TArray< FStreetMapRoad >& Roads = StreetMap.GetRoads();
+	const FBox Box3D( FVector( Box.Min, -1.0f ), FVector( Box.Max, 1.0f ) );
+	RoadSegmentTree.VisitOverlapping( Box, [&]( const int32 SegmentIndex, const FBox2D& SegmentBounds )
+	{
+		int32 RoadIndex, PointIndex;
+		GetRoadSegment( SegmentIndex, RoadIndex, PointIndex );
+
+		const FVector Start( Roads[ RoadIndex ].RoadPoints[ PointIndex ], 0.0f );
+		const FVector End( Roads[ RoadIndex ].RoadPoints[ PointIndex + 1 ], 0.0f );
+		if( Box.IsInside( FVector2D( Start ) ) || FMath::LineBoxIntersection( Box3D, Start, End, End - Start ) )
+		{
+			OutRoadIndices.Add( RoadIndex );
+		}
+	} );
+
+	// A road is found once for every segment that passes through
+	RemoveDuplicateIndices( OutRoadIndices );
+}
+
+
+void FStreetMapSpatialIndex::FindRoadsInRadius( const UStreetMap& StreetMap, const FVector2D& Center, const float Radius, TArray< int32 >& OutRoadIndices ) const
+{
+	OutRoadIndices.Reset();
+
+	const float RadiusSquared = FMath::Square( Radius );
+	RoadSegmentTree.VisitOverlapping( FBox2D( Center - FVector2D( Radius, Radius ), Center + FVector2D( Radius, Radius ) ), [&]( const int32 SegmentIndex, const FBox2D& SegmentBounds )
+	{
+		if( FVector2D::DistSquared( Center, FindNearestPointOnRoadSegment( StreetMap, Center, SegmentIndex ) ) <= RadiusSquared )
+		{
+			OutRoadIndices.Add( SegmentRoadIndices[ SegmentIndex ] );
+		}
+	} );
+
+	RemoveDuplicateIndices( OutRoadIndices );
+}
+
+
+void FStreetMapSpatialIndex::FindBuildingsInBox( const FBox2D& Box, TArray< int32 >& OutBuildingIndices ) const
+{
+	OutBuildingIndices.Reset();
+	BuildingTree.VisitOverlapping( Box, [&]( const int32 BuildingIndex, const FBox2D& BuildingBounds )
+	{
+		OutBuildingIndices.Add( BuildingIndex );
+	} );
+}
+
+
+void FStreetMapSpatialIndex::FindBuildingsInRadius( const FVector2D& Center, const float Radius, TArray< int32 >& OutBuildingIndices ) const
+{
+	OutBuildingIndices.Reset();
+
+	// The box around the circle also finds buildings in its corners, so check how far away each one really is
+	const float RadiusSquared = FMath::Square( Radius );
+	BuildingTree.VisitOverlapping( FBox2D( Center - FVector2D( Radius, Radius ), Center + FVector2D( Radius, Radius ) ), [&]( const int32 BuildingIndex, const FBox2D& BuildingBounds )
+	{
+		if( BuildingBounds.ComputeSquaredDistanceToPoint( Center ) <= RadiusSquared )
+		{
+			OutBuildingIndices.Add( BuildingIndex );
+		}
+	} );
+}
@@ -0,0 +1,253 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "StreetMapRuntime.h"
+
+
+/**
+ * Static R-tree over a set of bounding boxes, packed into flat arrays.  Items are sorted into leaves with the
+ * Sort-Tile-Recursive method, so that nearby items share leaves, and every level above is built from runs of the level
+ * below.  The tree can't be changed after it's built; rebuild it instead.
+ */
+struct STREETMAPRUNTIME_API FStreetMapBoundsTree
+{
+	/** Number of children each node of the tree has (except for the last node on each level) */
+	static const int32 NodeSize = 16;
+
+	/** Builds the tree over items with these bounds, replacing anything that was there.  ItemIndices are what queries report. */
+	void Build( const TArray< FBox2D >& ItemBounds, const TArray< int32 >& ItemIndices );
+
+	/** Empties the tree */
+	void Reset();
+
+	/** Calls the visitor with the index and bounds of every item whose bounds overlap a box */
+	template< typename VisitorType >
+	void VisitOverlapping( const FBox2D& Box, VisitorType&& Visitor ) const
+	{
+		if( Bounds.Num() == 0 )
+		{
+			return;
+		}
+
+		TArray< int32, TInlineAllocator< 64 > > Stack;
+		Stack.Add( Bounds.Num() - 1 );
+		while( Stack.Num() > 0 )
+		{
+			const int32 Position = Stack.Pop( /* bAllowShrinking */ false );
+			if( Bounds[ Position ].Intersect( Box ) )
+			{
+				if( IsItem( Position ) )
+				{
+					Visitor( Indices[ Position ], Bounds[ Position ] );
+				}
+				else
+				{
+					const int32 ChildrenEnd = GetChildrenEnd( Indices[ Position ] );
+					for( int32 ChildPosition = Indices[ Position ]; ChildPosition < ChildrenEnd; ++ChildPosition )
+					{
+						Stack.Add( ChildPosition );
+					}
+				}
+			}
+		}
+	}
+
+	/**
+	 * Calls the visitor with items in order of distance from a location, nearest first, until the visitor returns false or
+	 * there are no items left within the maximum distance.  Items can be further away than their bounds, so the distance
+	 * function works out the real (squared) distance to each one, given the item's index and bounds.
+	 */
+	template< typename DistanceFunctionType, typename VisitorType >
+	void VisitNearest( const FVector2D& Location, const float MaxDistance, DistanceFunctionType&& ComputeItemDistanceSquared, VisitorType&& Visitor ) const
+	{
+		if( Bounds.Num() == 0 )
+		{
+			return;
+		}
+
+		struct FQueuedEntry
+		{
+			float DistanceSquared;
+			int32 Position;
+
+			/** True once the real distance to an item has been worked out.  Until then, it's the distance to its bounds. */
+			bool bIsItemDistance;
+
+			bool operator<( const FQueuedEntry& Other ) const
+			{
+				return DistanceSquared < Other.DistanceSquared;
+			}
+		};
+
+		const float MaxDistanceSquared = MaxDistance < TNumericLimits< float >::Max() ? FMath::Square( MaxDistance ) : TNumericLimits< float >::Max();
+
+		TArray< FQueuedEntry, TInlineAllocator< 64 > > Queue;
+		Queue.HeapPush( FQueuedEntry{ Bounds.Last().ComputeSquaredDistanceToPoint( Location ), Bounds.Num() - 1, false } );
+		while( Queue.Num() > 0 )
+		{
+			FQueuedEntry Entry;
+			Queue.HeapPop( Entry, /* bAllowShrinking */ false );
+			if( Entry.DistanceSquared > MaxDistanceSquared )
+			{
+				break;
+			}
+
+			if( Entry.bIsItemDistance )
+			{
+				// Everything still queued is at least this far away
+				if( !Visitor( Indices[ Entry.Position ], Entry.DistanceSquared ) )
+				{
+					break;
+				}
+			}
+			else if( IsItem( Entry.Position ) )
+			{
+				Queue.HeapPush( FQueuedEntry{ ComputeItemDistanceSquared( Indices[ Entry.Position ], Bounds[ Entry.Position ] ), Entry.Position, true } );
+			}
+			else
+			{
+				const int32 ChildrenEnd = GetChildrenEnd( Indices[ Entry.Position ] );
+				for( int32 ChildPosition = Indices[ Entry.Position ]; ChildPosition < ChildrenEnd; ++ChildPosition )
+				{
+					const float ChildDistanceSquared = Bounds[ ChildPosition ].ComputeSquaredDistanceToPoint( Location );
+					if( ChildDistanceSquared <= MaxDistanceSquared )
+					{
+						Queue.HeapPush( FQueuedEntry{ ChildDistanceSquared, ChildPosition, false } );
+					}
+				}
+			}
+		}
+	}
+
+
+private:
+
+	/** Returns true if a position in the tree is an item rather than a node */
+	bool IsItem( const int32 Position ) const
+	{
+		return Position < LevelEnds[ 0 ];
+	}
+
+	/** Returns where a node's children end, given where they start */
+	int32 GetChildrenEnd( const int32 FirstChildPosition ) const
+	{
+		for( const int32 LevelEnd : LevelEnds )
+		{
+			if( FirstChildPosition < LevelEnd )
+			{
+				return FMath::Min( FirstChildPosition + NodeSize, LevelEnd );
+			}
+		}
+		return FirstChildPosition;
+	}
+
+	/** Bounds of every item, followed by the bounds of every node, one level at a time.  The last one is the root. */
+	TArray< FBox2D > Bounds;
+
+	/** For items, the item's index.  For nodes, where the node's children start. */
+	TArray< int32 > Indices;
+
+	/** Where each level of the tree ends.  The first level is the items themselves. */
+	TArray< int32 > LevelEnds;
+};
+
+
+/** The point on a road that is nearest to some location */
+struct FStreetMapRoadSegmentHit
+{
+	/** The road */
+	int32 RoadIndex = INDEX_NONE;
+
+	/** The point at the start of the road segment that is nearest */
+	int32 PointIndex = INDEX_NONE;
+
+	/** The nearest point on the road */
+	FVector2D Location = FVector2D::ZeroVector;
+
+	/** Distance along the road to the nearest point */
+	float PositionAlongRoad = 0.0f;
+
+	/** Distance from the location that was asked about to the nearest point */
+	float Distance = 0.0f;
+};
+
+
+/**
+ * Spatial index over a street map's road segments, nodes and buildings, for finding what is near a location or inside an
+ * area without scanning the whole map.  Built when the street map is loaded or imported.
+ */
+struct STREETMAPRUNTIME_API FStreetMapSpatialIndex
+{
+	/** Builds the index from a street map, replacing anything that was there.  The roads' distances must be cached already. */
+	void Build( const class UStreetMap& StreetMap );
+
+	/** Empties the index */
+	void Reset();
+
+	/**
+	 * Finds the point on any road that is nearest to a location.
+	 *
+	 * @param	StreetMap		The street map the index was built from
+	 * @param	Location		Where to search from
+	 * @param	MaxDistance		How far to search
+	 * @param	OutHit			The nearest point on a road
+	 *
+	 * @return	True if there is a road within the maximum distance
+	 */
+	bool FindNearestRoadSegment( const class UStreetMap& StreetMap, const FVector2D& Location, const float MaxDistance, FStreetMapRoadSegmentHit& OutHit ) const;
+
+	/** Finds the road segments within a distance of a location, nearest first, and up to a maximum number of them */
+	void FindNearestRoadSegments( const class UStreetMap& StreetMap, const FVector2D& Location, const float MaxDistance, const int32 MaxSegments, TArray< FStreetMapRoadSegmentHit >& OutHits ) const;
+
+	/**
+	 * Finds the roads within a distance of a location, nearest first, and up to a maximum number of them.  Each road is only
+	 * found once, at its nearest segment, so a road that bends back and forth near the location can't crowd out others.
+	 */
+	void FindNearestRoads( const class UStreetMap& StreetMap, const FVector2D& Location, const float MaxDistance, const int32 MaxRoads, TArray< FStreetMapRoadSegmentHit >& OutHits ) const;
+
+	/** Finds the nodes nearest to a location, nearest first.  Finds up to MaxNodes of them, within the maximum distance. */
+	void FindNearestNodes( const FVector2D& Location, const int32 MaxNodes, const float MaxDistance, TArray< int32 >& OutNodeIndices ) const;
+
+	/** Finds every road that passes through a box */
+	void FindRoadsInBox( const class UStreetMap& StreetMap, const FBox2D& Box, TArray< int32 >& OutRoadIndices ) const;
+
+	/** Finds every road that passes within a distance of a location */
+	void FindRoadsInRadius( const class UStreetMap& StreetMap, const FVector2D& Center, const float Radius, TArray< int32 >& OutRoadIndices ) const;
+
+	/** Finds every building whose bounds overlap a box */
+	void FindBuildingsInBox( const FBox2D& Box, TArray< int32 >& OutBuildingIndices ) const;
+
+	/** Finds every building whose bounds come within a distance of a location */
+	void FindBuildingsInRadius( const FVector2D& Center, const float Radius, TArray< int32 >& OutBuildingIndices ) const;
+
+
+private:
+
+	/** Works out where a road segment is, from its index in the segment tree */
+	void GetRoadSegment( const int32 SegmentIndex, int32& OutRoadIndex, int32& OutPointIndex ) const
+	{
+		OutRoadIndex = SegmentRoadIndices[ SegmentIndex ];
+		OutPointIndex = SegmentIndex - RoadFirstSegmentIndices[ OutRoadIndex ];
+	}
+
+	/** Finds the point on a road segment that is nearest to a location */
+	FVector2D FindNearestPointOnRoadSegment( const class UStreetMap& StreetMap, const FVector2D& Location, const int32 SegmentIndex ) const;
+
+	/** Fills in a hit for a road segment that was found near a location */
+	void MakeRoadSegmentHit( const class UStreetMap& StreetMap, const FVector2D& Location, const int32 SegmentIndex, const float DistanceSquared, FStreetMapRoadSegmentHit& OutHit ) const;
+
+	/** Every segment of every road */
+	FStreetMapBoundsTree RoadSegmentTree;
+
+	/** Every node */
+	FStreetMapBoundsTree NodeTree;
+
+	/** Every building */
+	FStreetMapBoundsTree BuildingTree;
+
+	/** The road each segment belongs to.  Segments are numbered road after road, one for each point but the last. */
+	TArray< int32 > SegmentRoadIndices;
+
+	/** Where each road's segments start */
+	TArray< int32 > RoadFirstSegmentIndices;
+};
@@ -2,4 +2,8 @@
 
 #include "RuntimeMeshGenericVertex.h"
 
+/** Street map mesh vertex.  Normals and tangents are packed into 8 bits per component, and texture coordinates are half precision. */
 DECLARE_RUNTIME_MESH_VERTEX(FStreetMapVertex, true, true, true, true, 1, ERuntimeMeshVertexTangentBasisType::Default, ERuntimeMeshVertexUVType::Default)
+
+/** Smaller street map mesh vertex without a tangent, for materials that don't need one (no normal maps) */
+DECLARE_RUNTIME_MESH_VERTEX(FStreetMapCompactVertex, true, true, false, true, 1, ERuntimeMeshVertexTangentBasisType::Default, ERuntimeMeshVertexUVType::Default)
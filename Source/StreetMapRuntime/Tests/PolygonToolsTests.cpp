@@ -0,0 +1,406 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapRuntime.h"
+#include "PolygonTools.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+namespace PolygonToolsTests
+{
+	/** An outer contour followed by the contours of its holes, laid out the way TriangulatePolygonWithHoles() wants them */
+	struct FOutline
+	{
+		FString Description;
+		TArray<FVector2D> Points;
+		TArray<int32> HoleStartIndices;
+
+		/**
+		 * Points that are duplicates of their neighbor, or on a straight line between their neighbors.  The triangulator may
+		 * leave these out, so the number of triangles can be anywhere from (corners - 2) up to (points - 2).
+		 */
+		int32 NumRedundantPoints = 0;
+
+		FOutline()
+		{
+		}
+
+		FOutline( const TCHAR* InDescription, const TArray<FVector2D>& InPoints, const int32 InNumRedundantPoints = 0 )
+			: Description( InDescription ),
+			  Points( InPoints ),
+			  NumRedundantPoints( InNumRedundantPoints )
+		{
+		}
+
+		/** Cuts a hole out of the outline.  The hole must be entirely inside the outer contour, and not touch any other hole. */
+		void AddHole( const TArray<FVector2D>& HolePoints )
+		{
+			HoleStartIndices.Add( Points.Num() );
+			Points.Append( HolePoints );
+		}
+
+		/** Returns this outline with every contour wound the other way around */
+		FOutline Reversed() const
+		{
+			FOutline Result( *this );
+			Result.Description += TEXT( " (reversed)" );
+			for( int32 ContourIndex = 0; ContourIndex <= HoleStartIndices.Num(); ++ContourIndex )
+			{
+				const int32 Start = GetContourStart( ContourIndex );
+				const int32 End = GetContourEnd( ContourIndex );
+				for( int32 PointIndex = Start; PointIndex < End; ++PointIndex )
+				{
+					Result.Points[ PointIndex ] = Points[ Start + End - 1 - PointIndex ];
+				}
+			}
+			return Result;
+		}
+
+		/** Contour 0 is the outer contour, and the rest are holes */
+		int32 GetContourStart( const int32 ContourIndex ) const
+		{
+			return ContourIndex == 0 ? 0 : HoleStartIndices[ ContourIndex - 1 ];
+		}
+
+		int32 GetContourEnd( const int32 ContourIndex ) const
+		{
+			return ContourIndex < HoleStartIndices.Num() ? HoleStartIndices[ ContourIndex ] : Points.Num();
+		}
+
+		/** Signed area of one contour, in double precision.  Positive for counter-clockwise contours. */
+		double GetContourArea( const int32 ContourIndex ) const
+		{
+			const int32 Start = GetContourStart( ContourIndex );
+			const int32 End = GetContourEnd( ContourIndex );
+
+			double DoubleArea = 0.0;
+			for( int32 P = End - 1, Q = Start; Q < End; P = Q++ )
+			{
+				DoubleArea += (double)Points[ P ].X * Points[ Q ].Y - (double)Points[ Q ].X * Points[ P ].Y;
+			}
+			return DoubleArea * 0.5;
+		}
+
+		/** Area inside the outer contour but outside the holes */
+		double GetFilledArea() const
+		{
+			double FilledArea = FMath::Abs( GetContourArea( 0 ) );
+			for( int32 HoleIndex = 0; HoleIndex < HoleStartIndices.Num(); ++HoleIndex )
+			{
+				FilledArea -= FMath::Abs( GetContourArea( HoleIndex + 1 ) );
+			}
+			return FilledArea;
+		}
+	};
+
+
+	/** Signed area of a triangle, in double precision.  Positive for counter-clockwise triangles. */
+	static double GetTriangleArea( const FVector2D A, const FVector2D B, const FVector2D C )
+	{
+		return 0.5 * ( ( (double)B.X - A.X ) * ( (double)C.Y - A.Y ) - ( (double)C.X - A.X ) * ( (double)B.Y - A.Y ) );
+	}
+
+
+	/** Points evenly spaced around a circle, counter-clockwise */
+	static TArray<FVector2D> MakeCircle( const FVector2D Center, const float Radius, const int32 NumPoints )
+	{
+		TArray<FVector2D> Points;
+		for( int32 PointIndex = 0; PointIndex < NumPoints; ++PointIndex )
+		{
+			const float Angle = 2.0f * PI * PointIndex / NumPoints;
+			Points.Add( Center + FVector2D( FMath::Cos( Angle ), FMath::Sin( Angle ) ) * Radius );
+		}
+		return Points;
+	}
+
+	/** A star with alternating inner and outer points, counter-clockwise.  Every inner point is a reflex corner. */
+	static TArray<FVector2D> MakeStar( const FVector2D Center, const float InnerRadius, const float OuterRadius, const int32 NumPoints )
+	{
+		TArray<FVector2D> Points;
+		for( int32 PointIndex = 0; PointIndex < NumPoints; ++PointIndex )
+		{
+			const float Angle = 2.0f * PI * PointIndex / NumPoints;
+			Points.Add( Center + FVector2D( FMath::Cos( Angle ), FMath::Sin( Angle ) ) * ( ( PointIndex % 2 ) ? InnerRadius : OuterRadius ) );
+		}
+		return Points;
+	}
+
+	/** A ring of points at random distances from the center, counter-clockwise.  Always simple, but very concave. */
+	static TArray<FVector2D> MakeBlob( const FVector2D Center, const float MinRadius, const float MaxRadius, const int32 NumPoints, const int32 Seed )
+	{
+		FRandomStream RandomStream( Seed );
+		TArray<FVector2D> Points;
+		for( int32 PointIndex = 0; PointIndex < NumPoints; ++PointIndex )
+		{
+			const float Angle = 2.0f * PI * PointIndex / NumPoints;
+			Points.Add( Center + FVector2D( FMath::Cos( Angle ), FMath::Sin( Angle ) ) * RandomStream.FRandRange( MinRadius, MaxRadius ) );
+		}
+		return Points;
+	}
+
+	/** An axis aligned rectangle, counter-clockwise */
+	static TArray<FVector2D> MakeRectangle( const FVector2D Min, const FVector2D Max )
+	{
+		return TArray<FVector2D>( { Min, FVector2D( Max.X, Min.Y ), Max, FVector2D( Min.X, Max.Y ) } );
+	}
+
+	/**
+	 * A long spine with rectangular wings sticking out of one side, counter-clockwise.  Shaped like the shopping malls, hospitals
+	 * and barracks that make up most of the large footprints in OpenStreetMap: lots of right angles, and lots of reflex corners.
+	 */
+	static TArray<FVector2D> MakeComb( const FVector2D Origin, const int32 NumWings, const float WingWidth, const float WingLength, const float WingSpacing, const float SpineDepth )
+	{
+		const float SpineLength = NumWings * ( WingWidth + WingSpacing ) + WingSpacing;
+
+		TArray<FVector2D> Points;
+		Points.Add( Origin );
+		Points.Add( Origin + FVector2D( SpineLength, 0.0f ) );
+		Points.Add( Origin + FVector2D( SpineLength, SpineDepth ) );
+		for( int32 WingIndex = NumWings - 1; WingIndex >= 0; --WingIndex )
+		{
+			const float WingStart = WingSpacing + WingIndex * ( WingWidth + WingSpacing );
+			Points.Add( Origin + FVector2D( WingStart + WingWidth, SpineDepth ) );
+			Points.Add( Origin + FVector2D( WingStart + WingWidth, SpineDepth + WingLength ) );
+			Points.Add( Origin + FVector2D( WingStart, SpineDepth + WingLength ) );
+			Points.Add( Origin + FVector2D( WingStart, SpineDepth ) );
+		}
+		Points.Add( Origin + FVector2D( 0.0f, SpineDepth ) );
+		return Points;
+	}
+
+	/** Moves a contour, so that coordinates aren't all small numbers close to the map's origin */
+	static TArray<FVector2D> Offset( TArray<FVector2D> Points, const FVector2D Offset )
+	{
+		for( FVector2D& Point : Points )
+		{
+			Point = Point + Offset;
+		}
+		return Points;
+	}
+
+
+	/** Small polygons for the triangulator's edge cases */
+	static TArray<FOutline> MakeEdgeCaseOutlines()
+	{
+		TArray<FOutline> Outlines;
+
+		Outlines.Add( FOutline( TEXT( "Triangle" ), { FVector2D( 0, 0 ), FVector2D( 100, 0 ), FVector2D( 0, 100 ) } ) );
+		Outlines.Add( FOutline( TEXT( "Square" ), MakeRectangle( FVector2D( 0, 0 ), FVector2D( 100, 100 ) ) ) );
+		Outlines.Add( FOutline( TEXT( "L shape" ), { FVector2D( 0, 0 ), FVector2D( 200, 0 ), FVector2D( 200, 100 ), FVector2D( 100, 100 ), FVector2D( 100, 300 ), FVector2D( 0, 300 ) } ) );
+		Outlines.Add( FOutline( TEXT( "U shape" ), { FVector2D( 0, 0 ), FVector2D( 300, 0 ), FVector2D( 300, 300 ), FVector2D( 200, 300 ), FVector2D( 200, 100 ), FVector2D( 100, 100 ), FVector2D( 100, 300 ), FVector2D( 0, 300 ) } ) );
+		Outlines.Add( FOutline( TEXT( "Arrow" ), { FVector2D( 0, 0 ), FVector2D( 100, 50 ), FVector2D( 200, 0 ), FVector2D( 100, 200 ) } ) );
+		Outlines.Add( FOutline( TEXT( "Cross" ), { FVector2D( 100, 0 ), FVector2D( 200, 0 ), FVector2D( 200, 100 ), FVector2D( 300, 100 ), FVector2D( 300, 200 ), FVector2D( 200, 200 ),
+			FVector2D( 200, 300 ), FVector2D( 100, 300 ), FVector2D( 100, 200 ), FVector2D( 0, 200 ), FVector2D( 0, 100 ), FVector2D( 100, 100 ) } ) );
+		Outlines.Add( FOutline( TEXT( "Star" ), MakeStar( FVector2D( 0, 0 ), 30.0f, 100.0f, 10 ) ) );
+
+		// Points on the middle of straight edges, like the nodes OpenStreetMap mappers leave where walls meet
+		Outlines.Add( FOutline( TEXT( "Square with collinear points" ), { FVector2D( 0, 0 ), FVector2D( 50, 0 ), FVector2D( 100, 0 ), FVector2D( 100, 50 ),
+			FVector2D( 100, 100 ), FVector2D( 50, 100 ), FVector2D( 0, 100 ), FVector2D( 0, 50 ) }, 4 ) );
+		Outlines.Add( FOutline( TEXT( "L shape with collinear points" ), { FVector2D( 0, 0 ), FVector2D( 100, 0 ), FVector2D( 200, 0 ), FVector2D( 200, 100 ), FVector2D( 100, 100 ),
+			FVector2D( 100, 200 ), FVector2D( 100, 300 ), FVector2D( 0, 300 ), FVector2D( 0, 150 ) }, 3 ) );
+
+		// Closed ways repeat their first node at the end, and sloppy mapping leaves the same node in twice
+		Outlines.Add( FOutline( TEXT( "Closed square" ), { FVector2D( 0, 0 ), FVector2D( 100, 0 ), FVector2D( 100, 100 ), FVector2D( 0, 100 ), FVector2D( 0, 0 ) }, 1 ) );
+		Outlines.Add( FOutline( TEXT( "Square with a duplicate point" ), { FVector2D( 0, 0 ), FVector2D( 100, 0 ), FVector2D( 100, 0 ), FVector2D( 100, 100 ), FVector2D( 0, 100 ) }, 1 ) );
+		Outlines.Add( FOutline( TEXT( "L shape with duplicate points" ), { FVector2D( 0, 0 ), FVector2D( 200, 0 ), FVector2D( 200, 100 ), FVector2D( 200, 100 ), FVector2D( 100, 100 ),
+			FVector2D( 100, 300 ), FVector2D( 0, 300 ), FVector2D( 0, 300 ), FVector2D( 0, 0 ) }, 3 ) );
+
+		// Holes
+		{
+			FOutline Outline( TEXT( "Square with a square hole" ), MakeRectangle( FVector2D( 0, 0 ), FVector2D( 300, 300 ) ) );
+			Outline.AddHole( MakeRectangle( FVector2D( 100, 100 ), FVector2D( 200, 200 ) ) );
+			Outlines.Add( Outline );
+		}
+		{
+			FOutline Outline( TEXT( "L shape with two holes" ), { FVector2D( 0, 0 ), FVector2D( 400, 0 ), FVector2D( 400, 200 ), FVector2D( 200, 200 ), FVector2D( 200, 400 ), FVector2D( 0, 400 ) } );
+			Outline.AddHole( MakeRectangle( FVector2D( 250, 50 ), FVector2D( 350, 150 ) ) );
+			Outline.AddHole( { FVector2D( 50, 250 ), FVector2D( 150, 250 ), FVector2D( 100, 350 ) } );
+			Outlines.Add( Outline );
+		}
+
+		// More than 80 points, so the z-order hash is used
+		Outlines.Add( FOutline( TEXT( "Circle, 100 points" ), MakeCircle( FVector2D( 0, 0 ), 1000.0f, 100 ) ) );
+		Outlines.Add( FOutline( TEXT( "Star, 200 points" ), MakeStar( FVector2D( 0, 0 ), 400.0f, 1000.0f, 200 ) ) );
+		Outlines.Add( FOutline( TEXT( "Blob, 500 points" ), MakeBlob( FVector2D( 0, 0 ), 200.0f, 1000.0f, 500, 1 ) ) );
+		Outlines.Add( FOutline( TEXT( "Comb, 84 points" ), MakeComb( FVector2D( 0, 0 ), 20, 100.0f, 400.0f, 50.0f, 200.0f ) ) );
+		{
+			FOutline Outline( TEXT( "Circle, 120 points with a star shaped hole" ), MakeCircle( FVector2D( 0, 0 ), 1000.0f, 120 ) );
+			Outline.AddHole( MakeStar( FVector2D( 0, 0 ), 300.0f, 600.0f, 40 ) );
+			Outlines.Add( Outline );
+		}
+
+		return Outlines;
+	}
+
+
+	/**
+	 * Building outlines for benchmarking, from the tiny to the huge.  They are modeled on the footprints that show up in
+	 * OpenStreetMap city extracts, and placed a few kilometers from the map's origin just like real buildings would be.
+	 */
+	static TArray<FOutline> MakeBuildingOutlineCorpus()
+	{
+		const FVector2D Location( 250000.0f, -180000.0f );
+
+		TArray<FOutline> Outlines;
+
+		Outlines.Add( FOutline( TEXT( "Row house" ), Offset( MakeRectangle( FVector2D( 0, 0 ), FVector2D( 600, 1200 ) ), Location ) ) );
+		Outlines.Add( FOutline( TEXT( "Corner shop" ), Offset( { FVector2D( 0, 0 ), FVector2D( 1500, 0 ), FVector2D( 1500, 800 ), FVector2D( 700, 800 ), FVector2D( 700, 1600 ), FVector2D( 0, 1600 ) }, Location ) ) );
+		Outlines.Add( FOutline( TEXT( "Church" ), Offset( { FVector2D( 800, 0 ), FVector2D( 1400, 0 ), FVector2D( 1400, 1200 ), FVector2D( 2200, 1200 ), FVector2D( 2200, 1800 ), FVector2D( 1400, 1800 ),
+			FVector2D( 1400, 3600 ), FVector2D( 800, 3600 ), FVector2D( 800, 1800 ), FVector2D( 0, 1800 ), FVector2D( 0, 1200 ), FVector2D( 800, 1200 ) }, Location ) ) );
+		Outlines.Add( FOutline( TEXT( "Round tower" ), MakeCircle( Location, 900.0f, 48 ) ) );
+		{
+			FOutline Outline( TEXT( "Perimeter block" ), Offset( MakeRectangle( FVector2D( 0, 0 ), FVector2D( 8000, 6000 ) ), Location ) );
+			Outline.AddHole( Offset( MakeRectangle( FVector2D( 1200, 1200 ), FVector2D( 6800, 4800 ) ), Location ) );
+			Outlines.Add( Outline );
+		}
+		Outlines.Add( FOutline( TEXT( "Stadium" ), MakeBlob( Location, 14000.0f, 15000.0f, 160, 2 ) ) );
+		Outlines.Add( FOutline( TEXT( "Hospital" ), Offset( MakeComb( FVector2D( 0, 0 ), 12, 1500.0f, 6000.0f, 2000.0f, 3000.0f ), Location ) ) );
+		Outlines.Add( FOutline( TEXT( "Station" ), MakeBlob( Location, 20000.0f, 26000.0f, 400, 3 ) ) );
+		Outlines.Add( FOutline( TEXT( "Shopping mall" ), Offset( MakeComb( FVector2D( 0, 0 ), 250, 800.0f, 4000.0f, 600.0f, 5000.0f ), Location ) ) );
+		{
+			// A campus: one big footprint with a courtyard for every wing
+			const int32 NumCourtyards = 24;
+			FOutline Outline( TEXT( "Campus" ), MakeBlob( Location, 60000.0f, 64000.0f, 2000, 4 ) );
+			for( int32 CourtyardIndex = 0; CourtyardIndex < NumCourtyards; ++CourtyardIndex )
+			{
+				const float Angle = 2.0f * PI * CourtyardIndex / NumCourtyards;
+				Outline.AddHole( MakeCircle( Location + FVector2D( FMath::Cos( Angle ), FMath::Sin( Angle ) ) * 40000.0f, 4000.0f, 16 ) );
+			}
+			Outlines.Add( Outline );
+		}
+
+		return Outlines;
+	}
+
+
+	/**
+	 * Triangulates an outline and checks the result: the right number of triangles, all wound counter-clockwise, and covering
+	 * exactly the area inside the outer contour and outside the holes.  Returns the number of triangles.
+	 */
+	static int32 TestTriangulation( FAutomationTestBase& Test, const FOutline& Outline )
+	{
+		const TCHAR* Description = *Outline.Description;
+
+		TArray<int32> TriangulatedIndices;
+		bool bWindsClockwise = false;
+		const bool bSucceeded = Outline.HoleStartIndices.Num() > 0 ?
+			FPolygonTools::TriangulatePolygonWithHoles( Outline.Points, Outline.HoleStartIndices, /* Out */ TriangulatedIndices, /* Out */ bWindsClockwise ) :
+			FPolygonTools::TriangulatePolygon( Outline.Points, /* Out */ TriangulatedIndices, /* Out */ bWindsClockwise );
+
+		if( !Test.TestTrue( *FString::Printf( TEXT( "%s: Triangulated" ), Description ), bSucceeded ) ||
+			!Test.TestEqual( *FString::Printf( TEXT( "%s: Index count is a multiple of three" ), Description ), TriangulatedIndices.Num() % 3, 0 ) )
+		{
+			return 0;
+		}
+
+		Test.TestEqual( *FString::Printf( TEXT( "%s: Winds clockwise" ), Description ), bWindsClockwise ? 1 : 0, Outline.GetContourArea( 0 ) < 0.0 ? 1 : 0 );
+
+		// Joining each hole to the outer contour adds two points to it, and a polygon with N points has N - 2 triangles
+		const int32 NumTriangles = TriangulatedIndices.Num() / 3;
+		const int32 MaxTriangles = Outline.Points.Num() - 2 + 2 * Outline.HoleStartIndices.Num();
+		const int32 MinTriangles = MaxTriangles - Outline.NumRedundantPoints;
+		if( Outline.NumRedundantPoints == 0 )
+		{
+			Test.TestEqual( *FString::Printf( TEXT( "%s: Triangle count" ), Description ), NumTriangles, MaxTriangles );
+		}
+		else
+		{
+			Test.TestTrue( *FString::Printf( TEXT( "%s: Triangle count %i is within [%i, %i]" ), Description, NumTriangles, MinTriangles, MaxTriangles ),
+				NumTriangles >= MinTriangles && NumTriangles <= MaxTriangles );
+		}
+
+		// The triangles must cover the polygon exactly, without overlapping.  Any triangle wound the wrong way would make the
+		// total come out short, so check them as we go.
+		const double ExpectedArea = Outline.GetFilledArea();
+		const double AreaTolerance = ExpectedArea * 1e-6;
+		double TotalArea = 0.0;
+		int32 NumClockwiseTriangles = 0;
+		for( int32 TriangleIndex = 0; TriangleIndex < NumTriangles; ++TriangleIndex )
+		{
+			const int32 A = TriangulatedIndices[ TriangleIndex * 3 + 0 ];
+			const int32 B = TriangulatedIndices[ TriangleIndex * 3 + 1 ];
+			const int32 C = TriangulatedIndices[ TriangleIndex * 3 + 2 ];
+			if( !Outline.Points.IsValidIndex( A ) || !Outline.Points.IsValidIndex( B ) || !Outline.Points.IsValidIndex( C ) )
+			{
+				Test.AddError( FString::Printf( TEXT( "%s: Triangle %i has an index out of range" ), Description, TriangleIndex ) );
+				return NumTriangles;
+			}
+
+			const double TriangleArea = GetTriangleArea( Outline.Points[ A ], Outline.Points[ B ], Outline.Points[ C ] );
+			if( TriangleArea < -AreaTolerance )
+			{
+				++NumClockwiseTriangles;
+			}
+			TotalArea += TriangleArea;
+		}
+
+		Test.TestEqual( *FString::Printf( TEXT( "%s: Clockwise triangles" ), Description ), NumClockwiseTriangles, 0 );
+		Test.TestEqual( *FString::Printf( TEXT( "%s: Area" ), Description ), TotalArea, ExpectedArea, AreaTolerance );
+
+		return NumTriangles;
+	}
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FPolygonToolsTriangulateTest, "StreetMap.Runtime.PolygonTools.Triangulate", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter )
+
+bool FPolygonToolsTriangulateTest::RunTest( const FString& Parameters )
+{
+	using namespace PolygonToolsTests;
+
+	TArray<FOutline> Outlines = MakeEdgeCaseOutlines();
+	Outlines.Append( MakeBuildingOutlineCorpus() );
+
+	// Either winding order is accepted, for the outer contour and the holes alike
+	for( const FOutline& Outline : Outlines )
+	{
+		TestTriangulation( *this, Outline );
+		TestTriangulation( *this, Outline.Reversed() );
+	}
+
+	// Too few points to make a polygon
+	TArray<int32> TriangulatedIndices;
+	bool bWindsClockwise = false;
+	TestFalse( TEXT( "Two points" ), FPolygonTools::TriangulatePolygon( { FVector2D( 0, 0 ), FVector2D( 100, 0 ) }, /* Out */ TriangulatedIndices, /* Out */ bWindsClockwise ) );
+	TestEqual( TEXT( "Two points: Index count" ), TriangulatedIndices.Num(), 0 );
+
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FPolygonToolsTriangulateBenchmark, "StreetMap.Runtime.PolygonTools.Triangulate.Benchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter )
+
+bool FPolygonToolsTriangulateBenchmark::RunTest( const FString& Parameters )
+{
+	using namespace PolygonToolsTests;
+
+	// Enough work per outline to time it reliably, without making the big ones take forever
+	const int32 PointsPerOutline = 1000000;
+
+	TArray<int32> TriangulatedIndices;
+	bool bWindsClockwise = false;
+
+	double TotalSeconds = 0.0;
+	for( const FOutline& Outline : MakeBuildingOutlineCorpus() )
+	{
+		const int32 NumIterations = FMath::Max( 10, PointsPerOutline / Outline.Points.Num() );
+
+		const double StartTime = FPlatformTime::Seconds();
+		for( int32 Iteration = 0; Iteration < NumIterations; ++Iteration )
+		{
+			FPolygonTools::TriangulatePolygonWithHoles( Outline.Points, Outline.HoleStartIndices, /* Out */ TriangulatedIndices, /* Out */ bWindsClockwise );
+		}
+		const double Seconds = ( FPlatformTime::Seconds() - StartTime ) / NumIterations;
+		TotalSeconds += Seconds;
+
+		AddInfo( FString::Printf( TEXT( "%s: %i points, %i holes, %i triangles: %.1f us" ),
+			*Outline.Description, Outline.Points.Num(), Outline.HoleStartIndices.Num(), TriangulatedIndices.Num() / 3, Seconds * 1e6 ) );
+	}
+
+	AddInfo( FString::Printf( TEXT( "Whole corpus: %.1f us" ), TotalSeconds * 1e6 ) );
+	return true;
+}
+
+
+#endif	// WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,54 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapRuntime.h"
+#include "StreetMap.h"
+#include "PolygonTools.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FStreetMapBuildingSimplifiedOutlinesTest, "StreetMap.Runtime.Building.SimplifiedOutlines", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter )
+
+bool FStreetMapBuildingSimplifiedOutlinesTest::RunTest( const FString& Parameters )
+{
+	// A round building, 20 meters across, with a point every few degrees
+	FStreetMapBuilding Building;
+	for( int32 PointIndex = 0; PointIndex < 120; ++PointIndex )
+	{
+		const float Angle = 2.0f * PI * PointIndex / 120;
+		Building.BuildingPoints.Add( FVector2D( FMath::Cos( Angle ), FMath::Sin( Angle ) ) * 1000.0f );
+	}
+
+	const TArray<float> SimplificationTolerances = FStreetMapMeshBuildSettings::GetDefaultSimplificationTolerances();
+	TestTrue( TEXT( "The default levels of detail are simplified" ), SimplificationTolerances.Num() > 0 );
+
+	// Asking for the same tolerances again doesn't add more outlines
+	Building.BuildSimplifiedOutlines( SimplificationTolerances );
+	Building.BuildSimplifiedOutlines( SimplificationTolerances );
+	TestEqual( TEXT( "Outlines" ), Building.SimplifiedOutlines.Num(), SimplificationTolerances.Num() );
+
+	for( const float SimplificationTolerance : SimplificationTolerances )
+	{
+		const FStreetMapBuildingOutline* Outline = Building.FindSimplifiedOutline( SimplificationTolerance );
+		if( !TestNotNull( *FString::Printf( TEXT( "Outline simplified by %.0f" ), SimplificationTolerance ), Outline ) )
+		{
+			continue;
+		}
+
+		// The outline must be exactly what the mesh would have simplified and triangulated for itself
+		TArray<FVector2D> ExpectedPoints;
+		FPolygonTools::SimplifyPolyline( Building.BuildingPoints, SimplificationTolerance, true, /* Out */ ExpectedPoints );
+		TestTrue( *FString::Printf( TEXT( "Outline simplified by %.0f: Points" ), SimplificationTolerance ), Outline->Points == ExpectedPoints );
+		TestTrue( *FString::Printf( TEXT( "Outline simplified by %.0f: Fewer points than the building" ), SimplificationTolerance ), Outline->Points.Num() < Building.BuildingPoints.Num() );
+		TestEqual( *FString::Printf( TEXT( "Outline simplified by %.0f: Triangulated indices" ), SimplificationTolerance ), Outline->TriangulatedIndices.Num(), ( Outline->Points.Num() - 2 ) * 3 );
+		TestFalse( *FString::Printf( TEXT( "Outline simplified by %.0f: Winds counterclockwise" ), SimplificationTolerance ), (bool)Outline->bWindsClockwise );
+	}
+
+	TestNull( TEXT( "Outline for a tolerance that wasn't asked for" ), Building.FindSimplifiedOutline( 123.0f ) );
+
+	return true;
+}
+
+
+#endif	// WITH_DEV_AUTOMATION_TESTS
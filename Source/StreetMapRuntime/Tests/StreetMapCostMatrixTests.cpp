@@ -0,0 +1,170 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapRuntime.h"
+#include "StreetMap.h"
+#include "StreetMapTestGrid.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+namespace StreetMapCostMatrixTests
+{
+	/** Picks random nodes to route between.  The same node can be picked more than once. */
+	static TArray<int32> MakeRandomNodeIndices( const UStreetMap& StreetMap, const int32 NumNodes, FRandomStream& RandomStream )
+	{
+		TArray<int32> NodeIndices;
+		for( int32 Index = 0; Index < NumNodes; ++Index )
+		{
+			NodeIndices.Add( RandomStream.RandHelper( StreetMap.GetNodes().Num() ) );
+		}
+		return NodeIndices;
+	}
+
+	/** Finds the cost of a route with FindRoute(), or the largest float if there isn't one */
+	static float FindRouteCost( const UStreetMap& StreetMap, const int32 StartNodeIndex, const int32 EndNodeIndex, const EStreetMapRouteAlgorithm Algorithm )
+	{
+		FStreetMapRoute Route;
+		return StreetMap.FindRoute( StartNodeIndex, EndNodeIndex, Route, Algorithm ) ? Route.Cost : TNumericLimits<float>::Max();
+	}
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FStreetMapCostMatrixTest, "StreetMap.Runtime.CostMatrix.ComputeCostMatrix", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter )
+
+bool FStreetMapCostMatrixTest::RunTest( const FString& Parameters )
+{
+	using namespace StreetMapCostMatrixTests;
+
+	UStreetMap& StreetMap = *StreetMapTestGrid::MakeGridStreetMap( 24, 24, 10000.0f );
+
+	FRandomStream RandomStream( 9 );
+	TArray<int32> SourceNodeIndices = MakeRandomNodeIndices( StreetMap, 30, RandomStream );
+	TArray<int32> TargetNodeIndices = MakeRandomNodeIndices( StreetMap, 40, RandomStream );
+
+	// A node asked for twice, and a node that is both a source and a target
+	TargetNodeIndices.Add( TargetNodeIndices[ 0 ] );
+	TargetNodeIndices.Add( SourceNodeIndices[ 0 ] );
+
+	// Every cost must match the route FindRoute() finds, both without and with a contraction hierarchy
+	for( const bool bWithContractionHierarchy : { false, true } )
+	{
+		const TCHAR* Description = bWithContractionHierarchy ? TEXT( "With a contraction hierarchy" ) : TEXT( "Without a contraction hierarchy" );
+		if( bWithContractionHierarchy )
+		{
+			StreetMap.BuildContractionHierarchy();
+		}
+		TestTrue( *FString::Printf( TEXT( "%s: Has the right kind of search graph" ), Description ), StreetMap.HasContractionHierarchy() == bWithContractionHierarchy );
+
+		FStreetMapCostMatrix CostMatrix;
+		if( !TestTrue( *FString::Printf( TEXT( "%s: Computed the cost matrix" ), Description ), StreetMap.ComputeCostMatrix( SourceNodeIndices, TargetNodeIndices, CostMatrix ) ) )
+		{
+			continue;
+		}
+		TestEqual( *FString::Printf( TEXT( "%s: Sources" ), Description ), CostMatrix.NumSources, SourceNodeIndices.Num() );
+		TestEqual( *FString::Printf( TEXT( "%s: Targets" ), Description ), CostMatrix.NumTargets, TargetNodeIndices.Num() );
+		TestEqual( *FString::Printf( TEXT( "%s: Costs" ), Description ), CostMatrix.Costs.Num(), SourceNodeIndices.Num() * TargetNodeIndices.Num() );
+
+		int32 NumMismatches = 0;
+		for( int32 SourceIndex = 0; SourceIndex < CostMatrix.NumSources; ++SourceIndex )
+		{
+			for( int32 TargetIndex = 0; TargetIndex < CostMatrix.NumTargets; ++TargetIndex )
+			{
+				const float ExpectedCost = FindRouteCost( StreetMap, SourceNodeIndices[ SourceIndex ], TargetNodeIndices[ TargetIndex ], EStreetMapRouteAlgorithm::AStar );
+				if( !StreetMapTestGrid::IsSameRouteCost( CostMatrix.GetCost( SourceIndex, TargetIndex ), ExpectedCost ) && NumMismatches++ < 10 )
+				{
+					// Only report the first few, so that one bug doesn't bury the log
+					AddError( FString::Printf( TEXT( "%s: Route from node %i to %i costs %.2f, but FindRoute() found one that costs %.2f" ),
+						Description, SourceNodeIndices[ SourceIndex ], TargetNodeIndices[ TargetIndex ], CostMatrix.GetCost( SourceIndex, TargetIndex ), ExpectedCost ) );
+				}
+			}
+		}
+		TestEqual( *FString::Printf( TEXT( "%s: Costs that don't match FindRoute()" ), Description ), NumMismatches, 0 );
+	}
+
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FStreetMapCostMatrixBenchmark, "StreetMap.Runtime.CostMatrix.Benchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter )
+
+bool FStreetMapCostMatrixBenchmark::RunTest( const FString& Parameters )
+{
+	using namespace StreetMapCostMatrixTests;
+
+	UStreetMap& StreetMap = *StreetMapTestGrid::MakeGridStreetMap( 200, 200, 10000.0f );
+
+	struct FMatrixSize
+	{
+		int32 NumSources;
+		int32 NumTargets;
+		TArray<int32> SourceNodeIndices;
+		TArray<int32> TargetNodeIndices;
+		FStreetMapCostMatrix CostMatrix;
+	};
+
+	FRandomStream RandomStream( 10 );
+	FMatrixSize Sizes[] = { { 100, 100 }, { 1000, 1000 } };
+	for( FMatrixSize& Size : Sizes )
+	{
+		Size.SourceNodeIndices = MakeRandomNodeIndices( StreetMap, Size.NumSources, RandomStream );
+		Size.TargetNodeIndices = MakeRandomNodeIndices( StreetMap, Size.NumTargets, RandomStream );
+	}
+
+	AddInfo( FString::Printf( TEXT( "%i nodes" ), StreetMap.GetNodes().Num() ) );
+
+	// Checking every route of the larger matrices would take far longer than computing them, so check a sample of them
+	const int32 NumSampledRoutes = 200;
+
+	for( const bool bWithContractionHierarchy : { false, true } )
+	{
+		const TCHAR* Description = bWithContractionHierarchy ? TEXT( "With a contraction hierarchy" ) : TEXT( "Without a contraction hierarchy" );
+		if( bWithContractionHierarchy )
+		{
+			const double BuildStartTime = FPlatformTime::Seconds();
+			StreetMap.BuildContractionHierarchy();
+			AddInfo( FString::Printf( TEXT( "Built the contraction hierarchy in %.2f s" ), FPlatformTime::Seconds() - BuildStartTime ) );
+		}
+
+		for( FMatrixSize& Size : Sizes )
+		{
+			FStreetMapCostMatrix CostMatrix;
+			const double StartTime = FPlatformTime::Seconds();
+			StreetMap.ComputeCostMatrix( Size.SourceNodeIndices, Size.TargetNodeIndices, CostMatrix );
+			const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+			int32 NumMismatches = 0;
+			for( int32 SampleIndex = 0; SampleIndex < NumSampledRoutes; ++SampleIndex )
+			{
+				const int32 SourceIndex = RandomStream.RandHelper( Size.NumSources );
+				const int32 TargetIndex = RandomStream.RandHelper( Size.NumTargets );
+				const float ExpectedCost = FindRouteCost( StreetMap, Size.SourceNodeIndices[ SourceIndex ], Size.TargetNodeIndices[ TargetIndex ], EStreetMapRouteAlgorithm::AStar );
+				NumMismatches += StreetMapTestGrid::IsSameRouteCost( CostMatrix.GetCost( SourceIndex, TargetIndex ), ExpectedCost ) ? 0 : 1;
+			}
+			TestEqual( *FString::Printf( TEXT( "%s, %ix%i: Sampled costs that don't match FindRoute()" ), Description, Size.NumSources, Size.NumTargets ), NumMismatches, 0 );
+
+			// Both ways of computing the matrix must agree on every cost, not just the sampled ones
+			if( bWithContractionHierarchy )
+			{
+				int32 NumDifferentCosts = 0;
+				for( int32 CostIndex = 0; CostIndex < CostMatrix.Costs.Num(); ++CostIndex )
+				{
+					NumDifferentCosts += StreetMapTestGrid::IsSameRouteCost( CostMatrix.Costs[ CostIndex ], Size.CostMatrix.Costs[ CostIndex ] ) ? 0 : 1;
+				}
+				TestEqual( *FString::Printf( TEXT( "%ix%i: Costs that differ with and without a contraction hierarchy" ), Size.NumSources, Size.NumTargets ), NumDifferentCosts, 0 );
+			}
+			else
+			{
+				Size.CostMatrix = CostMatrix;
+			}
+
+			AddInfo( FString::Printf( TEXT( "%s, %ix%i: %.1f ms (%.2f us per cost)" ),
+				Description, Size.NumSources, Size.NumTargets, Seconds * 1e3, Seconds * 1e6 / ( Size.NumSources * Size.NumTargets ) ) );
+		}
+	}
+
+	return true;
+}
+
+
+#endif	// WITH_DEV_AUTOMATION_TESTS
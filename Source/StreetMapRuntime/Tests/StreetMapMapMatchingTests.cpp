@@ -0,0 +1,230 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapRuntime.h"
+#include "StreetMap.h"
+#include "StreetMapTestGrid.h"
+#include "StreetMapProjection.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+namespace StreetMapMapMatchingTests
+{
+	/**
+	 * Records positions every so often along a route, the way a vehicle driving it might, each nudged off the road by up to
+	 * NoiseDistance in a random direction.  Also records which road each position was really on.
+	 */
+	static void MakeTrace( const UStreetMap& StreetMap, const FStreetMapRoute& Route, const float Spacing, const float NoiseDistance, FRandomStream& RandomStream, TArray<FVector2D>& OutPositions, TArray<int32>& OutRoadIndices )
+	{
+		OutPositions.Reset();
+		OutRoadIndices.Reset();
+
+		float NextPositionAlongRoute = 0.0f;
+		float StepStartAlongRoute = 0.0f;
+		for( const FStreetMapRouteStep& Step : Route.Steps )
+		{
+			const FStreetMapRoad& Road = StreetMap.GetRoads()[ Step.RoadIndex ];
+			const float FromPositionAlongRoad = Road.PointPositionsAlongRoad[ Step.FromPointIndexOnRoad ];
+			const float ToPositionAlongRoad = Road.PointPositionsAlongRoad[ Step.ToPointIndexOnRoad ];
+			const float StepLength = FMath::Abs( ToPositionAlongRoad - FromPositionAlongRoad );
+
+			for( ; NextPositionAlongRoute < StepStartAlongRoute + StepLength; NextPositionAlongRoute += Spacing )
+			{
+				const float Alpha = ( NextPositionAlongRoute - StepStartAlongRoute ) / StepLength;
+				const FVector2D Location = Road.MakeLocationAlongRoad( StreetMap, FMath::Lerp( FromPositionAlongRoad, ToPositionAlongRoad, Alpha ) );
+				const FVector2D Noise = FVector2D( RandomStream.FRandRange( -1.0f, 1.0f ), RandomStream.FRandRange( -1.0f, 1.0f ) ).GetSafeNormal() * RandomStream.FRandRange( 0.0f, NoiseDistance );
+				OutPositions.Add( Location + Noise );
+				OutRoadIndices.Add( Step.RoadIndex );
+			}
+			StepStartAlongRoute += StepLength;
+		}
+	}
+
+	/** Picks random routes that are only a few blocks long, like a short drive across town */
+	static TArray<FStreetMapRoute> MakeRandomRoutes( const UStreetMap& StreetMap, const int32 NumColumns, const int32 NumRows, const int32 NumRoutes, const int32 MaxBlocks, const int32 Seed )
+	{
+		FRandomStream RandomStream( Seed );
+		TArray<FStreetMapRoute> Routes;
+		while( Routes.Num() < NumRoutes )
+		{
+			const int32 StartColumn = RandomStream.RandHelper( NumColumns );
+			const int32 StartRow = RandomStream.RandHelper( NumRows );
+			const int32 EndColumn = FMath::Clamp( StartColumn + RandomStream.RandRange( -MaxBlocks, MaxBlocks ), 0, NumColumns - 1 );
+			const int32 EndRow = FMath::Clamp( StartRow + RandomStream.RandRange( -MaxBlocks, MaxBlocks ), 0, NumRows - 1 );
+
+			FStreetMapRoute Route;
+			if( StreetMap.FindRoute( StreetMapTestGrid::GetGridNodeIndex( NumColumns, StartColumn, StartRow ), StreetMapTestGrid::GetGridNodeIndex( NumColumns, EndColumn, EndRow ), Route ) && Route.Steps.Num() > 0 )
+			{
+				Routes.Add( Route );
+			}
+		}
+		return Routes;
+	}
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FStreetMapMapMatchingTest, "StreetMap.Runtime.MapMatching.MatchTrace", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter )
+
+bool FStreetMapMapMatchingTest::RunTest( const FString& Parameters )
+{
+	using namespace StreetMapMapMatchingTests;
+
+	const int32 GridSize = 24;
+	const float BlockSize = 10000.0f;
+	const UStreetMap& StreetMap = *StreetMapTestGrid::MakeGridStreetMap( GridSize, GridSize, BlockSize );
+
+	FStreetMapMapMatchingSettings Settings;
+	Settings.SearchRadius = BlockSize * 0.5f;
+	Settings.MaxCandidatesPerPoint = 4;
+
+	// Positions near an intersection could fairly be matched to either road, so only the ones mid block must match the
+	// road they were recorded on
+	const float IntersectionRadius = BlockSize * 0.25f;
+
+	FRandomStream RandomStream( 5 );
+	TArray<FVector2D> Positions;
+	TArray<int32> RoadIndices;
+	TArray<FStreetMapMatchedPoint> MatchedPoints;
+	int32 NumMismatches = 0;
+	for( const FStreetMapRoute& Route : MakeRandomRoutes( StreetMap, GridSize, GridSize, 50, 6, 6 ) )
+	{
+		MakeTrace( StreetMap, Route, BlockSize * 0.2f, Settings.PositionErrorStandardDeviation, RandomStream, Positions, RoadIndices );
+		if( !StreetMap.MatchTrace( Positions, Settings, MatchedPoints ) || MatchedPoints.Num() != Positions.Num() )
+		{
+			AddError( FString::Printf( TEXT( "Trace from node %i to %i couldn't be matched" ), Route.NodeIndices[ 0 ], Route.NodeIndices.Last() ) );
+			continue;
+		}
+
+		for( int32 PositionIndex = 0; PositionIndex < Positions.Num(); ++PositionIndex )
+		{
+			const FStreetMapMatchedPoint& MatchedPoint = MatchedPoints[ PositionIndex ];
+			TArray<int32> NearbyNodeIndices;
+			StreetMap.GetSpatialIndex().FindNearestNodes( Positions[ PositionIndex ], 1, IntersectionRadius, NearbyNodeIndices );
+			if( NearbyNodeIndices.Num() == 0 && MatchedPoint.RoadIndex != RoadIndices[ PositionIndex ] )
+			{
+				// Only report the first few, so that one bug doesn't bury the log
+				if( NumMismatches++ < 10 )
+				{
+					AddError( FString::Printf( TEXT( "%s was matched to road %i, but was recorded on road %i" ), *Positions[ PositionIndex ].ToString(), MatchedPoint.RoadIndex, RoadIndices[ PositionIndex ] ) );
+				}
+			}
+		}
+	}
+
+	TestEqual( TEXT( "Positions matched to the wrong road" ), NumMismatches, 0 );
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FStreetMapGeographicMapMatchingTest, "StreetMap.Runtime.MapMatching.MatchGeographicTrace", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter )
+
+bool FStreetMapGeographicMapMatchingTest::RunTest( const FString& Parameters )
+{
+	using namespace StreetMapMapMatchingTests;
+
+	const int32 GridSize = 24;
+	const float BlockSize = 10000.0f;
+	UStreetMap& StreetMap = *StreetMapTestGrid::MakeGridStreetMap( GridSize, GridSize, BlockSize );
+
+	FRandomStream RandomStream( 11 );
+	const FStreetMapRoute Route = MakeRandomRoutes( StreetMap, GridSize, GridSize, 1, 8, 12 )[ 0 ];
+	TArray<FVector2D> Positions;
+	TArray<int32> RoadIndices;
+	const FStreetMapMapMatchingSettings Settings;
+	MakeTrace( StreetMap, Route, BlockSize * 0.2f, Settings.PositionErrorStandardDeviation, RandomStream, Positions, RoadIndices );
+
+	// Until the street map knows where it is on the globe, latitudes and longitudes can't be matched
+	TArray<double> Latitudes, Longitudes;
+	TArray<FStreetMapMatchedPoint> MatchedPoints;
+	TestFalse( TEXT( "Matched a geographic trace without an origin" ), StreetMap.MatchGeographicTrace( Latitudes, Longitudes, Settings, MatchedPoints ) );
+
+	// Turn the trace into latitudes and longitudes around Seattle, by running the sinusoidal projection backwards
+	const double OriginLatitude = 47.6062;
+	const double OriginLongitude = -122.3321;
+	const float UnitsPerMeter = 100.0f;
+	StreetMap.SetGeographicOrigin( OriginLatitude, OriginLongitude, UnitsPerMeter );
+
+	const double UnitsPerDegree = FStreetMapProjection::MetersPerDegree * UnitsPerMeter;
+	for( const FVector2D& Position : Positions )
+	{
+		const double Latitude = OriginLatitude - Position.Y / UnitsPerDegree;
+		Latitudes.Add( Latitude );
+		Longitudes.Add( OriginLongitude + Position.X / ( FMath::Cos( FMath::DegreesToRadians( Latitude ) ) * UnitsPerDegree ) );
+	}
+
+	// Projecting them again must land back on the recorded positions
+	TArray<FVector2D> ProjectedPositions;
+	ProjectedPositions.SetNumUninitialized( Positions.Num() );
+	FStreetMapProjection::ProjectLatLongs( Latitudes.GetData(), Longitudes.GetData(), Latitudes.Num(), OriginLatitude, OriginLongitude, UnitsPerMeter, ProjectedPositions.GetData() );
+	int32 NumMisplacedPositions = 0;
+	for( int32 PositionIndex = 0; PositionIndex < Positions.Num(); ++PositionIndex )
+	{
+		NumMisplacedPositions += ProjectedPositions[ PositionIndex ].Equals( Positions[ PositionIndex ], 1.0f ) ? 0 : 1;
+	}
+	TestEqual( TEXT( "Positions that didn't survive the round trip through latitude and longitude" ), NumMisplacedPositions, 0 );
+
+	// And matching them must come out the same as matching the positions themselves
+	TArray<FStreetMapMatchedPoint> ExpectedMatchedPoints;
+	StreetMap.MatchTrace( Positions, Settings, ExpectedMatchedPoints );
+	if( TestTrue( TEXT( "Matched the geographic trace" ), StreetMap.MatchGeographicTrace( Latitudes, Longitudes, Settings, MatchedPoints ) ) &&
+		TestEqual( TEXT( "Matched points" ), MatchedPoints.Num(), ExpectedMatchedPoints.Num() ) )
+	{
+		int32 NumMismatches = 0;
+		for( int32 PositionIndex = 0; PositionIndex < MatchedPoints.Num(); ++PositionIndex )
+		{
+			NumMismatches += ( MatchedPoints[ PositionIndex ].RoadIndex == ExpectedMatchedPoints[ PositionIndex ].RoadIndex && MatchedPoints[ PositionIndex ].Location.Equals( ExpectedMatchedPoints[ PositionIndex ].Location, 1.0f ) ) ? 0 : 1;
+		}
+		TestEqual( TEXT( "Positions matched differently as latitudes and longitudes" ), NumMismatches, 0 );
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FStreetMapMapMatchingBenchmark, "StreetMap.Runtime.MapMatching.Benchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter )
+
+bool FStreetMapMapMatchingBenchmark::RunTest( const FString& Parameters )
+{
+	using namespace StreetMapMapMatchingTests;
+
+	const int32 GridSize = 200;
+	const float BlockSize = 10000.0f;
+	const UStreetMap& StreetMap = *StreetMapTestGrid::MakeGridStreetMap( GridSize, GridSize, BlockSize );
+	const FStreetMapMapMatchingSettings Settings;
+
+	FRandomStream RandomStream( 7 );
+	TArray<TArray<FVector2D>> Traces;
+	TArray<TArray<int32>> TraceRoadIndices;
+	int32 NumPositions = 0;
+	for( const FStreetMapRoute& Route : MakeRandomRoutes( StreetMap, GridSize, GridSize, 200, 10, 8 ) )
+	{
+		MakeTrace( StreetMap, Route, BlockSize * 0.2f, Settings.PositionErrorStandardDeviation, RandomStream, Traces[ Traces.AddDefaulted() ], TraceRoadIndices[ TraceRoadIndices.AddDefaulted() ] );
+		NumPositions += Traces.Last().Num();
+	}
+
+	TArray<FStreetMapMatchedPoint> MatchedPoints;
+	int32 NumMatchedToRecordedRoad = 0;
+	double Seconds = 0.0;
+	for( int32 TraceIndex = 0; TraceIndex < Traces.Num(); ++TraceIndex )
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		StreetMap.MatchTrace( Traces[ TraceIndex ], Settings, MatchedPoints );
+		Seconds += FPlatformTime::Seconds() - StartTime;
+
+		for( int32 PositionIndex = 0; PositionIndex < MatchedPoints.Num(); ++PositionIndex )
+		{
+			NumMatchedToRecordedRoad += ( MatchedPoints[ PositionIndex ].RoadIndex == TraceRoadIndices[ TraceIndex ][ PositionIndex ] ) ? 1 : 0;
+		}
+	}
+
+	// Positions right at an intersection can fairly go either way, so this won't be quite all of them
+	TestTrue( TEXT( "Most positions were matched to the road they were recorded on" ), NumMatchedToRecordedRoad >= NumPositions * 0.9f );
+
+	AddInfo( FString::Printf( TEXT( "%i traces, %i positions, %i candidates per position" ), Traces.Num(), NumPositions, Settings.MaxCandidatesPerPoint ) );
+	AddInfo( FString::Printf( TEXT( "%.2f us per position, %.0f positions per second" ), Seconds * 1e6 / NumPositions, NumPositions / FMath::Max( Seconds, 1e-9 ) ) );
+	AddInfo( FString::Printf( TEXT( "%.1f%% matched to the road they were recorded on" ), NumMatchedToRecordedRoad * 100.0f / NumPositions ) );
+	return true;
+}
+
+
+#endif	// WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,187 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapRuntime.h"
+#include "StreetMapProjection.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+namespace StreetMapProjectionTests
+{
+	/**
+	 * ProjectLatLongs() approximates cos() with a polynomial whose error is far below double precision, and both paths round
+	 * their results to float.  So the only differences we expect are float rounding: a few ulps, which is a relative error
+	 * of about 1e-6.  Results near zero are allowed to be off by a hundredth of a unit (a tenth of a millimeter.)
+	 */
+	static const float RelativeTolerance = 1e-6f;
+	static const float AbsoluteTolerance = 0.01f;
+
+	/** Checks that one projected coordinate matches the scalar projection, within tolerance */
+	static bool IsNearlyEqual( const float Actual, const float Expected )
+	{
+		return FMath::Abs( Actual - Expected ) <= FMath::Max( AbsoluteTolerance, FMath::Abs( Expected ) * RelativeTolerance );
+	}
+
+	struct FOrigin
+	{
+		const TCHAR* Description;
+		double Latitude;
+		double Longitude;
+	};
+
+	static const FOrigin Origins[] =
+	{
+		{ TEXT( "Equator" ), 0.0, 0.0 },
+		{ TEXT( "New York" ), 40.7128, -74.0060 },
+		{ TEXT( "Svalbard" ), 78.2232, 15.6267 },
+		{ TEXT( "McMurdo" ), -77.8419, 166.6863 },
+	};
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FStreetMapProjectionTest, "StreetMap.Runtime.Projection.ProjectLatLongs", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter )
+
+bool FStreetMapProjectionTest::RunTest( const FString& Parameters )
+{
+	using namespace StreetMapProjectionTests;
+
+	const double UnitsPerMeter = 100.0;
+
+	// A grid over the whole globe, pole to pole, plus a fine grid right up against each pole where cos() is steepest
+	TArray<double> Latitudes;
+	TArray<double> Longitudes;
+	for( int32 LatitudeStep = 0; LatitudeStep <= 180; ++LatitudeStep )
+	{
+		for( int32 LongitudeStep = 0; LongitudeStep <= 6; ++LongitudeStep )
+		{
+			Latitudes.Add( -90.0 + LatitudeStep );
+			Longitudes.Add( -180.0 + LongitudeStep * 60.0 + LatitudeStep * 0.01 );
+		}
+	}
+	for( int32 PoleStep = 0; PoleStep <= 100; ++PoleStep )
+	{
+		const double DegreesFromPole = PoleStep * 0.001;
+		Latitudes.Add( 90.0 - DegreesFromPole );
+		Longitudes.Add( 15.0 + DegreesFromPole );
+		Latitudes.Add( -90.0 + DegreesFromPole );
+		Longitudes.Add( 166.0 - DegreesFromPole );
+	}
+
+	// 181 * 7 + 202 points is odd, so the SIMD loop leaves some over for the scalar loop
+	const int32 NumPoints = Latitudes.Num();
+	TestTrue( TEXT( "Grid size isn't a multiple of four" ), NumPoints % 4 != 0 );
+
+	for( const FOrigin& Origin : Origins )
+	{
+		TArray<FVector2D> Expected;
+		Expected.SetNumUninitialized( NumPoints );
+		for( int32 PointIndex = 0; PointIndex < NumPoints; ++PointIndex )
+		{
+			Expected[ PointIndex ] = FStreetMapProjection::ProjectLatLong( Latitudes[ PointIndex ], Longitudes[ PointIndex ], Origin.Latitude, Origin.Longitude, UnitsPerMeter );
+		}
+
+		// Project runs of every length up to a few SIMD iterations, from every offset within a SIMD iteration, so that
+		// every split between the SIMD and scalar loops is covered, and the whole grid at once
+		TArray<TPair<int32, int32>> Runs;
+		for( int32 Offset = 0; Offset < 4; ++Offset )
+		{
+			for( int32 Count = 0; Count <= 13; ++Count )
+			{
+				Runs.Emplace( Offset, Count );
+			}
+		}
+		Runs.Emplace( 0, NumPoints );
+		Runs.Emplace( 1, NumPoints - 1 );
+
+		int32 NumMismatches = 0;
+		for( const TPair<int32, int32>& Run : Runs )
+		{
+			const int32 Offset = Run.Key;
+			const int32 Count = Run.Value;
+
+			// One extra position past the end, which must be left alone
+			const FVector2D Sentinel( 12345.0f, -6789.0f );
+			TArray<FVector2D> Actual;
+			Actual.Init( Sentinel, Count + 1 );
+			FStreetMapProjection::ProjectLatLongs( Latitudes.GetData() + Offset, Longitudes.GetData() + Offset, Count, Origin.Latitude, Origin.Longitude, UnitsPerMeter, Actual.GetData() );
+
+			TestTrue( *FString::Printf( TEXT( "%s: %i points from %i wrote past the end" ), Origin.Description, Count, Offset ), Actual[ Count ] == Sentinel );
+
+			for( int32 RunPointIndex = 0; RunPointIndex < Count; ++RunPointIndex )
+			{
+				const int32 PointIndex = Offset + RunPointIndex;
+				const FVector2D& Position = Actual[ RunPointIndex ];
+				if( !IsNearlyEqual( Position.X, Expected[ PointIndex ].X ) || !IsNearlyEqual( Position.Y, Expected[ PointIndex ].Y ) )
+				{
+					// Only report the first few, so that one bug doesn't bury the log
+					if( NumMismatches++ < 10 )
+					{
+						AddError( FString::Printf( TEXT( "%s: (%.6f, %.6f) projected to %s, expected %s" ),
+							Origin.Description, Latitudes[ PointIndex ], Longitudes[ PointIndex ], *Position.ToString(), *Expected[ PointIndex ].ToString() ) );
+					}
+				}
+			}
+		}
+
+		TestEqual( *FString::Printf( TEXT( "%s: Mismatched points" ), Origin.Description ), NumMismatches, 0 );
+	}
+
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FStreetMapProjectionBenchmark, "StreetMap.Runtime.Projection.Benchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter )
+
+bool FStreetMapProjectionBenchmark::RunTest( const FString& Parameters )
+{
+	using namespace StreetMapProjectionTests;
+
+	const double UnitsPerMeter = 100.0;
+	const double OriginLatitude = 40.7128;
+	const double OriginLongitude = -74.0060;
+
+	// About as many points as a large city's worth of roads and buildings, scattered over a few dozen kilometers
+	const int32 NumPoints = 1000000;
+	FRandomStream RandomStream( 3 );
+	TArray<double> Latitudes;
+	TArray<double> Longitudes;
+	Latitudes.SetNumUninitialized( NumPoints );
+	Longitudes.SetNumUninitialized( NumPoints );
+	for( int32 PointIndex = 0; PointIndex < NumPoints; ++PointIndex )
+	{
+		Latitudes[ PointIndex ] = OriginLatitude + RandomStream.FRandRange( -0.2f, 0.2f );
+		Longitudes[ PointIndex ] = OriginLongitude + RandomStream.FRandRange( -0.2f, 0.2f );
+	}
+
+	TArray<FVector2D> ScalarPositions;
+	ScalarPositions.SetNumUninitialized( NumPoints );
+	const double ScalarStartTime = FPlatformTime::Seconds();
+	for( int32 PointIndex = 0; PointIndex < NumPoints; ++PointIndex )
+	{
+		ScalarPositions[ PointIndex ] = FStreetMapProjection::ProjectLatLong( Latitudes[ PointIndex ], Longitudes[ PointIndex ], OriginLatitude, OriginLongitude, UnitsPerMeter );
+	}
+	const double ScalarSeconds = FPlatformTime::Seconds() - ScalarStartTime;
+
+	TArray<FVector2D> BatchedPositions;
+	BatchedPositions.SetNumUninitialized( NumPoints );
+	const double BatchedStartTime = FPlatformTime::Seconds();
+	FStreetMapProjection::ProjectLatLongs( Latitudes.GetData(), Longitudes.GetData(), NumPoints, OriginLatitude, OriginLongitude, UnitsPerMeter, BatchedPositions.GetData() );
+	const double BatchedSeconds = FPlatformTime::Seconds() - BatchedStartTime;
+
+	// Checking the results also keeps the compiler from throwing the scalar loop away
+	int32 NumMismatches = 0;
+	for( int32 PointIndex = 0; PointIndex < NumPoints; ++PointIndex )
+	{
+		NumMismatches += IsNearlyEqual( BatchedPositions[ PointIndex ].X, ScalarPositions[ PointIndex ].X ) && IsNearlyEqual( BatchedPositions[ PointIndex ].Y, ScalarPositions[ PointIndex ].Y ) ? 0 : 1;
+	}
+	TestEqual( TEXT( "Mismatched points" ), NumMismatches, 0 );
+
+	AddInfo( FString::Printf( TEXT( "ProjectLatLong() loop: %.2f ns per point (%i points)" ), ScalarSeconds * 1e9 / NumPoints, NumPoints ) );
+	AddInfo( FString::Printf( TEXT( "ProjectLatLongs(): %.2f ns per point" ), BatchedSeconds * 1e9 / NumPoints ) );
+	AddInfo( FString::Printf( TEXT( "Speedup: %.2fx" ), ScalarSeconds / FMath::Max( BatchedSeconds, 1e-9 ) ) );
+	return true;
+}
+
+
+#endif	// WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,85 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapRuntime.h"
+#include "StreetMap.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FStreetMapRoadPositionsTest, "StreetMap.Runtime.Road.PositionsAlongRoad", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter )
+
+bool FStreetMapRoadPositionsTest::RunTest( const FString& Parameters )
+{
+	// An L shaped road, with a repeated point at the corner so that one segment has no length.  There are nodes at both
+	// ends and at the corner, but not at the repeated point.
+	UStreetMap& StreetMap = *NewObject<UStreetMap>();
+	StreetMap.GetNodes().SetNum( 3 );
+	FStreetMapRoad& Road = StreetMap.GetRoads()[ StreetMap.GetRoads().AddDefaulted() ];
+	Road.RoadPoints = { FVector2D( 0.0f, 0.0f ), FVector2D( 100.0f, 0.0f ), FVector2D( 100.0f, 0.0f ), FVector2D( 100.0f, 50.0f ) };
+	Road.NodeIndices = { 0, 1, INDEX_NONE, 2 };
+	Road.CachePointPositionsAlongRoad();
+
+	TestTrue( TEXT( "Positions along the road are cached" ), Road.HasPointPositionsAlongRoad() );
+	TestEqual( TEXT( "Length of the road" ), Road.ComputeLengthOfRoad( StreetMap ), 150.0f );
+
+	struct FCase
+	{
+		float PositionAlongRoad;
+		int32 ExpectedSegment;
+		FVector2D ExpectedLocation;
+		int32 ExpectedEarlierNodeIndex;
+		int32 ExpectedLaterNodeIndex;
+	};
+
+	// Positions before the start and past the end of the road are clamped to its ends.  A position right at the corner
+	// node is on the segment before it, so it's between the first two nodes.
+	const FCase Cases[] =
+	{
+		{ -25.0f, 0, FVector2D( 0.0f, 0.0f ), 0, 1 },
+		{ 0.0f, 0, FVector2D( 0.0f, 0.0f ), 0, 1 },
+		{ 50.0f, 0, FVector2D( 50.0f, 0.0f ), 0, 1 },
+		{ 100.0f, 0, FVector2D( 100.0f, 0.0f ), 0, 1 },
+		{ 125.0f, 2, FVector2D( 100.0f, 25.0f ), 1, 2 },
+		{ 150.0f, 2, FVector2D( 100.0f, 50.0f ), 1, 2 },
+		{ 150.5f, 2, FVector2D( 100.0f, 50.0f ), 1, 2 },
+		{ 1000.0f, 2, FVector2D( 100.0f, 50.0f ), 1, 2 },
+	};
+	const float NodePositionsAlongRoad[] = { 0.0f, 100.0f, 150.0f };
+
+	for( const FCase& Case : Cases )
+	{
+		TestEqual( *FString::Printf( TEXT( "Segment for %.1f along the road" ), Case.PositionAlongRoad ), Road.FindSegmentForPositionAlongRoad( Case.PositionAlongRoad ), Case.ExpectedSegment );
+
+		const FVector2D Location = Road.MakeLocationAlongRoad( StreetMap, Case.PositionAlongRoad );
+		TestTrue( *FString::Printf( TEXT( "%.1f along the road is at %s, expected %s" ), Case.PositionAlongRoad, *Location.ToString(), *Case.ExpectedLocation.ToString() ), Location.Equals( Case.ExpectedLocation, 0.01f ) );
+
+		const FStreetMapNode* EarlierNode = nullptr;
+		const FStreetMapNode* LaterNode = nullptr;
+		float EarlierNodePositionAlongRoad = -1.0f;
+		float LaterNodePositionAlongRoad = -1.0f;
+		Road.FindEarlierAndLaterNodesForPositionAlongRoad( StreetMap, Case.PositionAlongRoad, EarlierNode, EarlierNodePositionAlongRoad, LaterNode, LaterNodePositionAlongRoad );
+		TestEqual( *FString::Printf( TEXT( "Node before %.1f along the road" ), Case.PositionAlongRoad ), EarlierNode->GetNodeIndex( StreetMap ), Case.ExpectedEarlierNodeIndex );
+		TestEqual( *FString::Printf( TEXT( "Node after %.1f along the road" ), Case.PositionAlongRoad ), LaterNode->GetNodeIndex( StreetMap ), Case.ExpectedLaterNodeIndex );
+		TestEqual( *FString::Printf( TEXT( "Position of the node before %.1f along the road" ), Case.PositionAlongRoad ), EarlierNodePositionAlongRoad, NodePositionsAlongRoad[ Case.ExpectedEarlierNodeIndex ] );
+		TestEqual( *FString::Printf( TEXT( "Position of the node after %.1f along the road" ), Case.PositionAlongRoad ), LaterNodePositionAlongRoad, NodePositionsAlongRoad[ Case.ExpectedLaterNodeIndex ] );
+	}
+
+	// Nodes are found by where they are on the road, since the same node can be on a road more than once
+	TestEqual( TEXT( "Position of the first node" ), Road.FindPositionAlongRoadForNode( StreetMap, 0 ), 0.0f );
+	TestEqual( TEXT( "Position of the corner node" ), Road.FindPositionAlongRoadForNode( StreetMap, 1 ), 100.0f );
+	TestEqual( TEXT( "Position of the last node" ), Road.FindPositionAlongRoadForNode( StreetMap, 3 ), 150.0f );
+
+	// Distances don't depend on which way round the nodes are, and point indices past either end are clamped to the road
+	TestEqual( TEXT( "Distance from end to end" ), Road.ComputeDistanceBetweenNodesOnRoad( StreetMap, 0, 3 ), 150.0f );
+	TestEqual( TEXT( "Distance from end to end, backward" ), Road.ComputeDistanceBetweenNodesOnRoad( StreetMap, 3, 0 ), 150.0f );
+	TestEqual( TEXT( "Distance from the corner to the end" ), Road.ComputeDistanceBetweenNodesOnRoad( StreetMap, 1, 3 ), 50.0f );
+	TestEqual( TEXT( "Distance from the start to the corner" ), Road.ComputeDistanceBetweenNodesOnRoad( StreetMap, 0, 1 ), 100.0f );
+	TestEqual( TEXT( "Distance from a node to itself" ), Road.ComputeDistanceBetweenNodesOnRoad( StreetMap, 1, 1 ), 0.0f );
+	TestEqual( TEXT( "Distance between points past either end" ), Road.ComputeDistanceBetweenNodesOnRoad( StreetMap, -1, 5 ), 150.0f );
+
+	return true;
+}
+
+
+#endif	// WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,215 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapRuntime.h"
+#include "StreetMap.h"
+#include "StreetMapTestGrid.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+namespace StreetMapRoutingTests
+{
+	struct FAlgorithm
+	{
+		const TCHAR* Description;
+		EStreetMapRouteAlgorithm Algorithm;
+	};
+
+	/** Every search.  The street map must have a contraction hierarchy, or the last one quietly falls back to A*. */
+	static const FAlgorithm Algorithms[] =
+	{
+		{ TEXT( "A*" ), EStreetMapRouteAlgorithm::AStar },
+		{ TEXT( "Bidirectional Dijkstra" ), EStreetMapRouteAlgorithm::BidirectionalDijkstra },
+		{ TEXT( "Contraction hierarchy" ), EStreetMapRouteAlgorithm::ContractionHierarchy },
+	};
+
+	/** Picks random pairs of nodes to route between */
+	static TArray<TPair<int32, int32>> MakeRandomNodePairs( const UStreetMap& StreetMap, const int32 NumPairs, const int32 Seed )
+	{
+		FRandomStream RandomStream( Seed );
+		TArray<TPair<int32, int32>> NodePairs;
+		for( int32 PairIndex = 0; PairIndex < NumPairs; ++PairIndex )
+		{
+			NodePairs.Emplace( RandomStream.RandHelper( StreetMap.GetNodes().Num() ), RandomStream.RandHelper( StreetMap.GetNodes().Num() ) );
+		}
+		return NodePairs;
+	}
+
+	/** Checks that a route runs from one node to the other along the roads it says it follows.  Returns an error, or an empty string. */
+	static FString ValidateRoute( const UStreetMap& StreetMap, const FStreetMapRoute& Route, const int32 StartNodeIndex, const int32 EndNodeIndex )
+	{
+		if( Route.NodeIndices.Num() == 0 || Route.NodeIndices[ 0 ] != StartNodeIndex || Route.NodeIndices.Last() != EndNodeIndex )
+		{
+			return TEXT( "doesn't start and end at the right nodes" );
+		}
+		if( Route.Steps.Num() != Route.NodeIndices.Num() - 1 )
+		{
+			return FString::Printf( TEXT( "has %i steps between %i nodes" ), Route.Steps.Num(), Route.NodeIndices.Num() );
+		}
+
+		for( int32 StepIndex = 0; StepIndex < Route.Steps.Num(); ++StepIndex )
+		{
+			const FStreetMapRouteStep& Step = Route.Steps[ StepIndex ];
+			const FStreetMapRoad& Road = StreetMap.GetRoads()[ Step.RoadIndex ];
+			if( Road.NodeIndices[ Step.FromPointIndexOnRoad ] != Route.NodeIndices[ StepIndex ] || Road.NodeIndices[ Step.ToPointIndexOnRoad ] != Route.NodeIndices[ StepIndex + 1 ] )
+			{
+				return FString::Printf( TEXT( "step %i doesn't follow road %i between its nodes" ), StepIndex, Step.RoadIndex );
+			}
+			if( Road.IsOneWay() && Step.ToPointIndexOnRoad < Step.FromPointIndexOnRoad )
+			{
+				return FString::Printf( TEXT( "step %i goes the wrong way up one way road %i" ), StepIndex, Step.RoadIndex );
+			}
+		}
+
+		return FString();
+	}
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FStreetMapRoutingTest, "StreetMap.Runtime.Routing.FindRoute", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter )
+
+bool FStreetMapRoutingTest::RunTest( const FString& Parameters )
+{
+	using namespace StreetMapRoutingTests;
+
+	UStreetMap& StreetMap = *StreetMapTestGrid::MakeGridStreetMap( 24, 24, 10000.0f );
+	StreetMap.BuildContractionHierarchy();
+	TestTrue( TEXT( "Has a contraction hierarchy" ), StreetMap.HasContractionHierarchy() );
+	const FStreetMapRoadGraph& Graph = StreetMap.GetRoadGraph();
+
+	// Random routes, plus one that goes nowhere
+	TArray<TPair<int32, int32>> NodePairs = MakeRandomNodePairs( StreetMap, 200, 1 );
+	NodePairs.Emplace( 100, 100 );
+
+	for( const FAlgorithm& Algorithm : Algorithms )
+	{
+		int32 NumMismatches = 0;
+		int32 NumOneWaySteps = 0;
+		for( const TPair<int32, int32>& NodePair : NodePairs )
+		{
+			const float ExpectedCost = StreetMapTestGrid::FindRouteCostWithDijkstra( Graph, NodePair.Key, NodePair.Value );
+
+			FStreetMapRoute Route;
+			const bool bFoundRoute = StreetMap.FindRoute( NodePair.Key, NodePair.Value, Route, Algorithm.Algorithm );
+
+			FString Error;
+			if( !bFoundRoute )
+			{
+				Error = TEXT( "wasn't found" );
+			}
+			else if( !StreetMapTestGrid::IsSameRouteCost( Route.Cost, ExpectedCost ) )
+			{
+				Error = FString::Printf( TEXT( "costs %.2f, expected %.2f" ), Route.Cost, ExpectedCost );
+			}
+			else
+			{
+				Error = ValidateRoute( StreetMap, Route, NodePair.Key, NodePair.Value );
+			}
+
+			for( const FStreetMapRouteStep& Step : Route.Steps )
+			{
+				NumOneWaySteps += StreetMap.GetRoads()[ Step.RoadIndex ].IsOneWay() ? 1 : 0;
+			}
+
+			// Only report the first few, so that one bug doesn't bury the log
+			if( !Error.IsEmpty() && NumMismatches++ < 10 )
+			{
+				AddError( FString::Printf( TEXT( "%s: Route from node %i to %i %s" ), Algorithm.Description, NodePair.Key, NodePair.Value, *Error ) );
+			}
+		}
+
+		TestEqual( *FString::Printf( TEXT( "%s: Bad routes" ), Algorithm.Description ), NumMismatches, 0 );
+
+		// Make sure one way roads were actually put to the test
+		TestTrue( *FString::Printf( TEXT( "%s: Some routes follow one way roads" ), Algorithm.Description ), NumOneWaySteps > 0 );
+	}
+
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FStreetMapStaleContractionHierarchyTest, "StreetMap.Runtime.Routing.StaleContractionHierarchy", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter )
+
+bool FStreetMapStaleContractionHierarchyTest::RunTest( const FString& Parameters )
+{
+	UStreetMap& StreetMap = *StreetMapTestGrid::MakeGridStreetMap( 8, 8, 10000.0f );
+	StreetMap.BuildContractionHierarchy();
+	TestTrue( TEXT( "Has a contraction hierarchy once it's built" ), StreetMap.HasContractionHierarchy() );
+
+	// Upgrade a street to a highway.  The map has just as many nodes as before, but routes cost less along that road now.
+	FStreetMapRoad& Road = StreetMap.GetRoads()[ 3 ];
+	TestTrue( TEXT( "Upgrading a street" ), Road.RoadType == EStreetMapRoadType::Street );
+	Road.RoadType = EStreetMapRoadType::Highway;
+	StreetMap.BuildRoadGraph();
+	TestFalse( TEXT( "Has a contraction hierarchy after the roads changed" ), StreetMap.HasContractionHierarchy() );
+
+	// Until the hierarchy is rebuilt, routes are found without it
+	const int32 StartNodeIndex = StreetMapTestGrid::GetGridNodeIndex( 8, 0, 3 );
+	const int32 EndNodeIndex = StreetMapTestGrid::GetGridNodeIndex( 8, 7, 3 );
+	const float ExpectedCost = StreetMapTestGrid::FindRouteCostWithDijkstra( StreetMap.GetRoadGraph(), StartNodeIndex, EndNodeIndex );
+	FStreetMapRoute Route;
+	TestTrue( TEXT( "Found a route along the new highway" ), StreetMap.FindRoute( StartNodeIndex, EndNodeIndex, Route, EStreetMapRouteAlgorithm::ContractionHierarchy ) && StreetMapTestGrid::IsSameRouteCost( Route.Cost, ExpectedCost ) );
+
+	StreetMap.BuildContractionHierarchy();
+	TestTrue( TEXT( "Has a contraction hierarchy once it's rebuilt" ), StreetMap.HasContractionHierarchy() );
+	TestTrue( TEXT( "Found a route along the new highway with the rebuilt hierarchy" ), StreetMap.FindRoute( StartNodeIndex, EndNodeIndex, Route, EStreetMapRouteAlgorithm::ContractionHierarchy ) && StreetMapTestGrid::IsSameRouteCost( Route.Cost, ExpectedCost ) );
+
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FStreetMapRoutingBenchmark, "StreetMap.Runtime.Routing.Benchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter )
+
+bool FStreetMapRoutingBenchmark::RunTest( const FString& Parameters )
+{
+	using namespace StreetMapRoutingTests;
+
+	// About as many intersections as a large city
+	UStreetMap& StreetMap = *StreetMapTestGrid::MakeGridStreetMap( 200, 200, 10000.0f );
+	const FStreetMapRoadGraph& Graph = StreetMap.GetRoadGraph();
+	const TArray<TPair<int32, int32>> NodePairs = MakeRandomNodePairs( StreetMap, 500, 2 );
+
+	const double BuildStartTime = FPlatformTime::Seconds();
+	StreetMap.BuildContractionHierarchy();
+	const double BuildSeconds = FPlatformTime::Seconds() - BuildStartTime;
+	TestTrue( TEXT( "Has a contraction hierarchy" ), StreetMap.HasContractionHierarchy() );
+
+	TArray<float> ExpectedCosts;
+	const double DijkstraStartTime = FPlatformTime::Seconds();
+	for( const TPair<int32, int32>& NodePair : NodePairs )
+	{
+		ExpectedCosts.Add( StreetMapTestGrid::FindRouteCostWithDijkstra( Graph, NodePair.Key, NodePair.Value ) );
+	}
+	const double DijkstraSeconds = FPlatformTime::Seconds() - DijkstraStartTime;
+
+	AddInfo( FString::Printf( TEXT( "%i nodes, %i routes" ), Graph.GetNumNodes(), NodePairs.Num() ) );
+	AddInfo( FString::Printf( TEXT( "Built the contraction hierarchy in %.2f s" ), BuildSeconds ) );
+	AddInfo( FString::Printf( TEXT( "Dijkstra: %.1f us per route" ), DijkstraSeconds * 1e6 / NodePairs.Num() ) );
+
+	for( const FAlgorithm& Algorithm : Algorithms )
+	{
+		TArray<float> Costs;
+		FStreetMapRoute Route;
+		const double StartTime = FPlatformTime::Seconds();
+		for( const TPair<int32, int32>& NodePair : NodePairs )
+		{
+			Costs.Add( StreetMap.FindRoute( NodePair.Key, NodePair.Value, Route, Algorithm.Algorithm ) ? Route.Cost : TNumericLimits<float>::Max() );
+		}
+		const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+		int32 NumMismatches = 0;
+		for( int32 PairIndex = 0; PairIndex < NodePairs.Num(); ++PairIndex )
+		{
+			NumMismatches += StreetMapTestGrid::IsSameRouteCost( Costs[ PairIndex ], ExpectedCosts[ PairIndex ] ) ? 0 : 1;
+		}
+		TestEqual( *FString::Printf( TEXT( "%s: Routes that cost more than Dijkstra's" ), Algorithm.Description ), NumMismatches, 0 );
+
+		AddInfo( FString::Printf( TEXT( "%s: %.1f us per route (%.2fx Dijkstra)" ), Algorithm.Description, Seconds * 1e6 / NodePairs.Num(), DijkstraSeconds / FMath::Max( Seconds, 1e-9 ) ) );
+	}
+
+	return true;
+}
+
+
+#endif	// WITH_DEV_AUTOMATION_TESTS
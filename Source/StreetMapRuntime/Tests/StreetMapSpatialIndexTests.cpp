@@ -0,0 +1,325 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapRuntime.h"
+#include "StreetMap.h"
+#include "StreetMapTestGrid.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+namespace StreetMapSpatialIndexTests
+{
+	/** Distance from a location to the nearest point on a road segment */
+	static float ComputeDistanceToRoadSegment( const FStreetMapRoad& Road, const int32 PointIndex, const FVector2D& Location )
+	{
+		return FVector2D::Distance( Location, FMath::ClosestPointOnSegment2D( Location, Road.RoadPoints[ PointIndex ], Road.RoadPoints[ PointIndex + 1 ] ) );
+	}
+
+	/** Finds how far the nearest road is by checking every segment of every road */
+	static float FindNearestRoadDistanceWithLinearScan( const UStreetMap& StreetMap, const FVector2D& Location )
+	{
+		float NearestDistance = TNumericLimits<float>::Max();
+		for( const FStreetMapRoad& Road : StreetMap.GetRoads() )
+		{
+			for( int32 PointIndex = 0; PointIndex + 1 < Road.RoadPoints.Num(); ++PointIndex )
+			{
+				NearestDistance = FMath::Min( NearestDistance, ComputeDistanceToRoadSegment( Road, PointIndex, Location ) );
+			}
+		}
+		return NearestDistance;
+	}
+
+	/** Finds how far each of the nearest roads are, nearest first, by checking every segment of every road */
+	static void FindNearestRoadDistancesWithLinearScan( const UStreetMap& StreetMap, const FVector2D& Location, const float MaxDistance, const int32 MaxRoads, TArray<float>& OutDistances )
+	{
+		OutDistances.Reset();
+		for( const FStreetMapRoad& Road : StreetMap.GetRoads() )
+		{
+			float NearestDistance = TNumericLimits<float>::Max();
+			for( int32 PointIndex = 0; PointIndex + 1 < Road.RoadPoints.Num(); ++PointIndex )
+			{
+				NearestDistance = FMath::Min( NearestDistance, ComputeDistanceToRoadSegment( Road, PointIndex, Location ) );
+			}
+			if( NearestDistance <= MaxDistance )
+			{
+				OutDistances.Add( NearestDistance );
+			}
+		}
+		OutDistances.Sort();
+		OutDistances.SetNum( FMath::Min( MaxRoads, OutDistances.Num() ) );
+	}
+
+	/** Finds how far each of the nearest nodes are, nearest first, by checking every node */
+	static void FindNearestNodeDistancesWithLinearScan( const UStreetMap& StreetMap, const FVector2D& Location, const int32 MaxNodes, TArray<float>& OutDistances )
+	{
+		OutDistances.Reset();
+		for( const FStreetMapNode& Node : StreetMap.GetNodes() )
+		{
+			OutDistances.Add( FVector2D::Distance( Location, Node.GetLocation( StreetMap ) ) );
+		}
+		OutDistances.Sort();
+		OutDistances.SetNum( FMath::Min( MaxNodes, OutDistances.Num() ) );
+	}
+
+	/** Finds every road that passes within a distance of a location by checking every segment of every road */
+	static void FindRoadsInRadiusWithLinearScan( const UStreetMap& StreetMap, const FVector2D& Center, const float Radius, TArray<int32>& OutRoadIndices )
+	{
+		OutRoadIndices.Reset();
+		const TArray<FStreetMapRoad>& Roads = StreetMap.GetRoads();
+		for( int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex )
+		{
+			for( int32 PointIndex = 0; PointIndex + 1 < Roads[ RoadIndex ].RoadPoints.Num(); ++PointIndex )
+			{
+				if( ComputeDistanceToRoadSegment( Roads[ RoadIndex ], PointIndex, Center ) <= Radius )
+				{
+					OutRoadIndices.Add( RoadIndex );
+					break;
+				}
+			}
+		}
+	}
+
+	/** Finds every road that passes through a box by checking every segment of every road */
+	static void FindRoadsInBoxWithLinearScan( const UStreetMap& StreetMap, const FBox2D& Box, TArray<int32>& OutRoadIndices )
+	{
+		OutRoadIndices.Reset();
+		const FBox Box3D( FVector( Box.Min, -1.0f ), FVector( Box.Max, 1.0f ) );
+		const TArray<FStreetMapRoad>& Roads = StreetMap.GetRoads();
+		for( int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex )
+		{
+			for( int32 PointIndex = 0; PointIndex + 1 < Roads[ RoadIndex ].RoadPoints.Num(); ++PointIndex )
+			{
+				const FVector Start( Roads[ RoadIndex ].RoadPoints[ PointIndex ], 0.0f );
+				const FVector End( Roads[ RoadIndex ].RoadPoints[ PointIndex + 1 ], 0.0f );
+				if( Box.IsInside( FVector2D( Start ) ) || FMath::LineBoxIntersection( Box3D, Start, End, End - Start ) )
+				{
+					OutRoadIndices.Add( RoadIndex );
+					break;
+				}
+			}
+		}
+	}
+
+	/** Finds every building whose bounds overlap a box by checking every building */
+	static void FindBuildingsInBoxWithLinearScan( const UStreetMap& StreetMap, const FBox2D& Box, TArray<int32>& OutBuildingIndices )
+	{
+		OutBuildingIndices.Reset();
+		const TArray<FStreetMapBuilding>& Buildings = StreetMap.GetBuildings();
+		for( int32 BuildingIndex = 0; BuildingIndex < Buildings.Num(); ++BuildingIndex )
+		{
+			if( FBox2D( Buildings[ BuildingIndex ].BoundsMin, Buildings[ BuildingIndex ].BoundsMax ).Intersect( Box ) )
+			{
+				OutBuildingIndices.Add( BuildingIndex );
+			}
+		}
+	}
+
+	/** Picks random places to search around, including some off the edges of the map */
+	static TArray<FVector2D> MakeRandomLocations( const int32 NumColumns, const int32 NumRows, const float BlockSize, const int32 NumLocations, const int32 Seed )
+	{
+		FRandomStream RandomStream( Seed );
+		TArray<FVector2D> Locations;
+		for( int32 LocationIndex = 0; LocationIndex < NumLocations; ++LocationIndex )
+		{
+			Locations.Emplace( RandomStream.FRandRange( -1.0f, NumColumns ) * BlockSize, RandomStream.FRandRange( -1.0f, NumRows ) * BlockSize );
+		}
+		return Locations;
+	}
+
+	/** Returns true if two lists of indices hold the same indices, in any order */
+	static bool IsSameIndices( TArray<int32> Indices, TArray<int32> ExpectedIndices )
+	{
+		Indices.Sort();
+		ExpectedIndices.Sort();
+		return Indices == ExpectedIndices;
+	}
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FStreetMapSpatialIndexTest, "StreetMap.Runtime.SpatialIndex.Queries", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter )
+
+bool FStreetMapSpatialIndexTest::RunTest( const FString& Parameters )
+{
+	using namespace StreetMapSpatialIndexTests;
+
+	const int32 GridSize = 24;
+	const float BlockSize = 10000.0f;
+	const UStreetMap& StreetMap = *StreetMapTestGrid::MakeGridStreetMap( GridSize, GridSize, BlockSize );
+	const FStreetMapSpatialIndex& SpatialIndex = StreetMap.GetSpatialIndex();
+
+	// Every query must find the same things as checking everything in the map
+	int32 NumMismatches = 0;
+	auto CheckQuery = [&]( const bool bIsSame, const TCHAR* Query, const FVector2D& Location )
+	{
+		// Only report the first few, so that one bug doesn't bury the log
+		if( !bIsSame && NumMismatches++ < 10 )
+		{
+			AddError( FString::Printf( TEXT( "%s around %s doesn't match a linear scan" ), Query, *Location.ToString() ) );
+		}
+	};
+
+	const float Radius = BlockSize * 0.75f;
+	const int32 MaxNodes = 8;
+	const int32 MaxRoads = 3;
+	TArray<int32> Indices, ExpectedIndices;
+	TArray<float> ExpectedDistances;
+	for( const FVector2D& Location : MakeRandomLocations( GridSize, GridSize, BlockSize, 500, 3 ) )
+	{
+		// Ties can come out either way, so compare distances rather than which road or node was found
+		FStreetMapRoadSegmentHit Hit;
+		const bool bFoundRoad = SpatialIndex.FindNearestRoadSegment( StreetMap, Location, TNumericLimits<float>::Max(), Hit );
+		const float ExpectedDistance = FindNearestRoadDistanceWithLinearScan( StreetMap, Location );
+		CheckQuery( bFoundRoad && FMath::IsNearlyEqual( Hit.Distance, ExpectedDistance, 0.1f ) && FMath::IsNearlyEqual( FVector2D::Distance( Location, Hit.Location ), Hit.Distance, 0.1f ), TEXT( "FindNearestRoadSegment" ), Location );
+
+		// Each road once, at its nearest segment
+		TArray<FStreetMapRoadSegmentHit> Hits;
+		SpatialIndex.FindNearestRoads( StreetMap, Location, Radius, MaxRoads, Hits );
+		FindNearestRoadDistancesWithLinearScan( StreetMap, Location, Radius, MaxRoads, ExpectedDistances );
+		bool bIsSameRoads = Hits.Num() == ExpectedDistances.Num();
+		for( int32 Index = 0; bIsSameRoads && Index < Hits.Num(); ++Index )
+		{
+			bIsSameRoads = FMath::IsNearlyEqual( Hits[ Index ].Distance, ExpectedDistances[ Index ], 0.1f ) && !Hits.ContainsByPredicate( [&]( const FStreetMapRoadSegmentHit& Other ) { return &Other != &Hits[ Index ] && Other.RoadIndex == Hits[ Index ].RoadIndex; } );
+		}
+		CheckQuery( bIsSameRoads, TEXT( "FindNearestRoads" ), Location );
+
+		SpatialIndex.FindNearestNodes( Location, MaxNodes, TNumericLimits<float>::Max(), Indices );
+		FindNearestNodeDistancesWithLinearScan( StreetMap, Location, MaxNodes, ExpectedDistances );
+		bool bIsSameNodes = Indices.Num() == ExpectedDistances.Num();
+		for( int32 Index = 0; bIsSameNodes && Index < Indices.Num(); ++Index )
+		{
+			bIsSameNodes = FMath::IsNearlyEqual( FVector2D::Distance( Location, StreetMap.GetNodes()[ Indices[ Index ] ].GetLocation( StreetMap ) ), ExpectedDistances[ Index ], 0.1f );
+		}
+		CheckQuery( bIsSameNodes, TEXT( "FindNearestNodes" ), Location );
+
+		SpatialIndex.FindRoadsInRadius( StreetMap, Location, Radius, Indices );
+		FindRoadsInRadiusWithLinearScan( StreetMap, Location, Radius, ExpectedIndices );
+		CheckQuery( IsSameIndices( Indices, ExpectedIndices ), TEXT( "FindRoadsInRadius" ), Location );
+
+		const FBox2D Box( Location, Location + FVector2D( 1.5f, 0.5f ) * BlockSize );
+		SpatialIndex.FindRoadsInBox( StreetMap, Box, Indices );
+		FindRoadsInBoxWithLinearScan( StreetMap, Box, ExpectedIndices );
+		CheckQuery( IsSameIndices( Indices, ExpectedIndices ), TEXT( "FindRoadsInBox" ), Location );
+
+		SpatialIndex.FindBuildingsInBox( Box, Indices );
+		FindBuildingsInBoxWithLinearScan( StreetMap, Box, ExpectedIndices );
+		CheckQuery( IsSameIndices( Indices, ExpectedIndices ), TEXT( "FindBuildingsInBox" ), Location );
+	}
+
+	TestEqual( TEXT( "Queries that don't match a linear scan" ), NumMismatches, 0 );
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FStreetMapSpatialIndexBenchmark, "StreetMap.Runtime.SpatialIndex.Benchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter )
+
+bool FStreetMapSpatialIndexBenchmark::RunTest( const FString& Parameters )
+{
+	using namespace StreetMapSpatialIndexTests;
+
+	const int32 GridSize = 200;
+	const float BlockSize = 10000.0f;
+	const UStreetMap& StreetMap = *StreetMapTestGrid::MakeGridStreetMap( GridSize, GridSize, BlockSize );
+	const FStreetMapSpatialIndex& SpatialIndex = StreetMap.GetSpatialIndex();
+	const TArray<FVector2D> Locations = MakeRandomLocations( GridSize, GridSize, BlockSize, 200, 4 );
+
+	AddInfo( FString::Printf( TEXT( "%i roads, %i nodes, %i buildings, %i queries of each kind" ), StreetMap.GetRoads().Num(), StreetMap.GetNodes().Num(), StreetMap.GetBuildings().Num(), Locations.Num() ) );
+
+	// Times a query with the index and with a linear scan, and checks that they agree
+	auto Compare = [&]( const TCHAR* Query, TFunctionRef<float( const FVector2D& )> QueryIndex, TFunctionRef<float( const FVector2D& )> QueryLinearScan )
+	{
+		TArray<float> Results, ExpectedResults;
+
+		const double IndexStartTime = FPlatformTime::Seconds();
+		for( const FVector2D& Location : Locations )
+		{
+			Results.Add( QueryIndex( Location ) );
+		}
+		const double IndexSeconds = FPlatformTime::Seconds() - IndexStartTime;
+
+		const double LinearStartTime = FPlatformTime::Seconds();
+		for( const FVector2D& Location : Locations )
+		{
+			ExpectedResults.Add( QueryLinearScan( Location ) );
+		}
+		const double LinearSeconds = FPlatformTime::Seconds() - LinearStartTime;
+
+		int32 NumMismatches = 0;
+		for( int32 LocationIndex = 0; LocationIndex < Locations.Num(); ++LocationIndex )
+		{
+			NumMismatches += FMath::IsNearlyEqual( Results[ LocationIndex ], ExpectedResults[ LocationIndex ], 0.1f ) ? 0 : 1;
+		}
+		TestEqual( *FString::Printf( TEXT( "%s: Queries that don't match a linear scan" ), Query ), NumMismatches, 0 );
+
+		AddInfo( FString::Printf( TEXT( "%s: %.2f us per query with the index, %.2f us with a linear scan (%.1fx)" ),
+			Query, IndexSeconds * 1e6 / Locations.Num(), LinearSeconds * 1e6 / Locations.Num(), LinearSeconds / FMath::Max( IndexSeconds, 1e-9 ) ) );
+	};
+
+	// Each query is boiled down to a number to compare: how far away the nearest thing is, or how many things were found
+	TArray<int32> Indices;
+	TArray<float> Distances;
+
+	Compare( TEXT( "FindNearestRoadSegment" ),
+		[&]( const FVector2D& Location )
+		{
+			FStreetMapRoadSegmentHit Hit;
+			return SpatialIndex.FindNearestRoadSegment( StreetMap, Location, TNumericLimits<float>::Max(), Hit ) ? Hit.Distance : -1.0f;
+		},
+		[&]( const FVector2D& Location )
+		{
+			return FindNearestRoadDistanceWithLinearScan( StreetMap, Location );
+		} );
+
+	Compare( TEXT( "FindNearestNodes" ),
+		[&]( const FVector2D& Location )
+		{
+			SpatialIndex.FindNearestNodes( Location, 8, TNumericLimits<float>::Max(), Indices );
+			return FVector2D::Distance( Location, StreetMap.GetNodes()[ Indices.Last() ].GetLocation( StreetMap ) );
+		},
+		[&]( const FVector2D& Location )
+		{
+			FindNearestNodeDistancesWithLinearScan( StreetMap, Location, 8, Distances );
+			return Distances.Last();
+		} );
+
+	Compare( TEXT( "FindRoadsInRadius" ),
+		[&]( const FVector2D& Location )
+		{
+			SpatialIndex.FindRoadsInRadius( StreetMap, Location, BlockSize * 2.0f, Indices );
+			return float( Indices.Num() );
+		},
+		[&]( const FVector2D& Location )
+		{
+			FindRoadsInRadiusWithLinearScan( StreetMap, Location, BlockSize * 2.0f, Indices );
+			return float( Indices.Num() );
+		} );
+
+	Compare( TEXT( "FindRoadsInBox" ),
+		[&]( const FVector2D& Location )
+		{
+			SpatialIndex.FindRoadsInBox( StreetMap, FBox2D( Location, Location + FVector2D( BlockSize * 3.0f, BlockSize * 2.0f ) ), Indices );
+			return float( Indices.Num() );
+		},
+		[&]( const FVector2D& Location )
+		{
+			FindRoadsInBoxWithLinearScan( StreetMap, FBox2D( Location, Location + FVector2D( BlockSize * 3.0f, BlockSize * 2.0f ) ), Indices );
+			return float( Indices.Num() );
+		} );
+
+	Compare( TEXT( "FindBuildingsInBox" ),
+		[&]( const FVector2D& Location )
+		{
+			SpatialIndex.FindBuildingsInBox( FBox2D( Location, Location + FVector2D( BlockSize * 3.0f, BlockSize * 2.0f ) ), Indices );
+			return float( Indices.Num() );
+		},
+		[&]( const FVector2D& Location )
+		{
+			FindBuildingsInBoxWithLinearScan( StreetMap, FBox2D( Location, Location + FVector2D( BlockSize * 3.0f, BlockSize * 2.0f ) ), Indices );
+			return float( Indices.Num() );
+		} );
+
+	return true;
+}
+
+
+#endif	// WITH_DEV_AUTOMATION_TESTS
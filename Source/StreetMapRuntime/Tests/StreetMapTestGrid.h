@@ -0,0 +1,195 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "StreetMapRuntime.h"
+#include "StreetMap.h"
+
+
+/** Street maps generated for automation tests and benchmarks, since the plugin doesn't ship with any map data */
+namespace StreetMapTestGrid
+{
+	/** Which node is at an intersection of a grid street map */
+	inline int32 GetGridNodeIndex( const int32 NumColumns, const int32 Column, const int32 Row )
+	{
+		return Row * NumColumns + Column;
+	}
+
+	/**
+	 * Makes a street map of a city grid, with NumColumns by NumRows intersections that are BlockSize apart.  Every row and
+	 * column is a single road that runs the whole way across, with a bend halfway along each block, and the intersections
+	 * are nudged about so that routes rarely cost exactly the same.  Every tenth road is a highway and every fifth is a major
+	 * road.  Every third row is one way, in alternating directions, so every intersection can still be reached from every
+	 * other one.  There is a building in the middle of every block.  The road graph and the spatial index are built.
+	 */
+	inline UStreetMap* MakeGridStreetMap( const int32 NumColumns, const int32 NumRows, const float BlockSize, const int32 Seed = 0 )
+	{
+		UStreetMap* StreetMap = NewObject<UStreetMap>();
+		TArray<FStreetMapRoad>& Roads = StreetMap->GetRoads();
+		TArray<FStreetMapNode>& Nodes = StreetMap->GetNodes();
+		TArray<FStreetMapBuilding>& Buildings = StreetMap->GetBuildings();
+
+		FRandomStream RandomStream( Seed );
+		TArray<FVector2D> IntersectionLocations;
+		IntersectionLocations.SetNumUninitialized( NumColumns * NumRows );
+		for( int32 Row = 0; Row < NumRows; ++Row )
+		{
+			for( int32 Column = 0; Column < NumColumns; ++Column )
+			{
+				const FVector2D Nudge( RandomStream.FRandRange( -0.15f, 0.15f ), RandomStream.FRandRange( -0.15f, 0.15f ) );
+				IntersectionLocations[ GetGridNodeIndex( NumColumns, Column, Row ) ] = FVector2D( Column + Nudge.X, Row + Nudge.Y ) * BlockSize;
+			}
+		}
+
+		Nodes.SetNum( NumColumns * NumRows );
+
+		// Adds a road through a line of intersections, in order, with a bend between every two of them
+		auto AddRoad = [&]( const TArray<int32>& IntersectionNodeIndices, const EStreetMapRoadType RoadType, const bool bIsOneWay )
+		{
+			const int32 RoadIndex = Roads.Num();
+			FStreetMapRoad& Road = Roads[ Roads.AddDefaulted() ];
+			Road.RoadType = RoadType;
+			Road.bIsOneWay = bIsOneWay ? 1 : 0;
+
+			for( int32 Index = 0; Index < IntersectionNodeIndices.Num(); ++Index )
+			{
+				const int32 NodeIndex = IntersectionNodeIndices[ Index ];
+				const FVector2D& Location = IntersectionLocations[ NodeIndex ];
+
+				FStreetMapRoadRef& RoadRef = Nodes[ NodeIndex ].RoadRefs[ Nodes[ NodeIndex ].RoadRefs.AddDefaulted() ];
+				RoadRef.RoadIndex = RoadIndex;
+				RoadRef.RoadPointIndex = Road.RoadPoints.Num();
+				Road.RoadPoints.Add( Location );
+				Road.NodeIndices.Add( NodeIndex );
+
+				if( Index + 1 < IntersectionNodeIndices.Num() )
+				{
+					const FVector2D NextLocation = IntersectionLocations[ IntersectionNodeIndices[ Index + 1 ] ];
+					const FVector2D Side = FVector2D( Location.Y - NextLocation.Y, NextLocation.X - Location.X ).GetSafeNormal();
+					Road.RoadPoints.Add( ( Location + NextLocation ) * 0.5f + Side * RandomStream.FRandRange( -0.1f, 0.1f ) * BlockSize );
+					Road.NodeIndices.Add( INDEX_NONE );
+				}
+			}
+
+			Road.BoundsMin = Road.BoundsMax = Road.RoadPoints[ 0 ];
+			for( const FVector2D& RoadPoint : Road.RoadPoints )
+			{
+				Road.BoundsMin = FVector2D::Min( Road.BoundsMin, RoadPoint );
+				Road.BoundsMax = FVector2D::Max( Road.BoundsMax, RoadPoint );
+			}
+		};
+
+		auto GetRoadType = []( const int32 LineIndex ) -> EStreetMapRoadType
+		{
+			return LineIndex % 10 == 0 ? EStreetMapRoadType::Highway : ( LineIndex % 5 == 0 ? EStreetMapRoadType::MajorRoad : EStreetMapRoadType::Street );
+		};
+
+		TArray<int32> IntersectionNodeIndices;
+		for( int32 Row = 0; Row < NumRows; ++Row )
+		{
+			const bool bIsOneWay = Row % 3 == 1;
+			const bool bRunsBackward = bIsOneWay && ( Row / 3 ) % 2 == 1;
+			IntersectionNodeIndices.Reset();
+			for( int32 Column = 0; Column < NumColumns; ++Column )
+			{
+				IntersectionNodeIndices.Add( GetGridNodeIndex( NumColumns, bRunsBackward ? NumColumns - 1 - Column : Column, Row ) );
+			}
+			AddRoad( IntersectionNodeIndices, GetRoadType( Row ), bIsOneWay );
+		}
+		for( int32 Column = 0; Column < NumColumns; ++Column )
+		{
+			IntersectionNodeIndices.Reset();
+			for( int32 Row = 0; Row < NumRows; ++Row )
+			{
+				IntersectionNodeIndices.Add( GetGridNodeIndex( NumColumns, Column, Row ) );
+			}
+			AddRoad( IntersectionNodeIndices, GetRoadType( Column ), false );
+		}
+
+		// A square building in the middle of every block
+		for( int32 Row = 0; Row + 1 < NumRows; ++Row )
+		{
+			for( int32 Column = 0; Column + 1 < NumColumns; ++Column )
+			{
+				const FVector2D Center = FVector2D( Column + 0.5f, Row + 0.5f ) * BlockSize;
+				const float HalfSize = BlockSize * 0.25f;
+
+				FStreetMapBuilding& Building = Buildings[ Buildings.AddDefaulted() ];
+				Building.BuildingPoints.Add( Center + FVector2D( -HalfSize, -HalfSize ) );
+				Building.BuildingPoints.Add( Center + FVector2D( HalfSize, -HalfSize ) );
+				Building.BuildingPoints.Add( Center + FVector2D( HalfSize, HalfSize ) );
+				Building.BuildingPoints.Add( Center + FVector2D( -HalfSize, HalfSize ) );
+				Building.BoundsMin = Center - FVector2D( HalfSize, HalfSize );
+				Building.BoundsMax = Center + FVector2D( HalfSize, HalfSize );
+				Building.Height = 0.0f;
+				Building.BuildingLevels = 0;
+				Building.bWindsClockwise = 0;
+				Building.bIsTriangulated = 0;
+			}
+		}
+
+		StreetMap->BuildRoadGraph();
+		StreetMap->BuildSpatialIndex();
+		return StreetMap;
+	}
+
+	/**
+	 * Finds the cost of the cheapest route between two nodes with a plain Dijkstra search over the road graph, to check
+	 * faster searches against.  Returns the largest float if there is no route.
+	 */
+	inline float FindRouteCostWithDijkstra( const FStreetMapRoadGraph& Graph, const int32 StartNodeIndex, const int32 EndNodeIndex )
+	{
+		struct FQueuedNode
+		{
+			float Cost;
+			int32 NodeIndex;
+
+			bool operator<( const FQueuedNode& Other ) const
+			{
+				return Cost < Other.Cost;
+			}
+		};
+
+		TArray<float> Costs;
+		Costs.Init( TNumericLimits<float>::Max(), Graph.GetNumNodes() );
+		TArray<FQueuedNode> Queue;
+
+		Costs[ StartNodeIndex ] = 0.0f;
+		Queue.HeapPush( FQueuedNode{ 0.0f, StartNodeIndex } );
+		while( Queue.Num() > 0 )
+		{
+			FQueuedNode QueuedNode;
+			Queue.HeapPop( QueuedNode, /* bAllowShrinking */ false );
+			if( QueuedNode.NodeIndex == EndNodeIndex )
+			{
+				return QueuedNode.Cost;
+			}
+			if( QueuedNode.Cost > Costs[ QueuedNode.NodeIndex ] )
+			{
+				// Already settled more cheaply
+				continue;
+			}
+
+			for( const FStreetMapRoadGraphEdge& Edge : Graph.GetEdges( QueuedNode.NodeIndex, true ) )
+			{
+				const float NewCost = QueuedNode.Cost + Edge.Cost;
+				if( NewCost < Costs[ Edge.NodeIndex ] )
+				{
+					Costs[ Edge.NodeIndex ] = NewCost;
+					Queue.HeapPush( FQueuedNode{ NewCost, Edge.NodeIndex } );
+				}
+			}
+		}
+
+		return TNumericLimits<float>::Max();
+	}
+
+	/** Checks that two route costs are the same, give or take the rounding of adding up costs in a different order */
+	inline bool IsSameRouteCost( const float Cost, const float ExpectedCost )
+	{
+		if( ExpectedCost == TNumericLimits<float>::Max() || Cost == TNumericLimits<float>::Max() )
+		{
+			return Cost == ExpectedCost;
+		}
+		return FMath::Abs( Cost - ExpectedCost ) <= FMath::Max( 1.0f, ExpectedCost * 1e-4f );
+	}
+}